@@ -51,6 +51,7 @@ constexpr int ee_grow_arrays          = 8;
 constexpr int ee_grow_faces           = 256;
 constexpr int ee_max_special          = 8;
 constexpr int ee_max_default_exts     = 4;	// max default extensions per module
+constexpr int ee_max_vertex_elements  = 16;	// attributes per exported vertex
 
 // types
 using ub8_t = unsigned char;
@@ -58,8 +59,13 @@ using vec_t = float;
 using vec2_t = float[2];
 using vec3_t = float[3];
 using vec4_t = float[4];
+using mat4_t = float[16];   /* column major, translation in [ 12 ], [ 13 ], [ 14 ] */
 using color_t = pmm::ub8_t[4];
 using index_t = int;
+using qvec3_t = unsigned short[3];   /* position quantized in a box, see compact_vertexes_t */
+using oct_t = short[2];              /* unit vector, octahedral snorm16 */
+using snorm4_t = short[4];
+using half2_t = unsigned short[2];   /* ieee half floats */
 using size_type = decltype(sizeof 0);
 
 enum surface_type
@@ -69,6 +75,35 @@ enum surface_type
 	st_patch
 };
 
+/* optional vertex streams of a surface, see pp_get_surface_attributes */
+enum surface_attribute
+{
+	sa_st               = 1,
+	sa_color            = 2,
+	sa_smoothing_group  = 4,
+	sa_tangent          = 8
+};
+
+/* attributes of an exported vertex */
+enum vertex_attribute
+{
+	va_position,                                /* xyz */
+	va_normal,
+	va_tangent,                                 /* w = bitangent sign */
+	va_st,                                      /* st[ set ] */
+	va_color                                    /* color[ set ], rgba */
+};
+
+/* storage of an exported attribute */
+enum vertex_format
+{
+	vf_float32,
+	vf_float16,
+	vf_unorm8,                                  /* [ 0, 1 ] -> 0..255, colors as they are */
+	vf_snorm16,                                 /* [ -1, 1 ] -> -32767..32767 */
+	vf_oct16                                    /* unit vector as two snorm16 octahedral coordinates */
+};
+
 enum print_level
 {
 	pl_normal,
@@ -78,10 +113,36 @@ enum print_level
 	pl_fatal
 };
 
+class bounds_t;
 class surface_t;
 class shader_t;
 class model_t;
 class module_t;
+class pp_vertex_index_t;
+class pp_shader_index_t;
+class pp_surface_index_t;
+class meshlet_t;
+class meshlets_t;
+class ray_hit_t;
+class bvh_t;
+class vertex_element_t;
+class vertex_layout_t;
+class draw_range_t;
+class flat_model_t;
+class compact_vertexes_t;
+class load_options_t;
+class model_info_t;
+class load_job_t;
+
+/* axis aligned box and bounding sphere of a surface or frame. the */
+/* box is inverted ( mins > maxs ) when there is nothing inside it */
+class bounds_t
+{
+public:
+	pmm::vec3_t mins, maxs;
+	pmm::vec3_t center;
+	pmm::vec_t radius;
+};
 
 class surface_t
 {
@@ -97,7 +158,8 @@ public:
 	int numVertexes, maxVertexes;
 	pmm::vec3_t                  *xyz;
 	pmm::vec3_t                  *normal;
-	pmm::index_t                 *smoothingGroup;
+	pmm::index_t                 *smoothingGroup; /* nullptr until a vertex gets a group other than 0 */
+	pmm::vec4_t                  *tangent;       /* xyz tangent, w bitangent sign; filled by pp_generate_tangents */
 
 	int numSTArrays, maxSTArrays;
 	pmm::vec2_t                  **st;
@@ -110,8 +172,28 @@ public:
 
 	int numFaceNormals, maxFaceNormals;
 	pmm::vec3_t                  *faceNormal;
+	pmm::vec_t                   *faceDist;      /* plane distance of each face normal */
 
 	int special[ pmm::ee_max_special ];
+
+	pmm::pp_vertex_index_t       *vertexIndex;   /* hashed vertex pool, built lazily by pp_find_surface_vertex_num */
+
+	pmm::bounds_t bounds;                        /* set by pp_calc_model_bounds at the end of a load */
+
+	pmm::compact_vertexes_t      *compact;       /* set by pp_compact_surface, xyz, normal, tangent and st[] are nullptr then */
+};
+
+/* quantized vertexes of a compacted surface, one allocation: */
+/* xyz = origin + q * scale, normals octahedral, sts half floats */
+class compact_vertexes_t
+{
+public:
+	pmm::vec3_t origin, scale;
+	pmm::qvec3_t                 *xyz;
+	pmm::oct_t                   *normal;
+	pmm::snorm4_t                *tangent;       /* nullptr if the surface had none */
+	int numSTArrays;
+	pmm::half2_t                 **st;
 };
 
 /* seaw0lf */
@@ -139,6 +221,7 @@ public:
 	int numFrames;                              /* sea: number of frames */
 	pmm::vec3_t mins;
 	pmm::vec3_t maxs;
+	pmm::bounds_t                *frameBounds;   /* numFrames entries from animated formats, else nullptr */
 
 	int num_shaders, maxShaders;
 	pmm::shader_t                **shader;
@@ -147,6 +230,100 @@ public:
 	pmm::surface_t               **surface;
 
 	const pmm::module_t          *module;        /* sea */
+
+	pmm::pp_shader_index_t       *shaderIndex;   /* name -> shader, built lazily by pp_find_shader */
+	pmm::pp_surface_index_t      *surfaceIndex;  /* name/shader -> surface, built lazily by pp_find_surface and pp_add_triangle_to_model */
+};
+
+/* one cluster of a surface, built by pp_build_meshlets. a triangle */
+/* i of the cluster uses surface vertexes vertex[ firstVertex + */
+/* triangle[ ( firstTriangle + i ) * 3 + j ] ], j = 0..2 */
+class meshlet_t
+{
+public:
+	int firstVertex, numVertexes;               /* range in meshlets_t::vertex */
+	int firstTriangle, numTriangles;            /* range of triangles in meshlets_t::triangle */
+	pmm::vec3_t center;                          /* bounding sphere */
+	pmm::vec_t radius;
+	pmm::vec3_t coneApex;                        /* normal cone: the cluster faces away from any */
+	pmm::vec3_t coneAxis;                        /* eye where dot( normalize( coneApex - eye ), */
+	pmm::vec_t coneCutoff;                       /* coneAxis ) >= coneCutoff; 1 = never culled */
+};
+
+/* all clusters of a surface in one allocation, see pp_free_meshlets */
+class meshlets_t
+{
+public:
+	int numMeshlets;
+	pmm::meshlet_t               *meshlet;
+	int numVertexes;
+	pmm::index_t                 *vertex;        /* surface vertex numbers, one run per cluster */
+	int numTriangles;
+	pmm::ub8_t                   *triangle;      /* 3 cluster local vertex numbers per triangle */
+};
+
+/* ray hit returned by pp_ray_intersect: the hit point is */
+/* ( 1 - u - v ) * xyz0 + u * xyz1 + v * xyz2 of the triangle */
+class ray_hit_t
+{
+public:
+	int surface, triangle;                      /* model surface and triangle numbers, -1 = no hit */
+	pmm::vec_t t, u, v;                          /* distance along the ray in dir units, barycentrics */
+};
+
+/* one attribute of an exported vertex */
+class vertex_element_t
+{
+public:
+	pmm::vertex_attribute attribute;
+	int set;                                    /* st or color array number */
+	pmm::vertex_format format;
+	int components;                             /* 1..4; vf_oct16 always stores 2 */
+	int offset;                                 /* bytes from the start of the vertex */
+};
+
+/* interleaved vertex description for pp_export_vertex_buffer */
+class vertex_layout_t
+{
+public:
+	int numElements;
+	pmm::vertex_element_t element[ pmm::ee_max_vertex_elements ];
+	int stride;                                 /* bytes per vertex */
+};
+
+/* one draw of a flattened model: indexCount indexes from firstIndex, */
+/* each offset by baseVertex, all from surfaces using one shader */
+class draw_range_t
+{
+public:
+	pmm::shader_t                *shader;
+	int firstIndex, indexCount;
+	int baseVertex, numVertexes;
+	pmm::bounds_t bounds;
+};
+
+/* whole model in one vertex and one index buffer, see pp_free_flat_model */
+class flat_model_t
+{
+public:
+	int numRanges;
+	pmm::draw_range_t            *range;
+	int numVertexes, vertexSize;                /* vertexSize is the layout stride */
+	void                        *vertexes;
+	int numIndexes, indexSize;                  /* 2 or 4 bytes, relative to the range baseVertex */
+	void                        *indexes;
+};
+
+/* summary of a model file read from its headers, see pp_probe_model */
+class model_info_t
+{
+public:
+	const pmm::module_t          *module;        /* format of the file */
+	int numFrames;
+	int numSurfaces;
+	int numVertexes, numTriangles;              /* as stored in the file, loaders may split or weld vertexes */
+	int numShaders, maxShaders;
+	char                        **shaderName;    /* unique names, in order of first use */
 };
 
 /* seaw0lf */
@@ -163,12 +340,67 @@ enum
 	pmv_error_memory,  /* out of memory error */
 };
 
+/* work pp_load_model leaves out, see load_options_t */
+enum load_flag
+{
+	lf_skip_normals = 1,        /* vertex normals stay zero */
+	lf_skip_st = 2,             /* no st arrays */
+	lf_skip_colors = 4,         /* no color arrays */
+	lf_skip_materials = 8,      /* no material files, e.g. the obj .mtl */
+	lf_skip_remap = 16,         /* no <model>.remap */
+};
+
+enum load_mode
+{
+	lm_full,                    /* everything the flags don't skip */
+	lm_geometry,                /* positions and indexes only, implies every lf_skip_* */
+	lm_bounds,                  /* as lm_geometry, then only the surface and model bounds are kept */
+};
+
+/* optional switches for pp_load_model; nullptr options load everything */
+class load_options_t
+{
+public:
+	int flags;                                  /* lf_* bits */
+	pmm::load_mode mode;
+	int ( *surfaceFilter )( const char *surfaceName, void *data ); /* nonzero keeps the surface, nullptr keeps all */
+	void                        *filterData;
+};
+
+/* switches for pp_load_models; zero members pick the defaults */
+class pipeline_options_t
+{
+public:
+	int numReaders;                             /* threads waiting in pp_load_file, 0 = 8 */
+	int numParsers;                             /* threads running the modules, 0 = pp_num_threads() */
+	pmm::size_type maxBytesInFlight;            /* file data read but not parsed yet, 0 = 256 MB */
+	const pmm::load_options_t   *loadOptions;   /* may be nullptr */
+	void ( *loaded )( int index, const char *fileName, pmm::model_t *model, void *data ); /* parser threads, in any order. model is nullptr on failure, else the callback's */
+	void                        *loadedData;
+};
+
+/* state of a pp_load_model_async job */
+enum load_status
+{
+	ls_queued,
+	ls_running,
+	ls_done,                    /* the model is ready */
+	ls_failed,                  /* no module could load the file */
+	ls_cancelled,
+};
+
+/* called on the worker thread once a job leaves ls_running or is cancelled while queued */
+using load_done_func = void ( * )( pmm::load_job_t *job, pmm::load_status status, void *data );
+
 // convenience (makes it easy to add new params to the callbacks)
 #define PM_PARAMS_CANLOAD \
 	const char *fileName, const void *buffer, int bufSize
 
 #define PM_PARAMS_LOAD \
-	const char *fileName, int frameNum, const void *buffer, int bufSize
+	const char *fileName, int frameNum, const void *buffer, int bufSize, const pmm::load_options_t *options
+
+#define PM_PARAMS_PROBE \
+	const char *fileName, const void *buffer, int bufSize, pmm::model_info_t *info
 
 #define PM_PARAMS_CANSAVE \
 	void
@@ -191,6 +423,7 @@ public:
 	pmm::model_t  *( *load )( PM_PARAMS_LOAD );  /* parses model file data */
 	int ( *cansave )( PM_PARAMS_CANSAVE );     /* checks whether module can save (returns 1 or 0 and might spit out a message) */
 	int ( *save )( PM_PARAMS_SAVE );           /* saves a pico model in module's native model format */
+	int ( *probe )( PM_PARAMS_PROBE );         /* fills a model_info_t from headers only (returns 1 or 0) */
 };
 
 class pp_manager final
@@ -198,6 +431,7 @@ class pp_manager final
 private:
 	using file_loader_type = std::function<int(std::string, pmm::ub8_t **)>; // bufsize <- name, buffer
 	file_loader_type __file_loader;
+	int __num_threads = 0;
 public:
 	int pp_init();      // Initialize the pmpmesh library
 	void pp_close();    // Close the pmpmesh library
@@ -211,6 +445,9 @@ public:
 public:
 	void pp_set_file_loader(const file_loader_type & file_loader__);
 	int pp_load_file(const std::string & name__, pmm::ub8_t ** buffer__);
+public:
+	void pp_set_num_threads(int num_threads__);  // worker threads for bulk mesh passes, 0 = hardware concurrency
+	int pp_num_threads() const;
 public:
 	void pp_print(pmm::print_level level__, const std::string & str__) const;
 };
@@ -219,7 +456,7 @@ inline pmm::pp_manager man{};
 
 const pmm::module_t ** pp_module_list( int *numModules );
 
-pmm::model_t * pp_load_model( const char *name, int frameNum );
+pmm::model_t * pp_load_model( const char *name, int frameNum, const pmm::load_options_t *options = nullptr );
 
 //										(inputStream, buffer, length)
 using pp_input_stream_read_func = pmm::size_type (*)(void *, unsigned char *, pmm::size_type);
@@ -230,13 +467,56 @@ pmm::model_t* pp_module_load_model_stream(
 	pmm::pp_input_stream_read_func inputStreamRead,
 	pmm::size_type streamLength,
 	int frameNum,
-	const char *fileName
+	const char *fileName,
+	const pmm::load_options_t *options = nullptr
+);
+
+pmm::model_info_t * pp_probe_model( const char *name );
+void pp_free_model_info( pmm::model_info_t *info );
+
+/* asynchronous loads, see pm_async.cpp. the file loader and the print */
+/* function are called from the worker threads. pmm::man.pp_close() */
+/* stops the workers, call it before the program exits */
+pmm::load_job_t * pp_load_model_async(
+	const char *name,
+	int frameNum,
+	const pmm::load_options_t *options = nullptr,
+	int priority = 0,                           /* higher runs first */
+	pmm::load_done_func done = nullptr,
+	void *doneData = nullptr
 );
+pmm::load_status pp_get_load_status( pmm::load_job_t *job );
+void pp_cancel_load( pmm::load_job_t *job );
+pmm::model_t * pp_wait_load( pmm::load_job_t *job );  /* blocks, the model then belongs to the caller */
+void pp_free_load( pmm::load_job_t *job );          /* cancels a pending load */
+
+/* many files at once, reads overlap parsing, see pm_pipeline.cpp */
+int pp_load_models( const char **names, int numNames, int frameNum, const pmm::pipeline_options_t *options );
+
+/* pk3 (zip) archives, see pm_vfs.cpp. hand pp_vfs_load_file to */
+/* pp_set_file_loader and models, .remap, .mtl and terrain images all come from the archives */
+int pp_vfs_add_pak( const char *path, int priority = 0 );  /* higher priority overrides, ties go to the later pak */
+int pp_vfs_load_file( const std::string &fileName, pmm::ub8_t **buffer );
+void pp_vfs_set_cache_size( pmm::size_type bytes );       /* recently loaded files kept decompressed, default 4 MB */
+void pp_vfs_clear( void );
 
 /* model functions */
 pmm::model_t * pp_new_model( void );
 void pp_free_model(pmm::model_t * model);
+pmm::model_t * pp_copy_model(pmm::model_t * model);
 int pp_adjust_model(pmm::model_t * model, int num_shaders, int num_surfaces);
+void pp_calc_model_bounds( pmm::model_t *model );
+void pp_calc_surface_bounds( pmm::surface_t *surface );
+
+/* quantized surface storage, see pm_compact.cpp */
+int pp_compact_surface( pmm::surface_t *surface );
+int pp_expand_surface( pmm::surface_t *surface );
+int pp_compact_model( pmm::model_t *model );
+int pp_expand_model( pmm::model_t *model );
+int pp_decode_surface_xyz( pmm::surface_t *surface, int first, int count, pmm::vec3_t *dest );
+int pp_decode_surface_normals( pmm::surface_t *surface, int first, int count, pmm::vec3_t *dest );
+int pp_decode_surface_tangents( pmm::surface_t *surface, int first, int count, pmm::vec4_t *dest );
+int pp_decode_surface_st( pmm::surface_t *surface, int array, int first, int count, pmm::vec2_t *dest );
 
 /* shader functions */
 pmm::shader_t * pp_new_shader( pmm::model_t *model );
@@ -306,13 +586,17 @@ pmm::shader_t                *pp_get_surface_shader( pmm::surface_t *surface );
 int                         pp_get_surface_num_vertices( pmm::surface_t *surface );
 pmm::vec_t                   *pp_get_surface_xyz( pmm::surface_t *surface, int num );
 pmm::vec_t                   *pp_get_surface_normal( pmm::surface_t *surface, int num );
+pmm::vec_t                   *pp_get_surface_tangent( pmm::surface_t *surface, int num );
 pmm::vec_t                   *pp_get_surface_st( pmm::surface_t *surface, int array, int num );
 pmm::ub8_t                  *pp_get_surface_color( pmm::surface_t *surface, int array, int num );
 int                         pp_get_surface_num_indices( pmm::surface_t *surface );
 pmm::index_t                 pp_get_surface_index( pmm::surface_t *surface, int num );
 pmm::index_t                 *pp_get_surface_indices( pmm::surface_t *surface, int num );
 pmm::vec_t                   *pp_get_face_normal( pmm::surface_t *surface, int num );
+pmm::vec_t                   pp_get_face_dist( pmm::surface_t *surface, int num );
 int                         pp_get_surface_special( pmm::surface_t *surface, int num );
+pmm::index_t                 pp_get_surface_smoothing_group( pmm::surface_t *surface, int num );
+int                         pp_get_surface_attributes( pmm::surface_t *surface );
 
 /* hashtable related functions */
 class pp_vertex_combination_data_t
@@ -330,19 +614,27 @@ public:
 	pmm::index_t index;
 
 	void                        *data;
-
-	pmm::pp_vertex_comnination_hash_t  *next;
 };
 
-int pp_get_hash_table_size( void );
+/* open addressing (robin hood) table with contiguous entry storage, grows */
+/* with its load factor. returned entries stay valid until the next add, */
+/* clear or free. pp_clear_vertex_combination_hash_table() empties a table */
+/* but keeps its storage, so one table can be reused for many surfaces. */
+/* vertices weld when xyz, normal and st are each within a per component */
+/* tolerance (defaults 0.01, 0.02, 0.0001) and the colors are equal. */
+class pp_vertex_combination_hash_table_t;
+
+int pp_get_hash_table_size( pmm::pp_vertex_combination_hash_table_t *hashTable );
 unsigned int pp_vertex_coord_generate_hash( pmm::vec3_t xyz );
 
-pmm::pp_vertex_comnination_hash_t ** pp_new_vertex_combination_hash_table();
-void pp_free_vertex_combination_hash_table( pmm::pp_vertex_comnination_hash_t **hashTable );
+pmm::pp_vertex_combination_hash_table_t * pp_new_vertex_combination_hash_table();
+void pp_clear_vertex_combination_hash_table( pmm::pp_vertex_combination_hash_table_t *hashTable );
+void pp_free_vertex_combination_hash_table( pmm::pp_vertex_combination_hash_table_t *hashTable );
+void pp_set_vertex_combination_tolerances( pmm::pp_vertex_combination_hash_table_t *hashTable, float xyzEpsilon, float normalEpsilon, float stEpsilon );
 
 pp_vertex_comnination_hash_t *
 	pp_find_vertex_combination_in_hash_table(
-		pmm::pp_vertex_comnination_hash_t **hashTable,
+		pmm::pp_vertex_combination_hash_table_t *hashTable,
 		pmm::vec3_t xyz,
 		pmm::vec3_t normal,
 		pmm::vec3_t st,
@@ -351,7 +643,7 @@ pp_vertex_comnination_hash_t *
 
 pp_vertex_comnination_hash_t *
 	pp_add_vertex_combination_to_hash_table(
-		pmm::pp_vertex_comnination_hash_t **hashTable,
+		pmm::pp_vertex_combination_hash_table_t *hashTable,
 		pmm::vec3_t xyz,
 		pmm::vec3_t normal,
 		pmm::vec3_t st,
@@ -372,8 +664,40 @@ int pp_find_surface_vertex_num(
 );
 
 void pp_fix_surface_normals( pmm::surface_t *surface );
+int pp_fix_surface_normals_crease( pmm::surface_t *surface, float creaseAngle );
+int pp_compute_face_normals( pmm::model_t *model );
+int pp_generate_tangents( pmm::surface_t *surface, int stArray );
+int pp_generate_model_tangents( pmm::model_t *model, int stArray );
+int pp_optimize_vertex_cache( pmm::surface_t *surface );
+int pp_optimize_vertex_fetch( pmm::surface_t *surface );
+int pp_optimize_overdraw( pmm::surface_t *surface, float threshold );
+int pp_simplify_surface( pmm::surface_t *surface, float targetRatio, float maxError );
+int pp_build_lod_chain( pmm::model_t *model, const float *ratios, int numRatios, float maxError, pmm::model_t **lods );
+pmm::meshlets_t * pp_build_meshlets( pmm::surface_t *surface, int maxVerts, int maxTris );
+void pp_free_meshlets( pmm::meshlets_t *meshlets );
+
+/* ray queries, see pm_bvh.cpp */
+pmm::bvh_t * pp_build_bvh( pmm::model_t *model );
+void pp_free_bvh( pmm::bvh_t *bvh );
+int pp_ray_intersect( pmm::bvh_t *bvh, pmm::vec3_t origin, pmm::vec3_t dir, float tMax, pmm::ray_hit_t *hit );
+int pp_ray_occluded( pmm::bvh_t *bvh, pmm::vec3_t origin, pmm::vec3_t dir, float tMax );
+int pp_ray_intersect_packet( pmm::bvh_t *bvh, int numRays, pmm::vec3_t *origins, pmm::vec3_t *dirs, const float *tMax, pmm::ray_hit_t *hits );
+int pp_ray_occluded_packet( pmm::bvh_t *bvh, int numRays, pmm::vec3_t *origins, pmm::vec3_t *dirs, const float *tMax, int *occluded );
+
+/* transforms and instancing, see pm_transform.cpp */
+void pp_transform_model( pmm::model_t *model, const pmm::mat4_t transform );
+int pp_bake_instances( pmm::model_t *model, const pmm::mat4_t *transforms, int numTransforms, pmm::model_t *out );
+
+/* gpu buffer export, see pm_export.cpp */
+int pp_add_vertex_element( pmm::vertex_layout_t *layout, pmm::vertex_attribute attribute, int set, pmm::vertex_format format, int components );
+pmm::size_type pp_export_vertex_buffer( pmm::surface_t *surface, const pmm::vertex_layout_t *layout, void *dst );
+int pp_surface_index_size( pmm::surface_t *surface );
+pmm::size_type pp_export_index_buffer( pmm::surface_t *surface, int indexSize, void *dst );
+pmm::flat_model_t * pp_flatten_model( pmm::model_t *model, const pmm::vertex_layout_t *layout, int indexSize );
+void pp_free_flat_model( pmm::flat_model_t *flat );
 int pp_remap_model( pmm::model_t *model, char *remapFile );
 
 void pp_add_triangle_to_model( pmm::model_t *model, pmm::vec3_t** xyz, pmm::vec3_t** normals, int numSTs, pmm::vec2_t **st, int numColors, pmm::color_t **colors, pmm::shader_t* shader, const char *name, pmm::index_t* smoothingGroup );
+void pp_add_triangles_to_model( pmm::model_t *model, int numTriangles, pmm::vec3_t *xyz, pmm::vec3_t *normals, int numSTs, pmm::vec2_t *st, int numColors, pmm::color_t *colors, pmm::index_t *smoothingGroups, int numShaders, pmm::shader_t **shaders, int *shaderNums, const char *name );
 
 }	// namespace pmm
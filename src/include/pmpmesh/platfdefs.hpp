@@ -97,6 +97,26 @@
 #define GDEF_COMPILER_GNU 0
 #endif
 
+// SIMD
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+#define GDEF_SIMD_SSE2 1
+#else
+#define GDEF_SIMD_SSE2 0
+#endif
+
+#if defined(__AVX__)
+#define GDEF_SIMD_AVX 1
+#else
+#define GDEF_SIMD_AVX 0
+#endif
+
+#if defined(__F16C__) || ( defined(_MSC_VER) && defined(__AVX2__) )
+#define GDEF_SIMD_F16C 1
+#else
+#define GDEF_SIMD_F16C 0
+#endif
+
 // ATTRIBUTE
 
 #if GDEF_COMPILER_GNU
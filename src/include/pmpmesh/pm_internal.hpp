@@ -43,6 +43,7 @@
 #include <string.h>
 #include <ctype.h>
 #include <math.h>
+#include <vector>
 
 #include <pmpmesh/pmpmesh.hpp>
 
@@ -82,6 +83,18 @@ public:
 	int curLine;
 };
 
+/* vertex -> triangle adjacency in compressed sparse row form: the triangles
+   using vertex v are tris[ first[ v ] ] .. tris[ first[ v + 1 ] - 1 ], in
+   ascending order. a triangle using a vertex twice is listed twice.
+   with a 'group' mapping, triangles are listed under group[ v ] instead. */
+
+class picoVertexTriangles_t
+{
+public:
+	std::vector<int> first;
+	std::vector<int> tris;
+};
+
 class picoMemStream_t
 {
 public:
@@ -116,6 +129,9 @@ char            *_pico_strlwr( char *str );
 /* vectors */
 void            _pico_zero_bounds( pmm::vec3_t mins, pmm::vec3_t maxs );
 void            _pico_expand_bounds( pmm::vec3_t p, pmm::vec3_t mins, pmm::vec3_t maxs );
+void            _pico_vec_bounds( pmm::vec3_t *xyz, int count, pmm::vec3_t mins, pmm::vec3_t maxs );
+pmm::vec_t       _pico_vec_radius( pmm::vec3_t *xyz, int count, pmm::vec3_t center );
+void            _pico_transform_vecs( pmm::vec3_t *v, int count, const pmm::vec_t *m, int point, int normalize );
 void            _pico_zero_vec( pmm::vec3_t vec );
 void            _pico_zero_vec2( pmm::vec2_t vec );
 void            _pico_zero_vec4( pmm::vec4_t vec );
@@ -125,6 +141,7 @@ void            _pico_set_color( pmm::color_t c, int r, int g, int b, int a );
 void            _pico_copy_color( pmm::color_t src, pmm::color_t dest );
 void            _pico_copy_vec( pmm::vec3_t src, pmm::vec3_t dest );
 void            _pico_copy_vec2( pmm::vec2_t src, pmm::vec2_t dest );
+void            _pico_copy_vec4( pmm::vec4_t src, pmm::vec4_t dest );
 pmm::vec_t       _pico_normalize_vec( pmm::vec3_t vec );
 void            _pico_add_vec( pmm::vec3_t a, pmm::vec3_t b, pmm::vec3_t dest );
 void            _pico_subtract_vec( pmm::vec3_t a, pmm::vec3_t b, pmm::vec3_t dest );
@@ -133,6 +150,28 @@ void            _pico_cross_vec( pmm::vec3_t a, pmm::vec3_t b, pmm::vec3_t dest
 pmm::vec_t       _pico_calc_plane( pmm::vec4_t plane, pmm::vec3_t a, pmm::vec3_t b, pmm::vec3_t c );
 void            _pico_scale_vec( pmm::vec3_t v, float scale, pmm::vec3_t dest );
 void            _pico_scale_vec4( pmm::vec4_t v, float scale, pmm::vec4_t dest );
+void            _pico_normalize_vecs( pmm::vec_t *x, pmm::vec_t *y, pmm::vec_t *z, int count );
+void            _pico_calc_face_planes( pmm::vec3_t *xyz, int numVertexes, pmm::index_t *index, int numTriangles, pmm::vec3_t *normals, pmm::vec_t *dists );
+
+/* vertex encodings */
+unsigned short  _pico_float_to_half( float f );
+float           _pico_half_to_float( unsigned short h );
+void            _pico_oct_encode( const pmm::vec_t *n, pmm::vec_t *oct );
+void            _pico_oct_decode( const pmm::vec_t *oct, pmm::vec_t *n );
+void            _pico_decode_positions( const pmm::qvec3_t *q, int count, const pmm::vec_t *origin, const pmm::vec_t *scale, pmm::vec3_t *dest );
+void            _pico_decode_octs( const pmm::oct_t *oct, int count, pmm::vec3_t *dest );
+void            _pico_decode_halves( const unsigned short *h, int count, pmm::vec_t *dest );
+void            _pico_decode_snorms( const short *s, int count, pmm::vec_t *dest );
+
+/* compact surfaces */
+void            _pico_free_float_vertexes( pmm::surface_t *surface );
+pmm::compact_vertexes_t *_pico_copy_compact( pmm::surface_t *surface );
+int             _pico_expand_compact( pmm::surface_t *surface, const char *caller );
+int             _pico_expand_compact_model( pmm::model_t *model, const char *caller );
+
+/* threading */
+void            _pico_parallel_for( int count, int grain, const std::function<void( int first, int last )> &func );
+void            _pico_parallel_worker( void );
 
 /* endian */
 int             _pico_big_long( int src );
@@ -143,6 +182,47 @@ int             _pico_little_long( int src );
 short           _pico_little_short( short src );
 float           _pico_little_float( float src );
 
+/* lookup indices */
+void            _pico_free_vertex_index( pmm::surface_t *surface );
+void            _pico_vertex_index_changed( pmm::surface_t *surface, int num );
+int             _pico_alloc_smoothing_groups( pmm::surface_t *surface );
+void            _pico_free_shader_index( pmm::model_t *model );
+int             _pico_shader_index_find( pmm::model_t *model, const char *name, int caseSensitive );
+void            _pico_shader_index_remove( pmm::shader_t *shader );
+void            _pico_shader_index_add( pmm::shader_t *shader );
+void            _pico_free_surface_index( pmm::model_t *model );
+int             _pico_surface_index_find( pmm::model_t *model, const char *name, int caseSensitive );
+void            _pico_surface_index_remove( pmm::surface_t *surface );
+void            _pico_surface_index_add( pmm::surface_t *surface );
+pmm::surface_t  *_pico_find_triangle_surface( pmm::model_t *model, pmm::shader_t *shader, const char *name );
+pmm::surface_t  *_pico_new_triangle_surface( pmm::model_t *model, pmm::shader_t *shader, const char *name );
+
+/* surface helpers */
+int             _pico_triangle_is_valid( pmm::surface_t *surface, int tri );
+void            _pico_build_vertex_triangles( pmm::surface_t *surface, const int *group, picoVertexTriangles_t *adjacency );
+void            _pico_copy_surface_vertex( pmm::surface_t *surface, int src, int dest );
+
+/* model helpers */
+pmm::bounds_t   *_pico_frame_bounds( pmm::model_t *model, int frameNum );
+void            _pico_set_frame_bounds( pmm::model_t *model, int frameNum, pmm::vec3_t *xyz, int count );
+pmm::shader_t   *_pico_copy_shader( pmm::model_t *model, pmm::shader_t *shader );
+
+/* load options */
+int             _pico_load_flags( const pmm::load_options_t *options );
+int             _pico_load_surface( const pmm::load_options_t *options, const char *name );
+
+/* model loading */
+pmm::model_t    *_pico_load_model_buffer( const char *fileName, int frameNum, pmm::ub8_t *buffer, int bufSize, const pmm::load_options_t *options );
+
+/* asynchronous loads */
+int             _pico_load_cancelled( void );
+void            _pico_async_shutdown( void );
+
+/* model probes */
+int             _pico_probe_range( int bufSize, long ofs, long len );
+int             _pico_probe_add_shader( pmm::model_info_t *info, const char *name );
+const char      *_pico_probe_token( const char *cp, const char *end, char *dest, int max );
+
 /* pico ascii parser */
 picoParser_t    *_pico_new_parser( const pmm::ub8_t *buffer, int bufSize );
 void            _pico_free_parser( picoParser_t *p );
@@ -24,7 +24,7 @@
 
 const int FLEN_error = INT_MIN;
 
-static int flen;
+static thread_local int flen;
 
 void set_flen( int i ) { flen = i; }
 
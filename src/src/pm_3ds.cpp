@@ -35,9 +35,6 @@
 #include <pmpmesh/pm_internal.hpp>
 #include <string>
 
-/* ydnar */
-static pmm::color_t white = { 255,255,255,255 };
-
 /* remarks:
  * - 3ds file version is stored in pico special field 0 on load (ydnar: removed)
  * todo:
@@ -61,6 +58,8 @@ public:
 	char           *basename;       /* ptr to model base name (eg. jeep) */
 	int cofs;
 	int maxofs;
+	const pmm::load_options_t *options;  /* caller's load switches, may be nullptr */
+	int loadFlags;
 };
 
 /* 3ds chunk types that we use */
@@ -295,7 +294,6 @@ static int GetMeshVertices( T3dsLoaderPers *pers ){
 
 		/* add current vertex */
 		pmm::pp_set_surface_xyz( pers->surface,i,v );
-		pmm::pp_set_surface_color( pers->surface,0,i,white ); /* ydnar */
 
 #ifdef DEBUG_PM_3DS_EX
 		printf( "Vertex: x: %f y: %f z: %f\n",v[0],v[1],v[2] );
@@ -524,6 +522,13 @@ static int DoNextEditorDataChunk( T3dsLoaderPers *pers, long endofs ){
 			/* ignore nullptr name surfaces */
 //			if( surfaceName
 
+			/* filtered out by the caller, skip the object's sub chunks */
+			if ( !_pico_load_surface( pers->options, surfaceName ) ) {
+				pers->surface = nullptr;
+				pers->cofs = nextofs;
+				continue;
+			}
+
 			/* allocate a pico surface */
 			surface = pmm::pp_new_surface( pers->model );
 			if ( surface == nullptr ) {
@@ -562,7 +567,7 @@ static int DoNextEditorDataChunk( T3dsLoaderPers *pers, long endofs ){
 			}
 			continue;
 		}
-		if ( chunk->id == CHUNK_OBJECT_UV ) {
+		if ( chunk->id == CHUNK_OBJECT_UV && !( pers->loadFlags & pmm::lf_skip_st ) ) {
 			if ( !GetMeshTexCoords( pers ) ) {
 				return 0;
 			}
@@ -712,6 +717,96 @@ static int DoNextChunk( T3dsLoaderPers *pers, int endofs ){
 	return 1;
 }
 
+/* little endian word at any alignment, for _3ds_probe_chunks() */
+static int _3ds_probe_word( const pmm::ub8_t *bp ){
+	return bp[ 0 ] | ( bp[ 1 ] << 8 );
+}
+
+/* _3ds_probe_chunks:
+ *  counts objects, vertices and faces and collects material names in
+ *  the chunks between ofs and endofs, without touching the buffer.
+ */
+static int _3ds_probe_chunks( const pmm::ub8_t *bufptr, int bufSize, long ofs, long endofs, pmm::model_info_t *info ){
+	const T3dsChunk *chunk;
+	char name[ 0xff ];
+	long nextofs, len;
+	int id;
+
+	while ( ofs < endofs )
+	{
+		if ( !_pico_probe_range( bufSize, ofs, sizeof( T3dsChunk ) ) ) {
+			return 0;
+		}
+		chunk = (const T3dsChunk *)( bufptr + ofs );
+		id  = (unsigned short) _pico_little_short( chunk->id );
+		len = _pico_little_long( chunk->len );
+		if ( len < (long) sizeof( T3dsChunk ) || !_pico_probe_range( bufSize, ofs, len ) ) {
+			return 0;
+		}
+		nextofs = ofs + len;
+		ofs += sizeof( T3dsChunk );
+
+		switch ( id )
+		{
+		case CHUNK_OBJECT:
+			/* skip the object name, then walk its sub chunks */
+			info->numSurfaces++;
+			while ( ofs < nextofs && bufptr[ ofs ] != '\0' )
+				ofs++;
+			if ( !_3ds_probe_chunks( bufptr, bufSize, ofs + 1, nextofs, info ) ) {
+				return 0;
+			}
+			break;
+
+		case CHUNK_EDITOR_DATA:
+		case CHUNK_OBJECT_MESH:
+		case CHUNK_MATERIAL:
+			if ( !_3ds_probe_chunks( bufptr, bufSize, ofs, nextofs, info ) ) {
+				return 0;
+			}
+			break;
+
+		case CHUNK_OBJECT_VERTICES:
+			if ( ofs + 2 <= nextofs ) {
+				info->numVertexes += _3ds_probe_word( bufptr + ofs );
+			}
+			break;
+
+		case CHUNK_OBJECT_FACES:
+			if ( ofs + 2 <= nextofs ) {
+				info->numTriangles += _3ds_probe_word( bufptr + ofs );
+			}
+			break;
+
+		case CHUNK_MATNAME:
+			/* trimmed to the first token like the loader does */
+			len = nextofs - ofs;
+			if ( len > (long) sizeof( name ) - 1 ) {
+				len = sizeof( name ) - 1;
+			}
+			memcpy( name, bufptr + ofs, len );
+			name[ len ] = '\0';
+			_pico_first_token( name );
+			_pico_probe_add_shader( info, name );
+			break;
+		}
+		ofs = nextofs;
+	}
+	return 1;
+}
+
+/* _3ds_probe:
+ *  walks the chunk tree of an autodesk 3ds model file.
+ */
+static int _3ds_probe( PM_PARAMS_PROBE ){
+	const T3dsChunk *chunk = (const T3dsChunk *)buffer;
+
+	(void) fileName;
+
+	/* the magic chunk spans the file, _3ds_canload checked its length */
+	return _3ds_probe_chunks( (const pmm::ub8_t *)buffer, bufSize, sizeof( T3dsChunk ), _pico_little_long( chunk->len ), info );
+}
+
 /* _3ds_load:
  *  loads an autodesk 3ds model file.
  */
@@ -738,6 +833,8 @@ static pmm::model_t *_3ds_load( PM_PARAMS_LOAD ){
 	pers.basename = (char *)basename;
 	pers.maxofs   =  bufSize;
 	pers.cofs     =  0L;
+	pers.options  =  options;
+	pers.loadFlags = _pico_load_flags( options );
 
 	/* do model setup */
 	pmm::pp_set_model_frame_num( model,frameNum );
@@ -770,5 +867,6 @@ extern const pmm::module_t picoModule3DS =
 	_3ds_canload,               /* validation routine */
 	_3ds_load,                  /* load routine */
 	nullptr,                       /* save validation routine */
-	nullptr                        /* save routine */
+	nullptr,                       /* save routine */
+	_3ds_probe                  /* probe routine */
 };
@@ -40,6 +40,8 @@
 #include <pmpmesh/pm_internal.hpp>
 #include <pmpmesh/pmpmesh.hpp>
 #include <sstream>
+#include <unordered_map>
+#include <vector>
 
 #ifdef DEBUG_PM_ASE
 #include "time.h"
@@ -276,32 +278,13 @@ using aseFacesIter_t = aseFace_t *;
 
 pmm::surface_t* PicoModelFindOrAddSurface( pmm::model_t *model, pmm::shader_t* shader ){
 	/* see if a surface already has the shader */
-	int i = 0;
-	for ( ; i < model->num_surfaces ; i++ )
-	{
-		pmm::surface_t* workSurface = model->surface[i];
-		if ( workSurface->shader == shader ) {
-			return workSurface;
-		}
+	pmm::surface_t* workSurface = _pico_find_triangle_surface( model, shader, nullptr );
+	if ( workSurface ) {
+		return workSurface;
 	}
 
 	/* no surface uses this shader yet, so create a new surface */
-
-	{
-		/* create a new surface in the model for the unique shader */
-		pmm::surface_t* workSurface = pmm::pp_new_surface( model );
-		if ( !workSurface ) {
-			pmm::man.pp_print(pmm::pl_error, "Could not allocate a new surface!\n");
-			return 0;
-		}
-
-		/* do surface setup */
-		pmm::pp_set_surface_type( workSurface, pmm::st_triangles );
-		pmm::pp_set_surface_name( workSurface, shader->name );
-		pmm::pp_set_surface_shader( workSurface, shader );
-
-		return workSurface;
-	}
+	return _pico_new_triangle_surface( model, shader, nullptr );
 }
 
 /* _ase_submit_triangles - jhefty
@@ -433,46 +416,70 @@ static void _ase_submit_triangles_unshared( pmm::model_t* model, aseMaterial_t*
 
 #endif
 
-static void _ase_submit_triangles( pmm::model_t* model, aseMaterial_t* materials, aseVertex_t* vertices, aseTexCoord_t* texcoords, aseColor_t* colors, aseFace_t* faces, int numFaces, const char *name ){
+static void _ase_submit_triangles( pmm::model_t* model, aseMaterial_t* materials, aseVertex_t* vertices, aseTexCoord_t* texcoords, aseColor_t* colors, aseFace_t* faces, int numFaces, const char *name, const pmm::load_options_t *options ){
 	aseFacesIter_t i = faces, end = faces + numFaces;
+	std::unordered_map<pmm::shader_t*, int> shaderNumbers;
+	std::vector<pmm::shader_t*> shaders;
+	std::vector<int> shaderNums;
+	std::vector<pmm::vec3_t> xyz( numFaces * 3 ), normal( numFaces * 3 );
+	std::vector<pmm::vec2_t> st( numFaces * 3 );
+	std::vector<pmm::color_t> color( numFaces * 3 );
+	std::vector<pmm::index_t> smooth( numFaces * 3 );
+	int numTriangles = 0;
+	int loadFlags = _pico_load_flags( options );
+
+	/* filtered out by the caller */
+	if ( !_pico_load_surface( options, name ) ) {
+		return;
+	}
+
 	for (; i != end; ++i )
 	{
 		/* look up the shader for the material/submaterial pair */
 		aseSubMaterial_t* subMtl = _ase_get_submaterial_or_default( materials, ( *i ).materialId, ( *i ).subMaterialId );
 		if ( subMtl == nullptr ) {
-			return;
+			break;
 		}
 
 		{
-			pmm::vec3_t* xyz[3];
-			pmm::vec3_t* normal[3];
-			pmm::vec2_t* st[3];
-			pmm::color_t* color[3];
-			pmm::index_t smooth[3];
 			int j;
 			/* we pull the data from the vertex, color and texcoord arrays using the face index data */
 			for ( j = 0 ; j < 3 ; j++ )
 			{
-				xyz[j]    = &vertices[( *i ).indices[j]].xyz;
-				normal[j] = &vertices[( *i ).indices[j]].normal;
-				st[j]     = &texcoords[( *i ).indices[j + 3]].texcoord;
+				int corner = numTriangles * 3 + j;
+
+				_pico_copy_vec( vertices[( *i ).indices[j]].xyz, xyz[corner] );
+				_pico_copy_vec( vertices[( *i ).indices[j]].normal, normal[corner] );
+				_pico_copy_vec2( texcoords[( *i ).indices[j + 3]].texcoord, st[corner] );
 
 				if ( colors != nullptr && ( *i ).indices[j + 6] >= 0 ) {
-					color[j] = &colors[( *i ).indices[j + 6]].color;
+					_pico_copy_color( colors[( *i ).indices[j + 6]].color, color[corner] );
 				}
 				else
 				{
-					color[j] = &white;
+					_pico_copy_color( white, color[corner] );
 				}
 
-				smooth[j] = ( vertices[( *i ).indices[j]].id * ( 1 << 16 ) ) + ( *i ).smoothingGroup; /* don't merge vertices */
+				smooth[corner] = ( vertices[( *i ).indices[j]].id * ( 1 << 16 ) ) + ( *i ).smoothingGroup; /* don't merge vertices */
 
 			}
 
-			/* submit the triangle to the model */
-			pmm::pp_add_triangle_to_model( model, xyz, normal, 1, st, 1, color, subMtl->shader, name, smooth );
+			/* number the shaders in order of first use */
+			auto shader = shaderNumbers.try_emplace( subMtl->shader, (int) shaders.size() );
+			if ( shader.second ) {
+				shaders.push_back( subMtl->shader );
+			}
+			shaderNums.push_back( shader.first->second );
+			numTriangles++;
 		}
 	}
+
+	/* submit the triangles to the model, without the streams the caller skips */
+	pmm::pp_add_triangles_to_model( model, numTriangles, xyz.data(),
+									( loadFlags & pmm::lf_skip_normals ) ? nullptr : normal.data(),
+									1, ( loadFlags & pmm::lf_skip_st ) ? nullptr : st.data(),
+									1, ( loadFlags & pmm::lf_skip_colors ) ? nullptr : color.data(),
+									smooth.data(), (int) shaders.size(), shaders.data(), shaderNums.data(), name );
 }
 
 static void shadername_convert( char* shaderName ){
@@ -487,6 +494,119 @@ static void shadername_convert( char* shaderName ){
 }
 
 
+/* _ase_probe_shader:
+ *  names a top level material the way the loader does, preferring
+ *  the models/ or textures/ part of its diffuse bitmap
+ */
+static void _ase_probe_shader( pmm::model_info_t *info, char *materialName, char *mapname ){
+	char* p = mapname;
+
+	shadername_convert( mapname );
+	{
+		/* remove extension */
+		char* last_period = strrchr( p, '.' );
+		if ( last_period != nullptr ) {
+			*last_period = '\0';
+		}
+	}
+	for (; *p != '\0'; ++p )
+	{
+		if ( _pico_strnicmp( p, "models/", 7 ) == 0 || _pico_strnicmp( p, "textures/", 9 ) == 0 ) {
+			break;
+		}
+	}
+	if ( *p != '\0' ) {
+		_pico_probe_add_shader( info, p );
+	}
+	else
+	{
+		shadername_convert( materialName );
+		_pico_probe_add_shader( info, materialName );
+	}
+}
+
+/* _ase_probe:
+ *  scans the lines of a 3dsmax ase for its objects, mesh counts and
+ *  materials. the loader splits every object by shader, so the
+ *  surface count is the number of geometry objects.
+ */
+static int _ase_probe( PM_PARAMS_PROBE ){
+	const char *cp  = (const char *)buffer;
+	const char *end = cp + bufSize;
+	const char *line;
+	char token[ 1024 ];
+	char materialName[ 1024 ] = { 0 }, mapname[ 1024 ] = { 0 };
+	int level = 0, materialLevel = -1, subMaterialLevel = -1, mapLevel = -1;
+	int hasSubMaterials = 0;
+
+	(void) fileName;
+
+	while ( cp < end )
+	{
+		line = cp;
+		cp = _pico_probe_token( cp, end, token, sizeof( token ) );
+
+		if ( !_pico_stricmp( token,"*geomobject" ) ) {
+			info->numSurfaces++;
+		}
+		else if ( !_pico_stricmp( token,"*mesh_numvertex" ) ) {
+			cp = _pico_probe_token( cp, end, token, sizeof( token ) );
+			info->numVertexes += atoi( token );
+		}
+		else if ( !_pico_stricmp( token,"*mesh_numfaces" ) ) {
+			cp = _pico_probe_token( cp, end, token, sizeof( token ) );
+			info->numTriangles += atoi( token );
+		}
+		else if ( !_pico_stricmp( token,"*material" ) ) {
+			materialLevel = level + 1;
+			hasSubMaterials = 0;
+			materialName[ 0 ] = mapname[ 0 ] = '\0';
+		}
+		else if ( !_pico_stricmp( token,"*submaterial" ) && materialLevel >= 0 ) {
+			subMaterialLevel = level + 1;
+			hasSubMaterials = 1;
+		}
+		else if ( !_pico_stricmp( token,"*material_name" ) && materialLevel >= 0 ) {
+			cp = _pico_probe_token( cp, end, materialName, sizeof( materialName ) );
+		}
+		else if ( !_pico_stricmp( token,"*map_diffuse" ) && materialLevel >= 0 ) {
+			mapLevel = level + 1;
+		}
+		else if ( !_pico_stricmp( token,"*bitmap" ) && mapLevel >= 0 ) {
+			cp = _pico_probe_token( cp, end, mapname, sizeof( mapname ) );
+		}
+
+		/* follow the braces to find the end of material blocks */
+		for ( cp = line; cp < end && *cp != '\n'; cp++ )
+		{
+			if ( *cp == '{' ) {
+				level++;
+			}
+			else if ( *cp == '}' ) {
+				level--;
+				if ( level < mapLevel ) {
+					mapLevel = -1;
+				}
+				if ( level < subMaterialLevel ) {
+					_pico_first_token( materialName );
+					shadername_convert( materialName );
+					_pico_probe_add_shader( info, materialName );
+					subMaterialLevel = -1;
+				}
+				if ( level < materialLevel ) {
+					if ( !hasSubMaterials ) {
+						_ase_probe_shader( info, materialName, mapname );
+					}
+					materialLevel = -1;
+				}
+			}
+		}
+		cp++;
+	}
+	return 1;
+}
+
+
 /* _ase_load:
  *  loads a 3dsmax ase model file.
  */
@@ -546,6 +666,18 @@ static pmm::model_t *_ase_load( PM_PARAMS_LOAD ){
 	/* parse ase model file */
 	while ( 1 )
 	{
+		/* the caller gave up on this load */
+		if ( _pico_load_cancelled() ) {
+			pmm::man.pp_m_delete( faces );
+			pmm::man.pp_m_delete( vertices );
+			pmm::man.pp_m_delete( texcoords );
+			pmm::man.pp_m_delete( colors );
+			_ase_free_materials( &materials );
+			_pico_free_parser( p );
+			pmm::pp_free_model( model );
+			return nullptr;
+		}
+
 		/* get first token on line */
 		if ( _pico_parse_first( p ) == nullptr ) {
 			break;
@@ -575,11 +707,16 @@ static pmm::model_t *_ase_load( PM_PARAMS_LOAD ){
 		/* model mesh (originally contained within geomobject) */
 		else if ( !_pico_stricmp( p->token,"*mesh" ) ) {
 			/* finish existing surface */
-			_ase_submit_triangles( model, materials, vertices, texcoords, colors, faces, numFaces, lastNodeName );
+			_ase_submit_triangles( model, materials, vertices, texcoords, colors, faces, numFaces, lastNodeName, options );
 			pmm::man.pp_m_delete( faces );
 			pmm::man.pp_m_delete( vertices );
 			pmm::man.pp_m_delete( texcoords );
 			pmm::man.pp_m_delete( colors );
+			faces = nullptr;
+			vertices = nullptr;
+			texcoords = nullptr;
+			colors = nullptr;
+			numFaces = 0;
 		}
 		else if ( !_pico_stricmp( p->token,"*mesh_numvertex" ) ) {
 			if ( !_pico_parse_int( p, &numVertices ) ) {
@@ -1159,7 +1296,7 @@ static pmm::model_t *_ase_load( PM_PARAMS_LOAD ){
 	}
 
 	/* ydnar: finish existing surface */
-	_ase_submit_triangles( model, materials, vertices, texcoords, colors, faces, numFaces, lastNodeName );
+	_ase_submit_triangles( model, materials, vertices, texcoords, colors, faces, numFaces, lastNodeName, options );
 	pmm::man.pp_m_delete( faces );
 	pmm::man.pp_m_delete( vertices );
 	pmm::man.pp_m_delete( texcoords );
@@ -1193,5 +1330,6 @@ extern const pmm::module_t picoModuleASE =
 	_ase_canload,               /* validation routine */
 	_ase_load,                  /* load routine */
 	nullptr,                       /* save validation routine */
-	nullptr                        /* save routine */
+	nullptr,                       /* save routine */
+	_ase_probe                  /* probe routine */
 };
@@ -0,0 +1,347 @@
+/* -----------------------------------------------------------------------------
+
+   PicoModel Library
+
+   Copyright (c) 2002, Randy Reddig & seaw0lf
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification,
+   are permitted provided that the following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list
+   of conditions and the following disclaimer.
+
+   Redistributions in binary form must reproduce the above copyright notice, this
+   list of conditions and the following disclaimer in the documentation and/or
+   other materials provided with the distribution.
+
+   Neither the names of the copyright holders nor the names of its contributors may
+   be used to endorse or promote products derived from this software without
+   specific prior written permission.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+   ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+   ANY DIRECT, INDIRECT, INCidentAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+   (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+   LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+   ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   ----------------------------------------------------------------------------- */
+
+/* asynchronous model loading on a pool of worker threads */
+
+#include <pmpmesh/pmpmesh.hpp>
+#include <pmpmesh/pm_internal.hpp>
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+
+/* one pp_load_model_async request. status, refs and model are guarded */
+/* by the pool mutex, cancelled is also polled by the loaders without it */
+class pmm::load_job_t
+{
+public:
+	char                        *name;
+	int frameNum;
+	int hasOptions;
+	pmm::load_options_t options;                /* copied, filterData stays the caller's */
+	int priority;
+	unsigned long serial;                       /* submission order among equal priorities */
+	pmm::load_done_func done;
+	void                        *doneData;
+	pmm::load_status status;
+	int cancelled;
+	int refs;                                   /* the caller's handle and the pool */
+	pmm::model_t                *model;         /* until pp_wait_load hands it out */
+};
+
+/* the pool is stopped by pp_close(). its state is never destroyed, so */
+/* workers still waiting at exit neither block a static destructor nor */
+/* find their mutex gone, they end with the process */
+static std::mutex &_pico_async_mutex = *new std::mutex;
+static std::condition_variable &_pico_async_wake = *new std::condition_variable;     /* workers wait for jobs */
+static std::condition_variable &_pico_async_finish = *new std::condition_variable;   /* pp_wait_load waits for jobs */
+static std::vector<pmm::load_job_t *> &_pico_async_queue = *new std::vector<pmm::load_job_t *>;  /* heap, see _pico_async_after */
+static std::vector<std::thread> &_pico_async_workers = *new std::vector<std::thread>;
+static int _pico_async_stop;
+static unsigned long _pico_async_serial;
+
+/* the job the calling worker thread is loading */
+static thread_local pmm::load_job_t *_pico_async_current;
+
+
+
+/* ----------------------------------------------------------------------------
+   helpers
+   ---------------------------------------------------------------------------- */
+
+/* _pico_async_after:
+ *  heap order, whether job 'a' runs after job 'b'
+ */
+static bool _pico_async_after( const pmm::load_job_t *a, const pmm::load_job_t *b ){
+	if ( a->priority != b->priority ) {
+		return a->priority < b->priority;
+	}
+	return a->serial > b->serial;
+}
+
+/* _pico_async_release:
+ *  drops one reference, the last one frees the job and a model nobody took.
+ *  called with the pool mutex held
+ */
+static void _pico_async_release( pmm::load_job_t *job ){
+	if ( --job->refs > 0 ) {
+		return;
+	}
+	if ( job->model != nullptr ) {
+		pmm::pp_free_model( job->model );
+	}
+	pmm::man.pp_m_delete( job->name );
+	pmm::man.pp_m_delete( job );
+}
+
+/* _pico_async_cancel:
+ *  flags a pending job and moves it to the front of the queue, so a worker
+ *  retires it right away. called with the pool mutex held
+ */
+static void _pico_async_cancel( pmm::load_job_t *job ){
+	if ( job->status != pmm::ls_queued && job->status != pmm::ls_running ) {
+		return;
+	}
+	std::atomic_ref<int>( job->cancelled ).store( 1, std::memory_order_relaxed );
+	if ( job->status == pmm::ls_queued ) {
+		job->priority = INT_MAX;
+		std::make_heap( _pico_async_queue.begin(), _pico_async_queue.end(), _pico_async_after );
+	}
+}
+
+/* _pico_async_worker:
+ *  runs queued jobs until _pico_async_shutdown
+ */
+static void _pico_async_worker( void ){
+	std::unique_lock<std::mutex> lock( _pico_async_mutex );
+	pmm::load_job_t *job;
+	pmm::model_t *model;
+	pmm::load_status status;
+
+	/* the pool already has a worker per core */
+	_pico_parallel_worker();
+
+	for ( ;; )
+	{
+		_pico_async_wake.wait( lock, [](){ return _pico_async_stop || !_pico_async_queue.empty(); } );
+		if ( _pico_async_queue.empty() ) {
+			return;
+		}
+		std::pop_heap( _pico_async_queue.begin(), _pico_async_queue.end(), _pico_async_after );
+		job = _pico_async_queue.back();
+		_pico_async_queue.pop_back();
+
+		/* file i/o and parsing run unlocked */
+		if ( !job->cancelled ) {
+			job->status = pmm::ls_running;
+			lock.unlock();
+			_pico_async_current = job;
+			model = pmm::pp_load_model( job->name, job->frameNum, job->hasOptions ? &job->options : nullptr );
+			_pico_async_current = nullptr;
+			lock.lock();
+		}
+		else {
+			model = nullptr;
+		}
+
+		if ( job->cancelled ) {
+			if ( model != nullptr ) {
+				pmm::pp_free_model( model );
+			}
+			status = pmm::ls_cancelled;
+		}
+		else {
+			status = model != nullptr ? pmm::ls_done : pmm::ls_failed;
+			job->model = model;
+		}
+		job->status = status;
+		_pico_async_finish.notify_all();
+
+		/* the callback may wait on or free the job */
+		if ( job->done != nullptr ) {
+			lock.unlock();
+			job->done( job, status, job->doneData );
+			lock.lock();
+		}
+		_pico_async_release( job );
+	}
+}
+
+/* _pico_async_shutdown:
+ *  cancels the queued jobs, lets the running ones finish and joins the
+ *  workers. the pool starts again with the next pp_load_model_async
+ */
+void _pico_async_shutdown( void ){
+	std::vector<std::thread> workers;
+
+	{
+		std::lock_guard<std::mutex> lock( _pico_async_mutex );
+		for ( pmm::load_job_t *job : _pico_async_queue )
+			std::atomic_ref<int>( job->cancelled ).store( 1, std::memory_order_relaxed );
+		_pico_async_stop = 1;
+		workers.swap( _pico_async_workers );
+	}
+	_pico_async_wake.notify_all();
+	for ( std::thread &worker : workers )
+		worker.join();
+
+	std::lock_guard<std::mutex> lock( _pico_async_mutex );
+	_pico_async_stop = 0;
+}
+
+/* _pico_load_cancelled:
+ *  nonzero when the load running on this thread was cancelled. long loader
+ *  loops poll this and give up like on a parse error, minus the message
+ */
+int _pico_load_cancelled( void ){
+	return _pico_async_current != nullptr && std::atomic_ref<int>( _pico_async_current->cancelled ).load( std::memory_order_relaxed );
+}
+
+
+
+/* ----------------------------------------------------------------------------
+   public functions
+   ---------------------------------------------------------------------------- */
+
+/*
+   pmm::pp_load_model_async()
+   queues a pp_load_model on the worker pool and returns at once. 'done'
+   is called on the worker thread when the job finishes, fails or is
+   cancelled. free the handle with pmm::pp_free_load()
+ */
+
+pmm::load_job_t *pmm::pp_load_model_async( const char *fileName, int frameNum, const pmm::load_options_t *options, int priority, pmm::load_done_func done, void *doneData ){
+	pmm::load_job_t *job;
+	int numWorkers;
+
+
+	if ( fileName == nullptr ) {
+		pmm::man.pp_print( pmm::pl_error, "pmm::pp_load_model_async: No filename given (fileName == nullptr)" );
+		return nullptr;
+	}
+
+	job = reinterpret_cast<decltype(job)>( pmm::man.pp_m_new( sizeof( *job ) ) );
+	if ( job == nullptr ) {
+		return nullptr;
+	}
+	job->name = _pico_clone_alloc( fileName );
+	if ( job->name == nullptr ) {
+		pmm::man.pp_m_delete( job );
+		return nullptr;
+	}
+	job->frameNum = frameNum;
+	if ( options != nullptr ) {
+		job->hasOptions = 1;
+		job->options = *options;
+	}
+	job->priority = priority;
+	job->done = done;
+	job->doneData = doneData;
+	job->status = pmm::ls_queued;
+	job->refs = 2;
+
+	std::lock_guard<std::mutex> lock( _pico_async_mutex );
+
+	/* start the pool on first use */
+	if ( _pico_async_workers.empty() ) {
+		numWorkers = pmm::man.pp_num_threads();
+		for ( int i = 0; i < numWorkers; i++ )
+			_pico_async_workers.emplace_back( _pico_async_worker );
+	}
+
+	job->serial = _pico_async_serial++;
+	_pico_async_queue.push_back( job );
+	std::push_heap( _pico_async_queue.begin(), _pico_async_queue.end(), _pico_async_after );
+	_pico_async_wake.notify_one();
+
+	return job;
+}
+
+/*
+   pmm::pp_get_load_status()
+   where a job is, without waiting. ls_failed for a nullptr job
+ */
+
+pmm::load_status pmm::pp_get_load_status( pmm::load_job_t *job ){
+	/* dummy check */
+	if ( job == nullptr ) {
+		return pmm::ls_failed;
+	}
+
+	std::lock_guard<std::mutex> lock( _pico_async_mutex );
+
+	return job->status;
+}
+
+/*
+   pmm::pp_cancel_load()
+   asks a queued or running job to stop. queued jobs never start, running
+   ones stop at the next check in the loader or are thrown away once it
+   returns
+ */
+
+void pmm::pp_cancel_load( pmm::load_job_t *job ){
+	/* dummy check */
+	if ( job == nullptr ) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock( _pico_async_mutex );
+
+	_pico_async_cancel( job );
+}
+
+/*
+   pmm::pp_wait_load()
+   blocks until the job is finished and hands out its model, nullptr
+   when it failed, was cancelled or the model was handed out before
+ */
+
+pmm::model_t *pmm::pp_wait_load( pmm::load_job_t *job ){
+	pmm::model_t *model;
+
+
+	/* dummy check */
+	if ( job == nullptr ) {
+		return nullptr;
+	}
+
+	std::unique_lock<std::mutex> lock( _pico_async_mutex );
+	_pico_async_finish.wait( lock, [job](){ return job->status != pmm::ls_queued && job->status != pmm::ls_running; } );
+	model = job->model;
+	job->model = nullptr;
+	return model;
+}
+
+/*
+   pmm::pp_free_load()
+   lets go of a handle. a pending job is cancelled, its callback still runs
+ */
+
+void pmm::pp_free_load( pmm::load_job_t *job ){
+	if ( job == nullptr ) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock( _pico_async_mutex );
+
+	_pico_async_cancel( job );
+	_pico_async_release( job );
+}
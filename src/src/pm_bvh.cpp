@@ -0,0 +1,860 @@
+/* -----------------------------------------------------------------------------
+
+   PicoModel Library
+
+   Copyright (c) 2002, Randy Reddig & seaw0lf
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification,
+   are permitted provided that the following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list
+   of conditions and the following disclaimer.
+
+   Redistributions in binary form must reproduce the above copyright notice, this
+   list of conditions and the following disclaimer in the documentation and/or
+   other materials provided with the distribution.
+
+   Neither the names of the copyright holders nor the names of its contributors may
+   be used to endorse or promote products derived from this software without
+   specific prior written permission.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+   ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+   ANY DIRECT, INDIRECT, INCidentAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+   (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+   LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+   ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   ----------------------------------------------------------------------------- */
+
+/* triangle bounding volume hierarchy and ray queries over a model */
+
+#include <pmpmesh/pmpmesh.hpp>
+#include <pmpmesh/pm_internal.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if GDEF_SIMD_SSE2
+#include <immintrin.h>
+#endif
+
+#define BVH_BINS            16      /* centroid bins per axis tried by the build */
+#define BVH_MAX_LEAF        8       /* larger leaves are split even when sah disagrees */
+#define BVH_MAX_DEPTH       64      /* traversal stacks are sized from this */
+#define BVH_TASK_MIN        1024    /* smallest subtree handed to a build thread */
+
+/* node of the hierarchy: a box, and either two children at first and
+   first + 1 (count 0) or 'count' triangles from 'first' */
+class picoBvhNode_t
+{
+public:
+	pmm::vec3_t mins, maxs;
+	int first, count;
+};
+
+/* triangle stored for intersection, in leaf order */
+class picoBvhTriangle_t
+{
+public:
+	pmm::vec3_t v0, e1, e2;     /* corner 0, and corners 1 and 2 minus corner 0 */
+	int surface, triangle;
+};
+
+class pmm::bvh_t
+{
+public:
+	picoBvhNode_t               *nodes;
+	int numNodes;
+	picoBvhTriangle_t           *triangles;
+	int numTriangles;
+};
+
+/* per triangle data used while building */
+class picoBvhBuild_t
+{
+public:
+	std::vector<float> mins, maxs, centers;    /* 3 floats per triangle */
+	std::vector<int> order;                    /* triangles, regrouped as leaves form */
+};
+
+class picoBvhTask_t
+{
+public:
+	int node, first, count, depth;
+};
+
+
+
+/* ----------------------------------------------------------------------------
+   build
+   ---------------------------------------------------------------------------- */
+
+static void _pico_box_clear( pmm::vec_t *mins, pmm::vec_t *maxs ){
+	mins[ 0 ] = mins[ 1 ] = mins[ 2 ] = FLT_MAX;
+	maxs[ 0 ] = maxs[ 1 ] = maxs[ 2 ] = -FLT_MAX;
+}
+
+static float _pico_box_area( const pmm::vec_t *mins, const pmm::vec_t *maxs ){
+	float x = maxs[ 0 ] - mins[ 0 ], y = maxs[ 1 ] - mins[ 1 ], z = maxs[ 2 ] - mins[ 2 ];
+
+	return x < 0 ? 0 : x * y + y * z + z * x;
+}
+
+static void _pico_box_add( pmm::vec_t *mins, pmm::vec_t *maxs, const pmm::vec_t *boxMins, const pmm::vec_t *boxMaxs ){
+	int j;
+
+	for ( j = 0; j < 3; j++ )
+	{
+		mins[ j ] = boxMins[ j ] < mins[ j ] ? boxMins[ j ] : mins[ j ];
+		maxs[ j ] = boxMaxs[ j ] > maxs[ j ] ? boxMaxs[ j ] : maxs[ j ];
+	}
+}
+
+/* _pico_bvh_split:
+ *  fits the node box around its triangles, then looks for the cheapest
+ *  binned sah split. returns the number of triangles moved to the left
+ *  half of the range, or 0 if the node should stay a leaf
+ */
+static int _pico_bvh_split( picoBvhBuild_t *build, picoBvhNode_t *node, int first, int count, int depth ){
+	pmm::vec3_t cmins, cmaxs;
+	float bestCost, binMins[ BVH_BINS ][ 3 ], binMaxs[ BVH_BINS ][ 3 ], rightArea[ BVH_BINS ];
+	int binCount[ BVH_BINS ], bestAxis = -1, bestBin = 0, i, j, axis;
+
+	_pico_box_clear( node->mins, node->maxs );
+	_pico_box_clear( cmins, cmaxs );
+	for ( i = first; i < first + count; i++ )
+	{
+		int t = build->order[ i ];
+		_pico_box_add( node->mins, node->maxs, &build->mins[ t * 3 ], &build->maxs[ t * 3 ] );
+		_pico_expand_bounds( &build->centers[ t * 3 ], cmins, cmaxs );
+	}
+	if ( count <= 2 || depth >= BVH_MAX_DEPTH - 1 ) {
+		return 0;
+	}
+
+	/* leaf cost: one unit per triangle over the node area */
+	bestCost = count <= BVH_MAX_LEAF ? _pico_box_area( node->mins, node->maxs ) * count : FLT_MAX;
+	for ( axis = 0; axis < 3; axis++ )
+	{
+		float extent = cmaxs[ axis ] - cmins[ axis ], scale, leftArea;
+		pmm::vec3_t mins, maxs;
+		int leftCount;
+
+		if ( extent <= 0 ) {
+			continue;
+		}
+		scale = BVH_BINS / extent;
+		for ( j = 0; j < BVH_BINS; j++ )
+		{
+			binCount[ j ] = 0;
+			_pico_box_clear( binMins[ j ], binMaxs[ j ] );
+		}
+		for ( i = first; i < first + count; i++ )
+		{
+			int t = build->order[ i ];
+			int bin = (int) ( ( build->centers[ t * 3 + axis ] - cmins[ axis ] ) * scale );
+			bin = bin < BVH_BINS ? bin : BVH_BINS - 1;
+			binCount[ bin ]++;
+			_pico_box_add( binMins[ bin ], binMaxs[ bin ], &build->mins[ t * 3 ], &build->maxs[ t * 3 ] );
+		}
+
+		/* sweep from the right, then from the left */
+		_pico_box_clear( mins, maxs );
+		for ( j = BVH_BINS - 1; j > 0; j-- )
+		{
+			_pico_box_add( mins, maxs, binMins[ j ], binMaxs[ j ] );
+			rightArea[ j ] = _pico_box_area( mins, maxs );
+		}
+		_pico_box_clear( mins, maxs );
+		leftCount = 0;
+		for ( j = 0; j < BVH_BINS - 1; j++ )
+		{
+			float cost;
+			_pico_box_add( mins, maxs, binMins[ j ], binMaxs[ j ] );
+			leftCount += binCount[ j ];
+			leftArea = _pico_box_area( mins, maxs );
+			if ( leftCount == 0 || leftCount == count ) {
+				continue;
+			}
+			cost = leftArea * leftCount + rightArea[ j + 1 ] * ( count - leftCount );
+			if ( cost < bestCost ) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = j;
+			}
+		}
+	}
+	if ( bestAxis < 0 ) {
+		return 0;
+	}
+
+	/* move the triangles of bins 0 .. bestBin to the front */
+	float scale = BVH_BINS / ( cmaxs[ bestAxis ] - cmins[ bestAxis ] ), low = cmins[ bestAxis ];
+	auto middle = std::partition( build->order.begin() + first, build->order.begin() + first + count, [build, bestAxis, bestBin, scale, low]( int t ){
+		int bin = (int) ( ( build->centers[ t * 3 + bestAxis ] - low ) * scale );
+		return ( bin < BVH_BINS ? bin : BVH_BINS - 1 ) <= bestBin;
+	} );
+	return (int) ( middle - ( build->order.begin() + first ) );
+}
+
+/* _pico_bvh_build_subtree:
+ *  builds the hierarchy below nodes[ 0 ], a root over 'count' triangles from 'first'
+ */
+static void _pico_bvh_build_subtree( picoBvhBuild_t *build, std::vector<picoBvhNode_t> &nodes, int first, int count, int depth ){
+	std::vector<picoBvhTask_t> stack;
+
+	stack.push_back( { 0, first, count, depth } );
+	while ( !stack.empty() )
+	{
+		picoBvhTask_t task = stack.back();
+		int left;
+
+		stack.pop_back();
+		left = _pico_bvh_split( build, &nodes[ task.node ], task.first, task.count, task.depth );
+		if ( left == 0 ) {
+			nodes[ task.node ].first = task.first;
+			nodes[ task.node ].count = task.count;
+			continue;
+		}
+		nodes[ task.node ].first = (int) nodes.size();
+		nodes[ task.node ].count = 0;
+		nodes.resize( nodes.size() + 2 );
+		stack.push_back( { nodes[ task.node ].first, task.first, left, task.depth + 1 } );
+		stack.push_back( { nodes[ task.node ].first + 1, task.first + left, task.count - left, task.depth + 1 } );
+	}
+}
+
+/*
+   pmm::pp_build_bvh()
+   builds a bounding volume hierarchy over the triangles of every triangle
+   surface of a model, with binned sah splits. the upper levels are split
+   first, then the subtrees below them are built on worker threads. the
+   hierarchy keeps its own copy of the triangles, so rebuild it after the
+   model changes.
+   returns the hierarchy, free it with pmm::pp_free_bvh(), or nullptr on error
+ */
+
+pmm::bvh_t *pmm::pp_build_bvh( pmm::model_t *model ){
+	picoBvhBuild_t build;
+	pmm::bvh_t *bvh;
+	std::vector<pmm::surface_t *> surfaces;
+	std::vector<int> surfaceNums, firstTriangle;
+	int numTriangles, taskMin, i, j;
+
+
+	/* dummy check */
+	if ( model == nullptr ) {
+		return nullptr;
+	}
+	if ( !_pico_expand_compact_model( model, "pp_build_bvh" ) ) {
+		return nullptr;
+	}
+
+	/* number the valid triangles of all surfaces */
+	numTriangles = 0;
+	for ( i = 0; i < model->num_surfaces; i++ )
+	{
+		pmm::surface_t *surface = model->surface[ i ];
+		if ( surface == nullptr || surface->type != pmm::st_triangles ) {
+			continue;
+		}
+		surfaces.push_back( surface );
+		surfaceNums.push_back( i );
+		firstTriangle.push_back( numTriangles );
+		numTriangles += surface->numIndexes / 3;
+	}
+	firstTriangle.push_back( numTriangles );
+	build.mins.resize( numTriangles * 3 );
+	build.maxs.resize( numTriangles * 3 );
+	build.centers.resize( numTriangles * 3 );
+	std::vector<char> valid( numTriangles );
+	_pico_parallel_for( (int) surfaces.size(), 1, [&]( int first, int last ){
+		for ( int s = first; s < last; s++ )
+		{
+			pmm::surface_t *surface = surfaces[ s ];
+			for ( int t = 0, k = firstTriangle[ s ]; k < firstTriangle[ s + 1 ]; t++, k++ )
+			{
+				valid[ k ] = _pico_triangle_is_valid( surface, t );
+				if ( !valid[ k ] ) {
+					continue;
+				}
+				_pico_box_clear( &build.mins[ k * 3 ], &build.maxs[ k * 3 ] );
+				for ( int c = 0; c < 3; c++ )
+					_pico_expand_bounds( surface->xyz[ surface->index[ t * 3 + c ] ], &build.mins[ k * 3 ], &build.maxs[ k * 3 ] );
+				for ( int c = 0; c < 3; c++ )
+					build.centers[ k * 3 + c ] = ( build.mins[ k * 3 + c ] + build.maxs[ k * 3 + c ] ) * 0.5f;
+			}
+		}
+	} );
+	for ( i = 0; i < numTriangles; i++ )
+		if ( valid[ i ] ) {
+			build.order.push_back( i );
+		}
+
+	bvh = reinterpret_cast<decltype(bvh)>( pmm::man.pp_m_new( sizeof( *bvh ) ) );
+	if ( bvh == nullptr ) {
+		return nullptr;
+	}
+	std::vector<picoBvhNode_t> nodes( 1 );
+	if ( build.order.empty() ) {
+		_pico_box_clear( nodes[ 0 ].mins, nodes[ 0 ].maxs );
+	}
+
+	/* split the top levels here, leaving subtrees for the threads */
+	std::vector<picoBvhTask_t> queue, tasks;
+	taskMin = (int) build.order.size() / ( 8 * ( pmm::man.pp_num_threads() > 0 ? pmm::man.pp_num_threads() : 1 ) );
+	taskMin = taskMin > BVH_TASK_MIN ? taskMin : BVH_TASK_MIN;
+	if ( !build.order.empty() ) {
+		queue.push_back( { 0, 0, (int) build.order.size(), 0 } );
+	}
+	while ( !queue.empty() )
+	{
+		picoBvhTask_t task = queue.back();
+		int left;
+
+		queue.pop_back();
+		if ( task.count <= taskMin ) {
+			tasks.push_back( task );
+			continue;
+		}
+		left = _pico_bvh_split( &build, &nodes[ task.node ], task.first, task.count, task.depth );
+		if ( left == 0 ) {
+			nodes[ task.node ].first = task.first;
+			nodes[ task.node ].count = task.count;
+			continue;
+		}
+		nodes[ task.node ].first = (int) nodes.size();
+		nodes[ task.node ].count = 0;
+		nodes.resize( nodes.size() + 2 );
+		queue.push_back( { nodes[ task.node ].first, task.first, left, task.depth + 1 } );
+		queue.push_back( { nodes[ task.node ].first + 1, task.first + left, task.count - left, task.depth + 1 } );
+	}
+
+	/* subtrees are uneven, so the threads take them one at a time, biggest first */
+	std::sort( tasks.begin(), tasks.end(), []( const picoBvhTask_t& a, const picoBvhTask_t& b ){ return a.count > b.count; } );
+	std::vector<std::vector<picoBvhNode_t>> subtrees( tasks.size() );
+	std::atomic<int> next( 0 );
+	_pico_parallel_for( (int) tasks.size(), 1, [&]( int, int ){
+		int k;
+		while ( ( k = next++ ) < (int) tasks.size() )
+		{
+			subtrees[ k ].resize( 1 );
+			_pico_bvh_build_subtree( &build, subtrees[ k ], tasks[ k ].first, tasks[ k ].count, tasks[ k ].depth );
+		}
+	} );
+
+	/* splice each subtree in place of its root, its other nodes go at the end */
+	for ( i = 0; i < (int) tasks.size(); i++ )
+	{
+		int offset = (int) nodes.size() - 1;
+		std::vector<picoBvhNode_t> &subtree = subtrees[ i ];
+		for ( j = 0; j < (int) subtree.size(); j++ )
+			if ( subtree[ j ].count == 0 ) {
+				subtree[ j ].first += offset;
+			}
+		nodes[ tasks[ i ].node ] = subtree[ 0 ];
+		nodes.insert( nodes.end(), subtree.begin() + 1, subtree.end() );
+	}
+
+	/* the finished arrays */
+	bvh->numNodes = (int) nodes.size();
+	bvh->numTriangles = (int) build.order.size();
+	bvh->nodes = reinterpret_cast<picoBvhNode_t *>( pmm::man.pp_k_new( bvh->numNodes, sizeof( *bvh->nodes ) ) );
+	bvh->triangles = reinterpret_cast<picoBvhTriangle_t *>( pmm::man.pp_k_new( bvh->numTriangles, sizeof( *bvh->triangles ) ) );
+	if ( bvh->nodes == nullptr || ( bvh->numTriangles > 0 && bvh->triangles == nullptr ) ) {
+		pmm::pp_free_bvh( bvh );
+		return nullptr;
+	}
+	memcpy( bvh->nodes, nodes.data(), bvh->numNodes * sizeof( *bvh->nodes ) );
+
+	/* triangles in leaf order */
+	_pico_parallel_for( (int) build.order.size(), 4096, [&]( int first, int last ){
+		for ( int k = first; k < last; k++ )
+		{
+			int t = build.order[ k ];
+			/* the last surface starting at or before t, which skips empty ones */
+			int s = (int) ( std::upper_bound( firstTriangle.begin(), firstTriangle.end(), t ) - firstTriangle.begin() ) - 1;
+			pmm::surface_t *surface = surfaces[ s ];
+			picoBvhTriangle_t *tri = &bvh->triangles[ k ];
+			pmm::index_t *index;
+
+			tri->surface = surfaceNums[ s ];
+			tri->triangle = t - firstTriangle[ s ];
+			index = surface->index + tri->triangle * 3;
+			_pico_copy_vec( surface->xyz[ index[ 0 ] ], tri->v0 );
+			_pico_subtract_vec( surface->xyz[ index[ 1 ] ], tri->v0, tri->e1 );
+			_pico_subtract_vec( surface->xyz[ index[ 2 ] ], tri->v0, tri->e2 );
+		}
+	} );
+
+	return bvh;
+}
+
+/*
+   pmm::pp_free_bvh()
+   frees a hierarchy built by pmm::pp_build_bvh()
+ */
+
+void pmm::pp_free_bvh( pmm::bvh_t *bvh ){
+	if ( bvh == nullptr ) {
+		return;
+	}
+	pmm::man.pp_m_delete( bvh->nodes );
+	pmm::man.pp_m_delete( bvh->triangles );
+	pmm::man.pp_m_delete( bvh );
+}
+
+
+
+/* ----------------------------------------------------------------------------
+   single rays
+   ---------------------------------------------------------------------------- */
+
+/* reciprocal direction, with zero components turned into huge slopes */
+static void _pico_ray_inverse( const pmm::vec_t *dir, pmm::vec_t *inverse ){
+	int j;
+
+	for ( j = 0; j < 3; j++ )
+		inverse[ j ] = dir[ j ] != 0 ? 1.0f / dir[ j ] : ( std::signbit( dir[ j ] ) ? -FLT_MAX : FLT_MAX );
+}
+
+/* distance along the ray to where it enters the box, or FLT_MAX if it
+   misses it before 'tMax' */
+static float _pico_ray_box( const picoBvhNode_t *node, const pmm::vec_t *origin, const pmm::vec_t *inverse, float tMax ){
+	float tNear = 0, tFar = tMax;
+	int j;
+
+	for ( j = 0; j < 3; j++ )
+	{
+		float t0 = ( node->mins[ j ] - origin[ j ] ) * inverse[ j ];
+		float t1 = ( node->maxs[ j ] - origin[ j ] ) * inverse[ j ];
+		tNear = std::max( tNear, std::min( t0, t1 ) );
+		tFar = std::min( tFar, std::max( t0, t1 ) );
+	}
+	return tNear <= tFar ? tNear : FLT_MAX;
+}
+
+/* moller-trumbore, both sides. updates 'hit' and returns 1 when the
+   triangle is hit closer than hit->t */
+static int _pico_ray_triangle( const picoBvhTriangle_t *tri, const pmm::vec_t *origin, const pmm::vec_t *dir, pmm::ray_hit_t *hit ){
+	pmm::vec3_t p, q, s;
+	float det, inv, u, v, t;
+
+	_pico_cross_vec( (pmm::vec_t *) dir, (pmm::vec_t *) tri->e2, p );
+	det = (float) _pico_dot_vec( (pmm::vec_t *) tri->e1, p );
+	if ( det == 0 ) {
+		return 0;
+	}
+	inv = 1.0f / det;
+	_pico_subtract_vec( (pmm::vec_t *) origin, (pmm::vec_t *) tri->v0, s );
+	u = (float) _pico_dot_vec( s, p ) * inv;
+	if ( u < 0 || u > 1 ) {
+		return 0;
+	}
+	_pico_cross_vec( s, (pmm::vec_t *) tri->e1, q );
+	v = (float) _pico_dot_vec( (pmm::vec_t *) dir, q ) * inv;
+	if ( v < 0 || u + v > 1 ) {
+		return 0;
+	}
+	t = (float) _pico_dot_vec( (pmm::vec_t *) tri->e2, q ) * inv;
+	if ( t <= 0 || t >= hit->t ) {
+		return 0;
+	}
+	hit->t = t;
+	hit->u = u;
+	hit->v = v;
+	hit->surface = tri->surface;
+	hit->triangle = tri->triangle;
+	return 1;
+}
+
+/* _pico_bvh_trace:
+ *  closest hit, or with 'any' set the first one found
+ */
+static int _pico_bvh_trace( const pmm::bvh_t *bvh, const pmm::vec_t *origin, const pmm::vec_t *dir, pmm::ray_hit_t *hit, int any ){
+	const picoBvhNode_t *stack[ BVH_MAX_DEPTH + 1 ], *node;
+	pmm::vec3_t inverse;
+	int numStack = 0, found = 0, i;
+
+	_pico_ray_inverse( dir, inverse );
+	node = &bvh->nodes[ 0 ];
+	if ( _pico_ray_box( node, origin, inverse, hit->t ) == FLT_MAX ) {
+		return 0;
+	}
+	while ( 1 )
+	{
+		if ( node->count > 0 ) {
+			for ( i = node->first; i < node->first + node->count; i++ )
+				if ( _pico_ray_triangle( &bvh->triangles[ i ], origin, dir, hit ) ) {
+					found = 1;
+					if ( any ) {
+						return 1;
+					}
+				}
+		}
+		else
+		{
+			/* nearer child first */
+			const picoBvhNode_t *nearChild = &bvh->nodes[ node->first ], *farChild = nearChild + 1;
+			float dNear = _pico_ray_box( nearChild, origin, inverse, hit->t ), dFar = _pico_ray_box( farChild, origin, inverse, hit->t );
+			if ( dFar < dNear ) {
+				std::swap( nearChild, farChild );
+				std::swap( dNear, dFar );
+			}
+			if ( dNear != FLT_MAX ) {
+				if ( dFar != FLT_MAX ) {
+					stack[ numStack++ ] = farChild;
+				}
+				node = nearChild;
+				continue;
+			}
+		}
+		if ( numStack == 0 ) {
+			break;
+		}
+		node = stack[ --numStack ];
+	}
+	return found;
+}
+
+/*
+   pmm::pp_ray_intersect()
+   finds the closest triangle hit by the ray origin + t * dir, 0 < t < tMax.
+   hit gets t, the model surface and triangle numbers, and barycentrics
+   u and v of the hit point ( 1 - u - v ) * xyz0 + u * xyz1 + v * xyz2.
+   returns 1 if something was hit, else 0
+ */
+
+int pmm::pp_ray_intersect( pmm::bvh_t *bvh, pmm::vec3_t origin, pmm::vec3_t dir, float tMax, pmm::ray_hit_t *hit ){
+	/* dummy check */
+	if ( bvh == nullptr || hit == nullptr ) {
+		return 0;
+	}
+	hit->t = tMax;
+	hit->surface = hit->triangle = -1;
+	hit->u = hit->v = 0;
+	if ( bvh->numTriangles == 0 ) {
+		return 0;
+	}
+	return _pico_bvh_trace( bvh, origin, dir, hit, 0 );
+}
+
+/*
+   pmm::pp_ray_occluded()
+   returns 1 if any triangle lies on the ray origin + t * dir, 0 < t < tMax
+ */
+
+int pmm::pp_ray_occluded( pmm::bvh_t *bvh, pmm::vec3_t origin, pmm::vec3_t dir, float tMax ){
+	pmm::ray_hit_t hit;
+
+	/* dummy check */
+	if ( bvh == nullptr || bvh->numTriangles == 0 ) {
+		return 0;
+	}
+	hit.t = tMax;
+	return _pico_bvh_trace( bvh, origin, dir, &hit, 1 );
+}
+
+
+
+/* ----------------------------------------------------------------------------
+   packets
+   ---------------------------------------------------------------------------- */
+
+#if GDEF_SIMD_AVX
+
+#define BVH_PACKET 8
+using picoLanes_t = __m256;
+static inline picoLanes_t _pico_lanes_set( float f ){ return _mm256_set1_ps( f ); }
+static inline picoLanes_t _pico_lanes_load( const float *f ){ return _mm256_loadu_ps( f ); }
+static inline void _pico_lanes_store( float *f, picoLanes_t a ){ _mm256_storeu_ps( f, a ); }
+static inline picoLanes_t _pico_lanes_add( picoLanes_t a, picoLanes_t b ){ return _mm256_add_ps( a, b ); }
+static inline picoLanes_t _pico_lanes_sub( picoLanes_t a, picoLanes_t b ){ return _mm256_sub_ps( a, b ); }
+static inline picoLanes_t _pico_lanes_mul( picoLanes_t a, picoLanes_t b ){ return _mm256_mul_ps( a, b ); }
+static inline picoLanes_t _pico_lanes_div( picoLanes_t a, picoLanes_t b ){ return _mm256_div_ps( a, b ); }
+static inline picoLanes_t _pico_lanes_min( picoLanes_t a, picoLanes_t b ){ return _mm256_min_ps( a, b ); }
+static inline picoLanes_t _pico_lanes_max( picoLanes_t a, picoLanes_t b ){ return _mm256_max_ps( a, b ); }
+static inline picoLanes_t _pico_lanes_less( picoLanes_t a, picoLanes_t b ){ return _mm256_cmp_ps( a, b, _CMP_LT_OQ ); }
+static inline picoLanes_t _pico_lanes_less_equal( picoLanes_t a, picoLanes_t b ){ return _mm256_cmp_ps( a, b, _CMP_LE_OQ ); }
+static inline picoLanes_t _pico_lanes_and( picoLanes_t a, picoLanes_t b ){ return _mm256_and_ps( a, b ); }
+static inline picoLanes_t _pico_lanes_and_not( picoLanes_t mask, picoLanes_t a ){ return _mm256_andnot_ps( mask, a ); }
+static inline picoLanes_t _pico_lanes_select( picoLanes_t mask, picoLanes_t a, picoLanes_t b ){ return _mm256_blendv_ps( b, a, mask ); }
+static inline int _pico_lanes_mask( picoLanes_t mask ){ return _mm256_movemask_ps( mask ); }
+
+#elif GDEF_SIMD_SSE2
+
+#define BVH_PACKET 4
+using picoLanes_t = __m128;
+static inline picoLanes_t _pico_lanes_set( float f ){ return _mm_set1_ps( f ); }
+static inline picoLanes_t _pico_lanes_load( const float *f ){ return _mm_loadu_ps( f ); }
+static inline void _pico_lanes_store( float *f, picoLanes_t a ){ _mm_storeu_ps( f, a ); }
+static inline picoLanes_t _pico_lanes_add( picoLanes_t a, picoLanes_t b ){ return _mm_add_ps( a, b ); }
+static inline picoLanes_t _pico_lanes_sub( picoLanes_t a, picoLanes_t b ){ return _mm_sub_ps( a, b ); }
+static inline picoLanes_t _pico_lanes_mul( picoLanes_t a, picoLanes_t b ){ return _mm_mul_ps( a, b ); }
+static inline picoLanes_t _pico_lanes_div( picoLanes_t a, picoLanes_t b ){ return _mm_div_ps( a, b ); }
+static inline picoLanes_t _pico_lanes_min( picoLanes_t a, picoLanes_t b ){ return _mm_min_ps( a, b ); }
+static inline picoLanes_t _pico_lanes_max( picoLanes_t a, picoLanes_t b ){ return _mm_max_ps( a, b ); }
+static inline picoLanes_t _pico_lanes_less( picoLanes_t a, picoLanes_t b ){ return _mm_cmplt_ps( a, b ); }
+static inline picoLanes_t _pico_lanes_less_equal( picoLanes_t a, picoLanes_t b ){ return _mm_cmple_ps( a, b ); }
+static inline picoLanes_t _pico_lanes_and( picoLanes_t a, picoLanes_t b ){ return _mm_and_ps( a, b ); }
+static inline picoLanes_t _pico_lanes_and_not( picoLanes_t mask, picoLanes_t a ){ return _mm_andnot_ps( mask, a ); }
+static inline picoLanes_t _pico_lanes_select( picoLanes_t mask, picoLanes_t a, picoLanes_t b ){ return _mm_or_ps( _mm_and_ps( mask, a ), _mm_andnot_ps( mask, b ) ); }
+static inline int _pico_lanes_mask( picoLanes_t mask ){ return _mm_movemask_ps( mask ); }
+
+#endif
+
+#ifdef BVH_PACKET
+
+/* up to BVH_PACKET rays, one per lane */
+class picoRayPacket_t
+{
+public:
+	picoLanes_t origin[ 3 ], dir[ 3 ], inverse[ 3 ], t, u, v;
+	int surface[ BVH_PACKET ], triangle[ BVH_PACKET ];
+	int live;       /* lanes still looking for a hit, one bit each */
+};
+
+/* lanes whose ray enters the box before their current t */
+static int _pico_packet_box( const picoBvhNode_t *node, const picoRayPacket_t *packet ){
+	picoLanes_t tNear = _pico_lanes_set( 0 ), tFar = packet->t;
+	int j;
+
+	for ( j = 0; j < 3; j++ )
+	{
+		picoLanes_t t0 = _pico_lanes_mul( _pico_lanes_sub( _pico_lanes_set( node->mins[ j ] ), packet->origin[ j ] ), packet->inverse[ j ] );
+		picoLanes_t t1 = _pico_lanes_mul( _pico_lanes_sub( _pico_lanes_set( node->maxs[ j ] ), packet->origin[ j ] ), packet->inverse[ j ] );
+		tNear = _pico_lanes_max( tNear, _pico_lanes_min( t0, t1 ) );
+		tFar = _pico_lanes_min( tFar, _pico_lanes_max( t0, t1 ) );
+	}
+	return _pico_lanes_mask( _pico_lanes_less_equal( tNear, tFar ) ) & packet->live;
+}
+
+/* lanes hitting the triangle closer than their current t, which is updated */
+static int _pico_packet_triangle( const picoBvhTriangle_t *tri, picoRayPacket_t *packet ){
+	picoLanes_t e1[ 3 ], e2[ 3 ], s[ 3 ], p[ 3 ], q[ 3 ], det, inv, u, v, t, zero = _pico_lanes_set( 0 ), one = _pico_lanes_set( 1 ), ok;
+	int j, mask;
+
+	for ( j = 0; j < 3; j++ )
+	{
+		e1[ j ] = _pico_lanes_set( tri->e1[ j ] );
+		e2[ j ] = _pico_lanes_set( tri->e2[ j ] );
+		s[ j ] = _pico_lanes_sub( packet->origin[ j ], _pico_lanes_set( tri->v0[ j ] ) );
+	}
+	for ( j = 0; j < 3; j++ )
+	{
+		int a = ( j + 1 ) % 3, b = ( j + 2 ) % 3;
+		p[ j ] = _pico_lanes_sub( _pico_lanes_mul( packet->dir[ a ], e2[ b ] ), _pico_lanes_mul( packet->dir[ b ], e2[ a ] ) );
+		q[ j ] = _pico_lanes_sub( _pico_lanes_mul( s[ a ], e1[ b ] ), _pico_lanes_mul( s[ b ], e1[ a ] ) );
+	}
+	det = _pico_lanes_add( _pico_lanes_add( _pico_lanes_mul( e1[ 0 ], p[ 0 ] ), _pico_lanes_mul( e1[ 1 ], p[ 1 ] ) ), _pico_lanes_mul( e1[ 2 ], p[ 2 ] ) );
+	inv = _pico_lanes_div( one, det );
+	u = _pico_lanes_mul( _pico_lanes_add( _pico_lanes_add( _pico_lanes_mul( s[ 0 ], p[ 0 ] ), _pico_lanes_mul( s[ 1 ], p[ 1 ] ) ), _pico_lanes_mul( s[ 2 ], p[ 2 ] ) ), inv );
+	v = _pico_lanes_mul( _pico_lanes_add( _pico_lanes_add( _pico_lanes_mul( packet->dir[ 0 ], q[ 0 ] ), _pico_lanes_mul( packet->dir[ 1 ], q[ 1 ] ) ), _pico_lanes_mul( packet->dir[ 2 ], q[ 2 ] ) ), inv );
+	t = _pico_lanes_mul( _pico_lanes_add( _pico_lanes_add( _pico_lanes_mul( e2[ 0 ], q[ 0 ] ), _pico_lanes_mul( e2[ 1 ], q[ 1 ] ) ), _pico_lanes_mul( e2[ 2 ], q[ 2 ] ) ), inv );
+
+	/* a zero determinant gives infinite or nan values, which fail these */
+	ok = _pico_lanes_and( _pico_lanes_less_equal( zero, u ), _pico_lanes_less_equal( zero, v ) );
+	ok = _pico_lanes_and( ok, _pico_lanes_less_equal( _pico_lanes_add( u, v ), one ) );
+	ok = _pico_lanes_and( ok, _pico_lanes_and( _pico_lanes_less( zero, t ), _pico_lanes_less( t, packet->t ) ) );
+	mask = _pico_lanes_mask( ok ) & packet->live;
+	if ( mask == 0 ) {
+		return 0;
+	}
+	packet->t = _pico_lanes_select( ok, t, packet->t );
+	packet->u = _pico_lanes_select( ok, u, packet->u );
+	packet->v = _pico_lanes_select( ok, v, packet->v );
+	for ( j = 0; j < BVH_PACKET; j++ )
+		if ( mask & ( 1 << j ) ) {
+			packet->surface[ j ] = tri->surface;
+			packet->triangle[ j ] = tri->triangle;
+		}
+	return mask;
+}
+
+/* _pico_bvh_trace_packet:
+ *  traces the live lanes of a packet together; with 'any' set a lane
+ *  retires at its first hit. returns the lanes that hit something
+ */
+static int _pico_bvh_trace_packet( const pmm::bvh_t *bvh, picoRayPacket_t *packet, int any ){
+	const picoBvhNode_t *stack[ BVH_MAX_DEPTH + 1 ], *node;
+	float origin[ 3 ][ BVH_PACKET ], dir[ 3 ][ BVH_PACKET ];
+	int numStack = 0, found = 0, lead, i, j;
+
+	for ( j = 0; j < 3; j++ )
+	{
+		_pico_lanes_store( origin[ j ], packet->origin[ j ] );
+		_pico_lanes_store( dir[ j ], packet->dir[ j ] );
+	}
+	stack[ numStack++ ] = &bvh->nodes[ 0 ];
+	while ( numStack > 0 && packet->live != 0 )
+	{
+		node = stack[ --numStack ];
+		if ( _pico_packet_box( node, packet ) == 0 ) {
+			continue;
+		}
+		if ( node->count > 0 ) {
+			for ( i = node->first; i < node->first + node->count && packet->live != 0; i++ )
+			{
+				int mask = _pico_packet_triangle( &bvh->triangles[ i ], packet );
+				found |= mask;
+				if ( any ) {
+					packet->live &= ~mask;
+				}
+			}
+			continue;
+		}
+
+		/* children are tested when popped; the nearer one along the
+		   first live ray goes on top */
+		const picoBvhNode_t *nearChild = &bvh->nodes[ node->first ], *farChild = nearChild + 1;
+		float dNear = 0, dFar = 0;
+		for ( lead = 0; !( packet->live & ( 1 << lead ) ); lead++ )
+			;
+		for ( j = 0; j < 3; j++ )
+		{
+			dNear += ( nearChild->mins[ j ] + nearChild->maxs[ j ] ) * dir[ j ][ lead ];
+			dFar += ( farChild->mins[ j ] + farChild->maxs[ j ] ) * dir[ j ][ lead ];
+		}
+		if ( dFar < dNear ) {
+			std::swap( nearChild, farChild );
+		}
+		stack[ numStack++ ] = farChild;
+		stack[ numStack++ ] = nearChild;
+	}
+	return found;
+}
+
+/* _pico_bvh_packets:
+ *  runs 'numRays' rays through the hierarchy in packets of BVH_PACKET
+ */
+static void _pico_bvh_packets( const pmm::bvh_t *bvh, int numRays, pmm::vec3_t *origins, pmm::vec3_t *dirs, const float *tMax, pmm::ray_hit_t *hits, int *occluded ){
+	int first, i, j;
+
+	for ( first = 0; first < numRays; first += BVH_PACKET )
+	{
+		float lanes[ 3 ][ 3 ][ BVH_PACKET ], t[ BVH_PACKET ];
+		int count = numRays - first < BVH_PACKET ? numRays - first : BVH_PACKET, found;
+		picoRayPacket_t packet;
+
+		/* spare lanes get a dead ray */
+		for ( i = 0; i < BVH_PACKET; i++ )
+		{
+			pmm::vec_t zero[ 3 ] = { 0, 0, 1 }, *origin = i < count ? origins[ first + i ] : zero, *dir = i < count ? dirs[ first + i ] : zero;
+			pmm::vec3_t inverse;
+			_pico_ray_inverse( dir, inverse );
+			for ( j = 0; j < 3; j++ )
+			{
+				lanes[ 0 ][ j ][ i ] = origin[ j ];
+				lanes[ 1 ][ j ][ i ] = dir[ j ];
+				lanes[ 2 ][ j ][ i ] = inverse[ j ];
+			}
+			t[ i ] = i < count ? tMax[ first + i ] : 0;
+		}
+		for ( j = 0; j < 3; j++ )
+		{
+			packet.origin[ j ] = _pico_lanes_load( lanes[ 0 ][ j ] );
+			packet.dir[ j ] = _pico_lanes_load( lanes[ 1 ][ j ] );
+			packet.inverse[ j ] = _pico_lanes_load( lanes[ 2 ][ j ] );
+		}
+		packet.t = _pico_lanes_load( t );
+		packet.u = packet.v = _pico_lanes_set( 0 );
+		packet.live = ( 1 << count ) - 1;
+		for ( i = 0; i < BVH_PACKET; i++ )
+			packet.surface[ i ] = packet.triangle[ i ] = -1;
+
+		found = _pico_bvh_trace_packet( bvh, &packet, occluded != nullptr );
+
+		if ( occluded != nullptr ) {
+			for ( i = 0; i < count; i++ )
+				occluded[ first + i ] = ( found >> i ) & 1;
+			continue;
+		}
+		float u[ BVH_PACKET ], v[ BVH_PACKET ];
+		_pico_lanes_store( t, packet.t );
+		_pico_lanes_store( u, packet.u );
+		_pico_lanes_store( v, packet.v );
+		for ( i = 0; i < count; i++ )
+		{
+			hits[ first + i ].t = t[ i ];
+			hits[ first + i ].u = u[ i ];
+			hits[ first + i ].v = v[ i ];
+			hits[ first + i ].surface = packet.surface[ i ];
+			hits[ first + i ].triangle = packet.triangle[ i ];
+		}
+	}
+}
+
+#endif
+
+/*
+   pmm::pp_ray_intersect_packet()
+   pmm::pp_ray_intersect() for 'numRays' rays, traced BVH_PACKET (8 with
+   avx, 4 with sse2) at a time. rays in a packet share the traversal, so
+   group rays that start and point alike. hits[ i ].triangle is -1 where
+   ray i hit nothing.
+   returns the number of rays that hit something
+ */
+
+int pmm::pp_ray_intersect_packet( pmm::bvh_t *bvh, int numRays, pmm::vec3_t *origins, pmm::vec3_t *dirs, const float *tMax, pmm::ray_hit_t *hits ){
+	int numHits = 0, i;
+
+
+	/* dummy check */
+	if ( bvh == nullptr || origins == nullptr || dirs == nullptr || tMax == nullptr || hits == nullptr ) {
+		return 0;
+	}
+	if ( bvh->numTriangles == 0 ) {
+		for ( i = 0; i < numRays; i++ )
+			pmm::pp_ray_intersect( bvh, origins[ i ], dirs[ i ], tMax[ i ], &hits[ i ] );
+		return 0;
+	}
+#ifdef BVH_PACKET
+	_pico_bvh_packets( bvh, numRays, origins, dirs, tMax, hits, nullptr );
+#else
+	for ( i = 0; i < numRays; i++ )
+		pmm::pp_ray_intersect( bvh, origins[ i ], dirs[ i ], tMax[ i ], &hits[ i ] );
+#endif
+	for ( i = 0; i < numRays; i++ )
+		numHits += hits[ i ].triangle >= 0;
+	return numHits;
+}
+
+/*
+   pmm::pp_ray_occluded_packet()
+   pmm::pp_ray_occluded() for 'numRays' rays, traced like
+   pmm::pp_ray_intersect_packet(); occluded[ i ] is set to 1 or 0.
+   returns the number of occluded rays
+ */
+
+int pmm::pp_ray_occluded_packet( pmm::bvh_t *bvh, int numRays, pmm::vec3_t *origins, pmm::vec3_t *dirs, const float *tMax, int *occluded ){
+	int numOccluded = 0, i;
+
+
+	/* dummy check */
+	if ( bvh == nullptr || origins == nullptr || dirs == nullptr || tMax == nullptr || occluded == nullptr ) {
+		return 0;
+	}
+#ifdef BVH_PACKET
+	if ( bvh->numTriangles != 0 ) {
+		_pico_bvh_packets( bvh, numRays, origins, dirs, tMax, nullptr, occluded );
+	}
+	else {
+		memset( occluded, 0, numRays * sizeof( *occluded ) );
+	}
+#else
+	for ( i = 0; i < numRays; i++ )
+		occluded[ i ] = pmm::pp_ray_occluded( bvh, origins[ i ], dirs[ i ], tMax[ i ] );
+#endif
+	for ( i = 0; i < numRays; i++ )
+		numOccluded += occluded[ i ];
+	return numOccluded;
+}
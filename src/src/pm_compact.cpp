@@ -0,0 +1,431 @@
+/* -----------------------------------------------------------------------------
+
+   PicoModel Library
+
+   Copyright (c) 2002, Randy Reddig & seaw0lf
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification,
+   are permitted provided that the following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list
+   of conditions and the following disclaimer.
+
+   Redistributions in binary form must reproduce the above copyright notice, this
+   list of conditions and the following disclaimer in the documentation and/or
+   other materials provided with the distribution.
+
+   Neither the names of the copyright holders nor the names of its contributors may
+   be used to endorse or promote products derived from this software without
+   specific prior written permission.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+   ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+   ANY DIRECT, INDIRECT, INCidentAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+   (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+   LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+   ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   ----------------------------------------------------------------------------- */
+
+/* quantized in-memory surface storage */
+
+#include <pmpmesh/pmpmesh.hpp>
+#include <pmpmesh/pm_internal.hpp>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+#define COMPACT_GRAIN       16384   /* vertexes per thread when compacting or expanding one surface */
+
+
+
+/* ----------------------------------------------------------------------------
+   helpers
+   ---------------------------------------------------------------------------- */
+
+/* _pico_align_size:
+ *  rounds a byte count up to 8 so every array of the block is aligned
+ */
+static pmm::size_type _pico_align_size( pmm::size_type size ){
+	return ( size + 7 ) & ~(pmm::size_type) 7;
+}
+
+/* _pico_new_compact:
+ *  one block holding the header, the st array pointers and all arrays,
+ *  with the pointers set up
+ */
+static pmm::compact_vertexes_t *_pico_new_compact( int numVertexes, int numSTArrays, int tangents ){
+	pmm::compact_vertexes_t *compact;
+	pmm::size_type size, xyzBytes, normalBytes, tangentBytes, stBytes, pointerBytes;
+	pmm::ub8_t *p;
+	int i;
+
+	pointerBytes = _pico_align_size( numSTArrays * sizeof( *compact->st ) );
+	xyzBytes = _pico_align_size( numVertexes * sizeof( *compact->xyz ) );
+	normalBytes = _pico_align_size( numVertexes * sizeof( *compact->normal ) );
+	tangentBytes = tangents ? _pico_align_size( numVertexes * sizeof( *compact->tangent ) ) : 0;
+	stBytes = _pico_align_size( numVertexes * sizeof( pmm::half2_t ) );
+	size = _pico_align_size( sizeof( *compact ) ) + pointerBytes + xyzBytes + normalBytes + tangentBytes + numSTArrays * stBytes;
+
+	compact = reinterpret_cast<decltype(compact)>(pmm::man.pp_m_new( size ));
+	if ( compact == nullptr ) {
+		return nullptr;
+	}
+	p = reinterpret_cast<pmm::ub8_t *>( compact ) + _pico_align_size( sizeof( *compact ) );
+	compact->st = reinterpret_cast<pmm::half2_t **>( p );
+	p += pointerBytes;
+	compact->xyz = reinterpret_cast<pmm::qvec3_t *>( p );
+	p += xyzBytes;
+	compact->normal = reinterpret_cast<pmm::oct_t *>( p );
+	p += normalBytes;
+	compact->tangent = tangents ? reinterpret_cast<pmm::snorm4_t *>( p ) : nullptr;
+	p += tangentBytes;
+	compact->numSTArrays = numSTArrays;
+	for ( i = 0; i < numSTArrays; i++, p += stBytes )
+		compact->st[ i ] = reinterpret_cast<pmm::half2_t *>( p );
+	return compact;
+}
+
+/* _pico_snorm16:
+ *  [ -1, 1 ] to a rounded short
+ */
+static short _pico_snorm16( float f ){
+	f = f < -1 ? -1 : f > 1 ? 1 : f;
+	return (short) lrintf( f * 32767.0f );
+}
+
+/* _pico_compact_vertexes:
+ *  quantizes vertexes [first, last) of a surface into its compact block
+ */
+static void _pico_compact_vertexes( pmm::surface_t *surface, pmm::compact_vertexes_t *compact, const pmm::vec_t *invScale, int first, int last ){
+	int i, j;
+
+	for ( i = first; i < last; i++ )
+	{
+		pmm::vec2_t oct;
+		for ( j = 0; j < 3; j++ )
+		{
+			long q = lrintf( ( surface->xyz[ i ][ j ] - compact->origin[ j ] ) * invScale[ j ] );
+			compact->xyz[ i ][ j ] = (unsigned short) ( q < 0 ? 0 : q > 65535 ? 65535 : q );
+		}
+		_pico_oct_encode( surface->normal[ i ], oct );
+		compact->normal[ i ][ 0 ] = _pico_snorm16( oct[ 0 ] );
+		compact->normal[ i ][ 1 ] = _pico_snorm16( oct[ 1 ] );
+		if ( compact->tangent != nullptr ) {
+			for ( j = 0; j < 4; j++ )
+				compact->tangent[ i ][ j ] = _pico_snorm16( surface->tangent[ i ][ j ] );
+		}
+		for ( j = 0; j < compact->numSTArrays; j++ )
+		{
+			compact->st[ j ][ i ][ 0 ] = _pico_float_to_half( surface->st[ j ][ i ][ 0 ] );
+			compact->st[ j ][ i ][ 1 ] = _pico_float_to_half( surface->st[ j ][ i ][ 1 ] );
+		}
+	}
+}
+
+/* _pico_free_float_vertexes:
+ *  frees the float position, normal, tangent and st arrays of a surface,
+ *  leaving the st array pointers nullptr
+ */
+void _pico_free_float_vertexes( pmm::surface_t *surface ){
+	int i;
+
+	pmm::man.pp_m_delete( surface->xyz );
+	pmm::man.pp_m_delete( surface->normal );
+	pmm::man.pp_m_delete( surface->tangent );
+	surface->xyz = nullptr;
+	surface->normal = nullptr;
+	surface->tangent = nullptr;
+	for ( i = 0; i < surface->numSTArrays; i++ )
+	{
+		pmm::man.pp_m_delete( surface->st[ i ] );
+		surface->st[ i ] = nullptr;
+	}
+}
+
+/* _pico_copy_compact:
+ *  duplicates the compact block of a surface
+ */
+pmm::compact_vertexes_t *_pico_copy_compact( pmm::surface_t *surface ){
+	pmm::compact_vertexes_t *src = surface->compact, *dest;
+	int i;
+
+	dest = _pico_new_compact( surface->numVertexes, src->numSTArrays, src->tangent != nullptr );
+	if ( dest == nullptr ) {
+		return nullptr;
+	}
+	_pico_copy_vec( src->origin, dest->origin );
+	_pico_copy_vec( src->scale, dest->scale );
+	memcpy( dest->xyz, src->xyz, surface->numVertexes * sizeof( *dest->xyz ) );
+	memcpy( dest->normal, src->normal, surface->numVertexes * sizeof( *dest->normal ) );
+	if ( src->tangent != nullptr ) {
+		memcpy( dest->tangent, src->tangent, surface->numVertexes * sizeof( *dest->tangent ) );
+	}
+	for ( i = 0; i < src->numSTArrays; i++ )
+		memcpy( dest->st[ i ], src->st[ i ], surface->numVertexes * sizeof( *dest->st[ i ] ) );
+	return dest;
+}
+
+/* _pico_expand_compact:
+ *  expands a compacted surface before 'caller' reads or changes its float
+ *  arrays. returns 0, after printing an error, if it runs out of memory
+ */
+int _pico_expand_compact( pmm::surface_t *surface, const char *caller ){
+	if ( surface == nullptr || surface->compact == nullptr ) {
+		return 1;
+	}
+	if ( !pmm::pp_expand_surface( surface ) ) {
+		pmm::man.pp_print( pmm::pl_error, ( std::ostringstream{} << caller << ": could not expand compacted surface" ).str() );
+		return 0;
+	}
+	return 1;
+}
+
+/* _pico_expand_compact_model:
+ *  the same for every surface of a model
+ */
+int _pico_expand_compact_model( pmm::model_t *model, const char *caller ){
+	int i;
+
+	for ( i = 0; i < model->num_surfaces; i++ )
+		if ( !_pico_expand_compact( model->surface[ i ], caller ) ) {
+			return 0;
+		}
+	return 1;
+}
+
+/* _pico_decode_range:
+ *  checks a decode request against a surface
+ */
+static int _pico_decode_range( pmm::surface_t *surface, int first, int count, void *dest ){
+	return surface != nullptr && dest != nullptr && first >= 0 && count >= 0 && first + count <= surface->numVertexes;
+}
+
+
+
+/* ----------------------------------------------------------------------------
+   compacting
+   ---------------------------------------------------------------------------- */
+
+/*
+   pmm::pp_compact_surface()
+   replaces the float positions, normals, tangents and sts of a surface by
+   one quantized block: positions as 16 bit steps across the surface box,
+   octahedral 16 bit normals, snorm16 tangents and half float sts. colors,
+   smoothing groups, indexes and face planes stay as they are. read the
+   vertexes with the pmm::pp_decode_surface_*() functions or the per vertex
+   getters. library functions that need the float arrays, and growing the
+   surface, expand it on their own; call pmm::pp_expand_surface() before
+   reading surface->xyz and the other arrays directly.
+   returns 1 on success, 0 if out of memory
+ */
+
+int pmm::pp_compact_surface( pmm::surface_t *surface ){
+	pmm::compact_vertexes_t *compact;
+	pmm::vec3_t mins, maxs, invScale;
+	int j;
+
+
+	/* dummy check */
+	if ( surface == nullptr ) {
+		return 0;
+	}
+	if ( surface->compact != nullptr ) {
+		return 1;
+	}
+
+	compact = _pico_new_compact( surface->numVertexes, surface->numSTArrays, surface->tangent != nullptr );
+	if ( compact == nullptr ) {
+		return 0;
+	}
+	_pico_vec_bounds( surface->xyz, surface->numVertexes, mins, maxs );
+	for ( j = 0; j < 3; j++ )
+	{
+		float extent = surface->numVertexes > 0 ? maxs[ j ] - mins[ j ] : 0;
+		compact->origin[ j ] = surface->numVertexes > 0 ? mins[ j ] : 0;
+		compact->scale[ j ] = extent / 65535.0f;
+		invScale[ j ] = extent > 0 ? 65535.0f / extent : 0;
+	}
+	_pico_parallel_for( surface->numVertexes, COMPACT_GRAIN, [surface, compact, &invScale]( int first, int last ){
+		_pico_compact_vertexes( surface, compact, invScale, first, last );
+	} );
+
+	_pico_free_float_vertexes( surface );
+	_pico_free_vertex_index( surface );
+	surface->compact = compact;
+	return 1;
+}
+
+/*
+   pmm::pp_expand_surface()
+   decodes a compacted surface back into float arrays
+   returns 1 on success, 0 if out of memory
+ */
+
+int pmm::pp_expand_surface( pmm::surface_t *surface ){
+	pmm::compact_vertexes_t *compact;
+	int size, i;
+
+
+	/* dummy check */
+	if ( surface == nullptr ) {
+		return 0;
+	}
+	compact = surface->compact;
+	if ( compact == nullptr ) {
+		return 1;
+	}
+
+	/* room for what pp_adjust_surface expects */
+	size = surface->maxVertexes > 0 ? surface->maxVertexes : 1;
+	surface->xyz = reinterpret_cast<decltype(surface->xyz)>(pmm::man.pp_k_new( size, sizeof( *surface->xyz ) ));
+	surface->normal = reinterpret_cast<decltype(surface->normal)>(pmm::man.pp_k_new( size, sizeof( *surface->normal ) ));
+	if ( compact->tangent != nullptr ) {
+		surface->tangent = reinterpret_cast<decltype(surface->tangent)>(pmm::man.pp_k_new( size, sizeof( *surface->tangent ) ));
+	}
+	for ( i = 0; i < compact->numSTArrays; i++ )
+		surface->st[ i ] = reinterpret_cast<pmm::vec2_t *>(pmm::man.pp_k_new( size, sizeof( *surface->st[ i ] ) ));
+	for ( i = 0; i < compact->numSTArrays; i++ )
+		if ( surface->st[ i ] == nullptr ) {
+			break;
+		}
+	if ( surface->xyz == nullptr || surface->normal == nullptr || ( compact->tangent != nullptr && surface->tangent == nullptr ) || i < compact->numSTArrays ) {
+		_pico_free_float_vertexes( surface );
+		return 0;
+	}
+
+	_pico_parallel_for( surface->numVertexes, COMPACT_GRAIN, [surface, compact]( int first, int last ){
+		int j;
+		_pico_decode_positions( compact->xyz + first, last - first, compact->origin, compact->scale, surface->xyz + first );
+		_pico_decode_octs( compact->normal + first, last - first, surface->normal + first );
+		if ( compact->tangent != nullptr ) {
+			_pico_decode_snorms( compact->tangent[ first ], ( last - first ) * 4, surface->tangent[ first ] );
+		}
+		for ( j = 0; j < compact->numSTArrays; j++ )
+			_pico_decode_halves( compact->st[ j ][ first ], ( last - first ) * 2, surface->st[ j ][ first ] );
+	} );
+
+	surface->compact = nullptr;
+	pmm::man.pp_m_delete( compact );
+	return 1;
+}
+
+/*
+   pmm::pp_compact_model()
+   compacts every surface of a model, see pmm::pp_compact_surface()
+ */
+
+int pmm::pp_compact_model( pmm::model_t *model ){
+	int i;
+
+
+	/* dummy check */
+	if ( model == nullptr ) {
+		return 0;
+	}
+	for ( i = 0; i < model->num_surfaces; i++ )
+		if ( model->surface[ i ] != nullptr && !pmm::pp_compact_surface( model->surface[ i ] ) ) {
+			return 0;
+		}
+	return 1;
+}
+
+/*
+   pmm::pp_expand_model()
+   expands every compacted surface of a model
+ */
+
+int pmm::pp_expand_model( pmm::model_t *model ){
+	int i;
+
+
+	/* dummy check */
+	if ( model == nullptr ) {
+		return 0;
+	}
+	for ( i = 0; i < model->num_surfaces; i++ )
+		if ( model->surface[ i ] != nullptr && !pmm::pp_expand_surface( model->surface[ i ] ) ) {
+			return 0;
+		}
+	return 1;
+}
+
+
+
+/* ----------------------------------------------------------------------------
+   accessors
+   ---------------------------------------------------------------------------- */
+
+/*
+   pmm::pp_decode_surface_xyz()
+   copies 'count' positions from vertex 'first' on, decoding them if the
+   surface is compacted. the same goes for the normal, tangent and st
+   versions. returns 1 on success, 0 on a bad range or missing attribute
+ */
+
+int pmm::pp_decode_surface_xyz( pmm::surface_t *surface, int first, int count, pmm::vec3_t *dest ){
+	if ( !_pico_decode_range( surface, first, count, dest ) ) {
+		return 0;
+	}
+	if ( surface->compact != nullptr ) {
+		_pico_decode_positions( surface->compact->xyz + first, count, surface->compact->origin, surface->compact->scale, dest );
+	}
+	else
+	{
+		memcpy( dest, surface->xyz + first, count * sizeof( *dest ) );
+	}
+	return 1;
+}
+
+int pmm::pp_decode_surface_normals( pmm::surface_t *surface, int first, int count, pmm::vec3_t *dest ){
+	if ( !_pico_decode_range( surface, first, count, dest ) ) {
+		return 0;
+	}
+	if ( surface->compact != nullptr ) {
+		_pico_decode_octs( surface->compact->normal + first, count, dest );
+	}
+	else
+	{
+		memcpy( dest, surface->normal + first, count * sizeof( *dest ) );
+	}
+	return 1;
+}
+
+int pmm::pp_decode_surface_tangents( pmm::surface_t *surface, int first, int count, pmm::vec4_t *dest ){
+	if ( !_pico_decode_range( surface, first, count, dest ) ) {
+		return 0;
+	}
+	if ( surface->compact != nullptr ) {
+		if ( surface->compact->tangent == nullptr ) {
+			return 0;
+		}
+		_pico_decode_snorms( surface->compact->tangent[ first ], count * 4, dest[ 0 ] );
+	}
+	else
+	{
+		if ( surface->tangent == nullptr ) {
+			return 0;
+		}
+		memcpy( dest, surface->tangent + first, count * sizeof( *dest ) );
+	}
+	return 1;
+}
+
+int pmm::pp_decode_surface_st( pmm::surface_t *surface, int array, int first, int count, pmm::vec2_t *dest ){
+	if ( !_pico_decode_range( surface, first, count, dest ) || array < 0 || array >= surface->numSTArrays ) {
+		return 0;
+	}
+	if ( surface->compact != nullptr ) {
+		_pico_decode_halves( surface->compact->st[ array ][ first ], count * 2, dest[ 0 ] );
+	}
+	else
+	{
+		memcpy( dest, surface->st[ array ] + first, count * sizeof( *dest ) );
+	}
+	return 1;
+}
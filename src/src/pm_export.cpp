@@ -0,0 +1,622 @@
+/* -----------------------------------------------------------------------------
+
+   PicoModel Library
+
+   Copyright (c) 2002, Randy Reddig & seaw0lf
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification,
+   are permitted provided that the following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list
+   of conditions and the following disclaimer.
+
+   Redistributions in binary form must reproduce the above copyright notice, this
+   list of conditions and the following disclaimer in the documentation and/or
+   other materials provided with the distribution.
+
+   Neither the names of the copyright holders nor the names of its contributors may
+   be used to endorse or promote products derived from this software without
+   specific prior written permission.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+   ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+   ANY DIRECT, INDIRECT, INCidentAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+   (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+   LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+   ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   ----------------------------------------------------------------------------- */
+
+/* gpu ready vertex and index buffer export, per surface or a whole model at once */
+
+#include <pmpmesh/pmpmesh.hpp>
+#include <pmpmesh/pm_internal.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+#if GDEF_SIMD_SSE2
+#include <immintrin.h>
+#endif
+
+#define EXPORT_BLOCK        256     /* vertexes gathered and converted at once */
+#define EXPORT_GRAIN        64      /* blocks per thread */
+
+
+
+/* ----------------------------------------------------------------------------
+   conversion
+   ---------------------------------------------------------------------------- */
+
+/* _pico_source_components:
+ *  number of floats an attribute has in a surface
+ */
+static int _pico_source_components( pmm::vertex_attribute attribute ){
+	switch ( attribute )
+	{
+	case pmm::va_position:
+	case pmm::va_normal:
+		return 3;
+	case pmm::va_st:
+		return 2;
+	case pmm::va_tangent:
+	case pmm::va_color:
+		return 4;
+	}
+	return 0;
+}
+
+/* _pico_format_size:
+ *  bytes of one component stored as 'format'
+ */
+static int _pico_format_size( pmm::vertex_format format ){
+	switch ( format )
+	{
+	case pmm::vf_float32:
+		return 4;
+	case pmm::vf_float16:
+	case pmm::vf_snorm16:
+	case pmm::vf_oct16:
+		return 2;
+	case pmm::vf_unorm8:
+		return 1;
+	}
+	return 0;
+}
+
+/* _pico_element_size:
+ *  bytes an element takes in a vertex
+ */
+static int _pico_element_size( const pmm::vertex_element_t *element ){
+	int components = element->format == pmm::vf_oct16 ? 2 : element->components;
+	return components * _pico_format_size( element->format );
+}
+
+/* _pico_check_element:
+ *  returns 1 if a surface has what an element asks for
+ */
+static int _pico_check_element( pmm::surface_t *surface, const pmm::vertex_element_t *element ){
+	if ( element->components < 1 || element->components > _pico_source_components( element->attribute ) ) {
+		return 0;
+	}
+	switch ( element->attribute )
+	{
+	case pmm::va_position:
+		return ( surface->xyz != nullptr || surface->compact != nullptr ) && element->format != pmm::vf_oct16;
+	case pmm::va_normal:
+		return surface->normal != nullptr || surface->compact != nullptr;
+	case pmm::va_tangent:
+		return surface->tangent != nullptr || ( surface->compact != nullptr && surface->compact->tangent != nullptr );
+	case pmm::va_st:
+	case pmm::va_color:
+		return element->set >= 0 && element->format != pmm::vf_oct16;
+	}
+	return 0;
+}
+
+/* _pico_pack_floats:
+ *  converts 'count' floats to 'format'; vf_oct16 packs like vf_snorm16
+ */
+static void _pico_pack_floats( const float *src, int count, pmm::vertex_format format, pmm::ub8_t *dest ){
+	int i = 0;
+
+	switch ( format )
+	{
+	case pmm::vf_float32:
+		memcpy( dest, src, count * sizeof( float ) );
+		break;
+
+	case pmm::vf_float16:
+	{
+		unsigned short *half = (unsigned short *) dest;
+#if GDEF_SIMD_F16C
+		for ( ; i + 8 <= count; i += 8 )
+			_mm_storeu_si128( (__m128i *) ( half + i ), _mm256_cvtps_ph( _mm256_loadu_ps( src + i ), _MM_FROUND_TO_NEAREST_INT ) );
+#endif
+		for ( ; i < count; i++ )
+			half[ i ] = _pico_float_to_half( src[ i ] );
+		break;
+	}
+
+	case pmm::vf_unorm8:
+	{
+#if GDEF_SIMD_SSE2
+		const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps( 1.0f ), scale = _mm_set1_ps( 255.0f );
+		for ( ; i + 8 <= count; i += 8 )
+		{
+			__m128i a = _mm_cvtps_epi32( _mm_mul_ps( _mm_min_ps( _mm_max_ps( _mm_loadu_ps( src + i ), zero ), one ), scale ) );
+			__m128i b = _mm_cvtps_epi32( _mm_mul_ps( _mm_min_ps( _mm_max_ps( _mm_loadu_ps( src + i + 4 ), zero ), one ), scale ) );
+			a = _mm_packs_epi32( a, b );
+			_mm_storel_epi64( (__m128i *) ( dest + i ), _mm_packus_epi16( a, a ) );
+		}
+#endif
+		for ( ; i < count; i++ )
+		{
+			float v = src[ i ] < 0 ? 0 : src[ i ] > 1 ? 1 : src[ i ];
+			dest[ i ] = (pmm::ub8_t) lrintf( v * 255.0f );
+		}
+		break;
+	}
+
+	case pmm::vf_snorm16:
+	case pmm::vf_oct16:
+	{
+		short *snorm = (short *) dest;
+#if GDEF_SIMD_SSE2
+		const __m128 minus = _mm_set1_ps( -1.0f ), one = _mm_set1_ps( 1.0f ), scale = _mm_set1_ps( 32767.0f );
+		for ( ; i + 8 <= count; i += 8 )
+		{
+			__m128i a = _mm_cvtps_epi32( _mm_mul_ps( _mm_min_ps( _mm_max_ps( _mm_loadu_ps( src + i ), minus ), one ), scale ) );
+			__m128i b = _mm_cvtps_epi32( _mm_mul_ps( _mm_min_ps( _mm_max_ps( _mm_loadu_ps( src + i + 4 ), minus ), one ), scale ) );
+			_mm_storeu_si128( (__m128i *) ( snorm + i ), _mm_packs_epi32( a, b ) );
+		}
+#endif
+		for ( ; i < count; i++ )
+		{
+			float v = src[ i ] < -1 ? -1 : src[ i ] > 1 ? 1 : src[ i ];
+			snorm[ i ] = (short) lrintf( v * 32767.0f );
+		}
+		break;
+	}
+	}
+}
+
+/* _pico_export_block:
+ *  writes vertexes [first, last) of a surface, one element at a time:
+ *  gather into floats, convert the whole run, scatter at the stride.
+ *  compacted surfaces are decoded a block at a time first
+ */
+static void _pico_export_block( pmm::surface_t *surface, const pmm::vertex_layout_t *layout, int first, int last, pmm::ub8_t *dest ){
+	float values[ EXPORT_BLOCK * 4 ], decoded[ EXPORT_BLOCK * 4 ];
+	pmm::ub8_t packed[ EXPORT_BLOCK * 16 ];
+	int count = last - first, e, i, j;
+
+	dest += (pmm::size_type) first * layout->stride;
+	for ( e = 0; e < layout->numElements; e++ )
+	{
+		const pmm::vertex_element_t *element = &layout->element[ e ];
+		int components = element->format == pmm::vf_oct16 ? 2 : element->components;
+		int size = _pico_element_size( element );
+		const float *src = nullptr;
+		int srcComponents = _pico_source_components( element->attribute );
+
+		/* colors are already bytes, missing ones are white */
+		if ( element->attribute == pmm::va_color ) {
+			pmm::color_t white = { 255, 255, 255, 255 };
+			int present = element->set < surface->numColorArrays;
+			pmm::color_t *color = present ? surface->color[ element->set ] + first : &white;
+			if ( element->format == pmm::vf_unorm8 ) {
+				for ( i = 0; i < count; i++ )
+					memcpy( dest + (pmm::size_type) i * layout->stride + element->offset, color[ present * i ], components );
+				continue;
+			}
+			for ( i = 0; i < count; i++ )
+				for ( j = 0; j < components; j++ )
+					values[ i * components + j ] = color[ present * i ][ j ] * ( 1.0f / 255.0f );
+		}
+		else if ( element->attribute == pmm::va_st && element->set >= surface->numSTArrays ) {
+			memset( values, 0, count * components * sizeof( *values ) );
+		}
+		else
+		{
+			if ( surface->compact != nullptr ) {
+				switch ( element->attribute )
+				{
+				case pmm::va_position:
+					pmm::pp_decode_surface_xyz( surface, first, count, reinterpret_cast<pmm::vec3_t *>( decoded ) );
+					break;
+				case pmm::va_normal:
+					pmm::pp_decode_surface_normals( surface, first, count, reinterpret_cast<pmm::vec3_t *>( decoded ) );
+					break;
+				case pmm::va_tangent:
+					pmm::pp_decode_surface_tangents( surface, first, count, reinterpret_cast<pmm::vec4_t *>( decoded ) );
+					break;
+				default:
+					pmm::pp_decode_surface_st( surface, element->set, first, count, reinterpret_cast<pmm::vec2_t *>( decoded ) );
+					break;
+				}
+				src = decoded;
+			}
+			else
+			{
+				switch ( element->attribute )
+				{
+				case pmm::va_position:
+					src = surface->xyz[ first ];
+					break;
+				case pmm::va_normal:
+					src = surface->normal[ first ];
+					break;
+				case pmm::va_tangent:
+					src = surface->tangent[ first ];
+					break;
+				default:
+					src = surface->st[ element->set ][ first ];
+					break;
+				}
+			}
+			if ( element->format == pmm::vf_oct16 ) {
+				for ( i = 0; i < count; i++ )
+					_pico_oct_encode( src + i * srcComponents, values + i * 2 );
+			}
+			else if ( components == srcComponents ) {
+				memcpy( values, src, count * components * sizeof( float ) );
+			}
+			else
+			{
+				for ( i = 0; i < count; i++ )
+					for ( j = 0; j < components; j++ )
+						values[ i * components + j ] = src[ i * srcComponents + j ];
+			}
+		}
+
+		_pico_pack_floats( values, count * components, element->format, packed );
+		for ( i = 0; i < count; i++ )
+			memcpy( dest + (pmm::size_type) i * layout->stride + element->offset, packed + i * size, size );
+	}
+}
+
+
+
+/* ----------------------------------------------------------------------------
+   vertex buffers
+   ---------------------------------------------------------------------------- */
+
+/*
+   pmm::pp_add_vertex_element()
+   appends an attribute to a layout at the next 4 byte aligned offset and
+   grows the stride to cover it. returns the offset, or -1 on error
+ */
+
+int pmm::pp_add_vertex_element( pmm::vertex_layout_t *layout, pmm::vertex_attribute attribute, int set, pmm::vertex_format format, int components ){
+	pmm::vertex_element_t *element;
+	int offset;
+
+
+	/* dummy check */
+	if ( layout == nullptr || layout->numElements < 0 || layout->numElements >= pmm::ee_max_vertex_elements ) {
+		return -1;
+	}
+	if ( format == pmm::vf_oct16 ) {
+		components = 3;
+	}
+	if ( components < 1 || components > _pico_source_components( attribute ) ) {
+		return -1;
+	}
+
+	offset = ( layout->stride + 3 ) & ~3;
+	element = &layout->element[ layout->numElements++ ];
+	element->attribute = attribute;
+	element->set = set;
+	element->format = format;
+	element->components = components;
+	element->offset = offset;
+	layout->stride = offset + _pico_element_size( element );
+	return offset;
+}
+
+/*
+   pmm::pp_export_vertex_buffer()
+   writes the vertexes of a surface interleaved as 'layout' describes.
+   with 'dst' nullptr only the size is returned. returns the bytes
+   written, or 0 if the surface lacks an attribute the layout asks for
+ */
+
+pmm::size_type pmm::pp_export_vertex_buffer( pmm::surface_t *surface, const pmm::vertex_layout_t *layout, void *dst ){
+	int numBlocks, e;
+
+
+	/* dummy check */
+	if ( surface == nullptr || layout == nullptr || layout->numElements < 0 || layout->numElements > pmm::ee_max_vertex_elements ) {
+		return 0;
+	}
+	for ( e = 0; e < layout->numElements; e++ )
+	{
+		const pmm::vertex_element_t *element = &layout->element[ e ];
+		if ( !_pico_check_element( surface, element ) || element->offset < 0 || element->offset + _pico_element_size( element ) > layout->stride ) {
+			pmm::man.pp_print( pmm::pl_error, ( std::ostringstream{} << "pp_export_vertex_buffer: surface " << ( surface->name != nullptr ? surface->name : "" ) << " can't fill element " << e << "\n" ).str() );
+			return 0;
+		}
+	}
+	if ( dst == nullptr || surface->numVertexes <= 0 ) {
+		return (pmm::size_type) surface->numVertexes * layout->stride;
+	}
+
+	numBlocks = ( surface->numVertexes + EXPORT_BLOCK - 1 ) / EXPORT_BLOCK;
+	_pico_parallel_for( numBlocks, EXPORT_GRAIN, [surface, layout, dst]( int first, int last ){
+		int block;
+		for ( block = first; block < last; block++ )
+		{
+			int end = ( block + 1 ) * EXPORT_BLOCK;
+			_pico_export_block( surface, layout, block * EXPORT_BLOCK, end < surface->numVertexes ? end : surface->numVertexes, (pmm::ub8_t *) dst );
+		}
+	} );
+	return (pmm::size_type) surface->numVertexes * layout->stride;
+}
+
+
+
+/* ----------------------------------------------------------------------------
+   index buffers
+   ---------------------------------------------------------------------------- */
+
+/*
+   pmm::pp_surface_index_size()
+   smallest index size in bytes that addresses every vertex of a surface
+ */
+
+int pmm::pp_surface_index_size( pmm::surface_t *surface ){
+	return surface != nullptr && surface->numVertexes > 65536 ? 4 : 2;
+}
+
+/*
+   pmm::pp_export_index_buffer()
+   writes the indexes of a surface as 2 or 4 byte integers, 'indexSize' 0
+   picks with pp_surface_index_size. 2 byte indexes out of range are
+   clamped to 0..65535. with 'dst' nullptr only the size is returned.
+   returns the bytes written, or 0 on error
+ */
+
+pmm::size_type pmm::pp_export_index_buffer( pmm::surface_t *surface, int indexSize, void *dst ){
+	pmm::size_type size;
+	int i = 0;
+
+
+	/* dummy check */
+	if ( surface == nullptr ) {
+		return 0;
+	}
+	if ( indexSize == 0 ) {
+		indexSize = pmm::pp_surface_index_size( surface );
+	}
+	if ( ( indexSize != 2 && indexSize != 4 ) || ( indexSize == 2 && surface->numVertexes > 65536 ) ) {
+		pmm::man.pp_print( pmm::pl_error, ( std::ostringstream{} << "pp_export_index_buffer: " << indexSize << " byte indexes can't address " << surface->numVertexes << " vertexes\n" ).str() );
+		return 0;
+	}
+
+	size = (pmm::size_type) surface->numIndexes * indexSize;
+	if ( dst == nullptr || size == 0 ) {
+		return size;
+	}
+	if ( indexSize == 4 ) {
+		memcpy( dst, surface->index, size );
+		return size;
+	}
+
+	/* narrow, clamped to 0..65535. biased so the signed saturating pack */
+	/* keeps that range, the tail clamps the same way */
+	unsigned short *index16 = (unsigned short *) dst;
+#if GDEF_SIMD_SSE2
+	const __m128i bias = _mm_set1_epi32( 32768 ), unbias = _mm_set1_epi16( (short) 0x8000 );
+	for ( ; i + 8 <= surface->numIndexes; i += 8 )
+	{
+		__m128i a = _mm_sub_epi32( _mm_loadu_si128( (const __m128i *) ( surface->index + i ) ), bias );
+		__m128i b = _mm_sub_epi32( _mm_loadu_si128( (const __m128i *) ( surface->index + i + 4 ) ), bias );
+		_mm_storeu_si128( (__m128i *) ( index16 + i ), _mm_xor_si128( _mm_packs_epi32( a, b ), unbias ) );
+	}
+#endif
+	for ( ; i < surface->numIndexes; i++ )
+		index16[ i ] = (unsigned short) std::clamp( surface->index[ i ], 0, 65535 );
+	return size;
+}
+
+
+
+/* ----------------------------------------------------------------------------
+   flattened models
+   ---------------------------------------------------------------------------- */
+
+/* one surface of a flattened model and where it lands */
+class picoFlatJob_t
+{
+public:
+	pmm::surface_t *surface;
+	int range;
+	int firstVertex, firstIndex, numIndexes;
+};
+
+/* _pico_flat_indexes:
+ *  copies the indexes of a job, moved from surface vertex numbers to
+ *  numbers relative to the range base vertex
+ */
+static void _pico_flat_indexes( const picoFlatJob_t *job, int rebase, int indexSize, void *indexes ){
+	const pmm::index_t *index = job->surface->index;
+	int i;
+
+	if ( indexSize == 4 ) {
+		pmm::index_t *dest = (pmm::index_t *) indexes + job->firstIndex;
+		for ( i = 0; i < job->numIndexes; i++ )
+			dest[ i ] = index[ i ] + rebase;
+	}
+	else
+	{
+		unsigned short *dest = (unsigned short *) indexes + job->firstIndex;
+		for ( i = 0; i < job->numIndexes; i++ )
+			dest[ i ] = (unsigned short) ( index[ i ] + rebase );
+	}
+}
+
+/*
+   pmm::pp_flatten_model()
+   concatenates the triangle surfaces of a model into one vertex buffer
+   laid out as 'layout' and one index buffer, with one draw range per
+   shader. 'indexSize' 0 picks 2 byte indexes unless a surface has more
+   than 65536 vertexes; with 2 byte indexes a shader gets more ranges when
+   its surfaces don't fit one. surfaces the layout can't be filled from
+   are left out. returns the buffers, free them with
+   pmm::pp_free_flat_model(), or nullptr on error
+ */
+
+pmm::flat_model_t *pmm::pp_flatten_model( pmm::model_t *model, const pmm::vertex_layout_t *layout, int indexSize ){
+	pmm::flat_model_t *flat;
+	int numVertexes = 0, numIndexes = 0, maxVertexes = 0, i;
+
+
+	/* dummy check */
+	if ( model == nullptr || layout == nullptr || layout->stride <= 0 ) {
+		return nullptr;
+	}
+
+	/* surfaces grouped by shader, in order of first use */
+	std::unordered_map<pmm::shader_t *, int> groupNums;
+	std::vector<std::vector<pmm::surface_t *>> groups;
+	for ( i = 0; i < model->num_surfaces; i++ )
+	{
+		pmm::surface_t *surface = model->surface[ i ];
+		if ( surface == nullptr || surface->type != pmm::st_triangles || surface->numVertexes <= 0 || surface->numIndexes < 3 ) {
+			continue;
+		}
+		if ( pmm::pp_export_vertex_buffer( surface, layout, nullptr ) == 0 ) {
+			continue;
+		}
+		auto found = groupNums.emplace( surface->shader, (int) groups.size() );
+		if ( found.second ) {
+			groups.emplace_back();
+		}
+		groups[ found.first->second ].push_back( surface );
+		maxVertexes = surface->numVertexes > maxVertexes ? surface->numVertexes : maxVertexes;
+	}
+
+	if ( indexSize == 0 ) {
+		indexSize = maxVertexes > 65536 ? 4 : 2;
+	}
+	if ( ( indexSize != 2 && indexSize != 4 ) || ( indexSize == 2 && maxVertexes > 65536 ) ) {
+		pmm::man.pp_print( pmm::pl_error, ( std::ostringstream{} << "pp_flatten_model: " << indexSize << " byte indexes can't address " << maxVertexes << " vertexes\n" ).str() );
+		return nullptr;
+	}
+
+	/* lay out the ranges */
+	std::vector<pmm::draw_range_t> ranges;
+	std::vector<picoFlatJob_t> jobs;
+	for ( auto &group : groups )
+	{
+		for ( pmm::surface_t *surface : group )
+		{
+			if ( ranges.empty() || ranges.back().shader != surface->shader
+				 || ( indexSize == 2 && ranges.back().numVertexes + surface->numVertexes > 65536 ) ) {
+				pmm::draw_range_t range;
+				range.shader = surface->shader;
+				range.firstIndex = numIndexes;
+				range.indexCount = 0;
+				range.baseVertex = numVertexes;
+				range.numVertexes = 0;
+				_pico_zero_bounds( range.bounds.mins, range.bounds.maxs );
+				ranges.push_back( range );
+			}
+			picoFlatJob_t job;
+			job.surface = surface;
+			job.range = (int) ranges.size() - 1;
+			job.firstVertex = numVertexes;
+			job.firstIndex = numIndexes;
+			job.numIndexes = surface->numIndexes - surface->numIndexes % 3;
+			jobs.push_back( job );
+			ranges.back().indexCount += job.numIndexes;
+			ranges.back().numVertexes += surface->numVertexes;
+			numVertexes += surface->numVertexes;
+			numIndexes += job.numIndexes;
+		}
+	}
+
+	/* one block: header, ranges, vertexes, indexes */
+	pmm::size_type rangeBytes = ( sizeof( pmm::flat_model_t ) + ranges.size() * sizeof( pmm::draw_range_t ) + 15 ) & ~(pmm::size_type) 15;
+	pmm::size_type vertexBytes = ( (pmm::size_type) numVertexes * layout->stride + 15 ) & ~(pmm::size_type) 15;
+	flat = reinterpret_cast<decltype(flat)>(pmm::man.pp_m_new( rangeBytes + vertexBytes + (pmm::size_type) numIndexes * indexSize ));
+	if ( flat == nullptr ) {
+		return nullptr;
+	}
+	flat->numRanges = (int) ranges.size();
+	flat->range = reinterpret_cast<pmm::draw_range_t *>( flat + 1 );
+	flat->numVertexes = numVertexes;
+	flat->vertexSize = layout->stride;
+	flat->vertexes = reinterpret_cast<pmm::ub8_t *>( flat ) + rangeBytes;
+	flat->numIndexes = numIndexes;
+	flat->indexSize = indexSize;
+	flat->indexes = reinterpret_cast<pmm::ub8_t *>( flat->vertexes ) + vertexBytes;
+	if ( !ranges.empty() ) {
+		memcpy( flat->range, ranges.data(), ranges.size() * sizeof( pmm::draw_range_t ) );
+	}
+
+	/* vertexes, each surface export runs threaded on its own */
+	for ( const picoFlatJob_t &job : jobs )
+		pmm::pp_export_vertex_buffer( job.surface, layout, reinterpret_cast<pmm::ub8_t *>( flat->vertexes ) + (pmm::size_type) job.firstVertex * layout->stride );
+
+	/* indexes, a surface per job */
+	_pico_parallel_for( (int) jobs.size(), 1, [flat, &jobs]( int first, int last ){
+		int j;
+		for ( j = first; j < last; j++ )
+			_pico_flat_indexes( &jobs[ j ], jobs[ j ].firstVertex - flat->range[ jobs[ j ].range ].baseVertex, flat->indexSize, flat->indexes );
+	} );
+
+	/* range boxes, then spheres around the box centers */
+	std::vector<std::vector<pmm::vec_t>> decoded( jobs.size() );
+	for ( pmm::size_type j = 0; j < jobs.size(); j++ )
+		if ( jobs[ j ].surface->compact != nullptr ) {
+			decoded[ j ].resize( jobs[ j ].surface->numVertexes * 3 );
+			pmm::pp_decode_surface_xyz( jobs[ j ].surface, 0, jobs[ j ].surface->numVertexes, reinterpret_cast<pmm::vec3_t *>( decoded[ j ].data() ) );
+		}
+	auto positions = [&jobs, &decoded]( pmm::size_type j ){
+		return jobs[ j ].surface->compact != nullptr ? reinterpret_cast<pmm::vec3_t *>( decoded[ j ].data() ) : jobs[ j ].surface->xyz;
+	};
+	for ( pmm::size_type j = 0; j < jobs.size(); j++ )
+	{
+		pmm::bounds_t *bounds = &flat->range[ jobs[ j ].range ].bounds;
+		pmm::vec3_t mins, maxs;
+		_pico_vec_bounds( positions( j ), jobs[ j ].surface->numVertexes, mins, maxs );
+		_pico_expand_bounds( mins, bounds->mins, bounds->maxs );
+		_pico_expand_bounds( maxs, bounds->mins, bounds->maxs );
+	}
+	for ( i = 0; i < flat->numRanges; i++ )
+	{
+		_pico_add_vec( flat->range[ i ].bounds.mins, flat->range[ i ].bounds.maxs, flat->range[ i ].bounds.center );
+		_pico_scale_vec( flat->range[ i ].bounds.center, 0.5f, flat->range[ i ].bounds.center );
+		flat->range[ i ].bounds.radius = 0;
+	}
+	for ( pmm::size_type j = 0; j < jobs.size(); j++ )
+	{
+		pmm::bounds_t *bounds = &flat->range[ jobs[ j ].range ].bounds;
+		pmm::vec_t radius = _pico_vec_radius( positions( j ), jobs[ j ].surface->numVertexes, bounds->center );
+		bounds->radius = radius > bounds->radius ? radius : bounds->radius;
+	}
+
+	return flat;
+}
+
+/*
+   pmm::pp_free_flat_model()
+   frees buffers built by pmm::pp_flatten_model()
+ */
+
+void pmm::pp_free_flat_model( pmm::flat_model_t *flat ){
+	if ( flat == nullptr ) {
+		return;
+	}
+	pmm::man.pp_m_delete( flat );
+}
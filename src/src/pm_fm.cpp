@@ -210,6 +210,43 @@ static int _fm_canload( PM_PARAMS_CANLOAD ){
 
 
 
+// _fm_probe() reads the counts and the skin name from the header and skin chunks.
+static int _fm_probe( PM_PARAMS_PROBE ){
+	const pmm::ub8_t        *bb = (const pmm::ub8_t*) buffer;
+	const fm_chunk_header_t *headerHdr;
+	const fm_header_t       *fm_head;
+	char skinname[FM_SKINPATHsize + 1];
+	long fm_file_pos;
+
+	(void) fileName;
+
+	// header chunk, the chunk order was checked by _fm_canload()
+	headerHdr = (const fm_chunk_header_t *) bb;
+	fm_file_pos = sizeof( fm_chunk_header_t );
+	if ( !_pico_probe_range( bufSize, fm_file_pos, sizeof( *fm_head ) ) ) {
+		return 0;
+	}
+	fm_head = (const fm_header_t *) ( bb + fm_file_pos );
+	info->numFrames = _pico_little_long( fm_head->numFrames );
+	info->numSurfaces = 1;
+	info->numVertexes = _pico_little_long( fm_head->numXYZ );
+	info->numTriangles = _pico_little_long( fm_head->numTris );
+
+	// first skin, same detox as the loader
+	fm_file_pos += headerHdr->size + sizeof( fm_chunk_header_t );
+	if ( _pico_probe_range( bufSize, fm_file_pos, FM_SKINPATHsize ) ) {
+		strncpy( skinname, (const char *) ( bb + fm_file_pos ), FM_SKINPATHsize );
+		skinname[FM_SKINPATHsize] = '\0';
+		_pico_setfext( skinname, "" );
+		_pico_unixify( skinname );
+		_pico_probe_add_shader( info, skinname );
+	}
+
+	return 1;
+}
+
+
+
 // _fm_load() loads a Heretic 2 model file.
 static pmm::model_t *_fm_load( PM_PARAMS_LOAD ){
 	int i, j, dups, dup_index;
@@ -233,7 +270,7 @@ static pmm::model_t *_fm_load( PM_PARAMS_LOAD ){
 	pmm::shader_t    *picoShader;
 	pmm::vec3_t xyz, normal;
 	pmm::vec2_t st;
-	pmm::color_t color;
+	int loadFlags = _pico_load_flags( options );
 
 
 	bb0 = bb = (pmm::ub8_t*) pmm::man.pp_m_new( bufSize );
@@ -424,6 +461,31 @@ static pmm::model_t *_fm_load( PM_PARAMS_LOAD ){
 	pmm::pp_set_model_name( picoModel, fileName );
 	pmm::pp_set_model_file_name( picoModel, fileName );
 
+	// bounds of every frame, for culling animated instances
+	if ( fm_head->numXYZ > 0 && fm_head->frameSize >= (int) ( sizeof( fm_frame_t ) + ( fm_head->numXYZ - 1 ) * sizeof( fm_vert_normal_t ) )
+		 && fm_file_pos + (long long) fm_head->frameSize * fm_head->numFrames <= bufSize ) {
+		pmm::vec3_t *frameXyz = (pmm::vec3_t *) pmm::man.pp_k_new( fm_head->numXYZ, sizeof( *frameXyz ) );
+		for ( i = 0; frameXyz != nullptr && i < fm_head->numFrames; i++ )
+		{
+			fm_frame_t *frameI = (fm_frame_t *) ( bb + fm_file_pos + fm_head->frameSize * i );
+			float scale[ 3 ], translate[ 3 ];
+			int k;
+			for ( j = 0; j < 3; j++ )
+			{
+				// the loaded frame is already swapped
+				scale[ j ] = frameI == frame ? frameI->header.scale[ j ] : _pico_little_float( frameI->header.scale[ j ] );
+				translate[ j ] = frameI == frame ? frameI->header.translate[ j ] : _pico_little_float( frameI->header.translate[ j ] );
+			}
+			for ( k = 0; k < fm_head->numXYZ; k++ )
+				for ( j = 0; j < 3; j++ )
+					frameXyz[ k ][ j ] = frameI->verts[ k ].v[ j ] * scale[ j ] + translate[ j ];
+			_pico_set_frame_bounds( picoModel, i, frameXyz, fm_head->numXYZ );
+		}
+		if ( frameXyz != nullptr ) {
+			pmm::man.pp_m_delete( frameXyz );
+		}
+	}
+
 	// allocate new pico surface
 	picoSurface = pmm::pp_new_surface( picoModel );
 	if ( picoSurface == nullptr ) {
@@ -687,15 +749,19 @@ static pmm::model_t *_fm_load( PM_PARAMS_LOAD ){
 		pmm::pp_set_surface_xyz( picoSurface, i, xyz );
 
 		/* set normal */
-		normal[ 0 ] = fm_normals[vert->lightnormalindex][0];
-		normal[ 1 ] = fm_normals[vert->lightnormalindex][1];
-		normal[ 2 ] = fm_normals[vert->lightnormalindex][2];
-		pmm::pp_set_surface_normal( picoSurface, i, normal );
+		if ( !( loadFlags & pmm::lf_skip_normals ) ) {
+			normal[ 0 ] = fm_normals[vert->lightnormalindex][0];
+			normal[ 1 ] = fm_normals[vert->lightnormalindex][1];
+			normal[ 2 ] = fm_normals[vert->lightnormalindex][2];
+			pmm::pp_set_surface_normal( picoSurface, i, normal );
+		}
 
 		/* set st coords */
-		st[ 0 ] =  ( ( texCoord[p_index_LUT[i].ST].s ) / ( (float)fm_head->skinWidth ) );
-		st[ 1 ] =  ( texCoord[p_index_LUT[i].ST].t / ( (float)fm_head->skinHeight ) );
-		pmm::pp_set_surface_st( picoSurface, 0, i, st );
+		if ( !( loadFlags & pmm::lf_skip_st ) ) {
+			st[ 0 ] =  ( ( texCoord[p_index_LUT[i].ST].s ) / ( (float)fm_head->skinWidth ) );
+			st[ 1 ] =  ( texCoord[p_index_LUT[i].ST].t / ( (float)fm_head->skinHeight ) );
+			pmm::pp_set_surface_st( picoSurface, 0, i, st );
+		}
 	}
 
 	if ( dups ) {
@@ -709,21 +775,22 @@ static pmm::model_t *_fm_load( PM_PARAMS_LOAD ){
 			pmm::pp_set_surface_xyz( picoSurface, i + fm_head->numXYZ, xyz );
 
 			/* set normal */
-			normal[ 0 ] = fm_normals[frame->verts[j].lightnormalindex][0];
-			normal[ 1 ] = fm_normals[frame->verts[j].lightnormalindex][1];
-			normal[ 2 ] = fm_normals[frame->verts[j].lightnormalindex][2];
-			pmm::pp_set_surface_normal( picoSurface, i + fm_head->numXYZ, normal );
+			if ( !( loadFlags & pmm::lf_skip_normals ) ) {
+				normal[ 0 ] = fm_normals[frame->verts[j].lightnormalindex][0];
+				normal[ 1 ] = fm_normals[frame->verts[j].lightnormalindex][1];
+				normal[ 2 ] = fm_normals[frame->verts[j].lightnormalindex][2];
+				pmm::pp_set_surface_normal( picoSurface, i + fm_head->numXYZ, normal );
+			}
 
 			/* set st coords */
-			st[ 0 ] =  ( ( texCoord[p_index_LUT_DUPS[i].ST].s ) / ( (float)fm_head->skinWidth ) );
-			st[ 1 ] =  ( texCoord[p_index_LUT_DUPS[i].ST].t / ( (float)fm_head->skinHeight ) );
-			pmm::pp_set_surface_st( picoSurface, 0, i + fm_head->numXYZ, st );
+			if ( !( loadFlags & pmm::lf_skip_st ) ) {
+				st[ 0 ] =  ( ( texCoord[p_index_LUT_DUPS[i].ST].s ) / ( (float)fm_head->skinWidth ) );
+				st[ 1 ] =  ( texCoord[p_index_LUT_DUPS[i].ST].t / ( (float)fm_head->skinHeight ) );
+				pmm::pp_set_surface_st( picoSurface, 0, i + fm_head->numXYZ, st );
+			}
 		}
 	}
 
-	/* set color */
-	pmm::pp_set_surface_color( picoSurface, 0, 0, color );
-
 	// Free up malloc'ed LL entries
 	for ( i = 0; i < fm_head->numXYZ; i++ )
 	{
@@ -767,5 +834,6 @@ extern const pmm::module_t picoModuleFM =
 	_fm_canload,                /* validation routine */
 	_fm_load,                   /* load routine */
 	nullptr,                       /* save validation routine */
-	nullptr                        /* save routine */
+	nullptr,                       /* save routine */
+	_fm_probe                   /* probe routine */
 };
@@ -38,6 +38,12 @@
 
 #include <string.h>
 #include <pmpmesh/pm_internal.hpp>
+#include <thread>
+#include <vector>
+
+#if GDEF_SIMD_SSE2
+#include <immintrin.h>
+#endif
 
 union floatSwapUnion
 {
@@ -177,6 +183,189 @@ void _pico_expand_bounds( pmm::vec3_t p, pmm::vec3_t mins, pmm::vec3_t maxs ){
 	}
 }
 
+#if GDEF_SIMD_SSE2
+/* _pico_load_vecs4:
+ *  x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3 -> x, y and z of four packed vectors
+ */
+static inline void _pico_load_vecs4( const pmm::vec_t *f, __m128 *x, __m128 *y, __m128 *z ){
+	__m128 r0 = _mm_loadu_ps( f ), r1 = _mm_loadu_ps( f + 4 ), r2 = _mm_loadu_ps( f + 8 );
+	__m128 xy = _mm_shuffle_ps( r1, r2, _MM_SHUFFLE( 2, 1, 3, 2 ) );
+	__m128 yz = _mm_shuffle_ps( r0, r1, _MM_SHUFFLE( 1, 0, 2, 1 ) );
+	*x = _mm_shuffle_ps( r0, xy, _MM_SHUFFLE( 2, 0, 3, 0 ) );
+	*y = _mm_shuffle_ps( yz, xy, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+	*z = _mm_shuffle_ps( yz, r2, _MM_SHUFFLE( 3, 0, 3, 1 ) );
+}
+
+/* _pico_store_vecs4:
+ *  the inverse of _pico_load_vecs4
+ */
+static inline void _pico_store_vecs4( pmm::vec_t *f, __m128 x, __m128 y, __m128 z ){
+	__m128 xy01 = _mm_unpacklo_ps( x, y ), xy23 = _mm_unpackhi_ps( x, y );
+	__m128 zx01 = _mm_shuffle_ps( z, x, _MM_SHUFFLE( 1, 1, 0, 0 ) ), yz1 = _mm_shuffle_ps( y, z, _MM_SHUFFLE( 1, 1, 1, 1 ) );
+	__m128 zx23 = _mm_shuffle_ps( z, x, _MM_SHUFFLE( 3, 3, 2, 2 ) ), yz3 = _mm_shuffle_ps( y, z, _MM_SHUFFLE( 3, 3, 3, 3 ) );
+	_mm_storeu_ps( f, _mm_shuffle_ps( xy01, zx01, _MM_SHUFFLE( 2, 0, 1, 0 ) ) );
+	_mm_storeu_ps( f + 4, _mm_shuffle_ps( yz1, xy23, _MM_SHUFFLE( 1, 0, 2, 0 ) ) );
+	_mm_storeu_ps( f + 8, _mm_shuffle_ps( zx23, yz3, _MM_SHUFFLE( 2, 0, 2, 0 ) ) );
+}
+#endif
+
+/* _pico_vec_bounds:
+ *  box around 'count' packed vectors, or a zeroed one if there are none.
+ *  four vectors ( eight with avx ) fill exactly three registers, so each
+ *  lane always holds the same component and the lanes are only folded
+ *  into x, y and z at the end.
+ */
+void _pico_vec_bounds( pmm::vec3_t *xyz, int count, pmm::vec3_t mins, pmm::vec3_t maxs ){
+	int i = 1, j, k;
+
+	if ( count <= 0 ) {
+		_pico_zero_bounds( mins, maxs );
+		return;
+	}
+	_pico_copy_vec( xyz[ 0 ], mins );
+	_pico_copy_vec( xyz[ 0 ], maxs );
+
+#if GDEF_SIMD_AVX
+	if ( count >= 8 ) {
+		const pmm::vec_t *f = xyz[ 0 ];
+		__m256 lo[ 3 ], hi[ 3 ];
+		float l[ 3 ][ 8 ], h[ 3 ][ 8 ];
+		for ( j = 0; j < 3; j++ )
+			lo[ j ] = hi[ j ] = _mm256_loadu_ps( f + j * 8 );
+		for ( i = 8; i + 8 <= count; i += 8 )
+			for ( j = 0; j < 3; j++ )
+			{
+				__m256 v = _mm256_loadu_ps( f + i * 3 + j * 8 );
+				lo[ j ] = _mm256_min_ps( lo[ j ], v );
+				hi[ j ] = _mm256_max_ps( hi[ j ], v );
+			}
+		for ( j = 0; j < 3; j++ )
+		{
+			_mm256_storeu_ps( l[ j ], lo[ j ] );
+			_mm256_storeu_ps( h[ j ], hi[ j ] );
+			for ( k = 0; k < 8; k++ )
+			{
+				mins[ ( j * 8 + k ) % 3 ] = l[ j ][ k ] < mins[ ( j * 8 + k ) % 3 ] ? l[ j ][ k ] : mins[ ( j * 8 + k ) % 3 ];
+				maxs[ ( j * 8 + k ) % 3 ] = h[ j ][ k ] > maxs[ ( j * 8 + k ) % 3 ] ? h[ j ][ k ] : maxs[ ( j * 8 + k ) % 3 ];
+			}
+		}
+	}
+#elif GDEF_SIMD_SSE2
+	if ( count >= 4 ) {
+		const pmm::vec_t *f = xyz[ 0 ];
+		__m128 lo[ 3 ], hi[ 3 ];
+		float l[ 3 ][ 4 ], h[ 3 ][ 4 ];
+		for ( j = 0; j < 3; j++ )
+			lo[ j ] = hi[ j ] = _mm_loadu_ps( f + j * 4 );
+		for ( i = 4; i + 4 <= count; i += 4 )
+			for ( j = 0; j < 3; j++ )
+			{
+				__m128 v = _mm_loadu_ps( f + i * 3 + j * 4 );
+				lo[ j ] = _mm_min_ps( lo[ j ], v );
+				hi[ j ] = _mm_max_ps( hi[ j ], v );
+			}
+		for ( j = 0; j < 3; j++ )
+		{
+			_mm_storeu_ps( l[ j ], lo[ j ] );
+			_mm_storeu_ps( h[ j ], hi[ j ] );
+			for ( k = 0; k < 4; k++ )
+			{
+				mins[ ( j * 4 + k ) % 3 ] = l[ j ][ k ] < mins[ ( j * 4 + k ) % 3 ] ? l[ j ][ k ] : mins[ ( j * 4 + k ) % 3 ];
+				maxs[ ( j * 4 + k ) % 3 ] = h[ j ][ k ] > maxs[ ( j * 4 + k ) % 3 ] ? h[ j ][ k ] : maxs[ ( j * 4 + k ) % 3 ];
+			}
+		}
+	}
+#endif
+
+	for ( ; i < count; i++ )
+		_pico_expand_bounds( xyz[ i ], mins, maxs );
+}
+
+/* _pico_vec_radius:
+ *  distance from 'center' to the farthest of 'count' packed vectors
+ */
+pmm::vec_t _pico_vec_radius( pmm::vec3_t *xyz, int count, pmm::vec3_t center ){
+	float best = 0;
+	int i = 0;
+
+#if GDEF_SIMD_SSE2
+	if ( count >= 4 ) {
+		const pmm::vec_t *f = xyz[ 0 ];
+		__m128 cx = _mm_set1_ps( center[ 0 ] ), cy = _mm_set1_ps( center[ 1 ] ), cz = _mm_set1_ps( center[ 2 ] );
+		__m128 farthest = _mm_setzero_ps();
+		float d[ 4 ];
+		for ( ; i + 4 <= count; i += 4 )
+		{
+			__m128 x, y, z;
+			_pico_load_vecs4( f + i * 3, &x, &y, &z );
+			x = _mm_sub_ps( x, cx );
+			y = _mm_sub_ps( y, cy );
+			z = _mm_sub_ps( z, cz );
+			farthest = _mm_max_ps( farthest, _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, x ), _mm_mul_ps( y, y ) ), _mm_mul_ps( z, z ) ) );
+		}
+		_mm_storeu_ps( d, farthest );
+		for ( int k = 0; k < 4; k++ )
+			best = d[ k ] > best ? d[ k ] : best;
+	}
+#endif
+
+	for ( ; i < count; i++ )
+	{
+		float x = xyz[ i ][ 0 ] - center[ 0 ], y = xyz[ i ][ 1 ] - center[ 1 ], z = xyz[ i ][ 2 ] - center[ 2 ];
+		if ( x * x + y * y + z * z > best ) {
+			best = x * x + y * y + z * z;
+		}
+	}
+	return (pmm::vec_t) sqrt( best );
+}
+
+/* _pico_transform_vecs:
+ *  multiplies 'count' packed vectors in place by the upper 3x3 of the
+ *  column major matrix 'm', adding its translation if 'point' is set and
+ *  renormalizing the results if 'normalize' is set
+ */
+void _pico_transform_vecs( pmm::vec3_t *v, int count, const pmm::vec_t *m, int point, int normalize ){
+	int i = 0, j;
+
+#if GDEF_SIMD_SSE2
+	__m128 c[ 3 ][ 3 ], t[ 3 ];
+	for ( j = 0; j < 3; j++ )
+	{
+		c[ j ][ 0 ] = _mm_set1_ps( m[ j * 4 ] );
+		c[ j ][ 1 ] = _mm_set1_ps( m[ j * 4 + 1 ] );
+		c[ j ][ 2 ] = _mm_set1_ps( m[ j * 4 + 2 ] );
+		t[ j ] = _mm_set1_ps( point ? m[ 12 + j ] : 0 );
+	}
+	for ( ; i + 4 <= count; i += 4 )
+	{
+		__m128 x, y, z, r[ 3 ];
+		_pico_load_vecs4( v[ i ], &x, &y, &z );
+		for ( j = 0; j < 3; j++ )
+			r[ j ] = _mm_add_ps( _mm_add_ps( _mm_mul_ps( c[ 0 ][ j ], x ), _mm_mul_ps( c[ 1 ][ j ], y ) ), _mm_add_ps( _mm_mul_ps( c[ 2 ][ j ], z ), t[ j ] ) );
+		if ( normalize ) {
+			/* zero length vectors are left alone */
+			__m128 len = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( r[ 0 ], r[ 0 ] ), _mm_mul_ps( r[ 1 ], r[ 1 ] ) ), _mm_mul_ps( r[ 2 ], r[ 2 ] ) ) );
+			__m128 zero = _mm_cmpeq_ps( len, _mm_setzero_ps() ), one = _mm_set1_ps( 1 );
+			__m128 ilen = _mm_or_ps( _mm_and_ps( zero, one ), _mm_andnot_ps( zero, _mm_div_ps( one, len ) ) );
+			for ( j = 0; j < 3; j++ )
+				r[ j ] = _mm_mul_ps( r[ j ], ilen );
+		}
+		_pico_store_vecs4( v[ i ], r[ 0 ], r[ 1 ], r[ 2 ] );
+	}
+#endif
+
+	for ( ; i < count; i++ )
+	{
+		pmm::vec3_t r;
+		for ( j = 0; j < 3; j++ )
+			r[ j ] = m[ j ] * v[ i ][ 0 ] + m[ 4 + j ] * v[ i ][ 1 ] + m[ 8 + j ] * v[ i ][ 2 ] + ( point ? m[ 12 + j ] : 0 );
+		if ( normalize ) {
+			_pico_normalize_vec( r );
+		}
+		_pico_copy_vec( r, v[ i ] );
+	}
+}
+
 void _pico_zero_vec( pmm::vec3_t vec ){
 	vec[ 0 ] = vec[ 1 ] = vec[ 2 ] = 0;
 }
@@ -235,6 +424,254 @@ pmm::vec_t _pico_normalize_vec( pmm::vec3_t vec ){
 	return (pmm::vec_t) len;
 }
 
+/* _pico_normalize_vecs:
+ *  normalizes 'count' vectors stored as separate x, y and z arrays.
+ *  lanes are rounded like _pico_normalize_vec (float length, double
+ *  reciprocal) so results match it bit for bit.
+ */
+void _pico_normalize_vecs( pmm::vec_t *x, pmm::vec_t *y, pmm::vec_t *z, int count ){
+	int i = 0;
+
+#if GDEF_SIMD_AVX
+	const __m256d one = _mm256_set1_pd( 1.0 );
+	for ( ; i + 8 <= count; i += 8 )
+	{
+		__m256 vx = _mm256_loadu_ps( x + i ), vy = _mm256_loadu_ps( y + i ), vz = _mm256_loadu_ps( z + i );
+		__m256 len = _mm256_sqrt_ps( _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( vx, vx ), _mm256_mul_ps( vy, vy ) ), _mm256_mul_ps( vz, vz ) ) );
+		__m256d len0 = _mm256_cvtps_pd( _mm256_castps256_ps128( len ) );
+		__m256d len1 = _mm256_cvtps_pd( _mm256_extractf128_ps( len, 1 ) );
+		/* zero length vectors are left alone */
+		__m256d ilen0 = _mm256_blendv_pd( _mm256_div_pd( one, len0 ), one, _mm256_cmp_pd( len0, _mm256_setzero_pd(), _CMP_EQ_OQ ) );
+		__m256d ilen1 = _mm256_blendv_pd( _mm256_div_pd( one, len1 ), one, _mm256_cmp_pd( len1, _mm256_setzero_pd(), _CMP_EQ_OQ ) );
+		__m256 ilen = _mm256_set_m128( _mm256_cvtpd_ps( ilen1 ), _mm256_cvtpd_ps( ilen0 ) );
+		_mm256_storeu_ps( x + i, _mm256_mul_ps( vx, ilen ) );
+		_mm256_storeu_ps( y + i, _mm256_mul_ps( vy, ilen ) );
+		_mm256_storeu_ps( z + i, _mm256_mul_ps( vz, ilen ) );
+	}
+#elif GDEF_SIMD_SSE2
+	const __m128d one = _mm_set1_pd( 1.0 );
+	for ( ; i + 4 <= count; i += 4 )
+	{
+		__m128 vx = _mm_loadu_ps( x + i ), vy = _mm_loadu_ps( y + i ), vz = _mm_loadu_ps( z + i );
+		__m128 len = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( vx, vx ), _mm_mul_ps( vy, vy ) ), _mm_mul_ps( vz, vz ) ) );
+		__m128d len0 = _mm_cvtps_pd( len );
+		__m128d len1 = _mm_cvtps_pd( _mm_movehl_ps( len, len ) );
+		/* zero length vectors are left alone */
+		__m128d zero0 = _mm_cmpeq_pd( len0, _mm_setzero_pd() ), zero1 = _mm_cmpeq_pd( len1, _mm_setzero_pd() );
+		__m128d ilen0 = _mm_or_pd( _mm_and_pd( zero0, one ), _mm_andnot_pd( zero0, _mm_div_pd( one, len0 ) ) );
+		__m128d ilen1 = _mm_or_pd( _mm_and_pd( zero1, one ), _mm_andnot_pd( zero1, _mm_div_pd( one, len1 ) ) );
+		__m128 ilen = _mm_movelh_ps( _mm_cvtpd_ps( ilen0 ), _mm_cvtpd_ps( ilen1 ) );
+		_mm_storeu_ps( x + i, _mm_mul_ps( vx, ilen ) );
+		_mm_storeu_ps( y + i, _mm_mul_ps( vy, ilen ) );
+		_mm_storeu_ps( z + i, _mm_mul_ps( vz, ilen ) );
+	}
+#endif
+
+	for ( ; i < count; i++ )
+	{
+		pmm::vec3_t vec = { x[ i ], y[ i ], z[ i ] };
+		_pico_normalize_vec( vec );
+		x[ i ] = vec[ 0 ];
+		y[ i ] = vec[ 1 ];
+		z[ i ] = vec[ 2 ];
+	}
+}
+
+/* _pico_float_to_half:
+ *  ieee half precision, rounded to nearest even
+ */
+unsigned short _pico_float_to_half( float f ){
+	unsigned int x, sign, absx, h, rest, half;
+
+	memcpy( &x, &f, sizeof( x ) );
+	sign = ( x >> 16 ) & 0x8000;
+	absx = x & 0x7fffffff;
+
+	/* inf and nan, and what rounds to inf */
+	if ( absx >= 0x7f800000 ) {
+		return (unsigned short) ( sign | 0x7c00 | ( absx > 0x7f800000 ? 0x200 : 0 ) );
+	}
+	if ( absx >= 0x477ff000 ) {
+		return (unsigned short) ( sign | 0x7c00 );
+	}
+
+	/* denormals */
+	if ( absx < 0x38800000 ) {
+		unsigned int shift = 126 - ( absx >> 23 );
+		if ( absx < 0x33000000 ) {
+			return (unsigned short) sign;
+		}
+		x = ( absx & 0x7fffff ) | 0x800000;
+		h = x >> shift;
+		rest = x & ( ( 1u << shift ) - 1 );
+		half = 1u << ( shift - 1 );
+		return (unsigned short) ( sign | ( h + ( rest > half || ( rest == half && ( h & 1 ) ) ) ) );
+	}
+
+	h = ( absx >> 13 ) - ( 112 << 10 );
+	rest = absx & 0x1fff;
+	return (unsigned short) ( sign | ( h + ( rest > 0x1000 || ( rest == 0x1000 && ( h & 1 ) ) ) ) );
+}
+
+float _pico_half_to_float( unsigned short h ){
+	unsigned int sign = ( h & 0x8000u ) << 16, exponent = ( h >> 10 ) & 0x1f, mantissa = h & 0x3ff, x;
+	float f;
+
+	if ( exponent == 0 ) {
+		f = mantissa * ( 1.0f / 16777216.0f );
+		return sign ? -f : f;
+	}
+	if ( exponent == 31 ) {
+		x = sign | 0x7f800000 | ( mantissa << 13 );
+	}
+	else {
+		x = sign | ( ( exponent + 112 ) << 23 ) | ( mantissa << 13 );
+	}
+	memcpy( &f, &x, sizeof( f ) );
+	return f;
+}
+
+/* _pico_oct_encode:
+ *  maps a unit vector onto the octahedron unfolded into [ -1, 1 ]^2
+ */
+void _pico_oct_encode( const pmm::vec_t *n, pmm::vec_t *oct ){
+	float l1 = fabsf( n[ 0 ] ) + fabsf( n[ 1 ] ) + fabsf( n[ 2 ] ), x, y;
+
+	if ( l1 == 0 ) {
+		oct[ 0 ] = oct[ 1 ] = 0;
+		return;
+	}
+	x = n[ 0 ] / l1;
+	y = n[ 1 ] / l1;
+	if ( n[ 2 ] < 0 ) {
+		float fx = ( 1 - fabsf( y ) ) * ( x >= 0 ? 1 : -1 );
+		y = ( 1 - fabsf( x ) ) * ( y >= 0 ? 1 : -1 );
+		x = fx;
+	}
+	oct[ 0 ] = x;
+	oct[ 1 ] = y;
+}
+
+void _pico_oct_decode( const pmm::vec_t *oct, pmm::vec_t *n ){
+	float x = oct[ 0 ], y = oct[ 1 ], z = 1 - fabsf( x ) - fabsf( y );
+
+	if ( z < 0 ) {
+		float fx = ( 1 - fabsf( y ) ) * ( x >= 0 ? 1 : -1 );
+		y = ( 1 - fabsf( x ) ) * ( y >= 0 ? 1 : -1 );
+		x = fx;
+	}
+	n[ 0 ] = x;
+	n[ 1 ] = y;
+	n[ 2 ] = z;
+	_pico_normalize_vec( n );
+}
+
+/* _pico_decode_positions:
+ *  origin + q * scale for 'count' quantized positions. four positions are
+ *  twelve shorts, so the per lane origin and scale repeat every three
+ *  registers
+ */
+void _pico_decode_positions( const pmm::qvec3_t *q, int count, const pmm::vec_t *origin, const pmm::vec_t *scale, pmm::vec3_t *dest ){
+	int i = 0, j;
+
+#if GDEF_SIMD_SSE2
+	const unsigned short *src = q[ 0 ];
+	pmm::vec_t *f = dest[ 0 ];
+	const __m128i zero = _mm_setzero_si128();
+	__m128 o[ 3 ], k[ 3 ];
+	for ( j = 0; j < 3; j++ )
+	{
+		o[ j ] = _mm_setr_ps( origin[ j % 3 ], origin[ ( j + 1 ) % 3 ], origin[ ( j + 2 ) % 3 ], origin[ j % 3 ] );
+		k[ j ] = _mm_setr_ps( scale[ j % 3 ], scale[ ( j + 1 ) % 3 ], scale[ ( j + 2 ) % 3 ], scale[ j % 3 ] );
+	}
+	for ( ; i + 4 <= count; i += 4 )
+	{
+		__m128i a = _mm_loadu_si128( (const __m128i *) ( src + i * 3 ) );
+		__m128i b = _mm_loadl_epi64( (const __m128i *) ( src + i * 3 + 8 ) );
+		_mm_storeu_ps( f + i * 3, _mm_add_ps( o[ 0 ], _mm_mul_ps( _mm_cvtepi32_ps( _mm_unpacklo_epi16( a, zero ) ), k[ 0 ] ) ) );
+		_mm_storeu_ps( f + i * 3 + 4, _mm_add_ps( o[ 1 ], _mm_mul_ps( _mm_cvtepi32_ps( _mm_unpackhi_epi16( a, zero ) ), k[ 1 ] ) ) );
+		_mm_storeu_ps( f + i * 3 + 8, _mm_add_ps( o[ 2 ], _mm_mul_ps( _mm_cvtepi32_ps( _mm_unpacklo_epi16( b, zero ) ), k[ 2 ] ) ) );
+	}
+#endif
+
+	for ( ; i < count; i++ )
+		for ( j = 0; j < 3; j++ )
+			dest[ i ][ j ] = origin[ j ] + q[ i ][ j ] * scale[ j ];
+}
+
+/* _pico_decode_octs:
+ *  unit vectors from 'count' octahedral snorm16 pairs
+ */
+void _pico_decode_octs( const pmm::oct_t *oct, int count, pmm::vec3_t *dest ){
+	int i = 0;
+
+#if GDEF_SIMD_SSE2
+	const __m128 inv = _mm_set1_ps( 1.0f / 32767.0f ), one = _mm_set1_ps( 1.0f ), zero = _mm_setzero_ps();
+	const __m128 minus = _mm_set1_ps( -1.0f ), sign = _mm_set1_ps( -0.0f );
+	for ( ; i + 4 <= count; i += 4 )
+	{
+		/* x0 y0 x1 y1 x2 y2 x3 y3 -> x, y */
+		__m128i a = _mm_loadu_si128( (const __m128i *) oct[ i ] );
+		__m128 lo = _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpacklo_epi16( a, a ), 16 ) );
+		__m128 hi = _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpackhi_epi16( a, a ), 16 ) );
+		__m128 x = _mm_max_ps( _mm_mul_ps( _mm_shuffle_ps( lo, hi, _MM_SHUFFLE( 2, 0, 2, 0 ) ), inv ), minus );
+		__m128 y = _mm_max_ps( _mm_mul_ps( _mm_shuffle_ps( lo, hi, _MM_SHUFFLE( 3, 1, 3, 1 ) ), inv ), minus );
+
+		/* fold the lower hemisphere back: x += x >= 0 ? -t : t */
+		__m128 z = _mm_sub_ps( _mm_sub_ps( one, _mm_andnot_ps( sign, x ) ), _mm_andnot_ps( sign, y ) );
+		__m128 t = _mm_max_ps( _mm_sub_ps( zero, z ), zero );
+		x = _mm_sub_ps( x, _mm_or_ps( t, _mm_and_ps( x, sign ) ) );
+		y = _mm_sub_ps( y, _mm_or_ps( t, _mm_and_ps( y, sign ) ) );
+
+		__m128 length = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, x ), _mm_mul_ps( y, y ) ), _mm_mul_ps( z, z ) ) );
+		_pico_store_vecs4( dest[ i ], _mm_div_ps( x, length ), _mm_div_ps( y, length ), _mm_div_ps( z, length ) );
+	}
+#endif
+
+	for ( ; i < count; i++ )
+	{
+		pmm::vec2_t f = { oct[ i ][ 0 ] / 32767.0f, oct[ i ][ 1 ] / 32767.0f };
+		f[ 0 ] = f[ 0 ] < -1 ? -1 : f[ 0 ];
+		f[ 1 ] = f[ 1 ] < -1 ? -1 : f[ 1 ];
+		_pico_oct_decode( f, dest[ i ] );
+	}
+}
+
+/* _pico_decode_halves:
+ *  'count' ieee half floats to floats
+ */
+void _pico_decode_halves( const unsigned short *h, int count, pmm::vec_t *dest ){
+	int i = 0;
+
+#if GDEF_SIMD_F16C
+	for ( ; i + 8 <= count; i += 8 )
+		_mm256_storeu_ps( dest + i, _mm256_cvtph_ps( _mm_loadu_si128( (const __m128i *) ( h + i ) ) ) );
+#endif
+
+	for ( ; i < count; i++ )
+		dest[ i ] = _pico_half_to_float( h[ i ] );
+}
+
+/* _pico_decode_snorms:
+ *  'count' snorm16 values to [ -1, 1 ]
+ */
+void _pico_decode_snorms( const short *s, int count, pmm::vec_t *dest ){
+	int i = 0;
+
+#if GDEF_SIMD_SSE2
+	const __m128 inv = _mm_set1_ps( 1.0f / 32767.0f ), minus = _mm_set1_ps( -1.0f );
+	for ( ; i + 8 <= count; i += 8 )
+	{
+		__m128i a = _mm_loadu_si128( (const __m128i *) ( s + i ) );
+		_mm_storeu_ps( dest + i, _mm_max_ps( _mm_mul_ps( _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpacklo_epi16( a, a ), 16 ) ), inv ), minus ) );
+		_mm_storeu_ps( dest + i + 4, _mm_max_ps( _mm_mul_ps( _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpackhi_epi16( a, a ), 16 ) ), inv ), minus ) );
+	}
+#endif
+
+	for ( ; i < count; i++ )
+		dest[ i ] = s[ i ] < -32767 ? -1.0f : s[ i ] / 32767.0f;
+}
+
 void _pico_add_vec( pmm::vec3_t a, pmm::vec3_t b, pmm::vec3_t dest ){
 	dest[ 0 ] = a[ 0 ] + b[ 0 ];
 	dest[ 1 ] = a[ 1 ] + b[ 1 ];
@@ -280,6 +717,104 @@ pmm::vec_t _pico_calc_plane( pmm::vec4_t plane, pmm::vec3_t a, pmm::vec3_t b, pm
 	return _pico_normalize_vec( plane );
 }
 
+/* triangles gathered into one batch by _pico_calc_face_planes */
+#define FACE_PLANES_BATCH 64
+
+/* _pico_calc_face_planes:
+ *  unit normal and plane distance of 'numTriangles' triangles, wound like
+ *  _pico_calc_plane. vertices are gathered into x/y/z batches, then the
+ *  cross products, normalization and distances run four or eight
+ *  triangles at a time. triangles with an index outside [0, numVertexes)
+ *  get a zero plane.
+ */
+void _pico_calc_face_planes( pmm::vec3_t *xyz, int numVertexes, pmm::index_t *index, int numTriangles, pmm::vec3_t *normals, pmm::vec_t *dists ){
+	static const pmm::vec3_t zero = { 0, 0, 0 };
+	pmm::vec_t p[ 9 ][ FACE_PLANES_BATCH ];       /* ax ay az bx by bz cx cy cz */
+	pmm::vec_t n[ 4 ][ FACE_PLANES_BATCH ];       /* nx ny nz dist */
+	int first, count, i, j, k;
+
+	for ( first = 0; first < numTriangles; first += FACE_PLANES_BATCH )
+	{
+		count = numTriangles - first < FACE_PLANES_BATCH ? numTriangles - first : FACE_PLANES_BATCH;
+
+		/* gather */
+		for ( i = 0; i < count; i++ )
+		{
+			pmm::index_t *tri = index + ( first + i ) * 3;
+			int valid = 1;
+			for ( j = 0; j < 3; j++ )
+				if ( tri[ j ] < 0 || tri[ j ] >= numVertexes ) {
+					valid = 0;
+				}
+			for ( j = 0; j < 3; j++ )
+				for ( k = 0; k < 3; k++ )
+					p[ j * 3 + k ][ i ] = valid ? xyz[ tri[ j ] ][ k ] : zero[ k ];
+		}
+
+		/* normal = ( c - a ) x ( b - a ) */
+		i = 0;
+#if GDEF_SIMD_AVX
+		for ( ; i + 8 <= count; i += 8 )
+		{
+			__m256 ax = _mm256_loadu_ps( p[ 0 ] + i ), ay = _mm256_loadu_ps( p[ 1 ] + i ), az = _mm256_loadu_ps( p[ 2 ] + i );
+			__m256 bax = _mm256_sub_ps( _mm256_loadu_ps( p[ 3 ] + i ), ax ), bay = _mm256_sub_ps( _mm256_loadu_ps( p[ 4 ] + i ), ay ), baz = _mm256_sub_ps( _mm256_loadu_ps( p[ 5 ] + i ), az );
+			__m256 cax = _mm256_sub_ps( _mm256_loadu_ps( p[ 6 ] + i ), ax ), cay = _mm256_sub_ps( _mm256_loadu_ps( p[ 7 ] + i ), ay ), caz = _mm256_sub_ps( _mm256_loadu_ps( p[ 8 ] + i ), az );
+			_mm256_storeu_ps( n[ 0 ] + i, _mm256_sub_ps( _mm256_mul_ps( cay, baz ), _mm256_mul_ps( caz, bay ) ) );
+			_mm256_storeu_ps( n[ 1 ] + i, _mm256_sub_ps( _mm256_mul_ps( caz, bax ), _mm256_mul_ps( cax, baz ) ) );
+			_mm256_storeu_ps( n[ 2 ] + i, _mm256_sub_ps( _mm256_mul_ps( cax, bay ), _mm256_mul_ps( cay, bax ) ) );
+		}
+#elif GDEF_SIMD_SSE2
+		for ( ; i + 4 <= count; i += 4 )
+		{
+			__m128 ax = _mm_loadu_ps( p[ 0 ] + i ), ay = _mm_loadu_ps( p[ 1 ] + i ), az = _mm_loadu_ps( p[ 2 ] + i );
+			__m128 bax = _mm_sub_ps( _mm_loadu_ps( p[ 3 ] + i ), ax ), bay = _mm_sub_ps( _mm_loadu_ps( p[ 4 ] + i ), ay ), baz = _mm_sub_ps( _mm_loadu_ps( p[ 5 ] + i ), az );
+			__m128 cax = _mm_sub_ps( _mm_loadu_ps( p[ 6 ] + i ), ax ), cay = _mm_sub_ps( _mm_loadu_ps( p[ 7 ] + i ), ay ), caz = _mm_sub_ps( _mm_loadu_ps( p[ 8 ] + i ), az );
+			_mm_storeu_ps( n[ 0 ] + i, _mm_sub_ps( _mm_mul_ps( cay, baz ), _mm_mul_ps( caz, bay ) ) );
+			_mm_storeu_ps( n[ 1 ] + i, _mm_sub_ps( _mm_mul_ps( caz, bax ), _mm_mul_ps( cax, baz ) ) );
+			_mm_storeu_ps( n[ 2 ] + i, _mm_sub_ps( _mm_mul_ps( cax, bay ), _mm_mul_ps( cay, bax ) ) );
+		}
+#endif
+		for ( ; i < count; i++ )
+		{
+			pmm::vec3_t a = { p[ 0 ][ i ], p[ 1 ][ i ], p[ 2 ][ i ] };
+			pmm::vec3_t b = { p[ 3 ][ i ], p[ 4 ][ i ], p[ 5 ][ i ] };
+			pmm::vec3_t c = { p[ 6 ][ i ], p[ 7 ][ i ], p[ 8 ][ i ] };
+			pmm::vec3_t ba, ca, normal;
+			_pico_subtract_vec( b, a, ba );
+			_pico_subtract_vec( c, a, ca );
+			_pico_cross_vec( ca, ba, normal );
+			n[ 0 ][ i ] = normal[ 0 ];
+			n[ 1 ][ i ] = normal[ 1 ];
+			n[ 2 ][ i ] = normal[ 2 ];
+		}
+
+		_pico_normalize_vecs( n[ 0 ], n[ 1 ], n[ 2 ], count );
+
+		/* dist = a . normal */
+		i = 0;
+#if GDEF_SIMD_AVX
+		for ( ; i + 8 <= count; i += 8 )
+			_mm256_storeu_ps( n[ 3 ] + i, _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( _mm256_loadu_ps( p[ 0 ] + i ), _mm256_loadu_ps( n[ 0 ] + i ) ),
+																		 _mm256_mul_ps( _mm256_loadu_ps( p[ 1 ] + i ), _mm256_loadu_ps( n[ 1 ] + i ) ) ),
+														   _mm256_mul_ps( _mm256_loadu_ps( p[ 2 ] + i ), _mm256_loadu_ps( n[ 2 ] + i ) ) ) );
+#elif GDEF_SIMD_SSE2
+		for ( ; i + 4 <= count; i += 4 )
+			_mm_storeu_ps( n[ 3 ] + i, _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( p[ 0 ] + i ), _mm_loadu_ps( n[ 0 ] + i ) ),
+															   _mm_mul_ps( _mm_loadu_ps( p[ 1 ] + i ), _mm_loadu_ps( n[ 1 ] + i ) ) ),
+												   _mm_mul_ps( _mm_loadu_ps( p[ 2 ] + i ), _mm_loadu_ps( n[ 2 ] + i ) ) ) );
+#endif
+		for ( ; i < count; i++ )
+			n[ 3 ][ i ] = p[ 0 ][ i ] * n[ 0 ][ i ] + p[ 1 ][ i ] * n[ 1 ][ i ] + p[ 2 ][ i ] * n[ 2 ][ i ];
+
+		/* scatter */
+		for ( i = 0; i < count; i++ )
+		{
+			_pico_set_vec( normals[ first + i ], n[ 0 ][ i ], n[ 1 ][ i ], n[ 2 ][ i ] );
+			dists[ first + i ] = n[ 3 ][ i ];
+		}
+	}
+}
+
 /* separate from _pico_set_vec4 */
 void _pico_set_color( pmm::color_t c, int r, int g, int b, int a ){
 	c[ 0 ] = r;
@@ -1165,3 +1700,59 @@ long _pico_memstream_tell( picoMemStream_t *s ){
 
 	return s->curPos - s->buffer;
 }
+
+/* set while a thread runs a _pico_parallel_for range */
+static thread_local int _pico_in_parallel = 0;
+
+/* _pico_parallel_for:
+ *  calls 'func' on consecutive [first, last) ranges covering [0, count),
+ *  spread over up to pmm::man.pp_num_threads() threads. ranges hold at
+ *  least 'grain' items, so small inputs stay on the calling thread, and
+ *  so do calls made from inside another parallel range.
+ */
+void _pico_parallel_for( int count, int grain, const std::function<void( int first, int last )> &func ){
+	int numThreads, chunk, i;
+	std::vector<std::thread> threads;
+
+	if ( count <= 0 ) {
+		return;
+	}
+	if ( grain < 1 ) {
+		grain = 1;
+	}
+
+	numThreads = _pico_in_parallel ? 1 : pmm::man.pp_num_threads();
+	if ( numThreads > ( count + grain - 1 ) / grain ) {
+		numThreads = ( count + grain - 1 ) / grain;
+	}
+	if ( numThreads <= 1 ) {
+		func( 0, count );
+		return;
+	}
+
+	/* the calling thread takes the first range */
+	chunk = ( count + numThreads - 1 ) / numThreads;
+	threads.reserve( numThreads - 1 );
+	for ( i = 1; i < numThreads && i * chunk < count; i++ )
+	{
+		int first = i * chunk;
+		int last = first + chunk < count ? first + chunk : count;
+		threads.emplace_back( [&func, first, last](){
+			_pico_in_parallel = 1;
+			func( first, last );
+		} );
+	}
+	_pico_in_parallel = 1;
+	func( 0, chunk );
+	_pico_in_parallel = 0;
+	for ( std::thread &thread : threads )
+		thread.join();
+}
+
+/* _pico_parallel_worker:
+ *  marks the calling thread as one of a pool that keeps the cores busy on
+ *  its own, so its _pico_parallel_for calls stay on the thread
+ */
+void _pico_parallel_worker( void ){
+	_pico_in_parallel = 1;
+}
@@ -46,7 +46,7 @@
 
 /* helper functions */
 static const char *lwo_lwIDToStr( unsigned int lwID ){
-	static char lwIDStr[5];
+	static thread_local char lwIDStr[5];
 
 	if ( !lwID ) {
 		return "n/a";
@@ -86,6 +86,104 @@ static int _lwo_canload( PM_PARAMS_CANLOAD ){
 	return ret;
 }
 
+/* big endian reads for _lwo_probe() */
+static unsigned int _lwo_probe_u4( const pmm::ub8_t *bp ){
+	return ( (unsigned int) bp[ 0 ] << 24 ) | ( (unsigned int) bp[ 1 ] << 16 ) | ( (unsigned int) bp[ 2 ] << 8 ) | bp[ 3 ];
+}
+
+static unsigned int _lwo_probe_u2( const pmm::ub8_t *bp ){
+	return ( (unsigned int) bp[ 0 ] << 8 ) | bp[ 1 ];
+}
+
+/*
+   _lwo_probe()
+   walks the top level chunks of a LightWave Object file. only
+   three vertex FACE polygons are counted since the loader
+   discards everything else.
+ */
+static int _lwo_probe( PM_PARAMS_PROBE ){
+	const pmm::ub8_t *buf = (const pmm::ub8_t *)buffer;
+	const pmm::ub8_t *bp, *end;
+	char name[ 256 ];
+	unsigned int id, type, polType;
+	long ofs, cksize, len, formEnd;
+	int nv, i;
+
+
+	(void) fileName;
+
+	if ( !_pico_probe_range( bufSize, 0, 12 ) ) {
+		return 0;
+	}
+	type = _lwo_probe_u4( buf + 8 );
+	formEnd = 8 + (long) _lwo_probe_u4( buf + 4 );
+	if ( formEnd > bufSize ) {
+		formEnd = bufSize;
+	}
+
+	for ( ofs = 12; ofs + 8 <= formEnd; ofs += 8 + cksize + ( cksize & 1 ) )
+	{
+		id = _lwo_probe_u4( buf + ofs );
+		cksize = _lwo_probe_u4( buf + ofs + 4 );
+		if ( !_pico_probe_range( bufSize, ofs + 8, cksize ) ) {
+			return 0;
+		}
+		bp = buf + ofs + 8;
+		end = bp + cksize;
+
+		if ( id == ID_PNTS ) {
+			info->numVertexes += cksize / 12;
+		}
+		else if ( id == ID_POLS && type == ID_LWO2 ) {
+			if ( cksize < 4 ) {
+				continue;
+			}
+			polType = _lwo_probe_u4( bp );
+			for ( bp += 4; bp + 2 <= end; )
+			{
+				nv = _lwo_probe_u2( bp ) & 0x03FF;
+				bp += 2;
+				for ( i = 0; i < nv && bp < end; i++ )
+					bp += ( bp[ 0 ] == 0xFF ) ? 4 : 2;
+				if ( polType == ID_FACE && nv == 3 ) {
+					info->numTriangles++;
+				}
+			}
+		}
+		else if ( id == ID_POLS ) {
+			/* LWOB polygons end in a surface index, negative means detail polygons follow */
+			for ( ; bp + 2 <= end; )
+			{
+				nv = _lwo_probe_u2( bp );
+				bp += 2 + 2 * nv;
+				if ( bp + 2 > end ) {
+					break;
+				}
+				if ( (short) _lwo_probe_u2( bp ) < 0 ) {
+					bp += 2;
+				}
+				bp += 2;
+				if ( nv == 3 ) {
+					info->numTriangles++;
+				}
+			}
+		}
+		else if ( id == ID_SURF ) {
+			/* same detox as the loader */
+			len = ( cksize < (long) sizeof( name ) - 1 ) ? cksize : (long) sizeof( name ) - 1;
+			strncpy( name, (const char *) bp, len );
+			name[ len ] = '\0';
+			info->numSurfaces++;
+			_pico_first_token( name );
+			_pico_setfext( name, "" );
+			_pico_unixify( name );
+			_pico_probe_add_shader( info, name );
+		}
+	}
+
+	return 1;
+}
+
 /*
    _lwo_load()
    loads a LightWave Object model file.
@@ -110,11 +208,12 @@ static pmm::model_t *_lwo_load( PM_PARAMS_LOAD ){
 	pmm::vec3_t xyz, normal;
 	pmm::vec2_t st;
 	pmm::color_t color;
+	int loadFlags = _pico_load_flags( options );
 
 	int defaultSTAxis[ 2 ];
 	pmm::vec2_t defaultXYZtoSTScale;
 
-	pmm::pp_vertex_comnination_hash_t **hashTable;
+	pmm::pp_vertex_combination_hash_table_t *hashTable;
 	pmm::pp_vertex_comnination_hash_t *vertexCombinationHash;
 
 #ifdef DEBUG_PM_LWO
@@ -218,14 +317,31 @@ static pmm::model_t *_lwo_load( PM_PARAMS_LOAD ){
 	defaultXYZtoSTScale[ 0 ] = 4.f / st[ 0 ];
 	defaultXYZtoSTScale[ 1 ] = 4.f / st[ 1 ];
 
+	/* one vertex combination table, cleared for each surface */
+	hashTable = pmm::pp_new_vertex_combination_hash_table();
+
+	if ( hashTable == nullptr ) {
+		pmm::man.pp_print(pmm::pl_error, "Unable to allocate hash table");
+		pmm::pp_free_model( picoModel );
+		lwFreeObject( obj );
+		return nullptr;
+	}
+
 	/* LWO surfaces become pico surfaces */
 	surface = obj->surf;
 	while ( surface )
 	{
+		/* filtered out by the caller */
+		if ( !_pico_load_surface( options, surface->name ) ) {
+			surface = surface->next;
+			continue;
+		}
+
 		/* allocate new pico surface */
 		picoSurface = pmm::pp_new_surface( picoModel );
 		if ( picoSurface == nullptr ) {
 			pmm::man.pp_print(pmm::pl_error, "Unable to allocate a new model surface");
+			pmm::pp_free_vertex_combination_hash_table( hashTable );
 			pmm::pp_free_model( picoModel );
 			lwFreeObject( obj );
 			return nullptr;
@@ -241,6 +357,7 @@ static pmm::model_t *_lwo_load( PM_PARAMS_LOAD ){
 		picoShader = pmm::pp_new_shader( picoModel );
 		if ( picoShader == nullptr ) {
 			pmm::man.pp_print(pmm::pl_error, "Unable to allocate a new model shader");
+			pmm::pp_free_vertex_combination_hash_table( hashTable );
 			pmm::pp_free_model( picoModel );
 			lwFreeObject( obj );
 			return nullptr;
@@ -259,14 +376,7 @@ static pmm::model_t *_lwo_load( PM_PARAMS_LOAD ){
 		/* copy indices and vertex data */
 		numverts = 0;
 
-		hashTable = pmm::pp_new_vertex_combination_hash_table();
-
-		if ( hashTable == nullptr ) {
-			pmm::man.pp_print(pmm::pl_error, "Unable to allocate hash table");
-			pmm::pp_free_model( picoModel );
-			lwFreeObject( obj );
-			return nullptr;
-		}
+		pmm::pp_clear_vertex_combination_hash_table( hashTable );
 
 		for ( i = 0, pol = layer->polygon.pol; i < layer->polygon.count; i++, pol++ )
 		{
@@ -371,6 +481,14 @@ static pmm::model_t *_lwo_load( PM_PARAMS_LOAD ){
 					}
 				}
 
+				/* skipped streams weld as their defaults */
+				if ( loadFlags & pmm::lf_skip_st ) {
+					_pico_zero_vec2( st );
+				}
+				if ( loadFlags & pmm::lf_skip_colors ) {
+					_pico_set_color( color, 255, 255, 255, 255 );
+				}
+
 				/* find vertex in this surface and if we can't find it there create it */
 				vertexCombinationHash = pmm::pp_find_vertex_combination_in_hash_table( hashTable, xyz, normal, st, color );
 
@@ -395,13 +513,19 @@ static pmm::model_t *_lwo_load( PM_PARAMS_LOAD ){
 					pmm::pp_set_surface_xyz( picoSurface, numverts, xyz );
 
 					/* set dummy normal */
-					pmm::pp_set_surface_normal( picoSurface, numverts, normal );
+					if ( !( loadFlags & pmm::lf_skip_normals ) ) {
+						pmm::pp_set_surface_normal( picoSurface, numverts, normal );
+					}
 
 					/* set color */
-					pmm::pp_set_surface_color( picoSurface, 0, numverts, color );
+					if ( !( loadFlags & pmm::lf_skip_colors ) ) {
+						pmm::pp_set_surface_color( picoSurface, 0, numverts, color );
+					}
 
 					/* set st coords */
-					pmm::pp_set_surface_st( picoSurface, 0, numverts, st );
+					if ( !( loadFlags & pmm::lf_skip_st ) ) {
+						pmm::pp_set_surface_st( picoSurface, 0, numverts, st );
+					}
 
 					/* set index */
 					pmm::pp_set_surface_index( picoSurface, ( i * 3 + j ), (pmm::index_t) numverts );
@@ -411,13 +535,13 @@ static pmm::model_t *_lwo_load( PM_PARAMS_LOAD ){
 			}
 		}
 
-		/* free the hashtable */
-		pmm::pp_free_vertex_combination_hash_table( hashTable );
-
 		/* get next surface */
 		surface = surface->next;
 	}
 
+	/* free the hashtable */
+	pmm::pp_free_vertex_combination_hash_table( hashTable );
+
 #ifdef DEBUG_PM_LWO
 	load_start = convert_finish = clock();
 #endif
@@ -462,5 +586,6 @@ extern const pmm::module_t picoModuleLWO =
 	_lwo_canload,               /* validation routine */
 	_lwo_load,                  /* load routine */
 	nullptr,                       /* save validation routine */
-	nullptr                        /* save routine */
+	nullptr,                       /* save routine */
+	_lwo_probe                  /* probe routine */
 };
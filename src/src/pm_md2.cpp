@@ -321,6 +321,35 @@ static int _md2_canload( PM_PARAMS_CANLOAD ){
 
 
 
+// _md2_probe() reads the counts and the skin name from the md2 header.
+
+static int _md2_probe( PM_PARAMS_PROBE ){
+	const md2_t *md2 = (const md2_t*) buffer;
+	char skinname[ MD2_MAX_SKINNAME + 1 ];
+	long ofsSkins;
+
+	(void) fileName;
+
+	info->numFrames = _pico_little_long( md2->numFrames );
+	info->numSurfaces = 1;
+	info->numVertexes = _pico_little_long( md2->numXYZ );
+	info->numTriangles = _pico_little_long( md2->numTris );
+
+	// same detox as the loader
+	ofsSkins = _pico_little_long( md2->ofsSkins );
+	if ( _pico_probe_range( bufSize, ofsSkins, MD2_MAX_SKINNAME ) ) {
+		strncpy( skinname, (const char *) buffer + ofsSkins, MD2_MAX_SKINNAME );
+		skinname[ MD2_MAX_SKINNAME ] = '\0';
+		_pico_setfext( skinname, "" );
+		_pico_unixify( skinname );
+		_pico_probe_add_shader( info, skinname );
+	}
+
+	return 1;
+}
+
+
+
 // _md2_load() loads a quake2 md2 model file.
 
 
@@ -343,7 +372,7 @@ static pmm::model_t *_md2_load( PM_PARAMS_LOAD ){
 	pmm::shader_t    *picoShader;
 	pmm::vec3_t xyz, normal;
 	pmm::vec2_t st;
-	pmm::color_t color;
+	int loadFlags = _pico_load_flags( options );
 
 
 	/* set as md2 */
@@ -467,6 +496,31 @@ static pmm::model_t *_md2_load( PM_PARAMS_LOAD ){
 	pmm::pp_set_model_name( picoModel, fileName );
 	pmm::pp_set_model_file_name( picoModel, fileName );
 
+	// bounds of every frame, for culling animated instances
+	if ( md2->numXYZ > 0 && md2->frameSize >= (int) ( sizeof( md2Frame_t ) + ( md2->numXYZ - 1 ) * sizeof( md2XyzNormal_t ) )
+		 && md2->ofsFrames + (long long) md2->frameSize * md2->numFrames <= bufSize ) {
+		pmm::vec3_t *frameXyz = (pmm::vec3_t *) pmm::man.pp_k_new( md2->numXYZ, sizeof( *frameXyz ) );
+		for ( i = 0; frameXyz != nullptr && i < md2->numFrames; i++ )
+		{
+			md2Frame_t *frameI = (md2Frame_t *) ( bb + md2->ofsFrames + md2->frameSize * i );
+			float scale[ 3 ], translate[ 3 ];
+			int k;
+			for ( j = 0; j < 3; j++ )
+			{
+				// the loaded frame is already swapped
+				scale[ j ] = frameI == frame ? frameI->scale[ j ] : _pico_little_float( frameI->scale[ j ] );
+				translate[ j ] = frameI == frame ? frameI->translate[ j ] : _pico_little_float( frameI->translate[ j ] );
+			}
+			for ( k = 0; k < md2->numXYZ; k++ )
+				for ( j = 0; j < 3; j++ )
+					frameXyz[ k ][ j ] = frameI->verts[ k ].v[ j ] * scale[ j ] + translate[ j ];
+			_pico_set_frame_bounds( picoModel, i, frameXyz, md2->numXYZ );
+		}
+		if ( frameXyz != nullptr ) {
+			pmm::man.pp_m_delete( frameXyz );
+		}
+	}
+
 	// allocate new pico surface
 	picoSurface = pmm::pp_new_surface( picoModel );
 	if ( picoSurface == nullptr ) {
@@ -600,15 +654,19 @@ static pmm::model_t *_md2_load( PM_PARAMS_LOAD ){
 		pmm::pp_set_surface_xyz( picoSurface, i, xyz );
 
 		/* set normal */
-		normal[ 0 ] = md2_normals[vertex->lightnormalindex][0];
-		normal[ 1 ] = md2_normals[vertex->lightnormalindex][1];
-		normal[ 2 ] = md2_normals[vertex->lightnormalindex][2];
-		pmm::pp_set_surface_normal( picoSurface, i, normal );
+		if ( !( loadFlags & pmm::lf_skip_normals ) ) {
+			normal[ 0 ] = md2_normals[vertex->lightnormalindex][0];
+			normal[ 1 ] = md2_normals[vertex->lightnormalindex][1];
+			normal[ 2 ] = md2_normals[vertex->lightnormalindex][2];
+			pmm::pp_set_surface_normal( picoSurface, i, normal );
+		}
 
 		/* set st coords */
-		st[ 0 ] =  ( ( texCoord[p_index_LUT[i].ST].s ) / ( (float)md2->skinWidth ) );
-		st[ 1 ] =  ( texCoord[p_index_LUT[i].ST].t / ( (float)md2->skinHeight ) );
-		pmm::pp_set_surface_st( picoSurface, 0, i, st );
+		if ( !( loadFlags & pmm::lf_skip_st ) ) {
+			st[ 0 ] =  ( ( texCoord[p_index_LUT[i].ST].s ) / ( (float)md2->skinWidth ) );
+			st[ 1 ] =  ( texCoord[p_index_LUT[i].ST].t / ( (float)md2->skinHeight ) );
+			pmm::pp_set_surface_st( picoSurface, 0, i, st );
+		}
 	}
 
 	if ( dups ) {
@@ -622,21 +680,22 @@ static pmm::model_t *_md2_load( PM_PARAMS_LOAD ){
 			pmm::pp_set_surface_xyz( picoSurface, i + md2->numXYZ, xyz );
 
 			/* set normal */
-			normal[ 0 ] = md2_normals[frame->verts[j].lightnormalindex][0];
-			normal[ 1 ] = md2_normals[frame->verts[j].lightnormalindex][1];
-			normal[ 2 ] = md2_normals[frame->verts[j].lightnormalindex][2];
-			pmm::pp_set_surface_normal( picoSurface, i + md2->numXYZ, normal );
+			if ( !( loadFlags & pmm::lf_skip_normals ) ) {
+				normal[ 0 ] = md2_normals[frame->verts[j].lightnormalindex][0];
+				normal[ 1 ] = md2_normals[frame->verts[j].lightnormalindex][1];
+				normal[ 2 ] = md2_normals[frame->verts[j].lightnormalindex][2];
+				pmm::pp_set_surface_normal( picoSurface, i + md2->numXYZ, normal );
+			}
 
 			/* set st coords */
-			st[ 0 ] =  ( ( texCoord[p_index_LUT_DUPS[i].ST].s ) / ( (float)md2->skinWidth ) );
-			st[ 1 ] =  ( texCoord[p_index_LUT_DUPS[i].ST].t / ( (float)md2->skinHeight ) );
-			pmm::pp_set_surface_st( picoSurface, 0, i + md2->numXYZ, st );
+			if ( !( loadFlags & pmm::lf_skip_st ) ) {
+				st[ 0 ] =  ( ( texCoord[p_index_LUT_DUPS[i].ST].s ) / ( (float)md2->skinWidth ) );
+				st[ 1 ] =  ( texCoord[p_index_LUT_DUPS[i].ST].t / ( (float)md2->skinHeight ) );
+				pmm::pp_set_surface_st( picoSurface, 0, i + md2->numXYZ, st );
+			}
 		}
 	}
 
-	/* set color */
-	pmm::pp_set_surface_color( picoSurface, 0, 0, color );
-
 	// Free up malloc'ed LL entries
 	for ( i = 0; i < md2->numXYZ; i++ )
 	{
@@ -680,5 +739,6 @@ extern const pmm::module_t picoModuleMD2 =
 	_md2_canload,                   /* validation routine */
 	_md2_load,                      /* load routine */
 	nullptr,                           /* save validation routine */
-	nullptr                            /* save routine */
+	nullptr,                           /* save routine */
+	_md2_probe                      /* probe routine */
 };
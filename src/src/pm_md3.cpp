@@ -163,6 +163,60 @@ static int _md3_canload( PM_PARAMS_CANLOAD ){
 
 
 
+/*
+   _md3_probe()
+   counts frames, surfaces, vertexes and triangles of an md3 from the
+   model and surface headers
+ */
+
+static int _md3_probe( PM_PARAMS_PROBE ){
+	const pmm::ub8_t    *bb = (const pmm::ub8_t*) buffer;
+	const md3_t         *md3 = (const md3_t*) buffer;
+	const md3Surface_t  *surface;
+	const md3Shader_t   *shader;
+	char name[ sizeof( shader->name ) + 1 ];
+	long ofs, ofsEnd;
+	int i, numSurfaces;
+
+
+	(void) fileName;
+
+	info->numFrames = _pico_little_long( md3->numFrames );
+	numSurfaces = _pico_little_long( md3->num_surfaces );
+
+	/* walk the surface headers */
+	ofs = _pico_little_long( md3->ofsSurfaces );
+	for ( i = 0; i < numSurfaces; i++, ofs += ofsEnd )
+	{
+		if ( !_pico_probe_range( bufSize, ofs, sizeof( *surface ) ) ) {
+			return 0;
+		}
+		surface = (const md3Surface_t*) ( bb + ofs );
+		info->numSurfaces++;
+		info->numVertexes += _pico_little_long( surface->numVerts );
+		info->numTriangles += _pico_little_long( surface->numTriangles );
+
+		/* same detox as the loader */
+		if ( _pico_probe_range( bufSize, ofs + _pico_little_long( surface->ofsShaders ), sizeof( *shader ) ) ) {
+			shader = (const md3Shader_t*) ( bb + ofs + _pico_little_long( surface->ofsShaders ) );
+			strncpy( name, shader->name, sizeof( name ) - 1 );
+			name[ sizeof( name ) - 1 ] = '\0';
+			_pico_setfext( name, "" );
+			_pico_unixify( name );
+			_pico_probe_add_shader( info, name );
+		}
+
+		ofsEnd = _pico_little_long( surface->ofsEnd );
+		if ( ofsEnd <= 0 ) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+
+
 /*
    _md3_load()
    loads a quake3 arena md3 model file.
@@ -185,7 +239,7 @@ static pmm::model_t *_md3_load( PM_PARAMS_LOAD ){
 	pmm::shader_t    *picoShader;
 	pmm::vec3_t xyz, normal;
 	pmm::vec2_t st;
-	pmm::color_t color;
+	int loadFlags = _pico_load_flags( options );
 
 
 	/* -------------------------------------------------
@@ -308,12 +362,31 @@ static pmm::model_t *_md3_load( PM_PARAMS_LOAD ){
 	pmm::pp_set_model_name( picoModel, fileName );
 	pmm::pp_set_model_file_name( picoModel, fileName );
 
+	/* frame headers carry the bounds of every frame */
+	frame = (md3Frame_t*) ( bb + md3->ofsFrames );
+	for ( i = 0; i < md3->numFrames; i++, frame++ )
+	{
+		pmm::bounds_t *bounds = _pico_frame_bounds( picoModel, i );
+		if ( bounds == nullptr ) {
+			break;
+		}
+		_pico_copy_vec( frame->bounds[ 0 ], bounds->mins );
+		_pico_copy_vec( frame->bounds[ 1 ], bounds->maxs );
+		_pico_copy_vec( frame->localOrigin, bounds->center );
+		bounds->radius = frame->radius;
+	}
+
 	/* md3 surfaces become picomodel surfaces */
 	surface = (md3Surface_t*) ( bb + md3->ofsSurfaces );
 
 	/* run through md3 surfaces */
-	for ( i = 0; i < md3->num_surfaces; i++ )
+	for ( i = 0; i < md3->num_surfaces; i++, surface = (md3Surface_t*) ( (pmm::ub8_t*) surface + surface->ofsEnd ) )
 	{
+		/* filtered out by the caller */
+		if ( !_pico_load_surface( options, surface->name ) ) {
+			continue;
+		}
+
 		/* allocate new pico surface */
 		picoSurface = pmm::pp_new_surface( picoModel );
 		if ( picoSurface == nullptr ) {
@@ -360,7 +433,6 @@ static pmm::model_t *_md3_load( PM_PARAMS_LOAD ){
 		/* copy vertices */
 		texCoord = (md3TexCoord_t*) ( (pmm::ub8_t *) surface + surface->ofsSt );
 		vertex = (md3Vertex_t*) ( (pmm::ub8_t*) surface + surface->ofsVertexes + surface->numVerts * frameNum * sizeof( md3Vertex_t ) );
-		_pico_set_color( color, 255, 255, 255, 255 );
 
 		for ( j = 0; j < surface->numVerts; j++, texCoord++, vertex++ )
 		{
@@ -371,26 +443,24 @@ static pmm::model_t *_md3_load( PM_PARAMS_LOAD ){
 			pmm::pp_set_surface_xyz( picoSurface, j, xyz );
 
 			/* decode lat/lng normal to 3 float normal */
-			lat = (float) ( ( vertex->normal >> 8 ) & 0xff );
-			lng = (float) ( vertex->normal & 0xff );
-			lat *= PICO_PI / 128;
-			lng *= PICO_PI / 128;
-			normal[ 0 ] = (pmm::vec_t) cos( lat ) * (pmm::vec_t) sin( lng );
-			normal[ 1 ] = (pmm::vec_t) sin( lat ) * (pmm::vec_t) sin( lng );
-			normal[ 2 ] = (pmm::vec_t) cos( lng );
-			pmm::pp_set_surface_normal( picoSurface, j, normal );
+			if ( !( loadFlags & pmm::lf_skip_normals ) ) {
+				lat = (float) ( ( vertex->normal >> 8 ) & 0xff );
+				lng = (float) ( vertex->normal & 0xff );
+				lat *= PICO_PI / 128;
+				lng *= PICO_PI / 128;
+				normal[ 0 ] = (pmm::vec_t) cos( lat ) * (pmm::vec_t) sin( lng );
+				normal[ 1 ] = (pmm::vec_t) sin( lat ) * (pmm::vec_t) sin( lng );
+				normal[ 2 ] = (pmm::vec_t) cos( lng );
+				pmm::pp_set_surface_normal( picoSurface, j, normal );
+			}
 
 			/* set st coords */
-			st[ 0 ] = texCoord->st[ 0 ];
-			st[ 1 ] = texCoord->st[ 1 ];
-			pmm::pp_set_surface_st( picoSurface, 0, j, st );
-
-			/* set color */
-			pmm::pp_set_surface_color( picoSurface, 0, j, color );
+			if ( !( loadFlags & pmm::lf_skip_st ) ) {
+				st[ 0 ] = texCoord->st[ 0 ];
+				st[ 1 ] = texCoord->st[ 1 ];
+				pmm::pp_set_surface_st( picoSurface, 0, j, st );
+			}
 		}
-
-		/* get next surface */
-		surface = (md3Surface_t*) ( (pmm::ub8_t*) surface + surface->ofsEnd );
 	}
 
 	/* return the new pico model */
@@ -413,5 +483,6 @@ extern const pmm::module_t picoModuleMD3 =
 	_md3_canload,               /* validation routine */
 	_md3_load,                  /* load routine */
 	nullptr,                       /* save validation routine */
-	nullptr                        /* save routine */
+	nullptr,                       /* save routine */
+	_md3_probe                  /* probe routine */
 };
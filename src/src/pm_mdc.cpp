@@ -434,6 +434,60 @@ static int _mdc_canload( PM_PARAMS_CANLOAD ){
 
 
 
+/*
+   _mdc_probe()
+   counts frames, surfaces, vertexes and triangles of an mdc from the
+   model and surface headers
+ */
+
+static int _mdc_probe( PM_PARAMS_PROBE ){
+	const pmm::ub8_t    *bb = (const pmm::ub8_t*) buffer;
+	const mdc_t         *mdc = (const mdc_t*) buffer;
+	const mdcSurface_t  *surface;
+	const mdcShader_t   *shader;
+	char name[ sizeof( shader->name ) + 1 ];
+	long ofs, ofsEnd;
+	int i, numSurfaces;
+
+
+	(void) fileName;
+
+	info->numFrames = _pico_little_long( mdc->numFrames );
+	numSurfaces = _pico_little_long( mdc->num_surfaces );
+
+	/* walk the surface headers */
+	ofs = _pico_little_long( mdc->ofsSurfaces );
+	for ( i = 0; i < numSurfaces; i++, ofs += ofsEnd )
+	{
+		if ( !_pico_probe_range( bufSize, ofs, sizeof( *surface ) ) ) {
+			return 0;
+		}
+		surface = (const mdcSurface_t*) ( bb + ofs );
+		info->numSurfaces++;
+		info->numVertexes += _pico_little_long( surface->numVerts );
+		info->numTriangles += _pico_little_long( surface->numTriangles );
+
+		/* same detox as the loader */
+		if ( _pico_probe_range( bufSize, ofs + _pico_little_long( surface->ofsShaders ), sizeof( *shader ) ) ) {
+			shader = (const mdcShader_t*) ( bb + ofs + _pico_little_long( surface->ofsShaders ) );
+			strncpy( name, shader->name, sizeof( name ) - 1 );
+			name[ sizeof( name ) - 1 ] = '\0';
+			_pico_setfext( name, "" );
+			_pico_unixify( name );
+			_pico_probe_add_shader( info, name );
+		}
+
+		ofsEnd = _pico_little_long( surface->ofsEnd );
+		if ( ofsEnd <= 0 ) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+
+
 /*
    _mdc_load()
    loads a Return to Castle Wolfenstein mdc model file.
@@ -458,7 +512,7 @@ static pmm::model_t *_mdc_load( PM_PARAMS_LOAD ){
 	pmm::shader_t        *picoShader;
 	pmm::vec3_t xyz, normal;
 	pmm::vec2_t st;
-	pmm::color_t color;
+	int loadFlags = _pico_load_flags( options );
 
 
 	/* -------------------------------------------------
@@ -607,12 +661,31 @@ static pmm::model_t *_mdc_load( PM_PARAMS_LOAD ){
 	pmm::pp_set_model_name( picoModel, fileName );
 	pmm::pp_set_model_file_name( picoModel, fileName );
 
+	/* frame headers carry the bounds of every frame */
+	frame = (mdcFrame_t*) ( bb + mdc->ofsFrames );
+	for ( i = 0; i < mdc->numFrames; i++, frame++ )
+	{
+		pmm::bounds_t *bounds = _pico_frame_bounds( picoModel, i );
+		if ( bounds == nullptr ) {
+			break;
+		}
+		_pico_copy_vec( frame->bounds[ 0 ], bounds->mins );
+		_pico_copy_vec( frame->bounds[ 1 ], bounds->maxs );
+		_pico_copy_vec( frame->localOrigin, bounds->center );
+		bounds->radius = frame->radius;
+	}
+
 	/* mdc surfaces become picomodel surfaces */
 	surface = (mdcSurface_t*) ( bb + mdc->ofsSurfaces );
 
 	/* run through mdc surfaces */
-	for ( i = 0; i < mdc->num_surfaces; i++ )
+	for ( i = 0; i < mdc->num_surfaces; i++, surface = (mdcSurface_t*) ( (pmm::ub8_t*) surface + surface->ofsEnd ) )
 	{
+		/* filtered out by the caller */
+		if ( !_pico_load_surface( options, surface->name ) ) {
+			continue;
+		}
+
 		/* allocate new pico surface */
 		picoSurface = pmm::pp_new_surface( picoModel );
 		if ( picoSurface == nullptr ) {
@@ -665,7 +738,6 @@ static pmm::model_t *_mdc_load( PM_PARAMS_LOAD ){
 				vertexComp = (mdcXyzCompressed_t *) ( (pmm::ub8_t *) surface + surface->ofsXyzCompressed ) + ( *mdcCompVert * surface->numVerts );
 			}
 		}
-		_pico_set_color( color, 255, 255, 255, 255 );
 
 		for ( j = 0; j < surface->numVerts; j++, texCoord++, mdcShort += 4 )
 		{
@@ -681,10 +753,12 @@ static pmm::model_t *_mdc_load( PM_PARAMS_LOAD ){
 				xyz[ 2 ] += ( (float) ( ( vertexComp->ofsVec >> 16 ) & 255 ) - MDC_MAX_OFS ) * MDC_DIST_SCALE;
 				pmm::pp_set_surface_xyz( picoSurface, j, xyz );
 
-				normal[ 0 ] = (float) mdcNormals[ ( vertexComp->ofsVec >> 24 ) ][ 0 ];
-				normal[ 1 ] = (float) mdcNormals[ ( vertexComp->ofsVec >> 24 ) ][ 1 ];
-				normal[ 2 ] = (float) mdcNormals[ ( vertexComp->ofsVec >> 24 ) ][ 2 ];
-				pmm::pp_set_surface_normal( picoSurface, j, normal );
+				if ( !( loadFlags & pmm::lf_skip_normals ) ) {
+					normal[ 0 ] = (float) mdcNormals[ ( vertexComp->ofsVec >> 24 ) ][ 0 ];
+					normal[ 1 ] = (float) mdcNormals[ ( vertexComp->ofsVec >> 24 ) ][ 1 ];
+					normal[ 2 ] = (float) mdcNormals[ ( vertexComp->ofsVec >> 24 ) ][ 2 ];
+					pmm::pp_set_surface_normal( picoSurface, j, normal );
+				}
 
 				vertexComp++;
 			}
@@ -693,27 +767,25 @@ static pmm::model_t *_mdc_load( PM_PARAMS_LOAD ){
 				pmm::pp_set_surface_xyz( picoSurface, j, xyz );
 
 				/* decode lat/lng normal to 3 float normal */
-				lat = (float) ( ( *( mdcShort + 3 ) >> 8 ) & 0xff );
-				lng = (float) ( *( mdcShort + 3 ) & 0xff );
-				lat *= PICO_PI / 128;
-				lng *= PICO_PI / 128;
-				normal[ 0 ] = (pmm::vec_t) cos( lat ) * (pmm::vec_t) sin( lng );
-				normal[ 1 ] = (pmm::vec_t) sin( lat ) * (pmm::vec_t) sin( lng );
-				normal[ 2 ] = (pmm::vec_t) cos( lng );
-				pmm::pp_set_surface_normal( picoSurface, j, normal );
+				if ( !( loadFlags & pmm::lf_skip_normals ) ) {
+					lat = (float) ( ( *( mdcShort + 3 ) >> 8 ) & 0xff );
+					lng = (float) ( *( mdcShort + 3 ) & 0xff );
+					lat *= PICO_PI / 128;
+					lng *= PICO_PI / 128;
+					normal[ 0 ] = (pmm::vec_t) cos( lat ) * (pmm::vec_t) sin( lng );
+					normal[ 1 ] = (pmm::vec_t) sin( lat ) * (pmm::vec_t) sin( lng );
+					normal[ 2 ] = (pmm::vec_t) cos( lng );
+					pmm::pp_set_surface_normal( picoSurface, j, normal );
+				}
 			}
 
 			/* set st coords */
-			st[ 0 ] = texCoord->st[ 0 ];
-			st[ 1 ] = texCoord->st[ 1 ];
-			pmm::pp_set_surface_st( picoSurface, 0, j, st );
-
-			/* set color */
-			pmm::pp_set_surface_color( picoSurface, 0, j, color );
+			if ( !( loadFlags & pmm::lf_skip_st ) ) {
+				st[ 0 ] = texCoord->st[ 0 ];
+				st[ 1 ] = texCoord->st[ 1 ];
+				pmm::pp_set_surface_st( picoSurface, 0, j, st );
+			}
 		}
-
-		/* get next surface */
-		surface = (mdcSurface_t*) ( (pmm::ub8_t*) surface + surface->ofsEnd );
 	}
 
 	/* return the new pico model */
@@ -736,5 +808,6 @@ extern const pmm::module_t picoModuleMDC =
 	_mdc_canload,                   /* validation routine */
 	_mdc_load,                      /* load routine */
 	nullptr,                           /* save validation routine */
-	nullptr                            /* save routine */
+	nullptr,                           /* save routine */
+	_mdc_probe                      /* probe routine */
 };
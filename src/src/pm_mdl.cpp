@@ -372,6 +372,34 @@ static char* _make_texture_path(const char *in, char *out) {
 	return out;
 }
 
+/*
+_mdl_probe()
+reads the counts from the mdl header, the shader is named after the file.
+*/
+static int _mdl_probe(PM_PARAMS_PROBE) {
+	const mdl_header_t *mdl = (const mdl_header_t*)buffer;
+	char texturePath[256];
+
+	if (!_pico_probe_range(bufSize, 0, sizeof(*mdl))) {
+		return 0;
+	}
+
+	info->numFrames = _pico_little_long(mdl->numFrames);
+	info->numSurfaces = 1;
+	info->numVertexes = _pico_little_long(mdl->numVerts);
+	info->numTriangles = _pico_little_long(mdl->numTris);
+
+	/* same name as _make_texture_path() */
+	strncpy(texturePath, fileName, sizeof(texturePath) - 5);
+	texturePath[sizeof(texturePath) - 5] = '\0';
+	_pico_setfext(texturePath, "");
+	strcat(texturePath, "_img");
+	_pico_unixify(texturePath);
+	_pico_probe_add_shader(info, texturePath);
+
+	return 1;
+}
+
 /*
 _mdl_load()
 loads a quake mdl model file.
@@ -391,6 +419,7 @@ static pmm::model_t *_mdl_load(PM_PARAMS_LOAD) {
 	mdl_frame_t *frame;
 	int i;
 	char texturePath[256];
+	int loadFlags = _pico_load_flags(options);
 
 	/* -------------------------------------------------
 	mdl loading
@@ -570,19 +599,23 @@ static pmm::model_t *_mdl_load(PM_PARAMS_LOAD) {
 			pmm::pp_set_surface_xyz(picoSurface, iCurrent, xyz);
 
 			/* add texture coordinate */
-			st[0] = _pico_little_long(textCoord->s);
-			st[1] = _pico_little_long(textCoord->t);
-			/* translate texture coordinate */
-			if (_pico_little_long(ofsTriangles->facesfront) == 0 && _pico_little_long(textCoord->onseam) != 0) {
-				st[0] += mdlHeader->skinWidth * 0.5f;
+			if (!(loadFlags & pmm::lf_skip_st)) {
+				st[0] = _pico_little_long(textCoord->s);
+				st[1] = _pico_little_long(textCoord->t);
+				/* translate texture coordinate */
+				if (_pico_little_long(ofsTriangles->facesfront) == 0 && _pico_little_long(textCoord->onseam) != 0) {
+					st[0] += mdlHeader->skinWidth * 0.5f;
+				}
+				/* Scale s and t to range from 0.0 to 1.0 */
+				st[0] = (st[0] + 0.5f) / mdlHeader->skinWidth;
+				st[1] = 1.0f - (st[1] + 0.5f) / mdlHeader->skinHeight;
+				pmm::pp_set_surface_st(picoSurface, 0, iCurrent, st);
 			}
-			/* Scale s and t to range from 0.0 to 1.0 */
-			st[0] = (st[0] + 0.5f) / mdlHeader->skinWidth;
-			st[1] = 1.0f - (st[1] + 0.5f) / mdlHeader->skinHeight;
-			pmm::pp_set_surface_st(picoSurface, 0, iCurrent, st);
 
 			/* copy normal */
-			pmm::pp_set_surface_normal(picoSurface, iCurrent, mdpl_normals[vertex->normalIndex]);
+			if (!(loadFlags & pmm::lf_skip_normals)) {
+				pmm::pp_set_surface_normal(picoSurface, iCurrent, mdpl_normals[vertex->normalIndex]);
+			}
 		}
 		pmm::pp_set_surface_index(picoSurface, iTemp + 0, iTemp + 0);
 		pmm::pp_set_surface_index(picoSurface, iTemp + 1, iTemp + 1);
@@ -608,5 +641,6 @@ extern const pmm::module_t picoModuleMDL =
 _mdl_canload,               /* validation routine */
 _mdl_load,                  /* load routine */
 nullptr,                       /* save validation routine */
-nullptr                        /* save routine */
+nullptr,                       /* save routine */
+_mdl_probe                  /* probe routine */
 };
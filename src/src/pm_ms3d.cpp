@@ -51,9 +51,6 @@
  #define DEBUG_PM_MS3D
  #define DEBUG_PM_MS3D_EX
 
-/* plain white */
-static pmm::color_t white = { 255,255,255,255 };
-
 /* ms3d limits */
 #define MS3D_MAX_VERTS      8192
 #define MS3D_MAX_TRIS       16384
@@ -194,6 +191,81 @@ static unsigned char *GetWord( unsigned char *bufptr, int *out ){
 	return( bufptr + 2 );
 }
 
+/* little endian word at any alignment, for _ms3d_probe() */
+static int _ms3d_probe_word( const unsigned char *bp ){
+	return bp[ 0 ] | ( bp[ 1 ] << 8 );
+}
+
+/* _ms3d_probe:
+ *	walks the vertex, triangle and group tables to the material names
+ */
+static int _ms3d_probe( PM_PARAMS_PROBE ){
+	const unsigned char *bufptr = (const unsigned char *) buffer;
+	const TMsGroup      *group;
+	const TMsMaterial   *material;
+	char name[ 32 ];
+	long ofs;
+	int numGroups, numMaterials, numTriangles;
+	int i;
+
+
+	(void) fileName;
+
+	/* vertex and triangle counts, each table follows its count */
+	ofs = sizeof( TMsHeader );
+	if ( !_pico_probe_range( bufSize, ofs, 2 ) ) {
+		return 0;
+	}
+	info->numVertexes = _ms3d_probe_word( bufptr + ofs );
+	ofs += 2 + (long) info->numVertexes * sizeof( TMsVertex );
+	if ( !_pico_probe_range( bufSize, ofs, 2 ) ) {
+		return 0;
+	}
+	info->numTriangles = _ms3d_probe_word( bufptr + ofs );
+	ofs += 2 + (long) info->numTriangles * sizeof( TMsTriangle );
+	if ( !_pico_probe_range( bufSize, ofs, 2 ) ) {
+		return 0;
+	}
+	numGroups = _ms3d_probe_word( bufptr + ofs );
+	ofs += 2;
+
+	/* the loader ignores hidden groups */
+	for ( i = 0; i < numGroups && i < MS3D_MAX_GROUPS; i++ )
+	{
+		if ( !_pico_probe_range( bufSize, ofs, sizeof( TMsGroup ) ) ) {
+			return 0;
+		}
+		group = (const TMsGroup *)( bufptr + ofs );
+		numTriangles = (unsigned short) _pico_little_short( group->numTriangles );
+		ofs += sizeof( TMsGroup ) + numTriangles * 2 + 1;
+		if ( !( group->flags & MS3D_HIDDEN ) ) {
+			info->numSurfaces++;
+		}
+	}
+
+	/* material names, trimmed like the loader */
+	if ( !_pico_probe_range( bufSize, ofs, 2 ) ) {
+		return 1;
+	}
+	numMaterials = _ms3d_probe_word( bufptr + ofs );
+	ofs += 2;
+	for ( i = 0; i < numMaterials; i++ )
+	{
+		if ( !_pico_probe_range( bufSize, ofs, sizeof( TMsMaterial ) ) ) {
+			break;
+		}
+		material = (const TMsMaterial *)( bufptr + ofs );
+		ofs += sizeof( TMsMaterial );
+		memcpy( name, material->name, sizeof( name ) );
+		name[ 31 ] = '\0';
+		_pico_strltrim( name );
+		_pico_strrtrim( name );
+		_pico_probe_add_shader( info, name );
+	}
+
+	return 1;
+}
+
 /* _ms3d_load:
  *	loads a milkshape3d model file.
  */
@@ -209,6 +281,7 @@ static pmm::model_t *_ms3d_load( PM_PARAMS_LOAD ){
 	int numTris;
 	unsigned char  *ptrToTris;
 	int i,k,m;
+	int loadFlags = _pico_load_flags( options );
 
 	/* create new pico model */
 	model = pmm::pp_new_model();
@@ -361,21 +434,22 @@ static pmm::model_t *_ms3d_load( PM_PARAMS_LOAD ){
 				/* store vertex origin */
 				pmm::pp_set_surface_xyz( surface,vertexIndex,vertex->xyz );
 
-				/* store vertex color */
-				pmm::pp_set_surface_color( surface,0,vertexIndex,white );
-
 				/* store vertex normal */
-				pmm::pp_set_surface_normal( surface,vertexIndex,triangle->vertexNormals[ m ] );
+				if ( !( loadFlags & pmm::lf_skip_normals ) ) {
+					pmm::pp_set_surface_normal( surface,vertexIndex,triangle->vertexNormals[ m ] );
+				}
 
 				/* store current face vertex index */
 				pmm::pp_set_surface_index( surface,( k * 3 + ( 2 - m ) ),(pmm::index_t)vertexIndex );
 
 				/* get texture vertex coord */
-				texCoord[ 0 ] = triangle->s[ m ];
-				texCoord[ 1 ] = -triangle->t[ m ];  /* flip t */
+				if ( !( loadFlags & pmm::lf_skip_st ) ) {
+					texCoord[ 0 ] = triangle->s[ m ];
+					texCoord[ 1 ] = -triangle->t[ m ];  /* flip t */
 
-				/* store texture vertex coord */
-				pmm::pp_set_surface_st( surface,0,vertexIndex,texCoord );
+					/* store texture vertex coord */
+					pmm::pp_set_surface_st( surface,0,vertexIndex,texCoord );
+				}
 			}
 		}
 		/* store material */
@@ -503,5 +577,6 @@ extern const pmm::module_t picoModuleMS3D =
 	_ms3d_canload,              /* validation routine */
 	_ms3d_load,                 /* load routine */
 	nullptr,                       /* save validation routine */
-	nullptr                        /* save routine */
+	nullptr,                       /* save routine */
+	_ms3d_probe                 /* probe routine */
 };
@@ -497,6 +497,75 @@ static int _obj_mtl_load( pmm::model_t *model ){
 	return 1;
 }
 
+/* _obj_probe:
+ *  scans the lines of a wavefront obj for the statements the loader
+ *  builds surfaces from, without parsing any numbers.
+ */
+static int _obj_probe( PM_PARAMS_PROBE ){
+	const char *cp  = (const char *)buffer;
+	const char *end = cp + bufSize;
+	char token[ 256 ];
+	int haveSurface = 0;
+	int numFaces = 0;
+	int numPoints;
+
+	(void) fileName;
+
+	while ( cp < end )
+	{
+		cp = _pico_probe_token( cp, end, token, sizeof( token ) );
+
+		/* vertex */
+		if ( !_pico_stricmp( token,"v" ) ) {
+			info->numVertexes++;
+		}
+		/* face, the loader splits quads and ignores more points */
+		else if ( !_pico_stricmp( token,"f" ) ) {
+			if ( !haveSurface ) {
+				info->numSurfaces++;
+				haveSurface = 1;
+			}
+			for ( numPoints = 0; ; numPoints++ )
+			{
+				cp = _pico_probe_token( cp, end, token, sizeof( token ) );
+				if ( token[ 0 ] == '\0' ) {
+					break;
+				}
+			}
+			if ( numPoints >= 3 ) {
+				info->numTriangles += ( numPoints >= 4 ) ? 2 : 1;
+				numFaces++;
+			}
+		}
+		/* group, renames an empty surface */
+		else if ( !_pico_stricmp( token,"g" ) ) {
+			if ( numFaces != 0 || !haveSurface ) {
+				info->numSurfaces++;
+				haveSurface = 1;
+				numFaces = 0;
+			}
+		}
+		/* material, starts an autoSurface after faces */
+		else if ( !_pico_stricmp( token,"usemtl" ) ) {
+			if ( numFaces != 0 || !haveSurface ) {
+				info->numSurfaces++;
+				haveSurface = 1;
+				numFaces = 0;
+			}
+			cp = _pico_probe_token( cp, end, token, sizeof( token ) );
+			if ( token[ 0 ] != '\0' ) {
+				_pico_probe_add_shader( info, token );
+			}
+		}
+
+		/* skip rest of line */
+		while ( cp < end && *cp != '\n' )
+			cp++;
+		cp++;
+	}
+	return 1;
+}
+
 /* _obj_load:
  *  loads a wavefront obj model file.
  */
@@ -512,6 +581,7 @@ static pmm::model_t *_obj_load( PM_PARAMS_LOAD ){
 	int numUVs      = 0;
 	int curVertex   = 0;
 	int curFace     = 0;
+	int loadFlags   = _pico_load_flags( options );
 
 	int autoGroupNumber = 0;
 	char autoGroupNameBuf[64];
@@ -565,13 +635,21 @@ static pmm::model_t *_obj_load( PM_PARAMS_LOAD ){
 	pmm::pp_set_model_file_name( model,fileName );
 
 	/* try loading the materials; we don't handle the result */
-#if 1
-	_obj_mtl_load( model );
-#endif
+	if ( !( loadFlags & pmm::lf_skip_materials ) ) {
+		_obj_mtl_load( model );
+	}
 
 	/* parse obj line by line */
 	while ( 1 )
 	{
+		/* the caller gave up on this load */
+		if ( _pico_load_cancelled() ) {
+			_pico_free_parser( p );
+			FreeObjVertexData( vertexData );
+			pmm::pp_free_model( model );
+			return nullptr;
+		}
+
 		/* get first token on line */
 		if ( _pico_parse_first( p ) == nullptr ) {
 			break;
@@ -869,8 +947,12 @@ static pmm::model_t *_obj_load( PM_PARAMS_LOAD ){
 				for ( i = 0; i < max; i++ )
 				{
 					/*if( has_v  )*/ pmm::pp_set_surface_xyz( curSurface,  ( curVertex + i ), verts  [ i ] );
-					/*if( has_vt )*/ pmm::pp_set_surface_st( curSurface,0,( curVertex + i ), coords [ i ] );
-					/*if( has_vn )*/ pmm::pp_set_surface_normal( curSurface,  ( curVertex + i ), normals[ i ] );
+					if ( !( loadFlags & pmm::lf_skip_st ) ) {
+						pmm::pp_set_surface_st( curSurface,0,( curVertex + i ), coords [ i ] );
+					}
+					if ( !( loadFlags & pmm::lf_skip_normals ) ) {
+						pmm::pp_set_surface_normal( curSurface,  ( curVertex + i ), normals[ i ] );
+					}
 				}
 				/* add our triangle (A B C) */
 				pmm::pp_set_surface_index( curSurface,( curFace * 3 + 2 ),(pmm::index_t)( curVertex + 0 ) );
@@ -919,15 +1001,18 @@ static pmm::model_t *_obj_load( PM_PARAMS_LOAD ){
 			{
 				shader = pmm::pp_find_shader( model, name, 1 );
 				if ( shader == nullptr ) {
-					pmm::man.pp_print(
-						pmm::pl_warning,
-						(
-							std::ostringstream{}
-								<< "Undefined material name in OBJ, line "
-								<< p->curLine
-								<< ". Making a default shader."
-						).str()
-					);
+					/* no .mtl was read when the caller skips materials */
+					if ( !( loadFlags & pmm::lf_skip_materials ) ) {
+						pmm::man.pp_print(
+							pmm::pl_warning,
+							(
+								std::ostringstream{}
+									<< "Undefined material name in OBJ, line "
+									<< p->curLine
+									<< ". Making a default shader."
+							).str()
+						);
+					}
 
 					/* create a new pico shader */
 					shader = pmm::pp_new_shader( model );
@@ -967,5 +1052,6 @@ extern const pmm::module_t picoModuleOBJ =
 	_obj_canload,               /* validation routine */
 	_obj_load,                  /* load routine */
 	nullptr,                       /* save validation routine */
-	nullptr                        /* save routine */
+	nullptr,                       /* save routine */
+	_obj_probe                  /* probe routine */
 };
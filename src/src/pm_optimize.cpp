@@ -0,0 +1,1346 @@
+/* -----------------------------------------------------------------------------
+
+   PicoModel Library
+
+   Copyright (c) 2002, Randy Reddig & seaw0lf
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification,
+   are permitted provided that the following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list
+   of conditions and the following disclaimer.
+
+   Redistributions in binary form must reproduce the above copyright notice, this
+   list of conditions and the following disclaimer in the documentation and/or
+   other materials provided with the distribution.
+
+   Neither the names of the copyright holders nor the names of its contributors may
+   be used to endorse or promote products derived from this software without
+   specific prior written permission.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+   ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+   ANY DIRECT, INDIRECT, INCidentAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+   (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+   LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+   ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   ----------------------------------------------------------------------------- */
+
+/* mesh optimization passes: triangle and vertex reordering, simplification and clustering */
+
+#include <pmpmesh/pmpmesh.hpp>
+#include <pmpmesh/pm_internal.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+
+
+
+/* ----------------------------------------------------------------------------
+   helpers
+   ---------------------------------------------------------------------------- */
+
+/* _pico_permute_vertex_array:
+ *  reorders an array of 'count' elements of 'size' bytes so that element
+ *  i becomes the old element order[ i ]
+ */
+static void _pico_permute_vertex_array( void *array, pmm::size_type size, const std::vector<int> &order ){
+	std::vector<pmm::ub8_t> temp( order.size() * size );
+	pmm::ub8_t *data = reinterpret_cast<pmm::ub8_t *>( array );
+	pmm::size_type i;
+
+	if ( array == nullptr ) {
+		return;
+	}
+	for ( i = 0; i < order.size(); i++ )
+		memcpy( &temp[ i * size ], data + order[ i ] * size, size );
+	memcpy( data, temp.data(), temp.size() );
+}
+
+/* _pico_reorder_triangles:
+ *  rewrites the index list in the triangle order 'order' (old triangle
+ *  numbers) and moves per-face normals along with their triangles
+ */
+static void _pico_reorder_triangles( pmm::surface_t *surface, const std::vector<int> &order ){
+	int numTriangles = (int) order.size();
+	std::vector<pmm::index_t> indexes( numTriangles * 3 );
+	int i;
+
+	for ( i = 0; i < numTriangles; i++ )
+	{
+		indexes[ i * 3 + 0 ] = surface->index[ order[ i ] * 3 + 0 ];
+		indexes[ i * 3 + 1 ] = surface->index[ order[ i ] * 3 + 1 ];
+		indexes[ i * 3 + 2 ] = surface->index[ order[ i ] * 3 + 2 ];
+	}
+	memcpy( surface->index, indexes.data(), indexes.size() * sizeof( *surface->index ) );
+
+	if ( surface->numFaceNormals >= numTriangles ) {
+		_pico_permute_vertex_array( surface->faceNormal, sizeof( *surface->faceNormal ), order );
+		_pico_permute_vertex_array( surface->faceDist, sizeof( *surface->faceDist ), order );
+	}
+}
+
+
+
+/* ----------------------------------------------------------------------------
+   vertex cache
+   ---------------------------------------------------------------------------- */
+
+/* scoring from Tom Forsyth, "Linear-Speed Vertex Cache Optimisation" */
+#define FORSYTH_CACHE_SIZE      32
+#define FORSYTH_MAX_VALENCE     32
+
+const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+const float FORSYTH_LAST_TRI_SCORE = 0.75f;
+const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+class picoForsythScores_t
+{
+public:
+	float cache[ FORSYTH_CACHE_SIZE ];
+	float valence[ FORSYTH_MAX_VALENCE ];
+};
+
+static void _pico_forsyth_init_scores( picoForsythScores_t *scores ){
+	int i;
+
+	for ( i = 0; i < FORSYTH_CACHE_SIZE; i++ )
+	{
+		/* the last triangle's vertices get a fixed score, so it is not
+		   simply drawn again with a different winding */
+		if ( i < 3 ) {
+			scores->cache[ i ] = FORSYTH_LAST_TRI_SCORE;
+		}
+		else {
+			scores->cache[ i ] = (float) pow( 1.0f - (float) ( i - 3 ) / ( FORSYTH_CACHE_SIZE - 3 ), FORSYTH_CACHE_DECAY_POWER );
+		}
+	}
+	for ( i = 0; i < FORSYTH_MAX_VALENCE; i++ )
+		scores->valence[ i ] = i == 0 ? 0 : FORSYTH_VALENCE_BOOST_SCALE * (float) pow( (float) i, -FORSYTH_VALENCE_BOOST_POWER );
+}
+
+static float _pico_forsyth_vertex_score( const picoForsythScores_t *scores, int cachePosition, int valence ){
+	float score;
+
+	/* vertices without triangles left never attract anything */
+	if ( valence == 0 ) {
+		return -1.0f;
+	}
+	score = cachePosition >= 0 ? scores->cache[ cachePosition ] : 0.0f;
+	if ( valence < FORSYTH_MAX_VALENCE ) {
+		score += scores->valence[ valence ];
+	}
+	else {
+		score += FORSYTH_VALENCE_BOOST_SCALE * (float) pow( (float) valence, -FORSYTH_VALENCE_BOOST_POWER );
+	}
+	return score;
+}
+
+/*
+   pmm::pp_optimize_vertex_cache()
+   reorders the triangles of a surface for post-transform vertex cache
+   locality (Forsyth's linear-speed scoring), then renumbers the vertices
+   in first-use order with pmm::pp_optimize_vertex_fetch().
+   returns 1 on success or 0 on error
+ */
+
+int pmm::pp_optimize_vertex_cache( pmm::surface_t *surface ){
+	picoForsythScores_t scores;
+	picoVertexTriangles_t adjacency;
+	int numVertexes, numTriangles, numCache, cursor, best, i, j, k;
+	int cache[ FORSYTH_CACHE_SIZE + 3 ], newCache[ FORSYTH_CACHE_SIZE + 3 ];
+
+
+	/* dummy check */
+	if ( surface == nullptr ) {
+		return 0;
+	}
+	numVertexes = surface->numVertexes;
+	numTriangles = surface->numIndexes / 3;
+	if ( numTriangles <= 1 ) {
+		return pmm::pp_optimize_vertex_fetch( surface );
+	}
+
+	_pico_forsyth_init_scores( &scores );
+
+	/* live triangles of a vertex are tris[ first[ v ] ] .. tris[ first[ v ] + valence[ v ] - 1 ] */
+	_pico_build_vertex_triangles( surface, nullptr, &adjacency );
+	std::vector<int> valence( numVertexes ), cachePosition( numVertexes, -1 );
+	std::vector<float> vertexScore( numVertexes ), triScore( numTriangles, 0.0f );
+	std::vector<char> emitted( numTriangles, 0 );
+	std::vector<int> order;
+	order.reserve( numTriangles );
+
+	for ( i = 0; i < numVertexes; i++ )
+	{
+		valence[ i ] = adjacency.first[ i + 1 ] - adjacency.first[ i ];
+		vertexScore[ i ] = _pico_forsyth_vertex_score( &scores, -1, valence[ i ] );
+	}
+	best = -1;
+	for ( i = 0; i < numTriangles; i++ )
+	{
+		if ( !_pico_triangle_is_valid( surface, i ) ) {
+			emitted[ i ] = 1;
+			continue;
+		}
+		for ( j = 0; j < 3; j++ )
+			triScore[ i ] += vertexScore[ surface->index[ i * 3 + j ] ];
+		if ( best < 0 || triScore[ i ] > triScore[ best ] ) {
+			best = i;
+		}
+	}
+
+	numCache = 0;
+	cursor = 0;
+	while ( best >= 0 )
+	{
+		pmm::index_t *tri = surface->index + best * 3;
+		int numNewCache = 0;
+
+		/* emit */
+		order.push_back( best );
+		emitted[ best ] = 1;
+		for ( j = 0; j < 3; j++ )
+		{
+			int v = tri[ j ], *live = &adjacency.tris[ adjacency.first[ v ] ];
+			for ( k = 0; k < valence[ v ]; k++ )
+				if ( live[ k ] == best ) {
+					live[ k ] = live[ --valence[ v ] ];
+					break;
+				}
+		}
+
+		/* the triangle's vertices move to the front of the cache */
+		for ( j = 0; j < 3; j++ )
+		{
+			for ( k = 0; k < numNewCache && newCache[ k ] != tri[ j ]; k++ )
+				;
+			if ( k == numNewCache ) {
+				newCache[ numNewCache++ ] = tri[ j ];
+			}
+		}
+		for ( i = 0; i < numCache; i++ )
+		{
+			if ( cache[ i ] == tri[ 0 ] || cache[ i ] == tri[ 1 ] || cache[ i ] == tri[ 2 ] ) {
+				continue;
+			}
+			newCache[ numNewCache++ ] = cache[ i ];
+		}
+
+		/* rescore every vertex that was or is in the cache */
+		for ( i = 0; i < numNewCache; i++ )
+		{
+			int v = newCache[ i ];
+			cachePosition[ v ] = i < FORSYTH_CACHE_SIZE ? i : -1;
+			vertexScore[ v ] = _pico_forsyth_vertex_score( &scores, cachePosition[ v ], valence[ v ] );
+		}
+		best = -1;
+		for ( i = 0; i < numNewCache; i++ )
+		{
+			int v = newCache[ i ];
+			for ( k = 0; k < valence[ v ]; k++ )
+			{
+				int t = adjacency.tris[ adjacency.first[ v ] + k ];
+				pmm::index_t *other = surface->index + t * 3;
+				triScore[ t ] = vertexScore[ other[ 0 ] ] + vertexScore[ other[ 1 ] ] + vertexScore[ other[ 2 ] ];
+				if ( i < FORSYTH_CACHE_SIZE && ( best < 0 || triScore[ t ] > triScore[ best ] ) ) {
+					best = t;
+				}
+			}
+		}
+		numCache = numNewCache < FORSYTH_CACHE_SIZE ? numNewCache : FORSYTH_CACHE_SIZE;
+		memcpy( cache, newCache, numCache * sizeof( *cache ) );
+
+		/* dead end: continue with the next triangle in input order */
+		if ( best < 0 ) {
+			while ( cursor < numTriangles && emitted[ cursor ] )
+				cursor++;
+			best = cursor < numTriangles ? cursor : -1;
+		}
+	}
+
+	/* triangles with bad indexes go last, as they were */
+	for ( i = 0; i < numTriangles; i++ )
+		if ( !_pico_triangle_is_valid( surface, i ) ) {
+			order.push_back( i );
+		}
+
+	_pico_reorder_triangles( surface, order );
+	return pmm::pp_optimize_vertex_fetch( surface );
+}
+
+/*
+   pmm::pp_optimize_vertex_fetch()
+   renumbers the vertices of a surface in the order the index list first
+   uses them, so vertex fetches walk memory forwards. vertices no
+   triangle uses are kept at the end in their old order.
+   returns 1 on success or 0 on error
+ */
+
+int pmm::pp_optimize_vertex_fetch( pmm::surface_t *surface ){
+	int numVertexes, next, i;
+
+
+	/* dummy check */
+	if ( surface == nullptr ) {
+		return 0;
+	}
+	numVertexes = surface->numVertexes;
+	if ( numVertexes <= 0 ) {
+		return 1;
+	}
+	if ( !_pico_expand_compact( surface, "pp_optimize_vertex_fetch" ) ) {
+		return 0;
+	}
+
+	/* new number of every old vertex, and the reverse */
+	std::vector<int> remap( numVertexes, -1 ), order( numVertexes );
+	next = 0;
+	for ( i = 0; i < surface->numIndexes; i++ )
+	{
+		pmm::index_t v = surface->index[ i ];
+		if ( v >= 0 && v < numVertexes && remap[ v ] < 0 ) {
+			remap[ v ] = next++;
+		}
+	}
+	for ( i = 0; i < numVertexes; i++ )
+		if ( remap[ i ] < 0 ) {
+			remap[ i ] = next++;
+		}
+	for ( i = 0; i < numVertexes; i++ )
+		order[ remap[ i ] ] = i;
+
+	_pico_vertex_index_changed( surface, 0 );
+	_pico_permute_vertex_array( surface->xyz, sizeof( *surface->xyz ), order );
+	_pico_permute_vertex_array( surface->normal, sizeof( *surface->normal ), order );
+	_pico_permute_vertex_array( surface->smoothingGroup, sizeof( *surface->smoothingGroup ), order );
+	_pico_permute_vertex_array( surface->tangent, sizeof( *surface->tangent ), order );
+	for ( i = 0; i < surface->numSTArrays; i++ )
+		_pico_permute_vertex_array( surface->st[ i ], sizeof( *surface->st[ i ] ), order );
+	for ( i = 0; i < surface->numColorArrays; i++ )
+		_pico_permute_vertex_array( surface->color[ i ], sizeof( *surface->color[ i ] ), order );
+
+	for ( i = 0; i < surface->numIndexes; i++ )
+	{
+		pmm::index_t v = surface->index[ i ];
+		if ( v >= 0 && v < numVertexes ) {
+			surface->index[ i ] = remap[ v ];
+		}
+	}
+	return 1;
+}
+
+
+
+/* ----------------------------------------------------------------------------
+   overdraw
+   ---------------------------------------------------------------------------- */
+
+/* fifo post-transform cache used to find cluster boundaries */
+#define OVERDRAW_CACHE_SIZE     16
+
+class picoOverdrawCache_t
+{
+public:
+	std::vector<unsigned int> stamp;
+	unsigned int time;
+
+	picoOverdrawCache_t( int numVertexes ) : stamp( numVertexes, 0 ), time( OVERDRAW_CACHE_SIZE + 1 ){
+	}
+
+	/* empties the cache */
+	void flush(){
+		time += OVERDRAW_CACHE_SIZE + 1;
+	}
+
+	/* returns the number of vertexes of the triangle that missed */
+	int add( const pmm::index_t *tri ){
+		int j, misses = 0;
+
+		for ( j = 0; j < 3; j++ )
+		{
+			if ( time - stamp[ tri[ j ] ] > OVERDRAW_CACHE_SIZE ) {
+				stamp[ tri[ j ] ] = time++;
+				misses++;
+			}
+		}
+		return misses;
+	}
+};
+
+class picoOverdrawCluster_t
+{
+public:
+	int first, last;
+	float sort;
+};
+
+/*
+   pmm::pp_optimize_overdraw()
+   reorders the triangles of a surface to reduce overdraw. the current
+   order is cut into clusters wherever the simulated vertex cache starts
+   over, and further while a cluster's running ACMR stays within
+   'threshold' times its own (1.05 allows 5% more vertex transforms).
+   clusters facing away from the surface center are drawn first, as
+   they tend to occlude the rest. run pmm::pp_optimize_vertex_cache()
+   first; the vertexes are renumbered with pmm::pp_optimize_vertex_fetch().
+   returns 1 on success or 0 on error
+ */
+
+int pmm::pp_optimize_overdraw( pmm::surface_t *surface, float threshold ){
+	int numTriangles, numValid, i, j;
+	pmm::vec3_t center;
+
+
+	/* dummy check */
+	if ( surface == nullptr ) {
+		return 0;
+	}
+	numTriangles = surface->numIndexes / 3;
+	if ( numTriangles <= 1 ) {
+		return pmm::pp_optimize_vertex_fetch( surface );
+	}
+	if ( !_pico_expand_compact( surface, "pp_optimize_overdraw" ) ) {
+		return 0;
+	}
+	if ( threshold < 1.0f ) {
+		threshold = 1.0f;
+	}
+
+	/* triangles with bad indexes are left out and go last */
+	std::vector<int> valid, order;
+	valid.reserve( numTriangles );
+	order.reserve( numTriangles );
+	for ( i = 0; i < numTriangles; i++ )
+		if ( _pico_triangle_is_valid( surface, i ) ) {
+			valid.push_back( i );
+		}
+	numValid = (int) valid.size();
+
+	/* hard boundaries: all three vertexes missed, so the cache started over */
+	picoOverdrawCache_t cache( surface->numVertexes );
+	std::vector<int> hard;
+	for ( i = 0; i < numValid; i++ )
+		if ( cache.add( surface->index + valid[ i ] * 3 ) == 3 || i == 0 ) {
+			hard.push_back( i );
+		}
+	hard.push_back( numValid );
+
+	/* soft boundaries: split a cluster once its running ACMR is good enough */
+	std::vector<picoOverdrawCluster_t> clusters;
+	for ( j = 0; j + 1 < (int) hard.size(); j++ )
+	{
+		int first = hard[ j ], last = hard[ j + 1 ], misses = 0, runMisses, runTriangles;
+		float limit;
+
+		cache.flush();
+		for ( i = first; i < last; i++ )
+			misses += cache.add( surface->index + valid[ i ] * 3 );
+		limit = threshold * misses / ( last - first );
+
+		cache.flush();
+		runMisses = runTriangles = 0;
+		for ( i = first; i < last; i++ )
+		{
+			runMisses += cache.add( surface->index + valid[ i ] * 3 );
+			runTriangles++;
+			if ( runMisses <= limit * runTriangles || i == last - 1 ) {
+				clusters.push_back( { first, i + 1, 0.0f } );
+				first = i + 1;
+				runMisses = runTriangles = 0;
+				cache.flush();
+			}
+		}
+	}
+
+	/* surface center */
+	_pico_zero_vec( center );
+	for ( i = 0; i < numValid; i++ )
+		for ( j = 0; j < 3; j++ )
+			_pico_add_vec( center, surface->xyz[ surface->index[ valid[ i ] * 3 + j ] ], center );
+	_pico_scale_vec( center, 1.0f / ( numValid * 3 ), center );
+
+	/* sort key: how far the area weighted cluster center lies out along its normal */
+	for ( picoOverdrawCluster_t& cluster : clusters )
+	{
+		pmm::vec3_t clusterCenter, clusterNormal, normal, ba, ca, mid;
+		float area = 0.0f, length;
+
+		_pico_zero_vec( clusterCenter );
+		_pico_zero_vec( clusterNormal );
+		for ( i = cluster.first; i < cluster.last; i++ )
+		{
+			pmm::index_t *tri = surface->index + valid[ i ] * 3;
+			float *a = surface->xyz[ tri[ 0 ] ], *b = surface->xyz[ tri[ 1 ] ], *c = surface->xyz[ tri[ 2 ] ];
+
+			/* same winding as pmm::pp_fix_surface_normals() */
+			_pico_subtract_vec( b, a, ba );
+			_pico_subtract_vec( c, a, ca );
+			_pico_cross_vec( ca, ba, normal );
+			length = (float) sqrt( _pico_dot_vec( normal, normal ) );
+
+			_pico_add_vec( a, b, mid );
+			_pico_add_vec( mid, c, mid );
+			_pico_scale_vec( mid, length / 3.0f, mid );
+			_pico_add_vec( clusterCenter, mid, clusterCenter );
+			_pico_add_vec( clusterNormal, normal, clusterNormal );
+			area += length;
+		}
+		if ( area > 0.0f ) {
+			_pico_scale_vec( clusterCenter, 1.0f / area, clusterCenter );
+		}
+		_pico_normalize_vec( clusterNormal );
+		_pico_subtract_vec( clusterCenter, center, clusterCenter );
+		cluster.sort = (float) _pico_dot_vec( clusterCenter, clusterNormal );
+	}
+
+	/* outermost clusters first, ties keep the cache order */
+	std::stable_sort( clusters.begin(), clusters.end(),
+		[]( const picoOverdrawCluster_t& a, const picoOverdrawCluster_t& b ){ return a.sort > b.sort; } );
+	for ( const picoOverdrawCluster_t& cluster : clusters )
+		for ( i = cluster.first; i < cluster.last; i++ )
+			order.push_back( valid[ i ] );
+	for ( i = 0; i < numTriangles; i++ )
+		if ( !_pico_triangle_is_valid( surface, i ) ) {
+			order.push_back( i );
+		}
+
+	_pico_reorder_triangles( surface, order );
+	return pmm::pp_optimize_vertex_fetch( surface );
+}
+
+
+
+/* ----------------------------------------------------------------------------
+   simplification
+   ---------------------------------------------------------------------------- */
+
+/* what a vertex may collapse into */
+enum
+{
+	SIMPLIFY_MANIFOLD,      /* interior vertex, collapses into any neighbour */
+	SIMPLIFY_BORDER,        /* on an open edge, collapses along it */
+	SIMPLIFY_SEAM,          /* one side of an st/color/smoothing seam, collapses along it with its twin */
+	SIMPLIFY_LOCKED         /* corners, seam ends and non-manifold vertexes stay */
+};
+
+/* open edges pull harder than faces, so outlines and seams keep their shape */
+const double SIMPLIFY_EDGE_WEIGHT = 10.0;
+
+/* a collapse may not turn a triangle by more than about 75 degrees */
+const double SIMPLIFY_FLIP_COS = 0.25;
+
+/* symmetric 4x4 error quadric, sum of weighted squared plane distances */
+class picoQuadric_t
+{
+public:
+	double a00, a11, a22, a10, a20, a21, b0, b1, b2, c, w;
+};
+
+class picoCollapse_t
+{
+public:
+	int from, to;
+	double error;
+};
+
+static void _pico_quadric_add_plane( picoQuadric_t *q, const double *n, double d, double w ){
+	q->a00 += w * n[ 0 ] * n[ 0 ];
+	q->a11 += w * n[ 1 ] * n[ 1 ];
+	q->a22 += w * n[ 2 ] * n[ 2 ];
+	q->a10 += w * n[ 1 ] * n[ 0 ];
+	q->a20 += w * n[ 2 ] * n[ 0 ];
+	q->a21 += w * n[ 2 ] * n[ 1 ];
+	q->b0 += w * n[ 0 ] * d;
+	q->b1 += w * n[ 1 ] * d;
+	q->b2 += w * n[ 2 ] * d;
+	q->c += w * d * d;
+	q->w += w;
+}
+
+static void _pico_quadric_add( picoQuadric_t *q, const picoQuadric_t *r ){
+	q->a00 += r->a00; q->a11 += r->a11; q->a22 += r->a22;
+	q->a10 += r->a10; q->a20 += r->a20; q->a21 += r->a21;
+	q->b0 += r->b0; q->b1 += r->b1; q->b2 += r->b2;
+	q->c += r->c;
+	q->w += r->w;
+}
+
+/* weighted mean squared distance of 'p' to the planes of 'q' plus 'r' */
+static double _pico_quadric_error( const picoQuadric_t *q, const picoQuadric_t *r, const pmm::vec_t *p ){
+	double x = p[ 0 ], y = p[ 1 ], z = p[ 2 ], e, w;
+
+	e = ( q->a00 + r->a00 ) * x * x + ( q->a11 + r->a11 ) * y * y + ( q->a22 + r->a22 ) * z * z
+		+ 2 * ( ( q->a10 + r->a10 ) * x * y + ( q->a20 + r->a20 ) * x * z + ( q->a21 + r->a21 ) * y * z )
+		+ 2 * ( ( q->b0 + r->b0 ) * x + ( q->b1 + r->b1 ) * y + ( q->b2 + r->b2 ) * z )
+		+ q->c + r->c;
+	w = q->w + r->w;
+	return w > 0 ? fabs( e ) / w : 0;
+}
+
+static void _pico_double_cross( const double *a, const double *b, double *dest ){
+	dest[ 0 ] = a[ 1 ] * b[ 2 ] - a[ 2 ] * b[ 1 ];
+	dest[ 1 ] = a[ 2 ] * b[ 0 ] - a[ 0 ] * b[ 2 ];
+	dest[ 2 ] = a[ 0 ] * b[ 1 ] - a[ 1 ] * b[ 0 ];
+}
+
+/* normal of a triangle given by corner positions, not normalized */
+static void _pico_corner_normal( const pmm::vec_t *a, const pmm::vec_t *b, const pmm::vec_t *c, double *dest ){
+	double ba[ 3 ] = { (double) b[ 0 ] - a[ 0 ], (double) b[ 1 ] - a[ 1 ], (double) b[ 2 ] - a[ 2 ] };
+	double ca[ 3 ] = { (double) c[ 0 ] - a[ 0 ], (double) c[ 1 ] - a[ 1 ], (double) c[ 2 ] - a[ 2 ] };
+
+	_pico_double_cross( ba, ca, dest );
+}
+
+/* outgoing half edges of every vertex (or of every group, when 'group' is
+   given), to[ first[ v ] ] .. to[ first[ v + 1 ] - 1 ] */
+class picoHalfEdges_t
+{
+public:
+	std::vector<int> first, to;
+};
+
+static void _pico_build_half_edges( picoHalfEdges_t *halfEdges, const std::vector<pmm::index_t> &indexes, const int *group, int numVertexes ){
+	int numIndexes = (int) indexes.size(), i;
+
+	halfEdges->first.assign( numVertexes + 1, 0 );
+	for ( i = 0; i < numIndexes; i++ )
+		halfEdges->first[ ( group ? group[ indexes[ i ] ] : indexes[ i ] ) + 1 ]++;
+	for ( i = 0; i < numVertexes; i++ )
+		halfEdges->first[ i + 1 ] += halfEdges->first[ i ];
+
+	std::vector<int> fill( halfEdges->first.begin(), halfEdges->first.end() - 1 );
+	halfEdges->to.resize( numIndexes );
+	for ( i = 0; i < numIndexes; i++ )
+	{
+		int a = indexes[ i ], b = indexes[ i % 3 == 2 ? i - 2 : i + 1 ];
+		if ( group ) {
+			a = group[ a ];
+			b = group[ b ];
+		}
+		halfEdges->to[ fill[ a ]++ ] = b;
+	}
+
+	/* sorted, so counting stays cheap around vertexes with huge fans */
+	for ( i = 0; i < numVertexes; i++ )
+		std::sort( halfEdges->to.begin() + halfEdges->first[ i ], halfEdges->to.begin() + halfEdges->first[ i + 1 ] );
+}
+
+static int _pico_count_half_edges( const picoHalfEdges_t *halfEdges, int a, int b ){
+	auto range = std::equal_range( halfEdges->to.begin() + halfEdges->first[ a ], halfEdges->to.begin() + halfEdges->first[ a + 1 ], b );
+
+	return (int) ( range.second - range.first );
+}
+
+/* _pico_collapse_flips:
+ *  true if moving position 'from' onto 'to' folds any remaining triangle
+ *  around 'from' over, or turns it nearly on edge
+ */
+static int _pico_collapse_flips( pmm::surface_t *surface, const std::vector<pmm::index_t> &indexes, const std::vector<int> &pos,
+								 const picoVertexTriangles_t &adjacency, int from, int to ){
+	int i, j;
+
+	for ( i = adjacency.first[ from ]; i < adjacency.first[ from + 1 ]; i++ )
+	{
+		const pmm::index_t *tri = &indexes[ adjacency.tris[ i ] * 3 ];
+		const pmm::vec_t *corner[ 3 ], *moved[ 3 ];
+		double before[ 3 ], after[ 3 ];
+
+		/* triangles on the collapsing edge vanish */
+		if ( pos[ tri[ 0 ] ] == to || pos[ tri[ 1 ] ] == to || pos[ tri[ 2 ] ] == to ) {
+			continue;
+		}
+		for ( j = 0; j < 3; j++ )
+		{
+			corner[ j ] = surface->xyz[ tri[ j ] ];
+			moved[ j ] = pos[ tri[ j ] ] == from ? surface->xyz[ to ] : corner[ j ];
+		}
+		_pico_corner_normal( corner[ 0 ], corner[ 1 ], corner[ 2 ], before );
+		_pico_corner_normal( moved[ 0 ], moved[ 1 ], moved[ 2 ], after );
+		if ( before[ 0 ] * after[ 0 ] + before[ 1 ] * after[ 1 ] + before[ 2 ] * after[ 2 ] <=
+			 SIMPLIFY_FLIP_COS * sqrt( ( before[ 0 ] * before[ 0 ] + before[ 1 ] * before[ 1 ] + before[ 2 ] * before[ 2 ] ) *
+									   ( after[ 0 ] * after[ 0 ] + after[ 1 ] * after[ 1 ] + after[ 2 ] * after[ 2 ] ) ) ) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+   pmm::pp_simplify_surface()
+   reduces a triangle surface to about 'targetRatio' of its triangles by
+   collapsing edges in order of quadric error. vertexes on st, color and
+   smoothing group seams only collapse along the seam, together with their
+   twin on the other side, and vertexes on open edges only along the edge.
+   simplification stops early when the next collapse would move the
+   surface by more than 'maxError' times its largest extent (0 = no limit).
+   unused vertexes are dropped and the rest renumbered in first-use order.
+   returns 1 on success, or when there is nothing to reduce, and 0 on error
+   or when no edge could be collapsed, the surface is then left unchanged
+ */
+
+int pmm::pp_simplify_surface( pmm::surface_t *surface, float targetRatio, float maxError ){
+	int numVertexes, numTriangles, targetIndexes, totalCollapsed, i, j, k;
+	double limit;
+
+
+	/* dummy check */
+	if ( surface == nullptr || surface->type == pmm::st_patch ) {
+		return 0;
+	}
+	numVertexes = surface->numVertexes;
+	numTriangles = surface->numIndexes / 3;
+	if ( targetRatio >= 1.0f || numTriangles == 0 ) {
+		return 1;
+	}
+	if ( !_pico_expand_compact( surface, "pp_simplify_surface" ) ) {
+		return 0;
+	}
+	if ( targetRatio < 0.0f ) {
+		targetRatio = 0.0f;
+	}
+
+	/* triangles with bad indexes are kept aside, untouched */
+	std::vector<pmm::index_t> indexes, bad;
+	indexes.reserve( numTriangles * 3 );
+	for ( i = 0; i < numTriangles; i++ )
+	{
+		std::vector<pmm::index_t> &dest = _pico_triangle_is_valid( surface, i ) ? indexes : bad;
+		dest.insert( dest.end(), surface->index + i * 3, surface->index + i * 3 + 3 );
+	}
+	targetIndexes = (int) ( indexes.size() / 3 * targetRatio ) * 3;
+
+	/* pos[ v ] is the lowest vertex at the same xyz, wedge[ v ] the next one there, in a ring */
+	std::vector<int> pos( numVertexes ), wedge( numVertexes ), sorted( numVertexes );
+	for ( i = 0; i < numVertexes; i++ )
+		sorted[ i ] = i;
+	std::sort( sorted.begin(), sorted.end(), [surface]( int a, int b ){
+		const pmm::vec_t *p = surface->xyz[ a ], *q = surface->xyz[ b ];
+		if ( p[ 0 ] != q[ 0 ] ) {
+			return p[ 0 ] < q[ 0 ];
+		}
+		if ( p[ 1 ] != q[ 1 ] ) {
+			return p[ 1 ] < q[ 1 ];
+		}
+		if ( p[ 2 ] != q[ 2 ] ) {
+			return p[ 2 ] < q[ 2 ];
+		}
+		return a < b;
+	} );
+	for ( i = 0; i < numVertexes; i = j )
+	{
+		const pmm::vec_t *p = surface->xyz[ sorted[ i ] ];
+		for ( j = i + 1; j < numVertexes; j++ )
+		{
+			const pmm::vec_t *q = surface->xyz[ sorted[ j ] ];
+			if ( p[ 0 ] != q[ 0 ] || p[ 1 ] != q[ 1 ] || p[ 2 ] != q[ 2 ] ) {
+				break;
+			}
+		}
+		for ( k = i; k < j; k++ )
+		{
+			pos[ sorted[ k ] ] = sorted[ i ];
+			wedge[ sorted[ k ] ] = sorted[ k + 1 < j ? k + 1 : i ];
+		}
+	}
+
+	/* open edges: loop[ v ] is where the open edge leaving v goes, loopBack[ v ] where the one entering comes from */
+	picoHalfEdges_t edges, posEdges;
+	std::vector<int> loop( numVertexes, -1 ), loopBack( numVertexes, -1 ), openOut( numVertexes, 0 ), openIn( numVertexes, 0 );
+	std::vector<int> posOpen( numVertexes, 0 );
+	std::vector<char> complex( numVertexes, 0 );
+	_pico_build_half_edges( &edges, indexes, nullptr, numVertexes );
+	_pico_build_half_edges( &posEdges, indexes, pos.data(), numVertexes );
+	for ( i = 0; i < (int) indexes.size(); i++ )
+	{
+		int a = indexes[ i ], b = indexes[ i % 3 == 2 ? i - 2 : i + 1 ];
+		if ( _pico_count_half_edges( &edges, a, b ) > 1 ) {
+			complex[ pos[ a ] ] = complex[ pos[ b ] ] = 1;
+		}
+		if ( _pico_count_half_edges( &edges, b, a ) == 0 ) {
+			loop[ a ] = b;
+			loopBack[ b ] = a;
+			openOut[ a ]++;
+			openIn[ b ]++;
+		}
+		if ( _pico_count_half_edges( &posEdges, pos[ b ], pos[ a ] ) == 0 ) {
+			posOpen[ pos[ a ] ]++;
+			posOpen[ pos[ b ] ]++;
+		}
+	}
+
+	/* classify */
+	std::vector<char> kind( numVertexes, SIMPLIFY_LOCKED );
+	for ( i = 0; i < numVertexes; i++ )
+	{
+		int p = pos[ i ], w = wedge[ i ];
+		if ( complex[ p ] ) {
+			continue;
+		}
+		if ( w == i ) {
+			if ( openOut[ i ] == 0 && openIn[ i ] == 0 ) {
+				kind[ i ] = SIMPLIFY_MANIFOLD;
+			}
+			else if ( openOut[ i ] == 1 && openIn[ i ] == 1 && posOpen[ p ] == 2 ) {
+				kind[ i ] = SIMPLIFY_BORDER;
+			}
+		}
+		else if ( wedge[ w ] == i && posOpen[ p ] == 0 &&
+				  openOut[ i ] == 1 && openIn[ i ] == 1 && openOut[ w ] == 1 && openIn[ w ] == 1 &&
+				  pos[ loop[ i ] ] == pos[ loopBack[ w ] ] && pos[ loopBack[ i ] ] == pos[ loop[ w ] ] ) {
+			kind[ i ] = SIMPLIFY_SEAM;
+		}
+	}
+
+	/* quadrics, one per position */
+	std::vector<picoQuadric_t> quadrics( numVertexes, picoQuadric_t{} );
+	pmm::vec3_t mins, maxs;
+	_pico_zero_bounds( mins, maxs );
+	for ( i = 0; i < (int) indexes.size(); i += 3 )
+	{
+		const pmm::vec_t *a = surface->xyz[ indexes[ i ] ], *b = surface->xyz[ indexes[ i + 1 ] ], *c = surface->xyz[ indexes[ i + 2 ] ];
+		double n[ 3 ], length, d;
+
+		_pico_corner_normal( a, b, c, n );
+		length = sqrt( n[ 0 ] * n[ 0 ] + n[ 1 ] * n[ 1 ] + n[ 2 ] * n[ 2 ] );
+		if ( length == 0 ) {
+			continue;
+		}
+		for ( j = 0; j < 3; j++ )
+			n[ j ] /= length;
+		d = -( n[ 0 ] * a[ 0 ] + n[ 1 ] * a[ 1 ] + n[ 2 ] * a[ 2 ] );
+		for ( j = 0; j < 3; j++ )
+		{
+			_pico_quadric_add_plane( &quadrics[ pos[ indexes[ i + j ] ] ], n, d, length * 0.5 );
+			_pico_expand_bounds( surface->xyz[ indexes[ i + j ] ], mins, maxs );
+		}
+
+		/* open edges get a plane standing on the edge, across the triangle */
+		for ( j = 0; j < 3; j++ )
+		{
+			int v0 = indexes[ i + j ], v1 = indexes[ i + ( j + 1 ) % 3 ];
+			const pmm::vec_t *p0 = surface->xyz[ v0 ], *p1 = surface->xyz[ v1 ];
+			double e[ 3 ] = { (double) p1[ 0 ] - p0[ 0 ], (double) p1[ 1 ] - p0[ 1 ], (double) p1[ 2 ] - p0[ 2 ] }, m[ 3 ], ml;
+
+			if ( _pico_count_half_edges( &edges, v1, v0 ) != 0 ) {
+				continue;
+			}
+			_pico_double_cross( e, n, m );
+			ml = sqrt( m[ 0 ] * m[ 0 ] + m[ 1 ] * m[ 1 ] + m[ 2 ] * m[ 2 ] );
+			if ( ml == 0 ) {
+				continue;
+			}
+			for ( k = 0; k < 3; k++ )
+				m[ k ] /= ml;
+			d = -( m[ 0 ] * p0[ 0 ] + m[ 1 ] * p0[ 1 ] + m[ 2 ] * p0[ 2 ] );
+			_pico_quadric_add_plane( &quadrics[ pos[ v0 ] ], m, d, ml * ml * SIMPLIFY_EDGE_WEIGHT );
+			_pico_quadric_add_plane( &quadrics[ pos[ v1 ] ], m, d, ml * ml * SIMPLIFY_EDGE_WEIGHT );
+		}
+	}
+	limit = 0;
+	for ( j = 0; j < 3; j++ )
+		if ( maxs[ j ] - mins[ j ] > limit ) {
+			limit = maxs[ j ] - mins[ j ];
+		}
+	limit = maxError > 0 ? ( maxError * limit ) * ( maxError * limit ) : DBL_MAX;
+
+	/* collapse in passes, each vertex neighbourhood changes at most once per pass */
+	std::vector<picoCollapse_t> collapses;
+	std::vector<int> remap( numVertexes );
+	std::vector<char> locked( numVertexes );
+	picoVertexTriangles_t adjacency;
+	totalCollapsed = 0;
+	while ( (int) indexes.size() > targetIndexes )
+	{
+		int goal = ( (int) indexes.size() - targetIndexes ) / 3, removed = 0, numCollapsed = 0, done = 0;
+
+		/* triangles around each position */
+		adjacency.first.assign( numVertexes + 1, 0 );
+		for ( i = 0; i < (int) indexes.size(); i++ )
+			adjacency.first[ pos[ indexes[ i ] ] + 1 ]++;
+		for ( i = 0; i < numVertexes; i++ )
+			adjacency.first[ i + 1 ] += adjacency.first[ i ];
+		std::vector<int> fill( adjacency.first.begin(), adjacency.first.end() - 1 );
+		adjacency.tris.resize( indexes.size() );
+		for ( i = 0; i < (int) indexes.size(); i++ )
+			adjacency.tris[ fill[ pos[ indexes[ i ] ] ]++ ] = i / 3;
+
+		/* rank every allowed edge collapse, in its cheaper direction. an inner
+		   edge is seen from both its triangles, so only one side adds it */
+		collapses.clear();
+		for ( i = 0; i < (int) indexes.size(); i++ )
+		{
+			int a = indexes[ i ], b = indexes[ i % 3 == 2 ? i - 2 : i + 1 ];
+			picoCollapse_t best = { -1, -1, DBL_MAX };
+			if ( pos[ a ] > pos[ b ] && loop[ a ] != b ) {
+				continue;
+			}
+			for ( j = 0; j < 2; j++ )
+			{
+				int from = j ? b : a, to = j ? a : b;
+				double error;
+				if ( kind[ from ] == SIMPLIFY_LOCKED ||
+					 ( kind[ from ] != SIMPLIFY_MANIFOLD && ( kind[ to ] != kind[ from ] || ( loop[ from ] != to && loopBack[ from ] != to ) ) ) ) {
+					continue;
+				}
+				error = _pico_quadric_error( &quadrics[ pos[ from ] ], &quadrics[ pos[ to ] ], surface->xyz[ to ] );
+				if ( error < best.error ) {
+					best = { from, to, error };
+				}
+			}
+			if ( best.from >= 0 ) {
+				collapses.push_back( best );
+			}
+		}
+		std::sort( collapses.begin(), collapses.end(), []( const picoCollapse_t& a, const picoCollapse_t& b ){
+			return a.error < b.error || ( a.error == b.error && ( a.from < b.from || ( a.from == b.from && a.to < b.to ) ) );
+		} );
+
+		for ( i = 0; i < numVertexes; i++ )
+			remap[ i ] = i;
+		std::fill( locked.begin(), locked.end(), 0 );
+		for ( const picoCollapse_t& collapse : collapses )
+		{
+			int from = collapse.from, to = collapse.to, p0 = pos[ from ], p1 = pos[ to ], twin = -1, twinTo = -1;
+
+			if ( collapse.error > limit ) {
+				done = 1;
+				break;
+			}
+			if ( removed >= goal ) {
+				break;
+			}
+			if ( locked[ p0 ] || locked[ p1 ] || _pico_collapse_flips( surface, indexes, pos, adjacency, p0, p1 ) ) {
+				continue;
+			}
+
+			/* the other side of a seam follows along the same edge */
+			if ( kind[ from ] == SIMPLIFY_SEAM ) {
+				twin = wedge[ from ];
+				twinTo = loop[ from ] == to ? loopBack[ twin ] : loop[ twin ];
+				if ( twinTo < 0 || pos[ twinTo ] != p1 ) {
+					continue;
+				}
+				remap[ twin ] = twinTo;
+			}
+			remap[ from ] = to;
+			_pico_quadric_add( &quadrics[ p1 ], &quadrics[ p0 ] );
+
+			/* freeze the neighbourhood until the next pass */
+			for ( j = adjacency.first[ p0 ]; j < adjacency.first[ p0 + 1 ]; j++ )
+				for ( k = 0; k < 3; k++ )
+					locked[ pos[ indexes[ adjacency.tris[ j ] * 3 + k ] ] ] = 1;
+			locked[ p1 ] = 1;
+			removed += kind[ from ] == SIMPLIFY_BORDER ? 1 : 2;
+			numCollapsed++;
+		}
+		if ( numCollapsed == 0 ) {
+			break;
+		}
+		totalCollapsed += numCollapsed;
+
+		/* apply, dropping triangles that lost an edge */
+		for ( i = j = 0; i < (int) indexes.size(); i += 3 )
+		{
+			int a = remap[ indexes[ i ] ], b = remap[ indexes[ i + 1 ] ], c = remap[ indexes[ i + 2 ] ];
+			if ( pos[ a ] == pos[ b ] || pos[ b ] == pos[ c ] || pos[ c ] == pos[ a ] ) {
+				continue;
+			}
+			indexes[ j++ ] = a;
+			indexes[ j++ ] = b;
+			indexes[ j++ ] = c;
+		}
+		indexes.resize( j );
+
+		/* open edge loops skip over the collapsed vertexes */
+		for ( i = 0; i < numVertexes; i++ )
+		{
+			if ( loop[ i ] >= 0 ) {
+				int l = loop[ i ], r = remap[ l ];
+				loop[ i ] = r == i ? loop[ l ] : r;
+			}
+			if ( loopBack[ i ] >= 0 ) {
+				int l = loopBack[ i ], r = remap[ l ];
+				loopBack[ i ] = r == i ? loopBack[ l ] : r;
+			}
+		}
+		if ( done ) {
+			break;
+		}
+	}
+
+	/* not reduced at all */
+	if ( totalCollapsed == 0 ) {
+		return 0;
+	}
+
+	/* write back */
+	surface->numIndexes = (int) ( indexes.size() + bad.size() );
+	if ( !indexes.empty() ) {
+		memcpy( surface->index, indexes.data(), indexes.size() * sizeof( *surface->index ) );
+	}
+	if ( !bad.empty() ) {
+		memcpy( surface->index + indexes.size(), bad.data(), bad.size() * sizeof( *surface->index ) );
+	}
+	if ( surface->numFaceNormals >= numTriangles ) {
+		surface->numFaceNormals = surface->numIndexes / 3;
+		_pico_calc_face_planes( surface->xyz, numVertexes, surface->index, surface->numFaceNormals, surface->faceNormal, surface->faceDist );
+	}
+
+	/* drop the vertexes nothing uses any more */
+	std::vector<char> used( numVertexes, 0 );
+	for ( i = 0; i < surface->numIndexes; i++ )
+		if ( surface->index[ i ] >= 0 && surface->index[ i ] < numVertexes ) {
+			used[ surface->index[ i ] ] = 1;
+		}
+	if ( !pmm::pp_optimize_vertex_fetch( surface ) ) {
+		return 0;
+	}
+	surface->numVertexes = (int) std::count( used.begin(), used.end(), 1 );
+	pmm::pp_calc_surface_bounds( surface );
+	return 1;
+}
+
+/*
+   pmm::pp_build_lod_chain()
+   builds 'numRatios' copies of a model, copy i simplified to about
+   ratios[ i ] of the triangles with pmm::pp_simplify_surface(). all
+   surfaces of all levels are simplified in one parallel pass, surfaces that
+   can't be reduced are kept as they are. the copies are stored in lods[],
+   and belong to the caller.
+   returns 1 on success or 0 on error or when a level with triangles could
+   not be reduced at all, lods[] is then all nullptr
+ */
+
+int pmm::pp_build_lod_chain( pmm::model_t *model, const float *ratios, int numRatios, float maxError, pmm::model_t **lods ){
+	int i, numSurfaces;
+
+
+	/* dummy check */
+	if ( model == nullptr || ratios == nullptr || lods == nullptr || numRatios < 1 ) {
+		return 0;
+	}
+
+	/* copy the model once per level */
+	for ( i = 0; i < numRatios; i++ )
+	{
+		lods[ i ] = pmm::pp_copy_model( model );
+		if ( lods[ i ] == nullptr ) {
+			while ( i-- > 0 )
+			{
+				pmm::pp_free_model( lods[ i ] );
+				lods[ i ] = nullptr;
+			}
+			return 0;
+		}
+	}
+
+	/* one task per level and surface */
+	numSurfaces = model->num_surfaces;
+	std::vector<char> tried( numRatios * numSurfaces ), reduced( numRatios * numSurfaces );
+	_pico_parallel_for( numRatios * numSurfaces, 1, [lods, ratios, numSurfaces, maxError, &tried, &reduced]( int first, int last ){
+		for ( int i = first; i < last; i++ )
+		{
+			pmm::surface_t *surface = lods[ i / numSurfaces ]->surface[ i % numSurfaces ];
+			if ( surface != nullptr && surface->type == pmm::st_triangles ) {
+				tried[ i ] = 1;
+				reduced[ i ] = pmm::pp_simplify_surface( surface, ratios[ i / numSurfaces ], maxError ) != 0;
+			}
+		}
+	} );
+
+	/* a level where no surface was reduced is no lod, drop the whole chain */
+	for ( i = 0; i < numRatios; i++ )
+	{
+		int first = i * numSurfaces, last = first + numSurfaces;
+		if ( std::find( tried.begin() + first, tried.begin() + last, 1 ) != tried.begin() + last &&
+			 std::find( reduced.begin() + first, reduced.begin() + last, 1 ) == reduced.begin() + last ) {
+			break;
+		}
+	}
+	if ( i < numRatios ) {
+		for ( i = 0; i < numRatios; i++ )
+		{
+			pmm::pp_free_model( lods[ i ] );
+			lods[ i ] = nullptr;
+		}
+		return 0;
+	}
+	for ( i = 0; i < numRatios; i++ )
+		pmm::pp_calc_model_bounds( lods[ i ] );
+
+	return 1;
+}
+
+
+
+/* ----------------------------------------------------------------------------
+   meshlets
+   ---------------------------------------------------------------------------- */
+
+/* local vertex numbers are stored in a byte */
+#define MESHLET_MAX_VERTEXES    256
+#define MESHLET_MAX_TRIANGLES   512
+
+/* _pico_meshlet_bounds:
+ *  bounding sphere and normal cone of the triangles tris[ 0 .. numTris - 1 ]
+ */
+static void _pico_meshlet_bounds( pmm::surface_t *surface, const int *tris, int numTris, pmm::meshlet_t *meshlet ){
+	pmm::vec3_t mins, maxs, normal, ba, ca, delta;
+	std::vector<float> normals( numTris * 3 );
+	double axis[ 3 ] = { 0, 0, 0 }, length, minDot, maxT;
+	int i, j;
+
+	/* sphere around the box */
+	_pico_zero_bounds( mins, maxs );
+	for ( i = 0; i < numTris; i++ )
+		for ( j = 0; j < 3; j++ )
+			_pico_expand_bounds( surface->xyz[ surface->index[ tris[ i ] * 3 + j ] ], mins, maxs );
+	_pico_add_vec( mins, maxs, meshlet->center );
+	_pico_scale_vec( meshlet->center, 0.5f, meshlet->center );
+	meshlet->radius = 0;
+	for ( i = 0; i < numTris; i++ )
+		for ( j = 0; j < 3; j++ )
+		{
+			_pico_subtract_vec( surface->xyz[ surface->index[ tris[ i ] * 3 + j ] ], meshlet->center, delta );
+			length = sqrt( _pico_dot_vec( delta, delta ) );
+			if ( length > meshlet->radius ) {
+				meshlet->radius = (pmm::vec_t) length;
+			}
+		}
+
+	/* cone around the unit face normals, same winding as pmm::pp_fix_surface_normals() */
+	for ( i = 0; i < numTris; i++ )
+	{
+		pmm::index_t *tri = surface->index + tris[ i ] * 3;
+		_pico_subtract_vec( surface->xyz[ tri[ 1 ] ], surface->xyz[ tri[ 0 ] ], ba );
+		_pico_subtract_vec( surface->xyz[ tri[ 2 ] ], surface->xyz[ tri[ 0 ] ], ca );
+		_pico_cross_vec( ca, ba, normal );
+		_pico_normalize_vec( normal );
+		for ( j = 0; j < 3; j++ )
+		{
+			normals[ i * 3 + j ] = normal[ j ];
+			axis[ j ] += normal[ j ];
+		}
+	}
+	length = sqrt( axis[ 0 ] * axis[ 0 ] + axis[ 1 ] * axis[ 1 ] + axis[ 2 ] * axis[ 2 ] );
+	_pico_copy_vec( meshlet->center, meshlet->coneApex );
+	_pico_zero_vec( meshlet->coneAxis );
+	meshlet->coneCutoff = 1;
+	if ( length == 0 ) {
+		return;
+	}
+	for ( j = 0; j < 3; j++ )
+		meshlet->coneAxis[ j ] = (pmm::vec_t) ( axis[ j ] / length );
+
+	minDot = 1;
+	for ( i = 0; i < numTris; i++ )
+	{
+		double d = _pico_dot_vec( &normals[ i * 3 ], meshlet->coneAxis );
+		if ( d < minDot ) {
+			minDot = d;
+		}
+	}
+
+	/* normals spread over a half space or more, the cluster can always be seen */
+	if ( minDot <= 0.1 ) {
+		return;
+	}
+
+	/* apex behind the center, far enough that every face plane is in front of it */
+	maxT = 0;
+	for ( i = 0; i < numTris; i++ )
+	{
+		pmm::vec_t *n = &normals[ i * 3 ];
+		_pico_subtract_vec( meshlet->center, surface->xyz[ surface->index[ tris[ i ] * 3 ] ], delta );
+		double t = _pico_dot_vec( delta, n ) / _pico_dot_vec( meshlet->coneAxis, n );
+		if ( t > maxT ) {
+			maxT = t;
+		}
+	}
+	for ( j = 0; j < 3; j++ )
+		meshlet->coneApex[ j ] = (pmm::vec_t) ( meshlet->center[ j ] - meshlet->coneAxis[ j ] * maxT );
+	meshlet->coneCutoff = (pmm::vec_t) sqrt( 1 - minDot * minDot );
+}
+
+/*
+   pmm::pp_build_meshlets()
+   partitions a triangle surface into clusters of at most 'maxVerts'
+   vertexes (up to 256) and 'maxTris' triangles (up to 512). clusters
+   grow through shared vertexes, preferring triangles that add the fewest
+   new vertexes and lie closest to the cluster, and continue in index
+   order when nothing connected fits, so run pmm::pp_optimize_vertex_cache()
+   first. triangles with bad indexes are left out.
+   returns the clusters, free them with pmm::pp_free_meshlets(), or nullptr on error
+ */
+
+pmm::meshlets_t *pmm::pp_build_meshlets( pmm::surface_t *surface, int maxVerts, int maxTris ){
+	picoVertexTriangles_t adjacency;
+	pmm::meshlets_t *meshlets;
+	int numVertexes, numTriangles, cursor, i, j, k;
+
+
+	/* dummy check */
+	if ( surface == nullptr || surface->type == pmm::st_patch ) {
+		return nullptr;
+	}
+	if ( !_pico_expand_compact( surface, "pp_build_meshlets" ) ) {
+		return nullptr;
+	}
+	maxVerts = maxVerts < 3 ? 3 : maxVerts > MESHLET_MAX_VERTEXES ? MESHLET_MAX_VERTEXES : maxVerts;
+	maxTris = maxTris < 1 ? 1 : maxTris > MESHLET_MAX_TRIANGLES ? MESHLET_MAX_TRIANGLES : maxTris;
+	numVertexes = surface->numVertexes;
+	numTriangles = surface->numIndexes / 3;
+
+	/* live triangles of a vertex are tris[ first[ v ] ] .. tris[ first[ v ] + live[ v ] - 1 ] */
+	_pico_build_vertex_triangles( surface, nullptr, &adjacency );
+	std::vector<int> live( numVertexes ), local( numVertexes, -1 );
+	std::vector<char> emitted( numTriangles, 0 );
+	for ( i = 0; i < numVertexes; i++ )
+		live[ i ] = adjacency.first[ i + 1 ] - adjacency.first[ i ];
+	for ( i = 0; i < numTriangles; i++ )
+		if ( !_pico_triangle_is_valid( surface, i ) ) {
+			emitted[ i ] = 1;
+		}
+
+	std::vector<pmm::meshlet_t> clusters;
+	std::vector<pmm::index_t> vertexes;
+	std::vector<pmm::ub8_t> triangles;
+	std::vector<int> tris;
+	pmm::vec3_t sum;
+	cursor = 0;
+	while ( 1 )
+	{
+		pmm::meshlet_t meshlet = {};
+		int best = -1;
+
+		/* seed with the next triangle in index order */
+		while ( cursor < numTriangles && emitted[ cursor ] )
+			cursor++;
+		if ( cursor == numTriangles ) {
+			break;
+		}
+		meshlet.firstVertex = (int) vertexes.size();
+		meshlet.firstTriangle = (int) triangles.size() / 3;
+		tris.clear();
+		_pico_zero_vec( sum );
+		best = cursor;
+
+		while ( best >= 0 )
+		{
+			pmm::index_t *tri = surface->index + best * 3;
+
+			/* add it */
+			emitted[ best ] = 1;
+			tris.push_back( best );
+			for ( j = 0; j < 3; j++ )
+			{
+				int v = tri[ j ], *list = &adjacency.tris[ adjacency.first[ v ] ];
+				if ( local[ v ] < 0 ) {
+					local[ v ] = meshlet.numVertexes++;
+					vertexes.push_back( v );
+					_pico_add_vec( sum, surface->xyz[ v ], sum );
+				}
+				triangles.push_back( (pmm::ub8_t) local[ v ] );
+				for ( k = 0; k < live[ v ]; k++ )
+					if ( list[ k ] == best ) {
+						list[ k ] = list[ --live[ v ] ];
+						break;
+					}
+			}
+			meshlet.numTriangles++;
+			if ( meshlet.numTriangles == maxTris ) {
+				break;
+			}
+
+			/* next: fewest new vertexes, then closest to the cluster center */
+			pmm::vec3_t center;
+			float bestDist = 0;
+			int bestExtra = 4;
+			_pico_scale_vec( sum, 1.0f / meshlet.numVertexes, center );
+			best = -1;
+			for ( i = meshlet.firstVertex; i < (int) vertexes.size(); i++ )
+			{
+				int v = vertexes[ i ];
+				for ( k = 0; k < live[ v ]; k++ )
+				{
+					int t = adjacency.tris[ adjacency.first[ v ] + k ];
+					pmm::index_t *other = surface->index + t * 3;
+					pmm::vec3_t mid, delta;
+					int extra = ( local[ other[ 0 ] ] < 0 ) + ( local[ other[ 1 ] ] < 0 ) + ( local[ other[ 2 ] ] < 0 );
+					float dist;
+
+					if ( meshlet.numVertexes + extra > maxVerts || extra > bestExtra ) {
+						continue;
+					}
+					_pico_add_vec( surface->xyz[ other[ 0 ] ], surface->xyz[ other[ 1 ] ], mid );
+					_pico_add_vec( mid, surface->xyz[ other[ 2 ] ], mid );
+					_pico_scale_vec( mid, 1.0f / 3.0f, mid );
+					_pico_subtract_vec( mid, center, delta );
+					dist = (float) _pico_dot_vec( delta, delta );
+					if ( extra < bestExtra || dist < bestDist ) {
+						best = t;
+						bestExtra = extra;
+						bestDist = dist;
+					}
+				}
+			}
+
+			/* nothing connected fits, try the next triangle in index order */
+			if ( best < 0 ) {
+				while ( cursor < numTriangles && emitted[ cursor ] )
+					cursor++;
+				if ( cursor < numTriangles ) {
+					pmm::index_t *other = surface->index + cursor * 3;
+					int extra = ( local[ other[ 0 ] ] < 0 ) + ( local[ other[ 1 ] ] < 0 ) + ( local[ other[ 2 ] ] < 0 );
+					if ( meshlet.numVertexes + extra <= maxVerts ) {
+						best = cursor;
+					}
+				}
+			}
+		}
+
+		/* close the cluster */
+		for ( i = meshlet.firstVertex; i < (int) vertexes.size(); i++ )
+			local[ vertexes[ i ] ] = -1;
+		_pico_meshlet_bounds( surface, tris.data(), (int) tris.size(), &meshlet );
+		clusters.push_back( meshlet );
+	}
+
+	/* one block: header, clusters, vertex numbers, local indexes */
+	pmm::size_type size = sizeof( pmm::meshlets_t ) + clusters.size() * sizeof( pmm::meshlet_t )
+						  + vertexes.size() * sizeof( pmm::index_t ) + triangles.size();
+	meshlets = reinterpret_cast<decltype(meshlets)>(pmm::man.pp_m_new( size ));
+	if ( meshlets == nullptr ) {
+		return nullptr;
+	}
+	meshlets->numMeshlets = (int) clusters.size();
+	meshlets->meshlet = reinterpret_cast<pmm::meshlet_t *>( meshlets + 1 );
+	meshlets->numVertexes = (int) vertexes.size();
+	meshlets->vertex = reinterpret_cast<pmm::index_t *>( meshlets->meshlet + meshlets->numMeshlets );
+	meshlets->numTriangles = (int) triangles.size() / 3;
+	meshlets->triangle = reinterpret_cast<pmm::ub8_t *>( meshlets->vertex + meshlets->numVertexes );
+	memcpy( meshlets->meshlet, clusters.data(), clusters.size() * sizeof( pmm::meshlet_t ) );
+	memcpy( meshlets->vertex, vertexes.data(), vertexes.size() * sizeof( pmm::index_t ) );
+	memcpy( meshlets->triangle, triangles.data(), triangles.size() );
+	return meshlets;
+}
+
+/*
+   pmm::pp_free_meshlets()
+   frees clusters built by pmm::pp_build_meshlets()
+ */
+
+void pmm::pp_free_meshlets( pmm::meshlets_t *meshlets ){
+	if ( meshlets == nullptr ) {
+		return;
+	}
+	pmm::man.pp_m_delete( meshlets );
+}
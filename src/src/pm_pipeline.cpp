@@ -0,0 +1,227 @@
+/* -----------------------------------------------------------------------------
+
+   PicoModel Library
+
+   Copyright (c) 2002, Randy Reddig & seaw0lf
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification,
+   are permitted provided that the following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list
+   of conditions and the following disclaimer.
+
+   Redistributions in binary form must reproduce the above copyright notice, this
+   list of conditions and the following disclaimer in the documentation and/or
+   other materials provided with the distribution.
+
+   Neither the names of the copyright holders nor the names of its contributors may
+   be used to endorse or promote products derived from this software without
+   specific prior written permission.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+   ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+   ANY DIRECT, INDIRECT, INCidentAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+   (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+   LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+   ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   ----------------------------------------------------------------------------- */
+
+/* pipelined loading of many model files */
+
+#include <pmpmesh/pmpmesh.hpp>
+#include <pmpmesh/pm_internal.hpp>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#define PIPELINE_READERS        8                       /* file reads are mostly latency, so more than the cores */
+#define PIPELINE_MAX_BYTES      ( 256 * 1024 * 1024 )
+
+
+
+/* one file between the readers and the parsers */
+class picoPipelineFile_t
+{
+public:
+	int index;
+	pmm::ub8_t                  *buffer;
+	int bufSize;                                /* < 0 when the read failed */
+};
+
+/* state shared by the threads of one pp_load_models call */
+class picoPipeline_t
+{
+public:
+	const char                  **names;
+	int numNames;
+	int frameNum;
+	int numParsers;
+	const pmm::pipeline_options_t *options;
+	pmm::size_type maxBytes;
+
+	std::mutex mutex;
+	std::condition_variable room;               /* readers wait for bytesInFlight to drop */
+	std::condition_variable work;               /* parsers wait for files */
+	std::deque<picoPipelineFile_t> files;       /* read, waiting for a parser */
+	pmm::size_type bytesInFlight;               /* read and not freed yet */
+	int nextRead;
+	int readersLeft;
+	int numLoaded;
+};
+
+
+
+/* _pico_pipeline_read:
+ *  reader thread, takes the next name while the parsers keep up
+ */
+static void _pico_pipeline_read( picoPipeline_t *pl ){
+	std::unique_lock<std::mutex> lock( pl->mutex );
+	picoPipelineFile_t file;
+
+	for ( ;; )
+	{
+		/* backpressure */
+		pl->room.wait( lock, [pl](){ return pl->nextRead >= pl->numNames || pl->bytesInFlight < pl->maxBytes; } );
+		if ( pl->nextRead >= pl->numNames ) {
+			break;
+		}
+		file.index = pl->nextRead++;
+		lock.unlock();
+
+		file.buffer = nullptr;
+		file.bufSize = pmm::man.pp_load_file( pl->names[ file.index ], &file.buffer );
+		if ( file.bufSize < 0 ) {
+			pmm::man.pp_print( pmm::pl_error, ( std::ostringstream{} << "pmm::pp_load_models: Failed loading model " << pl->names[ file.index ] ).str() );
+		}
+
+		lock.lock();
+		if ( file.bufSize > 0 ) {
+			pl->bytesInFlight += file.bufSize;
+		}
+		pl->files.push_back( file );
+		pl->work.notify_one();
+	}
+
+	/* the last reader lets idle parsers go */
+	if ( --pl->readersLeft == 0 ) {
+		pl->work.notify_all();
+	}
+}
+
+/* _pico_pipeline_parse:
+ *  parser thread, loads read files until the readers are done
+ */
+static void _pico_pipeline_parse( picoPipeline_t *pl ){
+	std::unique_lock<std::mutex> lock( pl->mutex );
+	picoPipelineFile_t file;
+	pmm::model_t *model;
+	const char *name;
+
+	/* several parsers already share the cores */
+	if ( pl->numParsers > 1 ) {
+		_pico_parallel_worker();
+	}
+
+	for ( ;; )
+	{
+		pl->work.wait( lock, [pl](){ return !pl->files.empty() || pl->readersLeft == 0; } );
+		if ( pl->files.empty() ) {
+			return;
+		}
+		file = pl->files.front();
+		pl->files.pop_front();
+		lock.unlock();
+
+		name = pl->names[ file.index ];
+		model = nullptr;
+		if ( file.bufSize >= 0 ) {
+			model = _pico_load_model_buffer( name, pl->frameNum, file.buffer, file.bufSize, pl->options->loadOptions );
+			if ( file.buffer ) {
+				pmm::man.pp_f_delete( file.buffer );
+			}
+		}
+
+		/* the buffer is gone, readers may go on while the caller post-processes */
+		lock.lock();
+		if ( file.bufSize > 0 ) {
+			pl->bytesInFlight -= file.bufSize;
+		}
+		if ( model != nullptr ) {
+			pl->numLoaded++;
+		}
+		pl->room.notify_all();
+		lock.unlock();
+
+		if ( pl->options->loaded != nullptr ) {
+			pl->options->loaded( file.index, name, model, pl->options->loadedData );
+		}
+		else if ( model != nullptr ) {
+			pmm::pp_free_model( model );
+		}
+		lock.lock();
+	}
+}
+
+/*
+   pmm::pp_load_models()
+   loads 'names' with a pool of reader threads feeding a pool of parser
+   threads, so the file i/o of one model hides behind the parsing of
+   others. readers stop while more than maxBytesInFlight of file data
+   waits, which bounds memory to about that plus one file per reader.
+   with several parsers each one runs its loader's passes on its own
+   thread. every model goes to options->loaded, returns the number loaded
+ */
+
+int pmm::pp_load_models( const char **names, int numNames, int frameNum, const pmm::pipeline_options_t *options ){
+	pmm::pipeline_options_t defaults{};
+	std::vector<std::thread> threads;
+	picoPipeline_t pl;
+	int numReaders, numParsers, i;
+
+
+	if ( names == nullptr || numNames <= 0 ) {
+		return 0;
+	}
+	if ( options == nullptr ) {
+		options = &defaults;
+	}
+
+	numReaders = options->numReaders > 0 ? options->numReaders : PIPELINE_READERS;
+	numParsers = options->numParsers > 0 ? options->numParsers : pmm::man.pp_num_threads();
+	if ( numReaders > numNames ) {
+		numReaders = numNames;
+	}
+	if ( numParsers > numNames ) {
+		numParsers = numNames;
+	}
+
+	pl.names = names;
+	pl.numNames = numNames;
+	pl.frameNum = frameNum;
+	pl.numParsers = numParsers;
+	pl.options = options;
+	pl.maxBytes = options->maxBytesInFlight > 0 ? options->maxBytesInFlight : PIPELINE_MAX_BYTES;
+	pl.bytesInFlight = 0;
+	pl.nextRead = 0;
+	pl.readersLeft = numReaders;
+	pl.numLoaded = 0;
+
+	threads.reserve( numReaders + numParsers );
+	for ( i = 0; i < numReaders; i++ )
+		threads.emplace_back( _pico_pipeline_read, &pl );
+	for ( i = 0; i < numParsers; i++ )
+		threads.emplace_back( _pico_pipeline_parse, &pl );
+	for ( std::thread &thread : threads )
+		thread.join();
+
+	return pl.numLoaded;
+}
@@ -342,6 +342,7 @@ static pmm::model_t *_terrain_load( PM_PARAMS_LOAD ) {
 	pmm::vec3_t xyz, normal;
 	pmm::vec2_t st;
 	pmm::color_t color;
+	int loadFlags = _pico_load_flags( options );
 
 
 	/* create pico parser */
@@ -444,16 +445,18 @@ static pmm::model_t *_terrain_load( PM_PARAMS_LOAD ) {
 
 	/* load colormap */
 	colormap = imageBuffer = nullptr;
-	imageBufSize = pmm::man.pp_load_file(colormapFile, &imageBuffer);
-	_terrain_load_tga_buffer( imageBuffer, &colormap, &cw, &ch );
-	pmm::man.pp_m_delete( colormapFile );
-	pmm::man.pp_f_delete(imageBuffer);
-
-	if ( cw != w || ch != h ) {
-		pmm::man.pp_print(pmm::pl_warning, "PicoTerrain colormap/heightmap size mismatch");
-		pmm::man.pp_m_delete( colormap );
-		colormap = nullptr;
+	if ( !( loadFlags & pmm::lf_skip_colors ) ) {
+		imageBufSize = pmm::man.pp_load_file(colormapFile, &imageBuffer);
+		_terrain_load_tga_buffer( imageBuffer, &colormap, &cw, &ch );
+		pmm::man.pp_f_delete(imageBuffer);
+
+		if ( cw != w || ch != h ) {
+			pmm::man.pp_print(pmm::pl_warning, "PicoTerrain colormap/heightmap size mismatch");
+			pmm::man.pp_m_delete( colormap );
+			colormap = nullptr;
+		}
 	}
+	pmm::man.pp_m_delete( colormapFile );
 
 	/* ----------------------------------------------------------------- */
 
@@ -524,21 +527,27 @@ static pmm::model_t *_terrain_load( PM_PARAMS_LOAD ) {
 			pmm::pp_set_surface_xyz( picoSurface, v, xyz );
 
 			/* set normal */
-			pmm::pp_set_surface_normal( picoSurface, v, normal );
+			if ( !( loadFlags & pmm::lf_skip_normals ) ) {
+				pmm::pp_set_surface_normal( picoSurface, v, normal );
+			}
 
 			/* set st */
-			st[ 0 ] = (float) i;
-			st[ 1 ] = (float) j;
-			pmm::pp_set_surface_st( picoSurface, 0, v, st );
+			if ( !( loadFlags & pmm::lf_skip_st ) ) {
+				st[ 0 ] = (float) i;
+				st[ 1 ] = (float) j;
+				pmm::pp_set_surface_st( picoSurface, 0, v, st );
+			}
 
 			/* set color */
-			if ( colorPixel != nullptr ) {
-				_pico_set_color( color, colorPixel[ 0 ], colorPixel[ 1 ], colorPixel[ 2 ], colorPixel[ 3 ] );
-			}
-			else{
-				_pico_set_color( color, 255, 255, 255, 255 );
+			if ( !( loadFlags & pmm::lf_skip_colors ) ) {
+				if ( colorPixel != nullptr ) {
+					_pico_set_color( color, colorPixel[ 0 ], colorPixel[ 1 ], colorPixel[ 2 ], colorPixel[ 3 ] );
+				}
+				else{
+					_pico_set_color( color, 255, 255, 255, 255 );
+				}
+				pmm::pp_set_surface_color( picoSurface, 0, v, color );
 			}
-			pmm::pp_set_surface_color( picoSurface, 0, v, color );
 
 			/* set triangles (zero alpha in heightmap suppresses this quad) */
 			if ( i < ( w - 1 ) && j < ( h - 1 ) && heightPixel[ 3 ] >= 128 ) {
@@ -589,5 +598,6 @@ extern const pmm::module_t picoModuleTerrain =
 	_terrain_canload,           /* validation routine */
 	_terrain_load,              /* load routine */
 	nullptr,                       /* save validation routine */
-	nullptr                        /* save routine */
+	nullptr,                       /* save routine */
+	nullptr                        /* probe routine */
 };
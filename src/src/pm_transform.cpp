@@ -0,0 +1,391 @@
+/* -----------------------------------------------------------------------------
+
+   PicoModel Library
+
+   Copyright (c) 2002, Randy Reddig & seaw0lf
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification,
+   are permitted provided that the following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list
+   of conditions and the following disclaimer.
+
+   Redistributions in binary form must reproduce the above copyright notice, this
+   list of conditions and the following disclaimer in the documentation and/or
+   other materials provided with the distribution.
+
+   Neither the names of the copyright holders nor the names of its contributors may
+   be used to endorse or promote products derived from this software without
+   specific prior written permission.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+   ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+   ANY DIRECT, INDIRECT, INCidentAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+   (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+   LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+   ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   ----------------------------------------------------------------------------- */
+
+/* model transforms and instance baking */
+
+#include <pmpmesh/pmpmesh.hpp>
+#include <pmpmesh/pm_internal.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#define TRANSFORM_GRAIN     16384   /* vertexes per thread when transforming one surface */
+
+
+
+/* ----------------------------------------------------------------------------
+   helpers
+   ---------------------------------------------------------------------------- */
+
+/* _pico_normal_matrix:
+ *  cofactors of the upper 3x3 of 'm', sign fixed so they point like the
+ *  inverse transpose: normals transformed by it only need renormalizing.
+ *  returns the determinant of 'm'
+ */
+static float _pico_normal_matrix( const pmm::vec_t *m, pmm::mat4_t normalMatrix ){
+	pmm::vec3_t c0 = { m[ 0 ], m[ 1 ], m[ 2 ] }, c1 = { m[ 4 ], m[ 5 ], m[ 6 ] }, c2 = { m[ 8 ], m[ 9 ], m[ 10 ] };
+	float det;
+	int j;
+
+	memset( normalMatrix, 0, sizeof( pmm::mat4_t ) );
+	_pico_cross_vec( c1, c2, normalMatrix );
+	_pico_cross_vec( c2, c0, normalMatrix + 4 );
+	_pico_cross_vec( c0, c1, normalMatrix + 8 );
+	normalMatrix[ 15 ] = 1;
+	det = (float) _pico_dot_vec( c0, normalMatrix );
+	if ( det < 0 ) {
+		for ( j = 0; j < 12; j++ )
+			normalMatrix[ j ] = -normalMatrix[ j ];
+	}
+	return det;
+}
+
+/* _pico_transform_vertexes:
+ *  transforms vertexes [first, last) of a surface: positions by 'm',
+ *  normals by 'normalMatrix' and tangents by 'm' with the bitangent sign
+ *  flipped for mirroring transforms
+ */
+static void _pico_transform_vertexes( pmm::surface_t *surface, int first, int last, const pmm::vec_t *m, const pmm::vec_t *normalMatrix, int mirror ){
+	int i;
+
+	_pico_transform_vecs( surface->xyz + first, last - first, m, 1, 0 );
+	_pico_transform_vecs( surface->normal + first, last - first, normalMatrix, 0, 1 );
+	if ( surface->tangent != nullptr ) {
+		for ( i = first; i < last; i++ )
+		{
+			pmm::vec3_t tangent = { surface->tangent[ i ][ 0 ], surface->tangent[ i ][ 1 ], surface->tangent[ i ][ 2 ] };
+			_pico_transform_vecs( &tangent, 1, m, 0, 1 );
+			_pico_copy_vec( tangent, surface->tangent[ i ] );
+			if ( mirror ) {
+				surface->tangent[ i ][ 3 ] = -surface->tangent[ i ][ 3 ];
+			}
+		}
+	}
+}
+
+/* _pico_flip_triangles:
+ *  reverses the winding of indexes [first, last), whole triangles only
+ */
+static void _pico_flip_triangles( pmm::index_t *index, int first, int last ){
+	int i;
+
+	for ( i = first; i + 3 <= last; i += 3 )
+		std::swap( index[ i + 1 ], index[ i + 2 ] );
+}
+
+/* _pico_transform_bounds:
+ *  box around the transformed corners of a box, and the transformed sphere
+ */
+static void _pico_transform_bounds( pmm::bounds_t *bounds, const pmm::vec_t *m ){
+	pmm::vec3_t corners[ 8 ];
+	float scale = 0;
+	int i, j;
+
+	if ( bounds->mins[ 0 ] > bounds->maxs[ 0 ] ) {
+		return;
+	}
+	for ( i = 0; i < 8; i++ )
+		for ( j = 0; j < 3; j++ )
+			corners[ i ][ j ] = ( i & ( 1 << j ) ) ? bounds->maxs[ j ] : bounds->mins[ j ];
+	_pico_transform_vecs( corners, 8, m, 1, 0 );
+	_pico_vec_bounds( corners, 8, bounds->mins, bounds->maxs );
+	_pico_transform_vecs( &bounds->center, 1, m, 1, 0 );
+	for ( j = 0; j < 3; j++ )
+	{
+		float length = (float) sqrt( m[ j * 4 ] * m[ j * 4 ] + m[ j * 4 + 1 ] * m[ j * 4 + 1 ] + m[ j * 4 + 2 ] * m[ j * 4 + 2 ] );
+		scale = length > scale ? length : scale;
+	}
+	bounds->radius *= scale;
+}
+
+
+
+/* ----------------------------------------------------------------------------
+   transforms
+   ---------------------------------------------------------------------------- */
+
+/*
+   pmm::pp_transform_model()
+   transforms a model in place by a column major matrix ( translation in
+   transform[ 12..14 ] ): positions, normals by the inverse transpose,
+   tangents, face planes and bounds. mirroring transforms also reverse
+   the triangle winding so front faces stay in front
+ */
+
+void pmm::pp_transform_model( pmm::model_t *model, const pmm::mat4_t transform ){
+	pmm::mat4_t normalMatrix;
+	int mirror, i;
+
+
+	/* dummy check */
+	if ( model == nullptr || transform == nullptr ) {
+		return;
+	}
+	if ( !_pico_expand_compact_model( model, "pp_transform_model" ) ) {
+		return;
+	}
+
+	mirror = _pico_normal_matrix( transform, normalMatrix ) < 0;
+	for ( i = 0; i < model->num_surfaces; i++ )
+	{
+		pmm::surface_t *surface = model->surface[ i ];
+		if ( surface == nullptr ) {
+			continue;
+		}
+
+		_pico_parallel_for( surface->numVertexes, TRANSFORM_GRAIN, [surface, transform, &normalMatrix, mirror]( int first, int last ){
+			_pico_transform_vertexes( surface, first, last, transform, normalMatrix, mirror );
+		} );
+		if ( mirror && surface->type == pmm::st_triangles ) {
+			_pico_flip_triangles( surface->index, 0, surface->numIndexes );
+		}
+		if ( surface->numFaceNormals > 0 ) {
+			_pico_calc_face_planes( surface->xyz, surface->numVertexes, surface->index, std::min( surface->numFaceNormals, surface->numIndexes / 3 ), surface->faceNormal, surface->faceDist );
+		}
+		_pico_vertex_index_changed( surface, 0 );
+	}
+
+	if ( model->frameBounds != nullptr ) {
+		for ( i = 0; i < model->numFrames; i++ )
+			_pico_transform_bounds( &model->frameBounds[ i ], transform );
+	}
+	pmm::pp_calc_model_bounds( model );
+}
+
+
+
+/* ----------------------------------------------------------------------------
+   instances
+   ---------------------------------------------------------------------------- */
+
+/* one surface of one instance, and where it lands in the destination */
+class picoBakeJob_t
+{
+public:
+	pmm::surface_t *src, *dest;
+	int instance;
+	int firstVertex, firstIndex;
+};
+
+/* sizes a destination surface grows to */
+class picoBakeTarget_t
+{
+public:
+	int numVertexes, numIndexes;
+	int numSTArrays, numColorArrays;
+};
+
+/* _pico_bake_job:
+ *  copies one source surface into its destination slot and transforms it
+ */
+static void _pico_bake_job( const picoBakeJob_t &job, const pmm::vec_t *transform, const pmm::vec_t *normalMatrix, int mirror ){
+	pmm::surface_t *src = job.src, *dest = job.dest;
+	pmm::color_t white = { 255, 255, 255, 255 };
+	int numVertexes = src->numVertexes, i, j;
+
+	/* vertexes */
+	memcpy( dest->xyz + job.firstVertex, src->xyz, numVertexes * sizeof( *dest->xyz ) );
+	memcpy( dest->normal + job.firstVertex, src->normal, numVertexes * sizeof( *dest->normal ) );
+	if ( dest->smoothingGroup != nullptr ) {
+		if ( src->smoothingGroup != nullptr ) {
+			memcpy( dest->smoothingGroup + job.firstVertex, src->smoothingGroup, numVertexes * sizeof( *dest->smoothingGroup ) );
+		}
+		else {
+			memset( dest->smoothingGroup + job.firstVertex, 0, numVertexes * sizeof( *dest->smoothingGroup ) );
+		}
+	}
+	if ( dest->tangent != nullptr ) {
+		if ( src->tangent != nullptr ) {
+			memcpy( dest->tangent + job.firstVertex, src->tangent, numVertexes * sizeof( *dest->tangent ) );
+		}
+		else {
+			memset( dest->tangent + job.firstVertex, 0, numVertexes * sizeof( *dest->tangent ) );
+		}
+	}
+	for ( j = 0; j < dest->numSTArrays; j++ )
+	{
+		if ( j < src->numSTArrays ) {
+			memcpy( dest->st[ j ] + job.firstVertex, src->st[ j ], numVertexes * sizeof( *dest->st[ j ] ) );
+		}
+		else {
+			memset( dest->st[ j ] + job.firstVertex, 0, numVertexes * sizeof( *dest->st[ j ] ) );
+		}
+	}
+	for ( j = 0; j < dest->numColorArrays; j++ )
+	{
+		if ( j < src->numColorArrays ) {
+			memcpy( dest->color[ j ] + job.firstVertex, src->color[ j ], numVertexes * sizeof( *dest->color[ j ] ) );
+		}
+		else {
+			for ( i = 0; i < numVertexes; i++ )
+				_pico_copy_color( white, dest->color[ j ][ job.firstVertex + i ] );
+		}
+	}
+	_pico_transform_vertexes( dest, job.firstVertex, job.firstVertex + numVertexes, transform, normalMatrix, mirror );
+
+	/* triangles */
+	for ( i = 0; i < src->numIndexes; i++ )
+		dest->index[ job.firstIndex + i ] = src->index[ i ] + job.firstVertex;
+	if ( mirror ) {
+		_pico_flip_triangles( dest->index, job.firstIndex, job.firstIndex + src->numIndexes );
+	}
+}
+
+/*
+   pmm::pp_bake_instances()
+   appends 'numTransforms' transformed copies of a model's triangle
+   surfaces to 'out', each as pmm::pp_transform_model() would leave it.
+   surfaces using the same shader end up in one surface of 'out', with
+   shaders matched by name and copied over as needed, so instances of
+   many models can be baked into one. missing st arrays and tangents are
+   zero and missing color arrays white. the bounds of 'out' are updated.
+   returns 1 on success, 0 on error
+ */
+
+int pmm::pp_bake_instances( pmm::model_t *model, const pmm::mat4_t *transforms, int numTransforms, pmm::model_t *out ){
+	std::unordered_map<pmm::shader_t *, pmm::shader_t *> shaders;
+	std::unordered_map<pmm::surface_t *, picoBakeTarget_t> targets;
+	std::vector<pmm::surface_t *> sources, dests, order;
+	std::vector<picoBakeJob_t> jobs;
+	std::vector<float> normalMatrices;
+	std::vector<int> mirrors;
+	std::atomic<int> next( 0 );
+	int i, t;
+
+
+	/* dummy check */
+	if ( model == nullptr || out == nullptr || model == out || numTransforms < 0 || ( transforms == nullptr && numTransforms > 0 ) ) {
+		return 0;
+	}
+	if ( !_pico_expand_compact_model( model, "pp_bake_instances" ) ) {
+		return 0;
+	}
+
+	/* destination surface of each source surface */
+	for ( i = 0; i < model->num_surfaces; i++ )
+	{
+		pmm::surface_t *surface = model->surface[ i ], *dest;
+		pmm::shader_t *shader = nullptr;
+		if ( surface == nullptr || surface->type != pmm::st_triangles || surface->numVertexes <= 0 || surface->numIndexes < 3 ) {
+			continue;
+		}
+
+		if ( surface->shader != nullptr ) {
+			auto it = shaders.find( surface->shader );
+			if ( it != shaders.end() ) {
+				shader = it->second;
+			}
+			else {
+				shader = surface->shader->name != nullptr ? pmm::pp_find_shader( out, surface->shader->name, 1 ) : nullptr;
+				if ( shader == nullptr ) {
+					shader = _pico_copy_shader( out, surface->shader );
+					if ( shader == nullptr ) {
+						return 0;
+					}
+				}
+				shaders[ surface->shader ] = shader;
+			}
+		}
+
+		/* shaderless surfaces only merge by name */
+		dest = _pico_find_triangle_surface( out, shader, shader != nullptr ? nullptr : surface->name );
+		if ( dest == nullptr ) {
+			dest = _pico_new_triangle_surface( out, shader, shader != nullptr ? nullptr : surface->name );
+			if ( dest == nullptr ) {
+				return 0;
+			}
+		}
+		if ( targets.find( dest ) == targets.end() ) {
+			targets[ dest ] = { dest->numVertexes, dest->numIndexes, dest->numSTArrays, dest->numColorArrays };
+			order.push_back( dest );
+		}
+		picoBakeTarget_t &target = targets[ dest ];
+		target.numSTArrays = std::max( target.numSTArrays, surface->numSTArrays );
+		target.numColorArrays = std::max( target.numColorArrays, surface->numColorArrays );
+		sources.push_back( surface );
+		dests.push_back( dest );
+	}
+
+	/* instances go one after another into their destinations */
+	jobs.reserve( sources.size() * numTransforms );
+	for ( t = 0; t < numTransforms; t++ )
+		for ( i = 0; i < (int) sources.size(); i++ )
+		{
+			picoBakeTarget_t &target = targets[ dests[ i ] ];
+			jobs.push_back( { sources[ i ], dests[ i ], t, target.numVertexes, target.numIndexes } );
+			target.numVertexes += sources[ i ]->numVertexes;
+			target.numIndexes += sources[ i ]->numIndexes;
+		}
+	for ( pmm::surface_t *dest : order )
+	{
+		const picoBakeTarget_t &target = targets[ dest ];
+		if ( !pmm::pp_adjust_surface( dest, target.numVertexes, target.numSTArrays, target.numColorArrays, target.numIndexes, 0 ) ) {
+			return 0;
+		}
+	}
+	for ( i = 0; i < (int) sources.size(); i++ )
+	{
+		pmm::surface_t *dest = dests[ i ];
+		if ( sources[ i ]->smoothingGroup != nullptr && !_pico_alloc_smoothing_groups( dest ) ) {
+			return 0;
+		}
+
+		/* tangents like st arrays, zero where a source has none */
+		if ( sources[ i ]->tangent != nullptr && dest->tangent == nullptr ) {
+			dest->tangent = reinterpret_cast<decltype(dest->tangent)>(pmm::man.pp_k_new( dest->maxVertexes, sizeof( *dest->tangent ) ));
+			if ( dest->tangent == nullptr ) {
+				return 0;
+			}
+		}
+	}
+
+	/* per instance normal matrices */
+	normalMatrices.resize( (pmm::size_type) numTransforms * 16 );
+	mirrors.resize( numTransforms );
+	for ( t = 0; t < numTransforms; t++ )
+		mirrors[ t ] = _pico_normal_matrix( transforms[ t ], &normalMatrices[ t * 16 ] ) < 0;
+
+	/* surfaces differ a lot in size, so threads pull jobs as they go */
+	_pico_parallel_for( (int) jobs.size(), 1, [&]( int, int ){
+		int job;
+		while ( ( job = next++ ) < (int) jobs.size() )
+			_pico_bake_job( jobs[ job ], transforms[ jobs[ job ].instance ], &normalMatrices[ jobs[ job ].instance * 16 ], mirrors[ jobs[ job ].instance ] );
+	} );
+
+	pmm::pp_calc_model_bounds( out );
+	return 1;
+}
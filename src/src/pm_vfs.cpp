@@ -0,0 +1,920 @@
+/* -----------------------------------------------------------------------------
+
+   PicoModel Library
+
+   Copyright (c) 2002, Randy Reddig & seaw0lf
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification,
+   are permitted provided that the following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list
+   of conditions and the following disclaimer.
+
+   Redistributions in binary form must reproduce the above copyright notice, this
+   list of conditions and the following disclaimer in the documentation and/or
+   other materials provided with the distribution.
+
+   Neither the names of the copyright holders nor the names of its contributors may
+   be used to endorse or promote products derived from this software without
+   specific prior written permission.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+   ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+   ANY DIRECT, INDIRECT, INCidentAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+   (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+   LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+   ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   ----------------------------------------------------------------------------- */
+
+/* pk3 (zip) file system for pp_set_file_loader */
+
+#include <pmpmesh/pmpmesh.hpp>
+#include <pmpmesh/pm_internal.hpp>
+#include <cstdio>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <shared_mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define VFS_CACHE_SIZE          ( 4 * 1024 * 1024 )     /* default, decompressed bytes */
+#define VFS_CACHE_ENTRY_DIV     4                       /* larger entries than size / this are not cached */
+
+#define ZIP_EOCD_ID             0x06054b50
+#define ZIP_EOCD_SIZE           22
+#define ZIP_EOCD_SEARCH         ( ZIP_EOCD_SIZE + 0xffff )  /* the archive comment comes last */
+#define ZIP_DIR_ID              0x02014b50
+#define ZIP_DIR_SIZE            46
+#define ZIP_LOCAL_ID            0x04034b50
+#define ZIP_LOCAL_SIZE          30
+
+#define ZIP_STORED              0
+#define ZIP_DEFLATED            8
+#define ZIP_MAX_RATIO           1032                    /* deflate expands at most 258 bytes per 2 bits */
+
+#define INFLATE_FAST_BITS       10
+#define INFLATE_MAX_BITS        15
+
+
+
+/* one archive added with pp_vfs_add_pak */
+class picoVfsPak_t
+{
+public:
+	std::string path;
+	int priority;
+};
+
+/* where a file lives inside its archive */
+class picoVfsEntry_t
+{
+public:
+	int pak;
+	unsigned int localOfs;                      /* local file header */
+	unsigned int compSize;
+	unsigned int size;
+	unsigned int crc;
+	int method;
+};
+
+/* a recently inflated file */
+class picoVfsCached_t
+{
+public:
+	std::string name;
+	pmm::ub8_t                  *buffer;
+	int size;
+};
+
+/* the index is read by every pp_vfs_load_file and written by pp_vfs_add_pak */
+static std::shared_mutex _pico_vfs_mutex;
+static std::vector<picoVfsPak_t> _pico_vfs_paks;
+static std::unordered_map<std::string, picoVfsEntry_t> _pico_vfs_files;
+static unsigned long _pico_vfs_generation;              /* bumped by every index change, see _vfs_cache_put */
+
+/* lru, most recent first */
+static std::mutex _pico_vfs_cache_mutex;
+static std::list<picoVfsCached_t> _pico_vfs_cache;
+static std::unordered_map<std::string, std::list<picoVfsCached_t>::iterator> _pico_vfs_cache_index;
+static pmm::size_type _pico_vfs_cache_size = VFS_CACHE_SIZE;
+static pmm::size_type _pico_vfs_cache_used;
+
+/* canonical huffman code, see _inflate_build */
+class picoInflateCode_t
+{
+public:
+	unsigned short fast[ 1 << INFLATE_FAST_BITS ];  /* ( length << 9 ) | symbol, 0 for longer codes */
+	unsigned short firstCode[ INFLATE_MAX_BITS + 2 ];
+	unsigned short firstSymbol[ INFLATE_MAX_BITS + 2 ];
+	int maxCode[ INFLATE_MAX_BITS + 2 ];        /* left aligned to 16 bits */
+	unsigned short symbols[ 288 ];              /* sorted by code */
+};
+
+/* one inflate call */
+class picoInflate_t
+{
+public:
+	const pmm::ub8_t            *in;
+	const pmm::ub8_t            *inEnd;
+	pmm::ub8_t                  *out;
+	pmm::ub8_t                  *outStart;
+	pmm::ub8_t                  *outEnd;
+	unsigned long long bits;
+	int numBits;
+	int pad;                                    /* zero bytes fed past the end of the input */
+	int error;
+};
+
+static const unsigned short _inflate_length_base[ 29 ] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const unsigned char _inflate_length_extra[ 29 ] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const unsigned short _inflate_dist_base[ 30 ] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const unsigned char _inflate_dist_extra[ 30 ] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const unsigned char _inflate_lengths_order[ 19 ] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+
+
+/* ----------------------------------------------------------------------------
+   inflate (rfc 1951)
+   ---------------------------------------------------------------------------- */
+
+/* _inflate_reverse:
+ *  reverses the low 'n' bits of 'v', huffman codes are stored msb first
+ */
+static int _inflate_reverse( int v, int n ){
+	int r = 0;
+
+	for ( int i = 0; i < n; i++ )
+	{
+		r = ( r << 1 ) | ( v & 1 );
+		v >>= 1;
+	}
+	return r;
+}
+
+/* _inflate_refill:
+ *  tops up the bit buffer. a broken stream may read a little past its end,
+ *  zeros are fed then and too many of them fail the stream
+ */
+static void _inflate_refill( picoInflate_t *z ){
+#if !GDEF_ARCH_ENDIAN_BIG
+	unsigned long long word;
+
+	/* whole bytes at once away from the end */
+	if ( z->inEnd - z->in >= 8 ) {
+		memcpy( &word, z->in, 8 );
+		z->bits |= word << z->numBits;
+		z->in += ( 63 - z->numBits ) >> 3;
+		z->numBits |= 56;
+		return;
+	}
+#endif
+	while ( z->numBits <= 56 )
+	{
+		if ( z->in < z->inEnd ) {
+			z->bits |= (unsigned long long) *z->in++ << z->numBits;
+		}
+		else if ( ++z->pad > 8 ) {
+			z->error = 1;
+			return;
+		}
+		z->numBits += 8;
+	}
+}
+
+static int _inflate_bits( picoInflate_t *z, int n ){
+	int v;
+
+	if ( z->numBits < n ) {
+		_inflate_refill( z );
+	}
+	v = (int) ( z->bits & ( ( 1ull << n ) - 1 ) );
+	z->bits >>= n;
+	z->numBits -= n;
+	return v;
+}
+
+/* _inflate_build:
+ *  builds a decoder from code lengths, returns 0 for an oversubscribed code.
+ *  incomplete codes are allowed, their missing codes fail in _inflate_decode
+ */
+static int _inflate_build( picoInflateCode_t *code, const unsigned char *lengths, int num ){
+	int count[ INFLATE_MAX_BITS + 1 ] = { 0 };
+	int next[ INFLATE_MAX_BITS + 1 ];
+	int c, k, s, j;
+
+
+	memset( code->fast, 0, sizeof( code->fast ) );
+	for ( int i = 0; i < num; i++ )
+		count[ lengths[ i ] ]++;
+	count[ 0 ] = 0;
+
+	c = 0;
+	k = 0;
+	for ( int i = 1; i <= INFLATE_MAX_BITS; i++ )
+	{
+		next[ i ] = c;
+		code->firstCode[ i ] = (unsigned short) c;
+		code->firstSymbol[ i ] = (unsigned short) k;
+		c += count[ i ];
+		if ( count[ i ] != 0 && c - 1 >= ( 1 << i ) ) {
+			return 0;
+		}
+		code->maxCode[ i ] = c << ( 16 - i );
+		c <<= 1;
+		k += count[ i ];
+	}
+	code->maxCode[ INFLATE_MAX_BITS + 1 ] = 0x10000;
+
+	for ( int i = 0; i < num; i++ )
+	{
+		s = lengths[ i ];
+		if ( s == 0 ) {
+			continue;
+		}
+		code->symbols[ next[ s ] - code->firstCode[ s ] + code->firstSymbol[ s ] ] = (unsigned short) i;
+		if ( s <= INFLATE_FAST_BITS ) {
+			for ( j = _inflate_reverse( next[ s ], s ); j < ( 1 << INFLATE_FAST_BITS ); j += 1 << s )
+				code->fast[ j ] = (unsigned short) ( ( s << 9 ) | i );
+		}
+		next[ s ]++;
+	}
+	return 1;
+}
+
+/* _inflate_decode:
+ *  reads one symbol, -1 on a code that is not in the table
+ */
+static int _inflate_decode( picoInflate_t *z, const picoInflateCode_t *code ){
+	int f, k, s;
+
+
+	if ( z->numBits < 16 ) {
+		_inflate_refill( z );
+	}
+
+	/* short codes in one lookup */
+	f = code->fast[ z->bits & ( ( 1 << INFLATE_FAST_BITS ) - 1 ) ];
+	if ( f != 0 ) {
+		s = f >> 9;
+		z->bits >>= s;
+		z->numBits -= s;
+		return f & 511;
+	}
+
+	/* longer ones walk the lengths */
+	k = _inflate_reverse( (int) ( z->bits & 0xffff ), 16 );
+	for ( s = INFLATE_FAST_BITS + 1; k >= code->maxCode[ s ]; s++ ) ;
+	if ( s > INFLATE_MAX_BITS ) {
+		return -1;
+	}
+	z->bits >>= s;
+	z->numBits -= s;
+	return code->symbols[ ( k >> ( 16 - s ) ) - code->firstCode[ s ] + code->firstSymbol[ s ] ];
+}
+
+/* _inflate_stored:
+ *  copies a stored block
+ */
+static int _inflate_stored( picoInflate_t *z ){
+	int len, nlen, unread;
+
+
+	/* to the byte boundary */
+	_inflate_bits( z, z->numBits & 7 );
+	len = _inflate_bits( z, 16 );
+	nlen = _inflate_bits( z, 16 );
+	if ( z->error || len != ( ~nlen & 0xffff ) || len > z->outEnd - z->out ) {
+		return 0;
+	}
+
+	/* hand the whole bytes left in the bit buffer back to the input */
+	unread = z->numBits / 8 - z->pad;
+	if ( unread < 0 ) {
+		return 0;
+	}
+	z->in -= unread;
+	z->bits = 0;
+	z->numBits = 0;
+	z->pad = 0;
+
+	if ( len > z->inEnd - z->in ) {
+		return 0;
+	}
+	memcpy( z->out, z->in, len );
+	z->out += len;
+	z->in += len;
+	return 1;
+}
+
+/* _inflate_dynamic:
+ *  reads the code lengths of a dynamic huffman block
+ */
+static int _inflate_dynamic( picoInflate_t *z, picoInflateCode_t *lit, picoInflateCode_t *dist ){
+	unsigned char lengths[ 286 + 32 ];
+	unsigned char lengthsLengths[ 19 ] = { 0 };
+	picoInflateCode_t lengthsCode;
+	int numLit, numDist, numLengths;
+	int n, sym, rep, fill;
+
+
+	numLit = _inflate_bits( z, 5 ) + 257;
+	numDist = _inflate_bits( z, 5 ) + 1;
+	numLengths = _inflate_bits( z, 4 ) + 4;
+	if ( numLit > 286 || numDist > 30 ) {
+		return 0;
+	}
+	for ( int i = 0; i < numLengths; i++ )
+		lengthsLengths[ _inflate_lengths_order[ i ] ] = (unsigned char) _inflate_bits( z, 3 );
+	if ( !_inflate_build( &lengthsCode, lengthsLengths, 19 ) ) {
+		return 0;
+	}
+
+	/* literal and distance lengths run together */
+	n = 0;
+	while ( n < numLit + numDist )
+	{
+		sym = _inflate_decode( z, &lengthsCode );
+		if ( sym < 0 || z->error ) {
+			return 0;
+		}
+		if ( sym < 16 ) {
+			lengths[ n++ ] = (unsigned char) sym;
+			continue;
+		}
+		if ( sym == 16 ) {
+			if ( n == 0 ) {
+				return 0;
+			}
+			fill = lengths[ n - 1 ];
+			rep = _inflate_bits( z, 2 ) + 3;
+		}
+		else if ( sym == 17 ) {
+			fill = 0;
+			rep = _inflate_bits( z, 3 ) + 3;
+		}
+		else {
+			fill = 0;
+			rep = _inflate_bits( z, 7 ) + 11;
+		}
+		if ( n + rep > numLit + numDist ) {
+			return 0;
+		}
+		memset( lengths + n, fill, rep );
+		n += rep;
+	}
+	if ( lengths[ 256 ] == 0 ) {
+		return 0;
+	}
+	return _inflate_build( lit, lengths, numLit ) && _inflate_build( dist, lengths + numLit, numDist );
+}
+
+/* _inflate_codes:
+ *  decodes one huffman block
+ */
+static int _inflate_codes( picoInflate_t *z, const picoInflateCode_t *lit, const picoInflateCode_t *dist ){
+	int sym, len, d;
+	pmm::ub8_t *from;
+
+
+	for ( ;; )
+	{
+		sym = _inflate_decode( z, lit );
+		if ( sym < 0 || z->error ) {
+			return 0;
+		}
+		if ( sym < 256 ) {
+			if ( z->out >= z->outEnd ) {
+				return 0;
+			}
+			*z->out++ = (pmm::ub8_t) sym;
+			continue;
+		}
+		if ( sym == 256 ) {
+			return 1;
+		}
+
+		/* length and distance back into the output */
+		sym -= 257;
+		if ( sym >= 29 ) {
+			return 0;
+		}
+		len = _inflate_length_base[ sym ] + _inflate_bits( z, _inflate_length_extra[ sym ] );
+		sym = _inflate_decode( z, dist );
+		if ( sym < 0 || sym >= 30 ) {
+			return 0;
+		}
+		d = _inflate_dist_base[ sym ] + _inflate_bits( z, _inflate_dist_extra[ sym ] );
+		if ( z->error || d > z->out - z->outStart || len > z->outEnd - z->out ) {
+			return 0;
+		}
+		from = z->out - d;
+		if ( d == 1 ) {
+			memset( z->out, *from, len );
+		}
+		else if ( d >= len ) {
+			memcpy( z->out, from, len );
+		}
+		else {
+			/* overlapping, repeats the last 'd' bytes */
+			int i = 0;
+			if ( d >= 8 ) {
+				for ( ; i + 8 <= len; i += 8 )
+					memcpy( z->out + i, from + i, 8 );
+			}
+			for ( ; i < len; i++ )
+				z->out[ i ] = from[ i ];
+		}
+		z->out += len;
+	}
+}
+
+/* _pico_inflate:
+ *  decompresses a raw deflate stream into exactly 'outSize' bytes
+ */
+static int _pico_inflate( const pmm::ub8_t *in, int inSize, pmm::ub8_t *out, int outSize ){
+	picoInflate_t z;
+	picoInflateCode_t *lit, *dist;
+	unsigned char lengths[ 288 ];
+	int final, type, ok;
+
+
+	/* the codes are too big for a loader thread's stack */
+	lit = reinterpret_cast<decltype(lit)>( pmm::man.pp_m_new( 2 * sizeof( *lit ) ) );
+	if ( lit == nullptr ) {
+		return 0;
+	}
+	dist = lit + 1;
+
+	memset( &z, 0, sizeof( z ) );
+	z.in = in;
+	z.inEnd = in + inSize;
+	z.out = z.outStart = out;
+	z.outEnd = out + outSize;
+
+	do
+	{
+		final = _inflate_bits( &z, 1 );
+		type = _inflate_bits( &z, 2 );
+		if ( type == 0 ) {
+			ok = _inflate_stored( &z );
+		}
+		else if ( type == 1 ) {
+			memset( lengths, 8, 144 );
+			memset( lengths + 144, 9, 112 );
+			memset( lengths + 256, 7, 24 );
+			memset( lengths + 280, 8, 8 );
+			_inflate_build( lit, lengths, 288 );
+			memset( lengths, 5, 30 );
+			_inflate_build( dist, lengths, 30 );
+			ok = _inflate_codes( &z, lit, dist );
+		}
+		else if ( type == 2 ) {
+			ok = _inflate_dynamic( &z, lit, dist ) && _inflate_codes( &z, lit, dist );
+		}
+		else {
+			ok = 0;
+		}
+	}
+	while ( ok && !final && !z.error );
+
+	pmm::man.pp_m_delete( lit );
+	/* the padding must not have been eaten */
+	return ok && !z.error && z.numBits >= z.pad * 8 && z.out == z.outEnd;
+}
+
+
+
+/* ----------------------------------------------------------------------------
+   helpers
+   ---------------------------------------------------------------------------- */
+
+static unsigned int _vfs_u2( const pmm::ub8_t *bp ){
+	return bp[ 0 ] | ( bp[ 1 ] << 8 );
+}
+
+static unsigned int _vfs_u4( const pmm::ub8_t *bp ){
+	return bp[ 0 ] | ( bp[ 1 ] << 8 ) | ( bp[ 2 ] << 16 ) | ( (unsigned int) bp[ 3 ] << 24 );
+}
+
+/* _vfs_crc:
+ *  zip crc-32, eight bytes per step (slicing by 8)
+ */
+static unsigned int _vfs_crc( const pmm::ub8_t *buffer, int size ){
+	static const class picoVfsCrcTable_t
+	{
+	public:
+		unsigned int t[ 8 ][ 256 ];
+		picoVfsCrcTable_t(){
+			for ( unsigned int i = 0; i < 256; i++ )
+			{
+				unsigned int c = i;
+				for ( int k = 0; k < 8; k++ )
+					c = ( c & 1 ) ? 0xedb88320u ^ ( c >> 1 ) : c >> 1;
+				t[ 0 ][ i ] = c;
+			}
+			for ( unsigned int i = 0; i < 256; i++ )
+				for ( int k = 1; k < 8; k++ )
+					t[ k ][ i ] = t[ 0 ][ t[ k - 1 ][ i ] & 0xff ] ^ ( t[ k - 1 ][ i ] >> 8 );
+		}
+	} table;
+	const unsigned int ( *t )[ 256 ] = table.t;
+	unsigned int crc = 0xffffffffu;
+	unsigned int a, b;
+	int i = 0;
+
+	for ( ; i + 8 <= size; i += 8 )
+	{
+		a = _vfs_u4( buffer + i ) ^ crc;
+		b = _vfs_u4( buffer + i + 4 );
+		crc = t[ 7 ][ a & 0xff ] ^ t[ 6 ][ ( a >> 8 ) & 0xff ] ^ t[ 5 ][ ( a >> 16 ) & 0xff ] ^ t[ 4 ][ a >> 24 ] ^
+			  t[ 3 ][ b & 0xff ] ^ t[ 2 ][ ( b >> 8 ) & 0xff ] ^ t[ 1 ][ ( b >> 16 ) & 0xff ] ^ t[ 0 ][ b >> 24 ];
+	}
+	for ( ; i < size; i++ )
+		crc = t[ 0 ][ ( crc ^ buffer[ i ] ) & 0xff ] ^ ( crc >> 8 );
+	return crc ^ 0xffffffffu;
+}
+
+/* _vfs_name:
+ *  archive paths are case insensitive and use forward slashes
+ */
+static std::string _vfs_name( const char *name ){
+	std::string s;
+
+	while ( *name == '/' || *name == '\\' || ( name[ 0 ] == '.' && ( name[ 1 ] == '/' || name[ 1 ] == '\\' ) ) )
+		name += *name == '.' ? 2 : 1;
+	s = name;
+	for ( char &c : s )
+	{
+		if ( c == '\\' ) {
+			c = '/';
+		}
+		else if ( c >= 'A' && c <= 'Z' ) {
+			c += 'a' - 'A';
+		}
+	}
+	return s;
+}
+
+/* _vfs_read:
+ *  reads 'size' bytes at 'ofs'. each read opens the archive on its own,
+ *  so loader threads never wait for each other here
+ */
+static int _vfs_read( const std::string &path, long ofs, pmm::ub8_t *buffer, int size ){
+	FILE *f;
+	int ok;
+
+	f = fopen( path.c_str(), "rb" );
+	if ( f == nullptr ) {
+		return 0;
+	}
+	ok = fseek( f, ofs, SEEK_SET ) == 0 && fread( buffer, 1, size, f ) == (size_t) size;
+	fclose( f );
+	return ok;
+}
+
+/* _vfs_cache_trim:
+ *  drops the oldest entries until the cache fits. called with the cache mutex held
+ */
+static void _vfs_cache_trim( pmm::size_type size ){
+	while ( _pico_vfs_cache_used > size )
+	{
+		picoVfsCached_t &cached = _pico_vfs_cache.back();
+		_pico_vfs_cache_used -= cached.size;
+		_pico_vfs_cache_index.erase( cached.name );
+		pmm::man.pp_m_delete( cached.buffer );
+		_pico_vfs_cache.pop_back();
+	}
+}
+
+/* _vfs_cache_get:
+ *  copies a cached file into a new buffer, -1 when it is not cached
+ */
+static int _vfs_cache_get( const std::string &name, pmm::ub8_t **buffer ){
+	std::lock_guard<std::mutex> lock( _pico_vfs_cache_mutex );
+	std::unordered_map<std::string, std::list<picoVfsCached_t>::iterator>::iterator it;
+
+	it = _pico_vfs_cache_index.find( name );
+	if ( it == _pico_vfs_cache_index.end() ) {
+		return -1;
+	}
+	_pico_vfs_cache.splice( _pico_vfs_cache.begin(), _pico_vfs_cache, it->second );
+	*buffer = reinterpret_cast<pmm::ub8_t *>( pmm::man.pp_m_new( it->second->size + 1 ) );
+	if ( *buffer == nullptr ) {
+		return -1;
+	}
+	memcpy( *buffer, it->second->buffer, it->second->size );
+	return it->second->size;
+}
+
+/* _vfs_cache_put:
+ *  keeps a copy of a small file. a file looked up before the index last
+ *  changed may be overridden by now, so it is not kept
+ */
+static void _vfs_cache_put( const std::string &name, unsigned long generation, const pmm::ub8_t *buffer, int size ){
+	std::shared_lock<std::shared_mutex> indexLock( _pico_vfs_mutex );
+	std::lock_guard<std::mutex> lock( _pico_vfs_cache_mutex );
+	picoVfsCached_t cached;
+
+	if ( generation != _pico_vfs_generation ) {
+		return;
+	}
+	if ( size == 0 || (pmm::size_type) size > _pico_vfs_cache_size / VFS_CACHE_ENTRY_DIV || _pico_vfs_cache_index.count( name ) ) {
+		return;
+	}
+	cached.buffer = reinterpret_cast<pmm::ub8_t *>( pmm::man.pp_m_new( size ) );
+	if ( cached.buffer == nullptr ) {
+		return;
+	}
+	memcpy( cached.buffer, buffer, size );
+	cached.name = name;
+	cached.size = size;
+	_vfs_cache_trim( _pico_vfs_cache_size - size );
+	_pico_vfs_cache.push_front( cached );
+	_pico_vfs_cache_index[ name ] = _pico_vfs_cache.begin();
+	_pico_vfs_cache_used += size;
+}
+
+static void _vfs_cache_clear( void ){
+	std::lock_guard<std::mutex> lock( _pico_vfs_cache_mutex );
+
+	_vfs_cache_trim( 0 );
+}
+
+/* frees the cache when the library goes away */
+static class _pico_vfs_guard_t
+{
+public:
+	~_pico_vfs_guard_t(){
+		_vfs_cache_clear();
+	}
+} _pico_vfs_guard;
+
+
+
+/* ----------------------------------------------------------------------------
+   public functions
+   ---------------------------------------------------------------------------- */
+
+/*
+   pmm::pp_vfs_add_pak()
+   indexes the central directory of a pk3 or zip. a file found in several
+   archives comes from the one with the highest priority, equal priorities
+   go to the archive added last. entries with sizes the archive cannot hold
+   are skipped. returns the number of files indexed or -1
+ */
+
+int pmm::pp_vfs_add_pak( const char *path, int priority ){
+	FILE *f;
+	long fileSize, tailOfs;
+	int tailSize, dirSize, numFiles, nameLen, pak, numIndexed, numBroken;
+	unsigned int dirOfs, flags;
+	pmm::ub8_t *tail, *dir, *bp, *eocd;
+	picoVfsEntry_t entry;
+	std::string name;
+
+
+	if ( path == nullptr ) {
+		pmm::man.pp_print( pmm::pl_error, "pmm::pp_vfs_add_pak: No path given (path == nullptr)" );
+		return -1;
+	}
+
+	f = fopen( path, "rb" );
+	if ( f == nullptr ) {
+		pmm::man.pp_print( pmm::pl_error, ( std::ostringstream{} << "pmm::pp_vfs_add_pak: Can't open " << path ).str() );
+		return -1;
+	}
+
+	/* find the end of central directory record, searching back over the comment */
+	fseek( f, 0, SEEK_END );
+	fileSize = ftell( f );
+	tailSize = fileSize < ZIP_EOCD_SEARCH ? (int) fileSize : ZIP_EOCD_SEARCH;
+	tailOfs = fileSize - tailSize;
+	tail = reinterpret_cast<pmm::ub8_t *>( pmm::man.pp_m_new( tailSize + 1 ) );
+	if ( tail == nullptr || fseek( f, tailOfs, SEEK_SET ) != 0 || fread( tail, 1, tailSize, f ) != (size_t) tailSize ) {
+		pmm::man.pp_m_delete( tail );
+		fclose( f );
+		pmm::man.pp_print( pmm::pl_error, ( std::ostringstream{} << "pmm::pp_vfs_add_pak: Can't read " << path ).str() );
+		return -1;
+	}
+	eocd = nullptr;
+	for ( bp = tail + tailSize - ZIP_EOCD_SIZE; bp >= tail; bp-- )
+	{
+		if ( _vfs_u4( bp ) == ZIP_EOCD_ID ) {
+			eocd = bp;
+			break;
+		}
+	}
+	if ( eocd == nullptr || _vfs_u2( eocd + 10 ) == 0xffff ) {
+		pmm::man.pp_m_delete( tail );
+		fclose( f );
+		pmm::man.pp_print( pmm::pl_error, ( std::ostringstream{} << "pmm::pp_vfs_add_pak: " << path << " is not a zip archive (or zip64)" ).str() );
+		return -1;
+	}
+	numFiles = _vfs_u2( eocd + 10 );
+	dirSize = _vfs_u4( eocd + 12 );
+	dirOfs = _vfs_u4( eocd + 16 );
+	pmm::man.pp_m_delete( tail );
+
+	/* read the central directory */
+	if ( dirSize < 0 || (long) dirOfs + dirSize > fileSize ) {
+		fclose( f );
+		pmm::man.pp_print( pmm::pl_error, ( std::ostringstream{} << "pmm::pp_vfs_add_pak: " << path << " has a broken central directory" ).str() );
+		return -1;
+	}
+	dir = reinterpret_cast<pmm::ub8_t *>( pmm::man.pp_m_new( dirSize + 1 ) );
+	if ( dir == nullptr || fseek( f, dirOfs, SEEK_SET ) != 0 || fread( dir, 1, dirSize, f ) != (size_t) dirSize ) {
+		pmm::man.pp_m_delete( dir );
+		fclose( f );
+		pmm::man.pp_print( pmm::pl_error, ( std::ostringstream{} << "pmm::pp_vfs_add_pak: Can't read " << path ).str() );
+		return -1;
+	}
+	fclose( f );
+
+	std::unique_lock<std::shared_mutex> lock( _pico_vfs_mutex );
+
+	pak = (int) _pico_vfs_paks.size();
+	_pico_vfs_paks.push_back( { path, priority } );
+	_pico_vfs_generation++;
+	numIndexed = 0;
+	numBroken = 0;
+
+	bp = dir;
+	for ( int i = 0; i < numFiles; i++ )
+	{
+		if ( bp + ZIP_DIR_SIZE > dir + dirSize || _vfs_u4( bp ) != ZIP_DIR_ID ) {
+			pmm::man.pp_print( pmm::pl_warning, ( std::ostringstream{} << "pmm::pp_vfs_add_pak: " << path << " has a broken central directory" ).str() );
+			break;
+		}
+		nameLen = _vfs_u2( bp + 28 );
+		if ( bp + ZIP_DIR_SIZE + nameLen > dir + dirSize ) {
+			break;
+		}
+		flags = _vfs_u2( bp + 8 );
+		entry.pak = pak;
+		entry.method = _vfs_u2( bp + 10 );
+		entry.crc = _vfs_u4( bp + 16 );
+		entry.compSize = _vfs_u4( bp + 20 );
+		entry.size = _vfs_u4( bp + 24 );
+		entry.localOfs = _vfs_u4( bp + 42 );
+		name.assign( reinterpret_cast<const char *>( bp + ZIP_DIR_SIZE ), nameLen );
+		bp += ZIP_DIR_SIZE + nameLen + _vfs_u2( bp + 30 ) + _vfs_u2( bp + 32 );
+
+		/* skip directories and encrypted files */
+		if ( name.empty() || name.back() == '/' || ( flags & 1 ) ) {
+			continue;
+		}
+
+		/* sizes the archive cannot hold, so a tiny file never asks for a huge buffer */
+		if ( (unsigned long long) entry.localOfs + entry.compSize > (unsigned long long) fileSize ||
+			 ( entry.method == ZIP_STORED && entry.size != entry.compSize ) ||
+			 ( entry.method == ZIP_DEFLATED && entry.size > (unsigned long long) entry.compSize * ZIP_MAX_RATIO ) ) {
+			numBroken++;
+			continue;
+		}
+		name = _vfs_name( name.c_str() );
+
+		/* overrides */
+		auto it = _pico_vfs_files.find( name );
+		if ( it != _pico_vfs_files.end() ) {
+			if ( _pico_vfs_paks[ it->second.pak ].priority > priority ) {
+				continue;
+			}
+			it->second = entry;
+		}
+		else {
+			_pico_vfs_files.emplace( name, entry );
+		}
+		numIndexed++;
+	}
+	pmm::man.pp_m_delete( dir );
+	lock.unlock();
+
+	if ( numBroken > 0 ) {
+		pmm::man.pp_print( pmm::pl_warning, ( std::ostringstream{} << "pmm::pp_vfs_add_pak: Skipped " << numBroken << " entries with impossible sizes in " << path ).str() );
+	}
+
+	/* cached files may be overridden now */
+	_vfs_cache_clear();
+	return numIndexed;
+}
+
+/*
+   pmm::pp_vfs_load_file()
+   a file loader for pmm::man.pp_set_file_loader(). returns the size of the
+   file with the buffer zero terminated, or -1 when no archive has it. safe
+   to call from several threads
+ */
+
+int pmm::pp_vfs_load_file( const std::string &fileName, pmm::ub8_t **buffer ){
+	picoVfsEntry_t entry;
+	std::string name, path;
+	unsigned long generation;
+	pmm::ub8_t local[ ZIP_LOCAL_SIZE ];
+	pmm::ub8_t *comp;
+	long dataOfs;
+	int size, ok;
+
+
+	*buffer = nullptr;
+	name = _vfs_name( fileName.c_str() );
+
+	size = _vfs_cache_get( name, buffer );
+	if ( size >= 0 ) {
+		return size;
+	}
+
+	{
+		std::shared_lock<std::shared_mutex> lock( _pico_vfs_mutex );
+		auto it = _pico_vfs_files.find( name );
+		if ( it == _pico_vfs_files.end() ) {
+			return -1;
+		}
+		entry = it->second;
+		path = _pico_vfs_paks[ entry.pak ].path;
+		generation = _pico_vfs_generation;
+	}
+
+	if ( ( entry.method != ZIP_STORED && entry.method != ZIP_DEFLATED ) || entry.size > 0x7ffffffe || entry.compSize > 0x7ffffffe ) {
+		pmm::man.pp_print( pmm::pl_error, ( std::ostringstream{} << "pmm::pp_vfs_load_file: " << fileName << " in " << path << " uses an unsupported compression" ).str() );
+		return -1;
+	}
+
+	/* the data follows the local header, whose extra field may differ from the directory's */
+	if ( !_vfs_read( path, entry.localOfs, local, ZIP_LOCAL_SIZE ) || _vfs_u4( local ) != ZIP_LOCAL_ID ) {
+		pmm::man.pp_print( pmm::pl_error, ( std::ostringstream{} << "pmm::pp_vfs_load_file: Can't read " << fileName << " from " << path ).str() );
+		return -1;
+	}
+	dataOfs = (long) entry.localOfs + ZIP_LOCAL_SIZE + _vfs_u2( local + 26 ) + _vfs_u2( local + 28 );
+
+	*buffer = reinterpret_cast<pmm::ub8_t *>( pmm::man.pp_m_new( entry.size + 1 ) );
+	if ( *buffer == nullptr ) {
+		return -1;
+	}
+	if ( entry.method == ZIP_STORED ) {
+		ok = entry.compSize == entry.size && _vfs_read( path, dataOfs, *buffer, entry.size );
+	}
+	else {
+		comp = reinterpret_cast<pmm::ub8_t *>( pmm::man.pp_m_new( entry.compSize + 1 ) );
+		ok = comp != nullptr && _vfs_read( path, dataOfs, comp, entry.compSize ) && _pico_inflate( comp, entry.compSize, *buffer, entry.size );
+		pmm::man.pp_m_delete( comp );
+	}
+	if ( !ok || _vfs_crc( *buffer, entry.size ) != entry.crc ) {
+		pmm::man.pp_m_delete( *buffer );
+		*buffer = nullptr;
+		pmm::man.pp_print( pmm::pl_error, ( std::ostringstream{} << "pmm::pp_vfs_load_file: " << fileName << " in " << path << " is corrupt" ).str() );
+		return -1;
+	}
+
+	_vfs_cache_put( name, generation, *buffer, entry.size );
+	return entry.size;
+}
+
+/*
+   pmm::pp_vfs_set_cache_size()
+   bytes of recently loaded files kept decompressed, 0 turns the cache off
+ */
+
+void pmm::pp_vfs_set_cache_size( pmm::size_type bytes ){
+	std::lock_guard<std::mutex> lock( _pico_vfs_cache_mutex );
+
+	_pico_vfs_cache_size = bytes;
+	_vfs_cache_trim( bytes );
+}
+
+/*
+   pmm::pp_vfs_clear()
+   forgets all archives
+ */
+
+void pmm::pp_vfs_clear( void ){
+	{
+		std::lock_guard<std::shared_mutex> lock( _pico_vfs_mutex );
+		_pico_vfs_paks.clear();
+		_pico_vfs_files.clear();
+		_pico_vfs_generation++;
+	}
+	_vfs_cache_clear();
+}
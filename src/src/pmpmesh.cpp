@@ -35,9 +35,15 @@
 #include <pmpmesh/pmpmesh.hpp>
 #include <pmpmesh/pm_internal.hpp>
 #include <algorithm>
+#include <cfloat>
 #include <iostream>
+#include <new>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 ///////////////////////////////////////////////////////////////////////////
 
@@ -49,8 +55,8 @@ int pmm::pp_manager::pp_init()
 
 void pmm::pp_manager::pp_close()
 {
-	// todo
-	return;
+	// stop the pp_load_model_async workers
+	_pico_async_shutdown();
 }
 
 int pmm::pp_manager::pp_error()
@@ -124,6 +130,19 @@ int pmm::pp_manager::pp_load_file(const std::string & name__, pmm::ub8_t ** buff
 	return __file_loader(name__, buffer__);
 }
 
+void pmm::pp_manager::pp_set_num_threads(int num_threads__)
+{
+	this->__num_threads = num_threads__ < 0 ? 0 : num_threads__;
+}
+
+int pmm::pp_manager::pp_num_threads() const
+{
+	if (__num_threads > 0)
+		return __num_threads;
+	int num_threads = static_cast<int>(std::thread::hardware_concurrency());
+	return num_threads > 0 ? num_threads : 1;
+}
+
 void pmm::pp_manager::pp_print(pmm::print_level level__, const std::string & str__) const
 {
 	std::string sub = str__;
@@ -134,26 +153,117 @@ void pmm::pp_manager::pp_print(pmm::print_level level__, const std::string & str
 
 ///////////////////////////////////////////////////////////////////////////
 
-pmm::model_t *PicoModuleLoadModel( const pmm::module_t* pm, const char* fileName, pmm::ub8_t* buffer, int bufSize, int frameNum ){
+/* _pico_load_flags:
+ *  the lf_* bits of 'options', with the geometry and bounds modes
+ *  turning on every skip
+ */
+int _pico_load_flags( const pmm::load_options_t *options ){
+	if ( options == nullptr ) {
+		return 0;
+	}
+	if ( options->mode != pmm::lm_full ) {
+		return options->flags | pmm::lf_skip_normals | pmm::lf_skip_st | pmm::lf_skip_colors | pmm::lf_skip_materials | pmm::lf_skip_remap;
+	}
+	return options->flags;
+}
+
+/* _pico_load_surface:
+ *  whether the surface filter of 'options' keeps a surface called 'name'
+ */
+int _pico_load_surface( const pmm::load_options_t *options, const char *name ){
+	if ( options == nullptr || options->surfaceFilter == nullptr ) {
+		return 1;
+	}
+	return options->surfaceFilter( name != nullptr ? name : "", options->filterData ) != 0;
+}
+
+/* _pico_filter_surfaces:
+ *  frees the surfaces the filter of 'options' rejects. loaders skip them
+ *  up front where the name is known early, this catches the rest
+ */
+static void _pico_filter_surfaces( pmm::model_t *model, const pmm::load_options_t *options ){
+	int i, numKept;
+
+
+	if ( options == nullptr || options->surfaceFilter == nullptr ) {
+		return;
+	}
+
+	numKept = 0;
+	for ( i = 0; i < model->num_surfaces; i++ )
+	{
+		if ( _pico_load_surface( options, model->surface[ i ]->name ) ) {
+			model->surface[ numKept++ ] = model->surface[ i ];
+		}
+		else {
+			pmm::pp_free_surface( model->surface[ i ] );
+		}
+	}
+
+	if ( numKept != model->num_surfaces ) {
+		model->num_surfaces = numKept;
+		_pico_free_surface_index( model );
+	}
+}
+
+/* _pico_strip_geometry:
+ *  frees the vertexes and indexes of every surface for lm_bounds,
+ *  keeping names, shaders and bounds
+ */
+static void _pico_strip_geometry( pmm::model_t *model ){
+	int i;
+
+
+	for ( i = 0; i < model->num_surfaces; i++ )
+	{
+		pmm::surface_t *surface = model->surface[ i ];
+
+		_pico_free_float_vertexes( surface );
+		_pico_free_vertex_index( surface );
+		pmm::man.pp_m_delete( surface->smoothingGroup );
+		pmm::man.pp_m_delete( surface->index );
+		pmm::man.pp_m_delete( surface->faceNormal );
+		pmm::man.pp_m_delete( surface->faceDist );
+		surface->smoothingGroup = nullptr;
+		surface->index = nullptr;
+		surface->faceNormal = nullptr;
+		surface->faceDist = nullptr;
+		surface->numVertexes = surface->maxVertexes = 0;
+		surface->numIndexes = surface->maxIndexes = 0;
+		surface->numFaceNormals = surface->maxFaceNormals = 0;
+	}
+}
+
+pmm::model_t *PicoModuleLoadModel( const pmm::module_t* pm, const char* fileName, pmm::ub8_t* buffer, int bufSize, int frameNum, const pmm::load_options_t *options ){
 	char                *modelFileName, *remapFileName;
 
 	/* see whether this module can load the model file or not */
 	if ( pm->canload( fileName, buffer, bufSize ) == pmm::pmv_ok ) {
 		/* use loader provided by module to read the model data */
-		pmm::model_t* model = pm->load( fileName, frameNum, buffer, bufSize );
+		pmm::model_t* model = pm->load( fileName, frameNum, buffer, bufSize, options );
 		if ( model == nullptr ) {
-			pmm::man.pp_f_delete(buffer);
 			return nullptr;
 		}
 
 		/* assign pointer to file format module */
 		model->module = pm;
 
+		/* drop surfaces the loader could only name late */
+		_pico_filter_surfaces( model, options );
+
+		/* surface and model bounds, in one pass per surface */
+		pmm::pp_calc_model_bounds( model );
+
+		/* bounds are all the caller wants */
+		if ( options != nullptr && options->mode == pmm::lm_bounds ) {
+			_pico_strip_geometry( model );
+		}
+
 		/* get model file name */
 		modelFileName = pmm::pp_get_model_file_name( model );
 
 		/* apply model remappings from <model>.remap */
-		if ( strlen( modelFileName ) ) {
+		if ( !( _pico_load_flags( options ) & pmm::lf_skip_remap ) && strlen( modelFileName ) ) {
 			/* alloc copy of model file name */
 			remapFileName = reinterpret_cast<decltype(remapFileName)>(pmm::man.pp_m_new( strlen( modelFileName ) + 20 ));
 			if ( remapFileName != nullptr ) {
@@ -175,30 +285,13 @@ pmm::model_t *PicoModuleLoadModel( const pmm::module_t* pm, const char* fileName
 	return nullptr;
 }
 
-/*
-   pmm::pp_load_model()
-   the meat and potatoes function
+/* _pico_load_model_buffer:
+ *  runs file data through the modules until one of them loads it. the
+ *  buffer stays the caller's
  */
-
-pmm::model_t *pmm::pp_load_model( const char *fileName, int frameNum ){
-	// make sure we've got a file name
-	if ( fileName == nullptr )
-	{
-		pmm::man.pp_print(pmm::pl_error, "pmm::pp_load_model: No filename given (fileName == nullptr)");
-		return nullptr;
-	}
-
+pmm::model_t *_pico_load_model_buffer( const char *fileName, int frameNum, pmm::ub8_t *buffer, int bufSize, const pmm::load_options_t *options ){
 	const pmm::module_t  **modules, *pm;
 	pmm::model_t         *model = nullptr;
-	pmm::ub8_t          *buffer;
-
-	// load file data (buffer is allocated by host app)
-	int bufSize = pmm::man.pp_load_file(fileName, &buffer);
-
-	if ( bufSize < 0 ) {
-		pmm::man.pp_print(pmm::pl_error, (std::ostringstream{} << "pmm::pp_load_model: Failed loading model " << fileName).str());
-		return nullptr;
-	}
 
 	/* get ptr to list of supported modules */
 	modules = pmm::pp_module_list( nullptr );
@@ -220,13 +313,47 @@ pmm::model_t *pmm::pp_load_model( const char *fileName, int frameNum ){
 			continue;
 		}
 
-		model = PicoModuleLoadModel( pm, fileName, buffer, bufSize, frameNum );
+		model = PicoModuleLoadModel( pm, fileName, buffer, bufSize, frameNum, options );
 		if ( model != nullptr ) {
 			/* model was loaded, so break out of loop */
 			break;
 		}
+
+		/* a cancelled pp_load_model_async tries no further modules */
+		if ( _pico_load_cancelled() ) {
+			break;
+		}
+	}
+
+	return model;
+}
+
+/*
+   pmm::pp_load_model()
+   the meat and potatoes function. options may be nullptr
+ */
+
+pmm::model_t *pmm::pp_load_model( const char *fileName, int frameNum, const pmm::load_options_t *options ){
+	// make sure we've got a file name
+	if ( fileName == nullptr )
+	{
+		pmm::man.pp_print(pmm::pl_error, "pmm::pp_load_model: No filename given (fileName == nullptr)");
+		return nullptr;
+	}
+
+	pmm::model_t         *model;
+	pmm::ub8_t          *buffer;
+
+	// load file data (buffer is allocated by host app)
+	int bufSize = pmm::man.pp_load_file(fileName, &buffer);
+
+	if ( bufSize < 0 ) {
+		pmm::man.pp_print(pmm::pl_error, (std::ostringstream{} << "pmm::pp_load_model: Failed loading model " << fileName).str());
+		return nullptr;
 	}
 
+	model = _pico_load_model_buffer( fileName, frameNum, buffer, bufSize, options );
+
 	/* free memory used by file buffer */
 	if ( buffer ) {
 		pmm::man.pp_f_delete(buffer);
@@ -236,7 +363,7 @@ pmm::model_t *pmm::pp_load_model( const char *fileName, int frameNum ){
 	return model;
 }
 
-pmm::model_t *pmm::pp_module_load_model_stream( const pmm::module_t* module, void* inputStream, pmm::pp_input_stream_read_func inputStreamRead, pmm::size_type streamLength, int frameNum, const char *fileName ){
+pmm::model_t *pmm::pp_module_load_model_stream( const pmm::module_t* module, void* inputStream, pmm::pp_input_stream_read_func inputStreamRead, pmm::size_type streamLength, int frameNum, const char *fileName, const pmm::load_options_t *options ){
 	pmm::model_t         *model;
 	pmm::ub8_t          *buffer;
 	int bufSize;
@@ -260,17 +387,156 @@ pmm::model_t *pmm::pp_module_load_model_stream( const pmm::module_t* module, voi
 	bufSize = (int)inputStreamRead( inputStream, buffer, streamLength );
 	buffer[bufSize] = '\0';
 
-	model = PicoModuleLoadModel( module, fileName, buffer, bufSize, frameNum );
+	model = PicoModuleLoadModel( module, fileName, buffer, bufSize, frameNum, options );
 
-	if ( model != 0 ) {
-		pmm::man.pp_m_delete( buffer );
-	}
+	pmm::man.pp_m_delete( buffer );
 
 	/* return */
 	return model;
 }
 
 
+/* _pico_probe_range:
+ *  whether 'len' bytes at offset 'ofs' lie inside a file of 'bufSize' bytes
+ */
+int _pico_probe_range( int bufSize, long ofs, long len ){
+	return ofs >= 0 && len >= 0 && ofs <= (long) bufSize && len <= (long) bufSize - ofs;
+}
+
+/* _pico_probe_add_shader:
+ *  appends 'name' to the shader names of 'info' unless it is there already
+ */
+int _pico_probe_add_shader( pmm::model_info_t *info, const char *name ){
+	int i;
+
+
+	if ( name == nullptr ) {
+		return 0;
+	}
+	for ( i = 0; i < info->numShaders; i++ )
+		if ( !strcmp( info->shaderName[ i ], name ) ) {
+			return 1;
+		}
+
+	if ( info->numShaders >= info->maxShaders ) {
+		info->maxShaders += pmm::ee_grow_shaders;
+		if ( !pmm::man.pp_m_renew( (void **) &info->shaderName, info->numShaders * sizeof( *info->shaderName ), info->maxShaders * sizeof( *info->shaderName ) ) ) {
+			return 0;
+		}
+	}
+	info->shaderName[ info->numShaders ] = _pico_clone_alloc( name );
+	if ( info->shaderName[ info->numShaders ] == nullptr ) {
+		return 0;
+	}
+	info->numShaders++;
+	return 1;
+}
+
+/* _pico_probe_token:
+ *  copies the next whitespace delimited or quoted token on the current
+ *  line of a text model and returns the position after it. dest is
+ *  empty at the end of the line.
+ */
+const char *_pico_probe_token( const char *cp, const char *end, char *dest, int max ){
+	int len = 0;
+
+
+	while ( cp < end && ( *cp == ' ' || *cp == '\t' || *cp == '\r' ) )
+		cp++;
+	if ( cp < end && *cp == '"' ) {
+		for ( cp++; cp < end && *cp != '"' && *cp != '\n'; cp++ )
+			if ( len < max - 1 ) {
+				dest[ len++ ] = *cp;
+			}
+		if ( cp < end && *cp == '"' ) {
+			cp++;
+		}
+	}
+	else
+	{
+		for ( ; cp < end && *cp != ' ' && *cp != '\t' && *cp != '\r' && *cp != '\n'; cp++ )
+			if ( len < max - 1 ) {
+				dest[ len++ ] = *cp;
+			}
+	}
+	dest[ len ] = '\0';
+	return cp;
+}
+
+/*
+   pmm::pp_probe_model()
+   summarizes a model file from its headers and chunk tables, without
+   building a model. formats without a probe routine give nullptr.
+   free the result with pmm::pp_free_model_info()
+ */
+
+pmm::model_info_t *pmm::pp_probe_model( const char *fileName ){
+	const pmm::module_t  **modules, *pm;
+	pmm::model_info_t    *info = nullptr;
+	pmm::ub8_t          *buffer;
+	int bufSize;
+
+
+	if ( fileName == nullptr ) {
+		pmm::man.pp_print( pmm::pl_error, "pmm::pp_probe_model: No filename given (fileName == nullptr)" );
+		return nullptr;
+	}
+
+	bufSize = pmm::man.pp_load_file( fileName, &buffer );
+	if ( bufSize < 0 ) {
+		pmm::man.pp_print( pmm::pl_error, ( std::ostringstream{} << "pmm::pp_probe_model: Failed loading model " << fileName ).str() );
+		return nullptr;
+	}
+
+	/* first module that recognizes the file and can probe it */
+	for ( modules = pmm::pp_module_list( nullptr ); *modules != nullptr; modules++ )
+	{
+		pm = *modules;
+		if ( pm->canload == nullptr || pm->probe == nullptr ) {
+			continue;
+		}
+		if ( pm->canload( fileName, buffer, bufSize ) != pmm::pmv_ok ) {
+			continue;
+		}
+
+		info = reinterpret_cast<decltype(info)>( pmm::man.pp_m_new( sizeof( *info ) ) );
+		if ( info == nullptr ) {
+			break;
+		}
+		info->module = pm;
+		info->numFrames = 1;
+		if ( pm->probe( fileName, buffer, bufSize, info ) ) {
+			break;
+		}
+		pmm::pp_free_model_info( info );
+		info = nullptr;
+	}
+
+	if ( buffer ) {
+		pmm::man.pp_f_delete( buffer );
+	}
+	return info;
+}
+
+/*
+   pmm::pp_free_model_info()
+   frees the result of pmm::pp_probe_model()
+ */
+
+void pmm::pp_free_model_info( pmm::model_info_t *info ){
+	int i;
+
+
+	if ( info == nullptr ) {
+		return;
+	}
+	for ( i = 0; i < info->numShaders; i++ )
+		pmm::man.pp_m_delete( info->shaderName[ i ] );
+	pmm::man.pp_m_delete( info->shaderName );
+	pmm::man.pp_m_delete( info );
+}
+
+
 /* ----------------------------------------------------------------------------
    models
    ---------------------------------------------------------------------------- */
@@ -337,12 +603,161 @@ void pmm::pp_free_model( pmm::model_t *model ){
 		pmm::pp_free_surface( model->surface[ i ] );
 	free( model->surface );
 
+	/* free frame bounds */
+	if ( model->frameBounds != nullptr ) {
+		pmm::man.pp_m_delete( model->frameBounds );
+	}
+
+	/* free lookup indices */
+	_pico_free_shader_index( model );
+	_pico_free_surface_index( model );
+
 	/* free the model */
 	pmm::man.pp_m_delete( model );
 }
 
 
 
+/* _pico_copy_shader:
+ *  adds a shader to 'model' with the name, maps and colors of 'shader'
+ */
+pmm::shader_t *_pico_copy_shader( pmm::model_t *model, pmm::shader_t *shader ){
+	pmm::shader_t *dest = pmm::pp_new_shader( model );
+
+	if ( dest == nullptr ) {
+		return nullptr;
+	}
+	pmm::pp_set_shader_name( dest, shader->name );
+	pmm::pp_set_shader_map_name( dest, shader->mapName );
+	memcpy( dest->ambientColor, shader->ambientColor, sizeof( dest->ambientColor ) );
+	memcpy( dest->diffuseColor, shader->diffuseColor, sizeof( dest->diffuseColor ) );
+	memcpy( dest->specularColor, shader->specularColor, sizeof( dest->specularColor ) );
+	dest->transparency = shader->transparency;
+	dest->shininess = shader->shininess;
+	return dest;
+}
+
+/*
+   pmm::pp_copy_model()
+   makes a deep copy of a model: its shaders, and its surfaces with all
+   vertex, index and face data. the copy's surfaces use the copy's shaders
+ */
+
+pmm::model_t *pmm::pp_copy_model( pmm::model_t *model ){
+	pmm::model_t *copy;
+	int i, j;
+
+
+	/* dummy check */
+	if ( model == nullptr ) {
+		return nullptr;
+	}
+
+	/* model */
+	copy = pmm::pp_new_model();
+	if ( copy == nullptr ) {
+		return nullptr;
+	}
+	pmm::pp_set_model_name( copy, model->name );
+	pmm::pp_set_model_file_name( copy, model->fileName );
+	copy->data = model->data;
+	copy->frameNum = model->frameNum;
+	copy->numFrames = model->numFrames;
+	_pico_copy_vec( model->mins, copy->mins );
+	_pico_copy_vec( model->maxs, copy->maxs );
+	copy->module = model->module;
+	if ( model->frameBounds != nullptr ) {
+		if ( _pico_frame_bounds( copy, 0 ) == nullptr ) {
+			pmm::pp_free_model( copy );
+			return nullptr;
+		}
+		memcpy( copy->frameBounds, model->frameBounds, model->numFrames * sizeof( *copy->frameBounds ) );
+	}
+
+	/* shaders */
+	for ( i = 0; i < model->num_shaders; i++ )
+	{
+		pmm::shader_t *shader = model->shader[ i ];
+		pmm::shader_t *dest = shader != nullptr ? _pico_copy_shader( copy, shader ) : pmm::pp_new_shader( copy );
+		if ( dest == nullptr ) {
+			pmm::pp_free_model( copy );
+			return nullptr;
+		}
+	}
+
+	/* surfaces */
+	for ( i = 0; i < model->num_surfaces; i++ )
+	{
+		pmm::surface_t *surface = model->surface[ i ], *dest = pmm::pp_new_surface( copy );
+		if ( dest == nullptr ) {
+			pmm::pp_free_model( copy );
+			return nullptr;
+		}
+		if ( surface == nullptr ) {
+			continue;
+		}
+		dest->data = surface->data;
+		dest->type = surface->type;
+		pmm::pp_set_surface_name( dest, surface->name );
+		for ( j = 0; j < model->num_shaders; j++ )
+			if ( model->shader[ j ] == surface->shader && surface->shader != nullptr ) {
+				pmm::pp_set_surface_shader( dest, copy->shader[ j ] );
+				break;
+			}
+		memcpy( dest->special, surface->special, sizeof( dest->special ) );
+		dest->bounds = surface->bounds;
+
+		if ( !pmm::pp_adjust_surface( dest, surface->numVertexes, surface->numSTArrays, surface->numColorArrays, surface->numIndexes, surface->numFaceNormals ) ) {
+			pmm::pp_free_model( copy );
+			return nullptr;
+		}
+		dest->numVertexes = surface->numVertexes;
+		dest->numIndexes = surface->numIndexes;
+		if ( surface->compact != nullptr ) {
+			_pico_free_float_vertexes( dest );
+			dest->compact = _pico_copy_compact( surface );
+			if ( dest->compact == nullptr ) {
+				pmm::pp_free_model( copy );
+				return nullptr;
+			}
+		}
+		else
+		{
+			memcpy( dest->xyz, surface->xyz, surface->numVertexes * sizeof( *dest->xyz ) );
+			memcpy( dest->normal, surface->normal, surface->numVertexes * sizeof( *dest->normal ) );
+			for ( j = 0; j < surface->numSTArrays; j++ )
+				memcpy( dest->st[ j ], surface->st[ j ], surface->numVertexes * sizeof( *dest->st[ j ] ) );
+		}
+		if ( surface->smoothingGroup != nullptr ) {
+			if ( !_pico_alloc_smoothing_groups( dest ) ) {
+				pmm::pp_free_model( copy );
+				return nullptr;
+			}
+			memcpy( dest->smoothingGroup, surface->smoothingGroup, surface->numVertexes * sizeof( *dest->smoothingGroup ) );
+		}
+		for ( j = 0; j < surface->numColorArrays; j++ )
+			memcpy( dest->color[ j ], surface->color[ j ], surface->numVertexes * sizeof( *dest->color[ j ] ) );
+		memcpy( dest->index, surface->index, surface->numIndexes * sizeof( *dest->index ) );
+		if ( surface->numFaceNormals > 0 ) {
+			memcpy( dest->faceNormal, surface->faceNormal, surface->numFaceNormals * sizeof( *dest->faceNormal ) );
+			memcpy( dest->faceDist, surface->faceDist, surface->numFaceNormals * sizeof( *dest->faceDist ) );
+		}
+		if ( surface->tangent != nullptr ) {
+			dest->tangent = reinterpret_cast<decltype(dest->tangent)>(pmm::man.pp_k_new( dest->maxVertexes, sizeof( *dest->tangent ) ));
+			if ( dest->tangent == nullptr ) {
+				pmm::pp_free_model( copy );
+				return nullptr;
+			}
+			memcpy( dest->tangent, surface->tangent, surface->numVertexes * sizeof( *dest->tangent ) );
+		}
+	}
+
+	/* return the copy */
+	return copy;
+}
+
+
+
 /*
    pmm::pp_adjust_model()
    adjusts a models's memory allocations to handle the requested sizes.
@@ -398,27 +813,132 @@ int pmm::pp_adjust_model( pmm::model_t *model, int num_shaders, int num_surfaces
 
 
 
-/* ----------------------------------------------------------------------------
-   shaders
-   ---------------------------------------------------------------------------- */
+/* surfaces per thread are picked so each thread gets about this many vertexes */
+#define BOUNDS_GRAIN 65536
+
+/* _pico_calc_bounds:
+ *  box around 'count' positions and the sphere around the box center
+ */
+static void _pico_calc_bounds( pmm::vec3_t *xyz, int count, pmm::bounds_t *bounds ){
+	_pico_vec_bounds( xyz, count, bounds->mins, bounds->maxs );
+	if ( count <= 0 ) {
+		_pico_zero_vec( bounds->center );
+		bounds->radius = 0;
+		return;
+	}
+	_pico_add_vec( bounds->mins, bounds->maxs, bounds->center );
+	_pico_scale_vec( bounds->center, 0.5f, bounds->center );
+	bounds->radius = _pico_vec_radius( xyz, count, bounds->center );
+}
 
 /*
-   pmm::pp_new_shader()
-   creates a new pico shader and returns its index. -sea
+   pmm::pp_calc_surface_bounds()
+   sets a surface's box and the bounding sphere around the box center.
+   compacted surfaces can't move and keep theirs
  */
 
-pmm::shader_t *pmm::pp_new_shader( pmm::model_t *model ){
-	pmm::shader_t    *shader;
+void pmm::pp_calc_surface_bounds( pmm::surface_t *surface ){
+	/* dummy check */
+	if ( surface == nullptr || surface->compact != nullptr ) {
+		return;
+	}
+	_pico_calc_bounds( surface->xyz, surface->numVertexes, &surface->bounds );
+}
 
+/*
+   pmm::pp_calc_model_bounds()
+   sets the bounds of every surface and the model box around them. done
+   once at the end of every load; call it again after moving vertexes
+ */
 
-	/* allocate and clear */
-	shader = reinterpret_cast<decltype(shader)>(pmm::man.pp_m_new( sizeof( pmm::shader_t ) ));
-	if ( shader == nullptr ) {
-		return nullptr;
+void pmm::pp_calc_model_bounds( pmm::model_t *model ){
+	int numVertexes = 0, grain, i;
+
+
+	/* dummy check */
+	if ( model == nullptr ) {
+		return;
 	}
-	memset( shader, 0, sizeof( pmm::shader_t ) );
 
-	/* attach it to the model */
+	/* surfaces */
+	for ( i = 0; i < model->num_surfaces; i++ )
+		if ( model->surface[ i ] != nullptr ) {
+			numVertexes += model->surface[ i ]->numVertexes;
+		}
+	grain = numVertexes > 0 ? (int) ( (long long) model->num_surfaces * BOUNDS_GRAIN / numVertexes ) : model->num_surfaces;
+	_pico_parallel_for( model->num_surfaces, grain, [model]( int first, int last ){
+		for ( int i = first; i < last; i++ )
+			pmm::pp_calc_surface_bounds( model->surface[ i ] );
+	} );
+
+	/* model */
+	_pico_zero_bounds( model->mins, model->maxs );
+	for ( i = 0; i < model->num_surfaces; i++ )
+	{
+		pmm::surface_t *surface = model->surface[ i ];
+		if ( surface == nullptr || surface->numVertexes <= 0 ) {
+			continue;
+		}
+		_pico_expand_bounds( surface->bounds.mins, model->mins, model->maxs );
+		_pico_expand_bounds( surface->bounds.maxs, model->mins, model->maxs );
+	}
+}
+
+/* _pico_frame_bounds:
+ *  bounds slot of frame 'frameNum', allocating model->numFrames of them
+ *  on first use. loaders of animated formats fill these in
+ */
+pmm::bounds_t *_pico_frame_bounds( pmm::model_t *model, int frameNum ){
+	int i;
+
+	if ( model == nullptr || frameNum < 0 || frameNum >= model->numFrames ) {
+		return nullptr;
+	}
+	if ( model->frameBounds == nullptr ) {
+		model->frameBounds = reinterpret_cast<decltype(model->frameBounds)>(pmm::man.pp_k_new( model->numFrames, sizeof( *model->frameBounds ) ));
+		if ( model->frameBounds == nullptr ) {
+			return nullptr;
+		}
+		for ( i = 0; i < model->numFrames; i++ )
+			_pico_zero_bounds( model->frameBounds[ i ].mins, model->frameBounds[ i ].maxs );
+	}
+	return &model->frameBounds[ frameNum ];
+}
+
+/* _pico_set_frame_bounds:
+ *  sets the bounds of frame 'frameNum' from its 'count' vertex positions
+ */
+void _pico_set_frame_bounds( pmm::model_t *model, int frameNum, pmm::vec3_t *xyz, int count ){
+	pmm::bounds_t *bounds = _pico_frame_bounds( model, frameNum );
+
+	if ( bounds != nullptr ) {
+		_pico_calc_bounds( xyz, count, bounds );
+	}
+}
+
+
+
+/* ----------------------------------------------------------------------------
+   shaders
+   ---------------------------------------------------------------------------- */
+
+/*
+   pmm::pp_new_shader()
+   creates a new pico shader and returns its index. -sea
+ */
+
+pmm::shader_t *pmm::pp_new_shader( pmm::model_t *model ){
+	pmm::shader_t    *shader;
+
+
+	/* allocate and clear */
+	shader = reinterpret_cast<decltype(shader)>(pmm::man.pp_m_new( sizeof( pmm::shader_t ) ));
+	if ( shader == nullptr ) {
+		return nullptr;
+	}
+	memset( shader, 0, sizeof( pmm::shader_t ) );
+
+	/* attach it to the model */
 	if ( model != nullptr ) {
 		/* adjust model */
 		if ( !pmm::pp_adjust_model( model, model->num_shaders + 1, 0 ) ) {
@@ -485,28 +1005,14 @@ pmm::shader_t *pmm::pp_find_shader( pmm::model_t *model, char *name, int caseSen
 		return nullptr;
 	}
 
-	/* walk list */
-	for ( i = 0; i < model->num_shaders; i++ )
-	{
-		/* skip null shaders or shaders with null names */
-		if ( model->shader[ i ] == nullptr ||
-			 model->shader[ i ]->name == nullptr ) {
-			continue;
-		}
-
-		/* compare the shader name with name we're looking for */
-		if ( caseSensitive ) {
-			if ( !strcmp( name, model->shader[ i ]->name ) ) {
-				return model->shader[ i ];
-			}
-		}
-		else if ( !_pico_stricmp( name, model->shader[ i ]->name ) ) {
-			return model->shader[ i ];
-		}
-	}
+	/* look the name up; shaders with null names are never indexed */
+	i = _pico_shader_index_find( model, name, caseSensitive );
 
 	/* named shader not found */
-	return nullptr;
+	if ( i < 0 ) {
+		return nullptr;
+	}
+	return model->shader[ i ];
 }
 
 
@@ -530,6 +1036,7 @@ pmm::surface_t *pmm::pp_new_surface( pmm::model_t *model ){
 		return nullptr;
 	}
 	memset( surface, 0, sizeof( *surface ) );
+	_pico_zero_bounds( surface->bounds.mins, surface->bounds.maxs );
 
 	/* attach it to the model */
 	if ( model != nullptr ) {
@@ -571,8 +1078,12 @@ void pmm::pp_free_surface( pmm::surface_t *surface ){
 	pmm::man.pp_m_delete( surface->xyz );
 	pmm::man.pp_m_delete( surface->normal );
 	pmm::man.pp_m_delete( surface->smoothingGroup );
+	pmm::man.pp_m_delete( surface->tangent );
 	pmm::man.pp_m_delete( surface->index );
 	pmm::man.pp_m_delete( surface->faceNormal );
+	pmm::man.pp_m_delete( surface->faceDist );
+	pmm::man.pp_m_delete( surface->compact );
+	_pico_free_vertex_index( surface );
 
 	if ( surface->name ) {
 		pmm::man.pp_m_delete( surface->name );
@@ -595,7 +1106,9 @@ void pmm::pp_free_surface( pmm::surface_t *surface ){
 /*
    pmm::pp_adjust_surface()
    adjusts a surface's memory allocations to handle the requested sizes.
-   will always grow, never shrink
+   will always grow, never shrink. st and color arrays are only made when
+   asked for, smoothing groups and tangents only grow once a surface has
+   them; see pmm::pp_get_surface_attributes()
  */
 
 int pmm::pp_adjust_surface( pmm::surface_t *surface, int numVertexes, int numSTArrays, int numColorArrays, int numIndexes, int numFaceNormals ){
@@ -607,31 +1120,34 @@ int pmm::pp_adjust_surface( pmm::surface_t *surface, int numVertexes, int numSTA
 		return 0;
 	}
 
+	/* compacted surfaces grow as floats */
+	if ( surface->compact != nullptr && !pmm::pp_expand_surface( surface ) ) {
+		return 0;
+	}
+
 	/* bare minimums */
 	if ( numVertexes < 1 ) {
 		numVertexes = 1;
 	}
-	if ( numSTArrays < 1 ) {
-		numSTArrays = 1;
-	}
-	if ( numColorArrays < 1 ) {
-		numColorArrays = 1;
-	}
 	if ( numIndexes < 1 ) {
 		numIndexes = 1;
 	}
 
-	/* additional vertices? */
-	while ( numVertexes > surface->maxVertexes ) /* fix */
+	/* additional vertices? grow to the final size in one copy */
+	if ( numVertexes > surface->maxVertexes ) /* fix */
 	{
-		surface->maxVertexes += pmm::ee_grow_vertices;
+		while ( numVertexes > surface->maxVertexes )
+			surface->maxVertexes += pmm::ee_grow_vertices;
 		if ( !pmm::man.pp_m_renew( (void **) &surface->xyz, surface->numVertexes * sizeof( *surface->xyz ), surface->maxVertexes * sizeof( *surface->xyz ) ) ) {
 			return 0;
 		}
 		if ( !pmm::man.pp_m_renew( (void **) &surface->normal, surface->numVertexes * sizeof( *surface->normal ), surface->maxVertexes * sizeof( *surface->normal ) ) ) {
 			return 0;
 		}
-		if ( !pmm::man.pp_m_renew( (void **) &surface->smoothingGroup, surface->numVertexes * sizeof( *surface->smoothingGroup ), surface->maxVertexes * sizeof( *surface->smoothingGroup ) ) ) {
+		if ( surface->smoothingGroup != nullptr && !pmm::man.pp_m_renew( (void **) &surface->smoothingGroup, surface->numVertexes * sizeof( *surface->smoothingGroup ), surface->maxVertexes * sizeof( *surface->smoothingGroup ) ) ) {
+			return 0;
+		}
+		if ( surface->tangent != nullptr && !pmm::man.pp_m_renew( (void **) &surface->tangent, surface->numVertexes * sizeof( *surface->tangent ), surface->maxVertexes * sizeof( *surface->tangent ) ) ) {
 			return 0;
 		}
 		for ( i = 0; i < surface->numSTArrays; i++ )
@@ -639,9 +1155,12 @@ int pmm::pp_adjust_surface( pmm::surface_t *surface, int numVertexes, int numSTA
 				return 0;
 			}
 		for ( i = 0; i < surface->numColorArrays; i++ )
+		{
 			if ( !pmm::man.pp_m_renew( (void **) &surface->color[ i ], surface->numVertexes * sizeof( *surface->color[ i ] ), surface->maxVertexes * sizeof( *surface->color[ i ] ) ) ) {
 				return 0;
 			}
+			memset( surface->color[ i ] + surface->numVertexes, 255, ( surface->maxVertexes - surface->numVertexes ) * sizeof( *surface->color[ i ] ) );
+		}
 	}
 
 	/* set vertex count to higher */
@@ -674,15 +1193,16 @@ int pmm::pp_adjust_surface( pmm::surface_t *surface, int numVertexes, int numSTA
 		while ( surface->numColorArrays < numColorArrays )
 		{
 			surface->color[surface->numColorArrays] = reinterpret_cast<decltype(&*surface->color[0])>(pmm::man.pp_m_new(surface->maxVertexes * sizeof (*surface->color[0])));
-			memset( surface->color[ surface->numColorArrays ], 0, surface->maxVertexes * sizeof( *surface->color[ 0 ] ) );
+			memset( surface->color[ surface->numColorArrays ], 255, surface->maxVertexes * sizeof( *surface->color[ 0 ] ) );
 			surface->numColorArrays++;
 		}
 	}
 
 	/* additional indices? */
-	while ( numIndexes > surface->maxIndexes ) /* fix */
+	if ( numIndexes > surface->maxIndexes ) /* fix */
 	{
-		surface->maxIndexes += pmm::ee_grow_indices;
+		while ( numIndexes > surface->maxIndexes )
+			surface->maxIndexes += pmm::ee_grow_indices;
 		if ( !pmm::man.pp_m_renew( (void **) &surface->index, surface->numIndexes * sizeof( *surface->index ), surface->maxIndexes * sizeof( *surface->index ) ) ) {
 			return 0;
 		}
@@ -694,12 +1214,16 @@ int pmm::pp_adjust_surface( pmm::surface_t *surface, int numVertexes, int numSTA
 	}
 
 	/* additional face normals? */
-	while ( numFaceNormals > surface->maxFaceNormals ) /* fix */
+	if ( numFaceNormals > surface->maxFaceNormals ) /* fix */
 	{
-		surface->maxFaceNormals += pmm::ee_grow_faces;
+		while ( numFaceNormals > surface->maxFaceNormals )
+			surface->maxFaceNormals += pmm::ee_grow_faces;
 		if ( !pmm::man.pp_m_renew( (void **) &surface->faceNormal, surface->numFaceNormals * sizeof( *surface->faceNormal ), surface->maxFaceNormals * sizeof( *surface->faceNormal ) ) ) {
 			return 0;
 		}
+		if ( !pmm::man.pp_m_renew( (void **) &surface->faceDist, surface->numFaceNormals * sizeof( *surface->faceDist ), surface->maxFaceNormals * sizeof( *surface->faceDist ) ) ) {
+			return 0;
+		}
 	}
 
 	/* set face normal count to higher */
@@ -724,29 +1248,14 @@ pmm::surface_t *pmm::pp_find_surface(
 		return nullptr;
 	}
 
-	/* walk list */
-	for ( i = 0; i < model->num_surfaces; i++ )
-	{
-		/* skip null surfaces or surfaces with null names */
-		if ( model->surface[ i ] == nullptr ||
-			 model->surface[ i ]->name == nullptr ) {
-			continue;
-		}
+	/* look the name up; surfaces with null names are never indexed */
+	i = _pico_surface_index_find( model, name, caseSensitive );
 
-		/* compare the surface name with name we're looking for */
-		if ( caseSensitive ) {
-			if ( !strcmp( name,model->surface[ i ]->name ) ) {
-				return model->surface[ i ];
-			}
-		}
-		else {
-			if ( !_pico_stricmp( name,model->surface[ i ]->name ) ) {
-				return model->surface[ i ];
-			}
-		}
-	}
 	/* named surface not found */
-	return nullptr;
+	if ( i < 0 ) {
+		return nullptr;
+	}
+	return model->surface[ i ];
 }
 
 
@@ -812,11 +1321,13 @@ void pmm::pp_set_shader_name( pmm::shader_t *shader, char *name ){
 	if ( shader == nullptr || name == nullptr ) {
 		return;
 	}
+	_pico_shader_index_remove( shader );
 	if ( shader->name != nullptr ) {
 		pmm::man.pp_m_delete( shader->name );
 	}
 
 	shader->name = _pico_clone_alloc( name );
+	_pico_shader_index_add( shader );
 }
 
 
@@ -926,11 +1437,13 @@ void pmm::pp_set_surface_name( pmm::surface_t *surface, const char *name ){
 	if ( surface == nullptr || name == nullptr ) {
 		return;
 	}
+	_pico_surface_index_remove( surface );
 	if ( surface->name != nullptr ) {
 		pmm::man.pp_m_delete( surface->name );
 	}
 
 	surface->name = _pico_clone_alloc( name );
+	_pico_surface_index_add( surface );
 }
 
 
@@ -939,7 +1452,9 @@ void pmm::pp_set_surface_shader( pmm::surface_t *surface, pmm::shader_t *shader
 	if ( surface == nullptr ) {
 		return;
 	}
+	_pico_surface_index_remove( surface );
 	surface->shader = shader;
+	_pico_surface_index_add( surface );
 }
 
 
@@ -951,10 +1466,8 @@ void pmm::pp_set_surface_xyz( pmm::surface_t *surface, int num, pmm::vec3_t xyz
 	if ( !pmm::pp_adjust_surface( surface, num + 1, 0, 0, 0, 0 ) ) {
 		return;
 	}
+	_pico_vertex_index_changed( surface, num );
 	_pico_copy_vec( xyz, surface->xyz[ num ] );
-	if ( surface->model != nullptr ) {
-		_pico_expand_bounds( xyz, surface->model->mins, surface->model->maxs );
-	}
 }
 
 
@@ -966,6 +1479,7 @@ void pmm::pp_set_surface_normal( pmm::surface_t *surface, int num, pmm::vec3_t n
 	if ( !pmm::pp_adjust_surface( surface, num + 1, 0, 0, 0, 0 ) ) {
 		return;
 	}
+	_pico_vertex_index_changed( surface, num );
 	_pico_copy_vec( normal, surface->normal[ num ] );
 }
 
@@ -978,6 +1492,7 @@ void pmm::pp_set_surface_st( pmm::surface_t *surface, int array, int num, pmm::v
 	if ( !pmm::pp_adjust_surface( surface, num + 1, array + 1, 0, 0, 0 ) ) {
 		return;
 	}
+	_pico_vertex_index_changed( surface, num );
 	surface->st[ array ][ num ][ 0 ] = st[ 0 ];
 	surface->st[ array ][ num ][ 1 ] = st[ 1 ];
 }
@@ -991,6 +1506,7 @@ void pmm::pp_set_surface_color( pmm::surface_t *surface, int array, int num, pmm
 	if ( !pmm::pp_adjust_surface( surface, num + 1, 0, array + 1, 0, 0 ) ) {
 		return;
 	}
+	_pico_vertex_index_changed( surface, num );
 	surface->color[ array ][ num ][ 0 ] = color[ 0 ];
 	surface->color[ array ][ num ][ 1 ] = color[ 1 ];
 	surface->color[ array ][ num ][ 2 ] = color[ 2 ];
@@ -1034,6 +1550,23 @@ void pmm::pp_set_face_normal( pmm::surface_t *surface, int num, pmm::vec3_t norm
 }
 
 
+/* _pico_smoothing_group:
+ *  smoothing group of a vertex, 0 on surfaces without any
+ */
+static inline pmm::index_t _pico_smoothing_group( const pmm::surface_t *surface, int num ){
+	return surface->smoothingGroup != nullptr ? surface->smoothingGroup[ num ] : 0;
+}
+
+/* _pico_alloc_smoothing_groups:
+ *  gives a surface its smoothing group array, all 0, on first use
+ */
+int _pico_alloc_smoothing_groups( pmm::surface_t *surface ){
+	if ( surface->smoothingGroup == nullptr ) {
+		surface->smoothingGroup = reinterpret_cast<decltype(surface->smoothingGroup)>(pmm::man.pp_k_new( surface->maxVertexes > 0 ? surface->maxVertexes : 1, sizeof( *surface->smoothingGroup ) ));
+	}
+	return surface->smoothingGroup != nullptr;
+}
+
 void pmm::pp_set_surface_smoothing_group( pmm::surface_t *surface, int num, pmm::index_t smoothingGroup ){
 	if ( num < 0 ) {
 		return;
@@ -1041,6 +1574,10 @@ void pmm::pp_set_surface_smoothing_group( pmm::surface_t *surface, int num, pmm:
 	if ( !pmm::pp_adjust_surface( surface, num + 1, 0, 0, 0, 0 ) ) {
 		return;
 	}
+	if ( surface->smoothingGroup == nullptr && ( smoothingGroup == 0 || !_pico_alloc_smoothing_groups( surface ) ) ) {
+		return;
+	}
+	_pico_vertex_index_changed( surface, num );
 	surface->smoothingGroup[ num ] = smoothingGroup;
 }
 
@@ -1320,26 +1857,77 @@ int pmm::pp_get_surface_num_vertices( pmm::surface_t *surface ){
 
 
 
+/* xyz, normal, tangent and st getters decode a compacted vertex into a */
+/* per thread copy, good until the same getter runs again on that thread */
+
 pmm::vec_t *pmm::pp_get_surface_xyz( pmm::surface_t *surface, int num ){
+	static thread_local pmm::vec3_t decoded;
+
 	if ( surface == nullptr || num < 0 || num > surface->numVertexes ) {
 		return nullptr;
 	}
+	if ( surface->compact != nullptr ) {
+		return pmm::pp_decode_surface_xyz( surface, num, 1, &decoded ) ? decoded : nullptr;
+	}
+	if ( surface->xyz == nullptr ) {
+		return nullptr;
+	}
 	return surface->xyz[ num ];
 }
 
 
 
 pmm::vec_t *pmm::pp_get_surface_normal( pmm::surface_t *surface, int num ){
+	static thread_local pmm::vec3_t decoded;
+
 	if ( surface == nullptr || num < 0 || num > surface->numVertexes ) {
 		return nullptr;
 	}
+	if ( surface->compact != nullptr ) {
+		return pmm::pp_decode_surface_normals( surface, num, 1, &decoded ) ? decoded : nullptr;
+	}
+	if ( surface->normal == nullptr ) {
+		return nullptr;
+	}
 	return surface->normal[ num ];
 }
 
 
 
+pmm::vec_t *pmm::pp_get_surface_tangent( pmm::surface_t *surface, int num ){
+	static thread_local pmm::vec4_t decoded;
+
+	if ( surface == nullptr || num < 0 || num >= surface->numVertexes ) {
+		return nullptr;
+	}
+	if ( surface->compact != nullptr ) {
+		return pmm::pp_decode_surface_tangents( surface, num, 1, &decoded ) ? decoded : nullptr;
+	}
+	if ( surface->tangent == nullptr ) {
+		return nullptr;
+	}
+	return surface->tangent[ num ];
+}
+
+
+
+/* st and color getters hand out a per thread copy of the default for */
+/* arrays a surface doesn't have, so writing through it is harmless */
+
 pmm::vec_t *pmm::pp_get_surface_st( pmm::surface_t *surface, int array, int num  ){
-	if ( surface == nullptr || array < 0 || array > surface->numSTArrays || num < 0 || num > surface->numVertexes ) {
+	static thread_local pmm::vec2_t defaultST, decoded;
+
+	if ( surface == nullptr || array < 0 || num < 0 || num > surface->numVertexes ) {
+		return nullptr;
+	}
+	if ( array >= surface->numSTArrays ) {
+		_pico_zero_vec2( defaultST );
+		return defaultST;
+	}
+	if ( surface->compact != nullptr ) {
+		return pmm::pp_decode_surface_st( surface, array, num, 1, &decoded ) ? decoded : nullptr;
+	}
+	if ( surface->st[ array ] == nullptr ) {
 		return nullptr;
 	}
 	return surface->st[ array ][ num ];
@@ -1348,9 +1936,15 @@ pmm::vec_t *pmm::pp_get_surface_st( pmm::surface_t *surface, int array, int num
 
 
 pmm::ub8_t *pmm::pp_get_surface_color( pmm::surface_t *surface, int array, int num ){
-	if ( surface == nullptr || array < 0 || array > surface->numColorArrays || num < 0 || num > surface->numVertexes ) {
+	static thread_local pmm::color_t defaultColor;
+
+	if ( surface == nullptr || array < 0 || num < 0 || num > surface->numVertexes ) {
 		return nullptr;
 	}
+	if ( array >= surface->numColorArrays ) {
+		_pico_set_color( defaultColor, 255, 255, 255, 255 );
+		return defaultColor;
+	}
 	return surface->color[ array ][ num ];
 }
 
@@ -1389,11 +1983,48 @@ pmm::vec_t *pmm::pp_get_face_normal( pmm::surface_t *surface, int num ){
 	return surface->faceNormal[ num ];
 }
 
-pmm::index_t PicoGetSurfaceSmoothingGroup( pmm::surface_t *surface, int num ){
-	if ( surface == nullptr || num < 0 || num > surface->numVertexes ) {
+pmm::vec_t pmm::pp_get_face_dist( pmm::surface_t *surface, int num ){
+	if ( surface == nullptr || num < 0 || num >= surface->numFaceNormals ) {
+		return 0;
+	}
+	return surface->faceDist[ num ];
+}
+
+pmm::index_t pmm::pp_get_surface_smoothing_group( pmm::surface_t *surface, int num ){
+	if ( surface == nullptr || num < 0 || num >= surface->numVertexes ) {
 		return -1;
 	}
-	return surface->smoothingGroup[ num ];
+	return _pico_smoothing_group( surface, num );
+}
+
+
+
+/*
+   pmm::pp_get_surface_attributes()
+   which optional vertex streams a surface has, as surface_attribute
+   bits. the getters return defaults for the others: st 0 0, color
+   white, smoothing group 0
+ */
+
+int pmm::pp_get_surface_attributes( pmm::surface_t *surface ){
+	int attributes = 0;
+
+	if ( surface == nullptr ) {
+		return 0;
+	}
+	if ( surface->numSTArrays > 0 ) {
+		attributes |= pmm::sa_st;
+	}
+	if ( surface->numColorArrays > 0 ) {
+		attributes |= pmm::sa_color;
+	}
+	if ( surface->smoothingGroup != nullptr ) {
+		attributes |= pmm::sa_smoothing_group;
+	}
+	if ( surface->tangent != nullptr || ( surface->compact != nullptr && surface->compact->tangent != nullptr ) ) {
+		attributes |= pmm::sa_tangent;
+	}
+	return attributes;
 }
 
 
@@ -1410,556 +2041,1653 @@ int pmm::pp_get_surface_special( pmm::surface_t *surface, int num ){
    hashtable related functions
    ---------------------------------------------------------------------------- */
 
+/* hash helpers; -0 and +0 compare equal, so they must hash equal */
+static inline unsigned int _pico_hash_float( float f ){
+	unsigned int bits = 0;
+	if ( f != 0.0f ) {
+		memcpy( &bits, &f, sizeof( bits ) );
+	}
+	return bits;
+}
+
+static inline unsigned int _pico_hash_mix( unsigned int hash, unsigned int value ){
+	value *= 0xcc9e2d51u;
+	value = ( value << 15 ) | ( value >> 17 );
+	value *= 0x1b873593u;
+	hash ^= value;
+	hash = ( hash << 13 ) | ( hash >> 19 );
+	return hash * 5 + 0xe6546b64u;
+}
+
+static inline unsigned int _pico_hash_final( unsigned int hash ){
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bu;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35u;
+	hash ^= hash >> 16;
+	return hash;
+}
+
 /* hashtable code for faster vertex lookups */
-//#define HASHTABLE_size 32768 // 2048			/* power of 2, use & */
-const int HASHTABLE_size = 7919; // 32749 // 2039    /* prime, use % */
+/* robin hood open addressing: slots only hold the hash and the number of */
+/* the entry, entries live contiguously in insertion order */
+const int HASHTABLE_min_size = 1024;      /* power of 2, use & */
+const int HASHTABLE_max_load = 80;        /* percent */
+
+/* default weld tolerances, see pp_set_vertex_combination_tolerances() */
+const float HASH_XYZ_EPSILON    = 0.01f;
+const float HASH_ST_EPSILON     = 0.0001f;
+const float HASH_NORMAL_EPSILON = 0.02f;
+
+/* positions are hashed by grid cell. cells are twice the xyz epsilon wide, */
+/* so everything within epsilon of a point lies in at most 2 cells per axis */
+class pmm::pp_vertex_combination_hash_table_t
+{
+public:
+	class slot_t
+	{
+	public:
+		unsigned int hash;
+		int entry;                  /* -1 = empty */
+	};
+
+	float xyzEpsilon, normalEpsilon, stEpsilon;
+	int numSlots;
+	slot_t *slots;
+	int numEntries, maxEntries;
+	pmm::pp_vertex_comnination_hash_t *entries;
+};
+
+int pmm::pp_get_hash_table_size( pmm::pp_vertex_combination_hash_table_t *hashTable ){
+	if ( hashTable == nullptr ) {
+		return 0;
+	}
+	return hashTable->numSlots;
+}
+
+/* grid cell coordinate; out of range and nan values share cell 0 */
+static inline long long _pico_hash_cell_coord( double v ){
+	if ( !( v > -1e18 && v < 1e18 ) ) {
+		return 0;
+	}
+	return (long long) floor( v );
+}
+
+static inline unsigned int _pico_hash_cell( long long x, long long y, long long z ){
+	unsigned int hash = 0;
 
-int pmm::pp_get_hash_table_size( void ){
-	return HASHTABLE_size;
+	hash = _pico_hash_mix( hash, (unsigned int) x );
+	hash = _pico_hash_mix( hash, (unsigned int)( x >> 32 ) );
+	hash = _pico_hash_mix( hash, (unsigned int) y );
+	hash = _pico_hash_mix( hash, (unsigned int)( y >> 32 ) );
+	hash = _pico_hash_mix( hash, (unsigned int) z );
+	hash = _pico_hash_mix( hash, (unsigned int)( z >> 32 ) );
+	return _pico_hash_final( hash );
 }
 
-#define HASH_USE_EPSILON
+/* hash of the cell holding xyz; exact positions when xyzEpsilon is 0 */
+static unsigned int _pico_hash_table_xyz_hash( float xyzEpsilon, pmm::vec3_t xyz ){
+	unsigned int hash = 0;
+
+	if ( xyzEpsilon <= 0.0f ) {
+		hash = _pico_hash_mix( hash, _pico_hash_float( xyz[ 0 ] ) );
+		hash = _pico_hash_mix( hash, _pico_hash_float( xyz[ 1 ] ) );
+		hash = _pico_hash_mix( hash, _pico_hash_float( xyz[ 2 ] ) );
+		return _pico_hash_final( hash );
+	}
 
-#ifdef HASH_USE_EPSILON
-#define HASH_XYZ_EPSILON                    0.01f
-#define HASH_XYZ_EPSILONSPACE_MULTIPLIER    1.f / HASH_XYZ_EPSILON
-#define HASH_ST_EPSILON                     0.0001f
-#define HASH_NORMAL_EPSILON                 0.02f
-#endif
+	const double scale = 1.0 / ( 2.0 * xyzEpsilon );
+	return _pico_hash_cell( _pico_hash_cell_coord( xyz[ 0 ] * scale ), _pico_hash_cell_coord( xyz[ 1 ] * scale ), _pico_hash_cell_coord( xyz[ 2 ] * scale ) );
+}
 
 unsigned int pmm::pp_vertex_coord_generate_hash( pmm::vec3_t xyz ){
-	unsigned int hash = 0;
+	return _pico_hash_table_xyz_hash( HASH_XYZ_EPSILON, xyz );
+}
 
-#ifndef HASH_USE_EPSILON
-	hash += ~( *( (unsigned int*) &xyz[ 0 ] ) << 15 );
-	hash ^= ( *( (unsigned int*) &xyz[ 0 ] ) >> 10 );
-	hash += ( *( (unsigned int*) &xyz[ 1 ] ) << 3 );
-	hash ^= ( *( (unsigned int*) &xyz[ 1 ] ) >> 6 );
-	hash += ~( *( (unsigned int*) &xyz[ 2 ] ) << 11 );
-	hash ^= ( *( (unsigned int*) &xyz[ 2 ] ) >> 16 );
-#else
-	pmm::vec3_t xyz_epsilonspace;
-
-	_pico_scale_vec( xyz, HASH_XYZ_EPSILONSPACE_MULTIPLIER, xyz_epsilonspace );
-	xyz_epsilonspace[ 0 ] = (float)floor( xyz_epsilonspace[ 0 ] );
-	xyz_epsilonspace[ 1 ] = (float)floor( xyz_epsilonspace[ 1 ] );
-	xyz_epsilonspace[ 2 ] = (float)floor( xyz_epsilonspace[ 2 ] );
-
-	hash += ~( *( (unsigned int*) &xyz_epsilonspace[ 0 ] ) << 15 );
-	hash ^= ( *( (unsigned int*) &xyz_epsilonspace[ 0 ] ) >> 10 );
-	hash += ( *( (unsigned int*) &xyz_epsilonspace[ 1 ] ) << 3 );
-	hash ^= ( *( (unsigned int*) &xyz_epsilonspace[ 1 ] ) >> 6 );
-	hash += ~( *( (unsigned int*) &xyz_epsilonspace[ 2 ] ) << 11 );
-	hash ^= ( *( (unsigned int*) &xyz_epsilonspace[ 2 ] ) >> 16 );
-#endif
-
-	//hash = hash & (HASHTABLE_size-1);
-	hash = hash % ( HASHTABLE_size );
-	return hash;
+/* _pico_hash_table_new_slots:
+ *  replaces the slots of a table by 'size' empty ones
+ */
+static int _pico_hash_table_new_slots( pmm::pp_vertex_combination_hash_table_t *hashTable, int size ){
+	pmm::pp_vertex_combination_hash_table_t::slot_t *slots;
+	int i;
+
+	slots = reinterpret_cast<decltype(slots)>( pmm::man.pp_k_new( size, sizeof( *slots ) ) );
+	if ( slots == nullptr ) {
+		return 0;
+	}
+	for ( i = 0; i < size; i++ )
+		slots[ i ].entry = -1;
+	pmm::man.pp_m_delete( hashTable->slots );
+	hashTable->slots = slots;
+	hashTable->numSlots = size;
+	return 1;
 }
 
-pmm::pp_vertex_comnination_hash_t **pmm::pp_new_vertex_combination_hash_table( void ){
-	pmm::pp_vertex_comnination_hash_t ** hashTable = reinterpret_cast<decltype(hashTable)>(pmm::man.pp_m_new(HASHTABLE_size * sizeof (pmm::pp_vertex_comnination_hash_t*)));
+pmm::pp_vertex_combination_hash_table_t *pmm::pp_new_vertex_combination_hash_table( void ){
+	pmm::pp_vertex_combination_hash_table_t *hashTable;
 
-	memset( hashTable, 0, HASHTABLE_size * sizeof( pmm::pp_vertex_comnination_hash_t* ) );
+	hashTable = reinterpret_cast<decltype(hashTable)>( pmm::man.pp_m_new( sizeof( *hashTable ) ) );
+	if ( hashTable == nullptr ) {
+		return nullptr;
+	}
+	hashTable->xyzEpsilon = HASH_XYZ_EPSILON;
+	hashTable->normalEpsilon = HASH_NORMAL_EPSILON;
+	hashTable->stEpsilon = HASH_ST_EPSILON;
+	if ( !_pico_hash_table_new_slots( hashTable, HASHTABLE_min_size ) ) {
+		pmm::man.pp_m_delete( hashTable );
+		return nullptr;
+	}
 
 	return hashTable;
 }
 
-void pmm::pp_free_vertex_combination_hash_table( pmm::pp_vertex_comnination_hash_t **hashTable ){
+void pmm::pp_clear_vertex_combination_hash_table( pmm::pp_vertex_combination_hash_table_t *hashTable ){
 	int i;
-	pmm::pp_vertex_comnination_hash_t *vertexCombinationHash;
-	pmm::pp_vertex_comnination_hash_t *nextVertexCombinationHash;
 
 	/* dummy check */
 	if ( hashTable == nullptr ) {
 		return;
 	}
 
-	for ( i = 0; i < HASHTABLE_size; i++ )
+	for ( i = 0; i < hashTable->numEntries; i++ )
+		if ( hashTable->entries[ i ].data != nullptr ) {
+			pmm::man.pp_m_delete( hashTable->entries[ i ].data );
+		}
+	hashTable->numEntries = 0;
+	for ( i = 0; i < hashTable->numSlots; i++ )
+		hashTable->slots[ i ].entry = -1;
+}
+
+void pmm::pp_free_vertex_combination_hash_table( pmm::pp_vertex_combination_hash_table_t *hashTable ){
+	/* dummy check */
+	if ( hashTable == nullptr ) {
+		return;
+	}
+
+	pmm::pp_clear_vertex_combination_hash_table( hashTable );
+	pmm::man.pp_m_delete( hashTable->entries );
+	pmm::man.pp_m_delete( hashTable->slots );
+	pmm::man.pp_m_delete( hashTable );
+}
+
+/* distance of a slot from the home slot of the hash it holds */
+static inline unsigned int _pico_hash_table_probe_distance( unsigned int hash, unsigned int slot, unsigned int mask ){
+	return ( slot - hash ) & mask;
+}
+
+static void _pico_hash_table_insert_slot( pmm::pp_vertex_combination_hash_table_t *hashTable, unsigned int hash, int entry ){
+	const unsigned int mask = (unsigned int) hashTable->numSlots - 1;
+	unsigned int i, distance;
+
+	for ( i = hash & mask, distance = 0;; i = ( i + 1 ) & mask, distance++ )
 	{
-		if ( hashTable[ i ] ) {
-			nextVertexCombinationHash = nullptr;
+		pmm::pp_vertex_combination_hash_table_t::slot_t &slot = hashTable->slots[ i ];
+		unsigned int slotDistance;
 
-			for ( vertexCombinationHash = hashTable[ i ]; vertexCombinationHash; vertexCombinationHash = nextVertexCombinationHash )
-			{
-				nextVertexCombinationHash = vertexCombinationHash->next;
-				if ( vertexCombinationHash->data != nullptr ) {
-					pmm::man.pp_m_delete( vertexCombinationHash->data );
-				}
-				pmm::man.pp_m_delete( vertexCombinationHash );
-			}
+		if ( slot.entry < 0 ) {
+			slot.hash = hash;
+			slot.entry = entry;
+			return;
+		}
+
+		/* robin hood: take the slot from entries closer to their home */
+		slotDistance = _pico_hash_table_probe_distance( slot.hash, i, mask );
+		if ( slotDistance < distance ) {
+			std::swap( slot.hash, hash );
+			std::swap( slot.entry, entry );
+			distance = slotDistance;
 		}
 	}
+}
 
-	pmm::man.pp_m_delete( hashTable );
+/* _pico_hash_table_rehash:
+ *  refills the slots from the entries, growing to 'size' slots.
+ *  returns 0, with the table unchanged, if out of memory
+ */
+static int _pico_hash_table_rehash( pmm::pp_vertex_combination_hash_table_t *hashTable, int size ){
+	int i;
+
+	size = std::max( size, HASHTABLE_min_size );
+	if ( size != hashTable->numSlots ) {
+		if ( !_pico_hash_table_new_slots( hashTable, size ) ) {
+			return 0;
+		}
+	}
+	else
+	{
+		for ( i = 0; i < hashTable->numSlots; i++ )
+			hashTable->slots[ i ].entry = -1;
+	}
+	for ( i = 0; i < hashTable->numEntries; i++ )
+		_pico_hash_table_insert_slot( hashTable, _pico_hash_table_xyz_hash( hashTable->xyzEpsilon, hashTable->entries[ i ].vcd.xyz ), i );
+	return 1;
 }
 
-pmm::pp_vertex_comnination_hash_t *pmm::pp_find_vertex_combination_in_hash_table( pmm::pp_vertex_comnination_hash_t **hashTable, pmm::vec3_t xyz, pmm::vec3_t normal, pmm::vec3_t st, pmm::color_t color ){
-	unsigned int hash;
-	pmm::pp_vertex_comnination_hash_t *vertexCombinationHash;
+/*
+   pmm::pp_set_vertex_combination_tolerances()
+   sets the per component distances within which xyz, normal and st
+   count as equal. 0 means exact. entries already added are rehashed.
+ */
 
-	/* dumy check */
-	if ( hashTable == nullptr || xyz == nullptr || normal == nullptr || st == nullptr || color == nullptr ) {
-		return nullptr;
+void pmm::pp_set_vertex_combination_tolerances( pmm::pp_vertex_combination_hash_table_t *hashTable, float xyzEpsilon, float normalEpsilon, float stEpsilon ){
+	/* dummy check */
+	if ( hashTable == nullptr ) {
+		return;
 	}
 
-	hash = pmm::pp_vertex_coord_generate_hash( xyz );
+	hashTable->xyzEpsilon = std::max( xyzEpsilon, 0.0f );
+	hashTable->normalEpsilon = std::max( normalEpsilon, 0.0f );
+	hashTable->stEpsilon = std::max( stEpsilon, 0.0f );
+	_pico_hash_table_rehash( hashTable, hashTable->numSlots );
+}
+
+/* _pico_hash_table_find_in_cell:
+ *  walks the probe run of one cell hash, returns the lowest matching entry
+ *  number below 'found' or 'found'
+ */
+static int _pico_hash_table_find_in_cell( pmm::pp_vertex_combination_hash_table_t *hashTable, unsigned int hash, int found, pmm::vec3_t xyz, pmm::vec3_t normal, pmm::vec3_t st, pmm::color_t color ){
+	const unsigned int mask = (unsigned int) hashTable->numSlots - 1;
+	unsigned int i, distance;
 
-	for ( vertexCombinationHash = hashTable[ hash ]; vertexCombinationHash; vertexCombinationHash = vertexCombinationHash->next )
+	/* a slot closer to its own home than we are to ours means no entry */
+	/* with this hash can follow */
+	for ( i = hash & mask, distance = 0;; i = ( i + 1 ) & mask, distance++ )
 	{
-#ifndef HASH_USE_EPSILON
-		/* check xyz */
-		if ( ( vertexCombinationHash->vcd.xyz[ 0 ] != xyz[ 0 ] || vertexCombinationHash->vcd.xyz[ 1 ] != xyz[ 1 ] || vertexCombinationHash->vcd.xyz[ 2 ] != xyz[ 2 ] ) ) {
-			continue;
-		}
+		const pmm::pp_vertex_combination_hash_table_t::slot_t &slot = hashTable->slots[ i ];
+		const pmm::pp_vertex_comnination_hash_t *vertexCombinationHash;
 
-		/* check normal */
-		if ( ( vertexCombinationHash->vcd.normal[ 0 ] != normal[ 0 ] || vertexCombinationHash->vcd.normal[ 1 ] != normal[ 1 ] || vertexCombinationHash->vcd.normal[ 2 ] != normal[ 2 ] ) ) {
-			continue;
+		if ( slot.entry < 0 || _pico_hash_table_probe_distance( slot.hash, i, mask ) < distance ) {
+			break;
 		}
-
-		/* check st */
-		if ( vertexCombinationHash->vcd.st[ 0 ] != st[ 0 ] || vertexCombinationHash->vcd.st[ 1 ] != st[ 1 ] ) {
+		if ( slot.hash != hash || ( found >= 0 && slot.entry > found ) ) {
 			continue;
 		}
-#else
+		vertexCombinationHash = &hashTable->entries[ slot.entry ];
+
 		/* check xyz */
-		if ( ( fabs( xyz[ 0 ] - vertexCombinationHash->vcd.xyz[ 0 ] ) ) > HASH_XYZ_EPSILON ||
-			 ( fabs( xyz[ 1 ] - vertexCombinationHash->vcd.xyz[ 1 ] ) ) > HASH_XYZ_EPSILON ||
-			 ( fabs( xyz[ 2 ] - vertexCombinationHash->vcd.xyz[ 2 ] ) ) > HASH_XYZ_EPSILON ) {
+		if ( ( fabs( xyz[ 0 ] - vertexCombinationHash->vcd.xyz[ 0 ] ) ) > hashTable->xyzEpsilon ||
+			 ( fabs( xyz[ 1 ] - vertexCombinationHash->vcd.xyz[ 1 ] ) ) > hashTable->xyzEpsilon ||
+			 ( fabs( xyz[ 2 ] - vertexCombinationHash->vcd.xyz[ 2 ] ) ) > hashTable->xyzEpsilon ) {
 			continue;
 		}
 
 		/* check normal */
-		if ( ( fabs( normal[ 0 ] - vertexCombinationHash->vcd.normal[ 0 ] ) ) > HASH_NORMAL_EPSILON ||
-			 ( fabs( normal[ 1 ] - vertexCombinationHash->vcd.normal[ 1 ] ) ) > HASH_NORMAL_EPSILON ||
-			 ( fabs( normal[ 2 ] - vertexCombinationHash->vcd.normal[ 2 ] ) ) > HASH_NORMAL_EPSILON ) {
+		if ( ( fabs( normal[ 0 ] - vertexCombinationHash->vcd.normal[ 0 ] ) ) > hashTable->normalEpsilon ||
+			 ( fabs( normal[ 1 ] - vertexCombinationHash->vcd.normal[ 1 ] ) ) > hashTable->normalEpsilon ||
+			 ( fabs( normal[ 2 ] - vertexCombinationHash->vcd.normal[ 2 ] ) ) > hashTable->normalEpsilon ) {
 			continue;
 		}
 
 		/* check st */
-		if ( ( fabs( st[ 0 ] - vertexCombinationHash->vcd.st[ 0 ] ) ) > HASH_ST_EPSILON ||
-			 ( fabs( st[ 1 ] - vertexCombinationHash->vcd.st[ 1 ] ) ) > HASH_ST_EPSILON ) {
+		if ( ( fabs( st[ 0 ] - vertexCombinationHash->vcd.st[ 0 ] ) ) > hashTable->stEpsilon ||
+			 ( fabs( st[ 1 ] - vertexCombinationHash->vcd.st[ 1 ] ) ) > hashTable->stEpsilon ) {
 			continue;
 		}
-#endif
 
 		/* check color */
-		if ( *( (int*) vertexCombinationHash->vcd.color ) != *( (int*) color ) ) {
+		if ( memcmp( vertexCombinationHash->vcd.color, color, sizeof( pmm::color_t ) ) ) {
 			continue;
 		}
 
 		/* gotcha */
-		return vertexCombinationHash;
+		found = slot.entry;
 	}
 
-	return nullptr;
+	return found;
 }
 
-pmm::pp_vertex_comnination_hash_t *pmm::pp_add_vertex_combination_to_hash_table( pmm::pp_vertex_comnination_hash_t **hashTable, pmm::vec3_t xyz, pmm::vec3_t normal, pmm::vec3_t st, pmm::color_t color, pmm::index_t index ){
-	unsigned int hash;
-	pmm::pp_vertex_comnination_hash_t *vertexCombinationHash;
+/*
+   pmm::pp_find_vertex_combination_in_hash_table()
+   finds the first added entry within tolerance of the given vertex. with
+   an xyz tolerance every cell that can hold a match is searched, so points
+   straddling a cell boundary still weld.
+ */
+
+pmm::pp_vertex_comnination_hash_t *pmm::pp_find_vertex_combination_in_hash_table( pmm::pp_vertex_combination_hash_table_t *hashTable, pmm::vec3_t xyz, pmm::vec3_t normal, pmm::vec3_t st, pmm::color_t color ){
+	long long lo[ 3 ], hi[ 3 ], x, y, z;
+	int found = -1;
 
 	/* dumy check */
 	if ( hashTable == nullptr || xyz == nullptr || normal == nullptr || st == nullptr || color == nullptr ) {
 		return nullptr;
 	}
 
-	vertexCombinationHash = reinterpret_cast<decltype(vertexCombinationHash)>(pmm::man.pp_m_new( sizeof( pmm::pp_vertex_comnination_hash_t ) ));
+	if ( hashTable->xyzEpsilon <= 0.0f ) {
+		found = _pico_hash_table_find_in_cell( hashTable, _pico_hash_table_xyz_hash( 0.0f, xyz ), found, xyz, normal, st, color );
+	}
+	else
+	{
+		/* cells overlapping [ xyz - epsilon, xyz + epsilon ], padded against rounding */
+		const double scale = 1.0 / ( 2.0 * hashTable->xyzEpsilon );
+		const double reach = hashTable->xyzEpsilon * 1.001;
+		for ( int i = 0; i < 3; i++ )
+		{
+			lo[ i ] = _pico_hash_cell_coord( ( xyz[ i ] - reach ) * scale );
+			hi[ i ] = _pico_hash_cell_coord( ( xyz[ i ] + reach ) * scale );
+			if ( hi[ i ] < lo[ i ] ) {
+				hi[ i ] = lo[ i ];
+			}
+		}
+		for ( x = lo[ 0 ]; x <= hi[ 0 ]; x++ )
+			for ( y = lo[ 1 ]; y <= hi[ 1 ]; y++ )
+				for ( z = lo[ 2 ]; z <= hi[ 2 ]; z++ )
+					found = _pico_hash_table_find_in_cell( hashTable, _pico_hash_cell( x, y, z ), found, xyz, normal, st, color );
+	}
+
+	return found >= 0 ? &hashTable->entries[ found ] : nullptr;
+}
+
+pmm::pp_vertex_comnination_hash_t *pmm::pp_add_vertex_combination_to_hash_table( pmm::pp_vertex_combination_hash_table_t *hashTable, pmm::vec3_t xyz, pmm::vec3_t normal, pmm::vec3_t st, pmm::color_t color, pmm::index_t index ){
+	pmm::pp_vertex_comnination_hash_t *vertexCombinationHash;
 
-	if ( !vertexCombinationHash ) {
+	/* dumy check */
+	if ( hashTable == nullptr || xyz == nullptr || normal == nullptr || st == nullptr || color == nullptr ) {
 		return nullptr;
 	}
 
-	hash = pmm::pp_vertex_coord_generate_hash( xyz );
+	/* keep the load factor in check */
+	if ( ( hashTable->numEntries + 1 ) * 100 > hashTable->numSlots * HASHTABLE_max_load ) {
+		if ( !_pico_hash_table_rehash( hashTable, hashTable->numSlots * 2 ) ) {
+			return nullptr;
+		}
+	}
+
+	/* room for the entry */
+	if ( hashTable->numEntries >= hashTable->maxEntries ) {
+		int maxEntries = std::max( hashTable->maxEntries * 2, HASHTABLE_min_size );
+		if ( !pmm::man.pp_m_renew( (void **) &hashTable->entries, hashTable->numEntries * sizeof( *hashTable->entries ), maxEntries * sizeof( *hashTable->entries ) ) ) {
+			return nullptr;
+		}
+		hashTable->maxEntries = maxEntries;
+	}
 
+	vertexCombinationHash = &hashTable->entries[ hashTable->numEntries++ ];
 	_pico_copy_vec( xyz, vertexCombinationHash->vcd.xyz );
 	_pico_copy_vec( normal, vertexCombinationHash->vcd.normal );
 	_pico_copy_vec2( st, vertexCombinationHash->vcd.st );
 	_pico_copy_color( color, vertexCombinationHash->vcd.color );
 	vertexCombinationHash->index = index;
 	vertexCombinationHash->data = nullptr;
-	vertexCombinationHash->next = hashTable[ hash ];
-	hashTable[ hash ] = vertexCombinationHash;
+
+	_pico_hash_table_insert_slot( hashTable, _pico_hash_table_xyz_hash( hashTable->xyzEpsilon, xyz ), hashTable->numEntries - 1 );
 
 	return vertexCombinationHash;
 }
 
 /* ----------------------------------------------------------------------------
-   specialized routines
+   lookup indices
    ---------------------------------------------------------------------------- */
 
-/*
-   pmm::pp_find_surfaceVertex()
-   finds a vertex matching the set parameters
-   fixme: needs non-naive algorithm
+/* vertex index: an open addressing table (linear probing, power of 2 size)
+   over the vertex pool of one surface. each slot keeps the full hash of the
+   vertex attributes, so probing only compares attributes on a hash match.
+   vertices are hashed lazily, [0, numIndexed) are in the table. */
+
+class pmm::pp_vertex_index_t
+{
+public:
+	class slot_t
+	{
+	public:
+		unsigned int hash;
+		pmm::index_t vertex;       /* -1 = empty */
+	};
+
+	int numSTs, numColors;         /* attribute layout the index was built for */
+	int numIndexed;
+	int numUsed;
+	int numSlots;
+	slot_t *slots;
+};
+
+/* position index: for every key, the ascending positions of the model's
+   shaders or surfaces stored under it. the front of a list is the match a
+   linear scan over the model would have returned first. */
+
+template<typename key_t, typename hash_t = std::hash<key_t>>
+class pp_position_index_t
+{
+public:
+	std::unordered_map<key_t, std::vector<int>, hash_t> positions;
+
+	void add( const key_t &key, int position ){
+		std::vector<int> &list = positions[ key ];
+		list.insert( std::upper_bound( list.begin(), list.end(), position ), position );
+	}
+
+	void remove( const key_t &key, int position ){
+		auto it = positions.find( key );
+		if ( it == positions.end() ) {
+			return;
+		}
+		auto at = std::lower_bound( it->second.begin(), it->second.end(), position );
+		if ( at != it->second.end() && *at == position ) {
+			it->second.erase( at );
+		}
+		if ( it->second.empty() ) {
+			positions.erase( it );
+		}
+	}
+
+	int find( const key_t &key ) const {
+		auto it = positions.find( key );
+		return it != positions.end() ? it->second.front() : -1;
+	}
+};
+
+/* shader index: name -> shader for pp_find_shader, case-insensitive names
+   are stored lowercased. shaders [0, numIndexed) of the model are indexed. */
+
+class pmm::pp_shader_index_t
+{
+public:
+	int numIndexed;
+	std::unordered_map<pmm::shader_t*, int> position;
+	pp_position_index_t<std::string> byName;
+	pp_position_index_t<std::string> byNameNoCase;
+};
+
+/* surface index: name -> surface for pp_find_surface, plus (name, shader)
+   and shader -> surface for pp_add_triangle_to_model.
+   surfaces [0, numIndexed) of the model are indexed. */
+
+class pmm::pp_surface_index_t
+{
+public:
+	class key_hash_t
+	{
+	public:
+		pmm::size_type operator()( const std::pair<std::string, pmm::shader_t*> &key ) const {
+			return std::hash<std::string>{}( key.first ) ^ ( std::hash<pmm::shader_t*>{}( key.second ) * 31u );
+		}
+	};
+
+	int numIndexed;
+	std::unordered_map<pmm::surface_t*, int> position;
+	pp_position_index_t<std::string> byName;
+	pp_position_index_t<std::string> byNameNoCase;
+	pp_position_index_t<std::pair<std::string, pmm::shader_t*>, key_hash_t> byNameShader;
+	pp_position_index_t<pmm::shader_t*> byShader;
+};
+
+static inline unsigned int _pico_hash_vec2( unsigned int hash, const pmm::vec_t *v ){
+	hash = _pico_hash_mix( hash, _pico_hash_float( v[ 0 ] ) );
+	return _pico_hash_mix( hash, _pico_hash_float( v[ 1 ] ) );
+}
+
+static inline unsigned int _pico_hash_vec3( unsigned int hash, const pmm::vec_t *v ){
+	hash = _pico_hash_vec2( hash, v );
+	return _pico_hash_mix( hash, _pico_hash_float( v[ 2 ] ) );
+}
+
+static inline unsigned int _pico_hash_color( unsigned int hash, const pmm::ub8_t *c ){
+	return _pico_hash_mix( hash, (unsigned int) c[ 0 ] | ( (unsigned int) c[ 1 ] << 8 ) | ( (unsigned int) c[ 2 ] << 16 ) | ( (unsigned int) c[ 3 ] << 24 ) );
+}
+
+/* default st/color standing in for arrays a surface does not have */
+static pmm::vec2_t _pico_default_st = { 0, 0 };
+static pmm::color_t _pico_default_color = { 255, 255, 255, 255 };
+
+static unsigned int _pico_surface_vertex_hash( pmm::surface_t *surface, int num, int numSTs, int numColors ){
+	unsigned int hash = 0;
+	int j;
+
+	hash = _pico_hash_vec3( hash, surface->xyz[ num ] );
+	hash = _pico_hash_vec3( hash, surface->normal[ num ] );
+	hash = _pico_hash_mix( hash, (unsigned int) _pico_smoothing_group( surface, num ) );
+	for ( j = 0; j < numSTs; j++ )
+		hash = _pico_hash_vec2( hash, j < surface->numSTArrays ? surface->st[ j ][ num ] : _pico_default_st );
+	for ( j = 0; j < numColors; j++ )
+		hash = _pico_hash_color( hash, j < surface->numColorArrays ? surface->color[ j ][ num ] : _pico_default_color );
+	return _pico_hash_final( hash );
+}
+
+static unsigned int _pico_query_vertex_hash( pmm::vec3_t xyz, pmm::vec3_t normal, int numSTs, pmm::vec2_t *st, int numColors, pmm::color_t *color, pmm::index_t smoothingGroup ){
+	unsigned int hash = 0;
+	int j;
+
+	hash = _pico_hash_vec3( hash, xyz );
+	hash = _pico_hash_vec3( hash, normal );
+	hash = _pico_hash_mix( hash, (unsigned int) smoothingGroup );
+	for ( j = 0; j < numSTs; j++ )
+		hash = _pico_hash_vec2( hash, st[ j ] );
+	for ( j = 0; j < numColors; j++ )
+		hash = _pico_hash_color( hash, color[ j ] );
+	return _pico_hash_final( hash );
+}
+
+void _pico_free_vertex_index( pmm::surface_t *surface ){
+	if ( surface == nullptr ) {
+		return;
+	}
+	if ( surface->vertexIndex != nullptr ) {
+		pmm::man.pp_m_delete( surface->vertexIndex->slots );
+		pmm::man.pp_m_delete( surface->vertexIndex );
+	}
+	surface->vertexIndex = nullptr;
+}
+
+/* _pico_vertex_index_changed:
+ *  called before vertex 'num' of a surface is written. overwriting a vertex
+ *  that is already hashed makes the index stale, so it is dropped and
+ *  rebuilt on the next lookup. appending vertices keeps it valid.
  */
+void _pico_vertex_index_changed( pmm::surface_t *surface, int num ){
+	if ( surface->vertexIndex != nullptr && num < surface->vertexIndex->numIndexed ) {
+		_pico_free_vertex_index( surface );
+	}
+}
 
-int pmm::pp_find_surface_vertex_num( pmm::surface_t *surface, pmm::vec3_t xyz, pmm::vec3_t normal, int numSTs, pmm::vec2_t *st, int numColors, pmm::color_t *color, pmm::index_t smoothingGroup ){
-	int i, j;
+/* _pico_vertex_index_insert:
+ *  adds a hashed vertex, growing the table as needed
+ */
+static void _pico_vertex_index_insert( pmm::pp_vertex_index_t *vertexIndex, unsigned int hash, pmm::index_t vertex ){
+	unsigned int mask, i;
+
+	/* keep the load factor at or below 1/2 */
+	if ( ( vertexIndex->numUsed + 1 ) * 2 > vertexIndex->numSlots ) {
+		pmm::pp_vertex_index_t::slot_t *old = vertexIndex->slots;
+		int numOld = vertexIndex->numSlots, j;
+
+		vertexIndex->numSlots = std::max<int>( numOld * 2, pmm::ee_grow_vertices );
+		vertexIndex->slots = reinterpret_cast<pmm::pp_vertex_index_t::slot_t *>( pmm::man.pp_k_new( vertexIndex->numSlots, sizeof( *vertexIndex->slots ) ) );
+		for ( j = 0; j < vertexIndex->numSlots; j++ )
+			vertexIndex->slots[ j ].vertex = -1;
+		vertexIndex->numUsed = 0;
+		for ( j = 0; j < numOld; j++ )
+			if ( old[ j ].vertex >= 0 ) {
+				_pico_vertex_index_insert( vertexIndex, old[ j ].hash, old[ j ].vertex );
+			}
+		pmm::man.pp_m_delete( old );
+	}
 
+	mask = (unsigned int) vertexIndex->numSlots - 1;
+	for ( i = hash & mask; vertexIndex->slots[ i ].vertex >= 0; i = ( i + 1 ) & mask )
+		;
+	vertexIndex->slots[ i ].hash = hash;
+	vertexIndex->slots[ i ].vertex = vertex;
+	vertexIndex->numUsed++;
+}
 
-	/* dummy check */
-	if ( surface == nullptr || surface->numVertexes <= 0 ) {
-		return -1;
+/* _pico_update_vertex_index:
+ *  returns the surface's vertex index for the given attribute layout,
+ *  (re)building it if needed and hashing any vertices appended since
+ *  the last lookup. returns nullptr if the index can't be allocated.
+ */
+static pmm::pp_vertex_index_t *_pico_update_vertex_index( pmm::surface_t *surface, int numSTs, int numColors ){
+	pmm::pp_vertex_index_t *vertexIndex = surface->vertexIndex;
+
+	/* a different layout hashes different attributes */
+	if ( vertexIndex != nullptr && ( vertexIndex->numSTs != numSTs || vertexIndex->numColors != numColors ) ) {
+		_pico_free_vertex_index( surface );
+		vertexIndex = nullptr;
 	}
 
-	/* walk vertex list */
-	for ( i = 0; i < surface->numVertexes; i++ )
+	if ( vertexIndex == nullptr ) {
+		vertexIndex = reinterpret_cast<pmm::pp_vertex_index_t *>( pmm::man.pp_m_new( sizeof( *vertexIndex ) ) );
+		if ( vertexIndex == nullptr ) {
+			return nullptr;
+		}
+		vertexIndex->numSTs = numSTs;
+		vertexIndex->numColors = numColors;
+		surface->vertexIndex = vertexIndex;
+	}
+
+	for ( ; vertexIndex->numIndexed < surface->numVertexes; vertexIndex->numIndexed++ )
+		_pico_vertex_index_insert( vertexIndex, _pico_surface_vertex_hash( surface, vertexIndex->numIndexed, numSTs, numColors ), vertexIndex->numIndexed );
+
+	return vertexIndex;
+}
+
+/* _pico_lower_key:
+ *  key for case-insensitive lookups, folded the way _pico_stricmp compares
+ */
+static std::string _pico_lower_key( const char *name ){
+	std::string key( name );
+
+	for ( char &c : key )
+		c = (char) tolower( (unsigned char) c );
+	return key;
+}
+
+void _pico_free_shader_index( pmm::model_t *model ){
+	if ( model == nullptr ) {
+		return;
+	}
+	if ( model->shaderIndex != nullptr ) {
+		model->shaderIndex->~pp_shader_index_t();
+		pmm::man.pp_m_delete( model->shaderIndex );
+	}
+	model->shaderIndex = nullptr;
+}
+
+static void _pico_shader_index_insert( pmm::pp_shader_index_t *shaderIndex, pmm::shader_t *shader, int position ){
+	if ( shader->name == nullptr ) {
+		return;
+	}
+	shaderIndex->byName.add( shader->name, position );
+	shaderIndex->byNameNoCase.add( _pico_lower_key( shader->name ), position );
+}
+
+static void _pico_shader_index_erase( pmm::pp_shader_index_t *shaderIndex, pmm::shader_t *shader, int position ){
+	if ( shader->name == nullptr ) {
+		return;
+	}
+	shaderIndex->byName.remove( shader->name, position );
+	shaderIndex->byNameNoCase.remove( _pico_lower_key( shader->name ), position );
+}
+
+/* _pico_update_shader_index:
+ *  returns the model's shader index, indexing shaders added since the last
+ *  call. returns nullptr if the index can't be allocated
+ */
+static pmm::pp_shader_index_t *_pico_update_shader_index( pmm::model_t *model ){
+	pmm::pp_shader_index_t *shaderIndex = model->shaderIndex;
+
+	if ( shaderIndex == nullptr ) {
+		void *memory = pmm::man.pp_m_new( sizeof( *shaderIndex ) );
+		if ( memory == nullptr ) {
+			return nullptr;
+		}
+		shaderIndex = model->shaderIndex = new ( memory ) pmm::pp_shader_index_t{};
+	}
+
+	for ( ; shaderIndex->numIndexed < model->num_shaders; shaderIndex->numIndexed++ )
 	{
-		/* check xyz */
-		if ( xyz != nullptr && ( surface->xyz[ i ][ 0 ] != xyz[ 0 ] || surface->xyz[ i ][ 1 ] != xyz[ 1 ] || surface->xyz[ i ][ 2 ] != xyz[ 2 ] ) ) {
+		pmm::shader_t *shader = model->shader[ shaderIndex->numIndexed ];
+		if ( shader == nullptr ) {
 			continue;
 		}
+		shaderIndex->position.emplace( shader, shaderIndex->numIndexed );
+		_pico_shader_index_insert( shaderIndex, shader, shaderIndex->numIndexed );
+	}
 
-		/* check normal */
-		if ( normal != nullptr && ( surface->normal[ i ][ 0 ] != normal[ 0 ] || surface->normal[ i ][ 1 ] != normal[ 1 ] || surface->normal[ i ][ 2 ] != normal[ 2 ] ) ) {
-			continue;
+	return shaderIndex;
+}
+
+/* _pico_shader_index_find:
+ *  position of the first shader named 'name', -1 if there is none
+ */
+int _pico_shader_index_find( pmm::model_t *model, const char *name, int caseSensitive ){
+	pmm::pp_shader_index_t *shaderIndex = _pico_update_shader_index( model );
+	int i;
+
+	/* no index: walk list */
+	if ( shaderIndex == nullptr ) {
+		for ( i = 0; i < model->num_shaders; i++ )
+			if ( model->shader[ i ] != nullptr && model->shader[ i ]->name != nullptr &&
+				 !( caseSensitive ? strcmp( name, model->shader[ i ]->name ) : _pico_stricmp( name, model->shader[ i ]->name ) ) ) {
+				return i;
+			}
+		return -1;
+	}
+
+	if ( caseSensitive ) {
+		return shaderIndex->byName.find( name );
+	}
+	return shaderIndex->byNameNoCase.find( _pico_lower_key( name ) );
+}
+
+/* _pico_shader_index_remove, _pico_shader_index_add:
+ *  called before and after a shader's name changes. shaders that are not
+ *  indexed yet are picked up by the next update.
+ */
+void _pico_shader_index_remove( pmm::shader_t *shader ){
+	pmm::model_t *model = shader->model;
+
+	if ( model == nullptr || model->shaderIndex == nullptr ) {
+		return;
+	}
+	auto it = model->shaderIndex->position.find( shader );
+	if ( it != model->shaderIndex->position.end() ) {
+		_pico_shader_index_erase( model->shaderIndex, shader, it->second );
+	}
+}
+
+void _pico_shader_index_add( pmm::shader_t *shader ){
+	pmm::model_t *model = shader->model;
+
+	if ( model == nullptr || model->shaderIndex == nullptr ) {
+		return;
+	}
+	auto it = model->shaderIndex->position.find( shader );
+	if ( it != model->shaderIndex->position.end() ) {
+		_pico_shader_index_insert( model->shaderIndex, shader, it->second );
+	}
+}
+
+void _pico_free_surface_index( pmm::model_t *model ){
+	if ( model == nullptr ) {
+		return;
+	}
+	if ( model->surfaceIndex != nullptr ) {
+		model->surfaceIndex->~pp_surface_index_t();
+		pmm::man.pp_m_delete( model->surfaceIndex );
+	}
+	model->surfaceIndex = nullptr;
+}
+
+static void _pico_surface_index_insert( pmm::pp_surface_index_t *surfaceIndex, pmm::surface_t *surface, int position ){
+	if ( surface->name != nullptr ) {
+		surfaceIndex->byName.add( surface->name, position );
+		surfaceIndex->byNameNoCase.add( _pico_lower_key( surface->name ), position );
+		surfaceIndex->byNameShader.add( std::make_pair( std::string( surface->name ), surface->shader ), position );
+	}
+	surfaceIndex->byShader.add( surface->shader, position );
+}
+
+static void _pico_surface_index_erase( pmm::pp_surface_index_t *surfaceIndex, pmm::surface_t *surface, int position ){
+	if ( surface->name != nullptr ) {
+		surfaceIndex->byName.remove( surface->name, position );
+		surfaceIndex->byNameNoCase.remove( _pico_lower_key( surface->name ), position );
+		surfaceIndex->byNameShader.remove( std::make_pair( std::string( surface->name ), surface->shader ), position );
+	}
+	surfaceIndex->byShader.remove( surface->shader, position );
+}
+
+/* _pico_update_surface_index:
+ *  returns the model's surface index, indexing surfaces added since the last
+ *  call. returns nullptr if the index can't be allocated
+ */
+static pmm::pp_surface_index_t *_pico_update_surface_index( pmm::model_t *model ){
+	pmm::pp_surface_index_t *surfaceIndex = model->surfaceIndex;
+
+	if ( surfaceIndex == nullptr ) {
+		void *memory = pmm::man.pp_m_new( sizeof( *surfaceIndex ) );
+		if ( memory == nullptr ) {
+			return nullptr;
 		}
+		surfaceIndex = model->surfaceIndex = new ( memory ) pmm::pp_surface_index_t{};
+	}
 
-		/* check normal */
-		if ( surface->smoothingGroup[ i ] != smoothingGroup ) {
+	for ( ; surfaceIndex->numIndexed < model->num_surfaces; surfaceIndex->numIndexed++ )
+	{
+		pmm::surface_t *surface = model->surface[ surfaceIndex->numIndexed ];
+		if ( surface == nullptr ) {
 			continue;
 		}
+		surfaceIndex->position.emplace( surface, surfaceIndex->numIndexed );
+		_pico_surface_index_insert( surfaceIndex, surface, surfaceIndex->numIndexed );
+	}
 
-		/* check st */
-		if ( numSTs > 0 && st != nullptr ) {
-			for ( j = 0; j < numSTs; j++ )
-			{
-				if ( surface->st[ j ][ i ][ 0 ] != st[ j ][ 0 ] || surface->st[ j ][ i ][ 1 ] != st[ j ][ 1 ] ) {
-					break;
-				}
+	return surfaceIndex;
+}
+
+/* _pico_surface_index_find:
+ *  position of the first surface named 'name', -1 if there is none
+ */
+int _pico_surface_index_find( pmm::model_t *model, const char *name, int caseSensitive ){
+	pmm::pp_surface_index_t *surfaceIndex = _pico_update_surface_index( model );
+	int i;
+
+	/* no index: walk list */
+	if ( surfaceIndex == nullptr ) {
+		for ( i = 0; i < model->num_surfaces; i++ )
+			if ( model->surface[ i ] != nullptr && model->surface[ i ]->name != nullptr &&
+				 !( caseSensitive ? strcmp( name, model->surface[ i ]->name ) : _pico_stricmp( name, model->surface[ i ]->name ) ) ) {
+				return i;
 			}
-			if ( j != numSTs ) {
-				continue;
+		return -1;
+	}
+
+	if ( caseSensitive ) {
+		return surfaceIndex->byName.find( name );
+	}
+	return surfaceIndex->byNameNoCase.find( _pico_lower_key( name ) );
+}
+
+/* _pico_surface_index_remove, _pico_surface_index_add:
+ *  called before and after a surface's name or shader changes. surfaces
+ *  that are not indexed yet (usually the one just created) are picked up
+ *  by the next update.
+ */
+void _pico_surface_index_remove( pmm::surface_t *surface ){
+	pmm::model_t *model = surface->model;
+
+	if ( model == nullptr || model->surfaceIndex == nullptr ) {
+		return;
+	}
+	auto it = model->surfaceIndex->position.find( surface );
+	if ( it != model->surfaceIndex->position.end() ) {
+		_pico_surface_index_erase( model->surfaceIndex, surface, it->second );
+	}
+}
+
+void _pico_surface_index_add( pmm::surface_t *surface ){
+	pmm::model_t *model = surface->model;
+
+	if ( model == nullptr || model->surfaceIndex == nullptr ) {
+		return;
+	}
+	auto it = model->surfaceIndex->position.find( surface );
+	if ( it != model->surfaceIndex->position.end() ) {
+		_pico_surface_index_insert( model->surfaceIndex, surface, it->second );
+	}
+}
+
+/* _pico_find_triangle_surface:
+ *  finds the first surface using 'shader' and, if given, named 'name'
+ */
+pmm::surface_t *_pico_find_triangle_surface( pmm::model_t *model, pmm::shader_t *shader, const char *name ){
+	pmm::pp_surface_index_t *surfaceIndex = _pico_update_surface_index( model );
+	int i;
+
+	/* no index: walk list */
+	if ( surfaceIndex == nullptr ) {
+		for ( i = 0; i < model->num_surfaces; i++ )
+		{
+			pmm::surface_t *surface = model->surface[ i ];
+			if ( surface != nullptr && surface->shader == shader &&
+				 ( name == nullptr || ( surface->name != nullptr && !strcmp( surface->name, name ) ) ) ) {
+				return surface;
 			}
 		}
+		return nullptr;
+	}
 
-		/* check color */
-		if ( numColors > 0 && color != nullptr ) {
-			for ( j = 0; j < numSTs; j++ )
+	if ( name == nullptr ) {
+		i = surfaceIndex->byShader.find( shader );
+	}
+	else {
+		i = surfaceIndex->byNameShader.find( std::make_pair( std::string( name ), shader ) );
+	}
+	return i >= 0 ? model->surface[ i ] : nullptr;
+}
+
+/* ----------------------------------------------------------------------------
+   specialized routines
+   ---------------------------------------------------------------------------- */
+
+/* _pico_surface_vertex_matches:
+ *  compares vertex 'num' of a surface with the given attributes.
+ *  nullptr xyz/normal match any value.
+ */
+static int _pico_surface_vertex_matches( pmm::surface_t *surface, int num, pmm::vec3_t xyz, pmm::vec3_t normal, int numSTs, pmm::vec2_t *st, int numColors, pmm::color_t *color, pmm::index_t smoothingGroup ){
+	int j;
+
+	/* check xyz */
+	if ( xyz != nullptr && ( surface->xyz[ num ][ 0 ] != xyz[ 0 ] || surface->xyz[ num ][ 1 ] != xyz[ 1 ] || surface->xyz[ num ][ 2 ] != xyz[ 2 ] ) ) {
+		return 0;
+	}
+
+	/* check normal */
+	if ( normal != nullptr && ( surface->normal[ num ][ 0 ] != normal[ 0 ] || surface->normal[ num ][ 1 ] != normal[ 1 ] || surface->normal[ num ][ 2 ] != normal[ 2 ] ) ) {
+		return 0;
+	}
+
+	/* check smoothing group */
+	if ( _pico_smoothing_group( surface, num ) != smoothingGroup ) {
+		return 0;
+	}
+
+	/* check st */
+	for ( j = 0; j < numSTs; j++ )
+	{
+		const pmm::vec_t *vst = j < surface->numSTArrays ? surface->st[ j ][ num ] : _pico_default_st;
+		if ( vst[ 0 ] != st[ j ][ 0 ] || vst[ 1 ] != st[ j ][ 1 ] ) {
+			return 0;
+		}
+	}
+
+	/* check color */
+	for ( j = 0; j < numColors; j++ )
+	{
+		const pmm::ub8_t *vcolor = j < surface->numColorArrays ? surface->color[ j ][ num ] : _pico_default_color;
+		if ( memcmp( vcolor, color[ j ], sizeof( pmm::color_t ) ) ) {
+			return 0;
+		}
+	}
+
+	/* vertex matches */
+	return 1;
+}
+
+/* _pico_vertex_index_find:
+ *  probes a vertex index for the given attributes. duplicates may be
+ *  hashed, so the lowest matching vertex wins like in a linear search.
+ */
+static int _pico_vertex_index_find( pmm::pp_vertex_index_t *vertexIndex, pmm::surface_t *surface, unsigned int hash, pmm::vec3_t xyz, pmm::vec3_t normal, int numSTs, pmm::vec2_t *st, int numColors, pmm::color_t *color, pmm::index_t smoothingGroup ){
+	unsigned int mask, i;
+	int found = -1;
+
+	if ( vertexIndex->numSlots == 0 ) {
+		return -1;
+	}
+
+	mask = (unsigned int) vertexIndex->numSlots - 1;
+	for ( i = hash & mask; vertexIndex->slots[ i ].vertex >= 0; i = ( i + 1 ) & mask )
+	{
+		const pmm::pp_vertex_index_t::slot_t &slot = vertexIndex->slots[ i ];
+		if ( slot.hash == hash && ( found < 0 || slot.vertex < found ) &&
+			 _pico_surface_vertex_matches( surface, slot.vertex, xyz, normal, numSTs, st, numColors, color, smoothingGroup ) ) {
+			found = slot.vertex;
+		}
+	}
+
+	return found;
+}
+
+/*
+   pmm::pp_find_surface_vertex_num()
+   finds the first vertex matching the set parameters. lookups with both
+   xyz and normal go through the surface's hashed vertex index, otherwise
+   the vertex list is walked.
+ */
+
+int pmm::pp_find_surface_vertex_num( pmm::surface_t *surface, pmm::vec3_t xyz, pmm::vec3_t normal, int numSTs, pmm::vec2_t *st, int numColors, pmm::color_t *color, pmm::index_t smoothingGroup ){
+	pmm::pp_vertex_index_t *vertexIndex;
+	unsigned int hash;
+	int i;
+
+
+	/* dummy check */
+	if ( surface == nullptr || surface->numVertexes <= 0 ) {
+		return -1;
+	}
+	if ( !_pico_expand_compact( surface, "pp_find_surface_vertex_num" ) ) {
+		return -1;
+	}
+
+	/* attributes that are not compared are not hashed either */
+	if ( st == nullptr || numSTs < 0 ) {
+		numSTs = 0;
+	}
+	if ( color == nullptr || numColors < 0 ) {
+		numColors = 0;
+	}
+
+	/* wildcards can't be hashed: walk vertex list, as when the index can't be allocated */
+	vertexIndex = nullptr;
+	if ( xyz != nullptr && normal != nullptr ) {
+		vertexIndex = _pico_update_vertex_index( surface, numSTs, numColors );
+	}
+	if ( vertexIndex == nullptr ) {
+		for ( i = 0; i < surface->numVertexes; i++ )
+			if ( _pico_surface_vertex_matches( surface, i, xyz, normal, numSTs, st, numColors, color, smoothingGroup ) ) {
+				return i;
+			}
+		return -1;
+	}
+
+	hash = _pico_query_vertex_hash( xyz, normal, numSTs, st, numColors, color, smoothingGroup );
+	return _pico_vertex_index_find( vertexIndex, surface, hash, xyz, normal, numSTs, st, numColors, color, smoothingGroup );
+}
+
+
+
+
+/* vertices or triangles handed to one task by the bulk normal passes */
+#define NORMALS_GRAIN 4096
+
+/* _pico_triangle_weighted_normal:
+ *  area weighted normal of a triangle, unnormalized
+ */
+static void _pico_triangle_weighted_normal( pmm::vec3_t a, pmm::vec3_t b, pmm::vec3_t c, pmm::vec3_t normal ){
+	pmm::vec3_t ba, ca;
+
+	_pico_subtract_vec( b, a, ba );
+	_pico_subtract_vec( c, a, ca );
+	_pico_cross_vec( ca, ba, normal );
+}
+
+/* _pico_triangle_is_valid:
+ *  true if all three indexes of triangle 'tri' address a vertex
+ */
+int _pico_triangle_is_valid( pmm::surface_t *surface, int tri ){
+	pmm::index_t *index = surface->index + tri * 3;
+
+	return index[ 0 ] >= 0 && index[ 0 ] < surface->numVertexes &&
+		   index[ 1 ] >= 0 && index[ 1 ] < surface->numVertexes &&
+		   index[ 2 ] >= 0 && index[ 2 ] < surface->numVertexes;
+}
+
+void _pico_build_vertex_triangles( pmm::surface_t *surface, const int *group, picoVertexTriangles_t *adjacency ){
+	int numTriangles = surface->numIndexes / 3;
+	int i, j;
+
+	adjacency->first.assign( surface->numVertexes + 1, 0 );
+	for ( i = 0; i < numTriangles; i++ )
+		if ( _pico_triangle_is_valid( surface, i ) ) {
+			for ( j = 0; j < 3; j++ )
 			{
-				if ( *( (int*) surface->color[ j ] ) != *( (int*) color[ j ] ) ) {
-					break;
-				}
+				int v = surface->index[ i * 3 + j ];
+				adjacency->first[ ( group ? group[ v ] : v ) + 1 ]++;
 			}
-			if ( j != numColors ) {
-				continue;
+		}
+	for ( i = 0; i < surface->numVertexes; i++ )
+		adjacency->first[ i + 1 ] += adjacency->first[ i ];
+
+	/* fill in triangle order so every list comes out sorted */
+	std::vector<int> fill( adjacency->first.begin(), adjacency->first.end() - 1 );
+	adjacency->tris.resize( adjacency->first[ surface->numVertexes ] );
+	for ( i = 0; i < numTriangles; i++ )
+		if ( _pico_triangle_is_valid( surface, i ) ) {
+			for ( j = 0; j < 3; j++ )
+			{
+				int v = surface->index[ i * 3 + j ];
+				adjacency->tris[ fill[ group ? group[ v ] : v ]++ ] = i;
 			}
 		}
+}
+
+/* _pico_group_vertices:
+ *  points every vertex at the first vertex that compares equal to it.
+ *  groups are found through an open addressing table filled in vertex
+ *  order, the hashes are computed in parallel.
+ */
+template<typename hash_func_t, typename equal_func_t>
+static void _pico_group_vertices( int numVertexes, std::vector<int> &group, hash_func_t hashFunc, equal_func_t equalFunc ){
+	std::vector<unsigned int> hashes( numVertexes );
+	std::vector<int> slots;
+	unsigned int mask;
+	int i;
 
-		/* vertex matches */
-		return i;
+	_pico_parallel_for( numVertexes, NORMALS_GRAIN, [&hashes, &hashFunc]( int first, int last ){
+		for ( int i = first; i < last; i++ )
+			hashes[ i ] = hashFunc( i );
+	} );
+
+	for ( mask = 1; mask < (unsigned int) numVertexes * 2; mask <<= 1 )
+		;
+	slots.assign( mask, -1 );
+	mask--;
+
+	group.resize( numVertexes );
+	for ( i = 0; i < numVertexes; i++ )
+	{
+		unsigned int slot = hashes[ i ] & mask;
+		for ( ;; slot = ( slot + 1 ) & mask )
+		{
+			int other = slots[ slot ];
+			if ( other < 0 ) {
+				slots[ slot ] = group[ i ] = i;
+				break;
+			}
+			if ( hashes[ other ] == hashes[ i ] && equalFunc( other, i ) ) {
+				group[ i ] = other;
+				break;
+			}
+		}
 	}
-
-	/* nada */
-	return -1;
 }
 
+/* _pico_group_shared_vertices:
+ *  groups vertices with the same xyz and smoothing group
+ */
+static void _pico_group_shared_vertices( pmm::surface_t *surface, std::vector<int> &group ){
+	_pico_group_vertices( surface->numVertexes, group,
+		[surface]( int i ){
+			return _pico_hash_final( _pico_hash_mix( _pico_hash_vec3( 0, surface->xyz[ i ] ), (unsigned int) _pico_smoothing_group( surface, i ) ) );
+		},
+		[surface]( int a, int b ){
+			return surface->xyz[ a ][ 0 ] == surface->xyz[ b ][ 0 ] &&
+				   surface->xyz[ a ][ 1 ] == surface->xyz[ b ][ 1 ] &&
+				   surface->xyz[ a ][ 2 ] == surface->xyz[ b ][ 2 ] &&
+				   _pico_smoothing_group( surface, a ) == _pico_smoothing_group( surface, b );
+		} );
+}
 
+double _pico_length_vec( pmm::vec3_t vec ){
+	return sqrt( vec[ 0 ] * vec[ 0 ] + vec[ 1 ] * vec[ 1 ] + vec[ 2 ] * vec[ 2 ] );
+}
 
+#define NORMAL_UNIT_LENGTH_EPSILON 0.01
+#define FLOAT_EQUAL_EPSILON( f, other, epsilon ) ( fabs( f - other ) < epsilon )
 
-class IndexArray
-{
-public:
-	pmm::index_t* data;
-	pmm::index_t* last;
-};
-
-void indexarray_push_back( IndexArray* self, pmm::index_t value ){
-	*self->last++ = value;
+int _pico_normal_is_unit_length( pmm::vec3_t normal ){
+	return FLOAT_EQUAL_EPSILON( _pico_length_vec( normal ), 1.0, NORMAL_UNIT_LENGTH_EPSILON );
 }
 
-pmm::size_type indexarray_size( IndexArray* self ){
-	return self->last - self->data;
+int _pico_normal_within_tolerance( pmm::vec3_t normal, pmm::vec3_t other ){
+	return _pico_dot_vec( normal, other ) > 0.0f;
 }
 
-void indexarray_reserve( IndexArray* self, pmm::size_type size ){
-	self->last = reinterpret_cast<decltype(self->last)>(pmm::man.pp_k_new(size, sizeof (pmm::index_t)));
-	self->data = reinterpret_cast<decltype(self->data)>(self->last);
-}
+/*
+   pmm::pp_fix_surface_normals()
+   regenerates vertex normals that are missing or point away from the
+   smoothed normal. every vertex gets the area weighted normals of its
+   triangles, summed over all vertices sharing its xyz and smoothing group.
+ */
 
-void indexarray_clear( IndexArray* self ){
-	pmm::man.pp_m_delete( self->data );
-}
+void pmm::pp_fix_surface_normals( pmm::surface_t* surface ){
+	int numVertexes, numTriangles, i;
+	picoVertexTriangles_t adjacency;
+	std::vector<int> group;
 
-class BinaryTreeNode
-{
-public:
-	pmm::index_t left;
-	pmm::index_t right;
-};
 
-class BinaryTree
-{
-public:
-	BinaryTreeNode* data;
-	BinaryTreeNode* last;
-};
+	/* dummy check */
+	if ( surface == nullptr || surface->numVertexes <= 0 ) {
+		return;
+	}
+	if ( !_pico_expand_compact( surface, "pp_fix_surface_normals" ) ) {
+		return;
+	}
+	numVertexes = surface->numVertexes;
+	numTriangles = surface->numIndexes / 3;
 
-void binarytree_extend( BinaryTree* self ){
-	self->last->left = 0;
-	self->last->right = 0;
-	++self->last;
-}
+	/* triangle normals */
+	std::vector<pmm::vec_t> triNormals( numTriangles * 3 );
+	_pico_parallel_for( numTriangles, NORMALS_GRAIN, [surface, &triNormals]( int first, int last ){
+		for ( int i = first; i < last; i++ )
+		{
+			if ( !_pico_triangle_is_valid( surface, i ) ) {
+				continue;
+			}
+			pmm::index_t *index = surface->index + i * 3;
+			_pico_triangle_weighted_normal( surface->xyz[ index[ 0 ] ], surface->xyz[ index[ 1 ] ], surface->xyz[ index[ 2 ] ], &triNormals[ i * 3 ] );
+		}
+	} );
+
+	/* per vertex sums, gathered through the adjacency in triangle order
+	   so the result does not depend on the number of threads */
+	_pico_build_vertex_triangles( surface, nullptr, &adjacency );
+	std::vector<pmm::vec_t> normals( numVertexes * 3 );
+	pmm::vec_t *x = normals.data(), *y = x + numVertexes, *z = y + numVertexes;
+	_pico_parallel_for( numVertexes, NORMALS_GRAIN, [&adjacency, &triNormals, x, y, z]( int first, int last ){
+		for ( int i = first; i < last; i++ )
+		{
+			pmm::vec3_t sum = { 0, 0, 0 };
+			for ( int j = adjacency.first[ i ]; j < adjacency.first[ i + 1 ]; j++ )
+				_pico_add_vec( &triNormals[ adjacency.tris[ j ] * 3 ], sum, sum );
+			x[ i ] = sum[ 0 ];
+			y[ i ] = sum[ 1 ];
+			z[ i ] = sum[ 2 ];
+		}
+	} );
+
+	/* combine shared vertices: the first vertex of a group sums the group
+	   in vertex order and is normalized, then every other member copies it.
+	   the copies read other chunks, so they wait for all normalizing to end */
+	_pico_group_shared_vertices( surface, group );
+	for ( i = 0; i < numVertexes; i++ )
+		if ( group[ i ] != i ) {
+			x[ group[ i ] ] += x[ i ];
+			y[ group[ i ] ] += y[ i ];
+			z[ group[ i ] ] += z[ i ];
+		}
+	_pico_parallel_for( numVertexes, NORMALS_GRAIN, [x, y, z]( int first, int last ){
+		/* members are normalized too, the copies below overwrite them */
+		_pico_normalize_vecs( x + first, y + first, z + first, last - first );
+	} );
+	_pico_parallel_for( numVertexes, NORMALS_GRAIN, [&group, x, y, z]( int first, int last ){
+		for ( int i = first; i < last; i++ )
+			if ( group[ i ] != i ) {
+				x[ i ] = x[ group[ i ] ];
+				y[ i ] = y[ group[ i ] ];
+				z[ i ] = z[ group[ i ] ];
+			}
+	} );
 
-pmm::size_type binarytree_size( BinaryTree* self ){
-	return self->last - self->data;
+	/* keep normals that are unit length and agree with the generated one */
+	_pico_vertex_index_changed( surface, 0 );
+	_pico_parallel_for( numVertexes, NORMALS_GRAIN, [surface, x, y, z]( int first, int last ){
+		for ( int i = first; i < last; i++ )
+		{
+			pmm::vec3_t generated = { x[ i ], y[ i ], z[ i ] };
+			if ( !_pico_normal_is_unit_length( surface->normal[ i ] ) || !_pico_normal_within_tolerance( surface->normal[ i ], generated ) ) {
+				_pico_copy_vec( generated, surface->normal[ i ] );
+			}
+		}
+	} );
 }
 
-void binarytree_reserve( BinaryTree* self, pmm::size_type size ){
-	self->last = reinterpret_cast<decltype(self->last)>(pmm::man.pp_k_new(size, sizeof (BinaryTreeNode)));
-	self->data = reinterpret_cast<decltype(self->data)>(self->last);
-}
+/* _pico_copy_surface_vertex:
+ *  copies every attribute of vertex 'src' to vertex 'dest' of the same surface
+ */
+void _pico_copy_surface_vertex( pmm::surface_t *surface, int src, int dest ){
+	int j;
 
-void binarytree_clear( BinaryTree* self ){
-	pmm::man.pp_m_delete( self->data );
+	_pico_copy_vec( surface->xyz[ src ], surface->xyz[ dest ] );
+	_pico_copy_vec( surface->normal[ src ], surface->normal[ dest ] );
+	if ( surface->smoothingGroup != nullptr ) {
+		surface->smoothingGroup[ dest ] = surface->smoothingGroup[ src ];
+	}
+	if ( surface->tangent != nullptr ) {
+		_pico_copy_vec4( surface->tangent[ src ], surface->tangent[ dest ] );
+	}
+	for ( j = 0; j < surface->numSTArrays; j++ )
+		_pico_copy_vec2( surface->st[ j ][ src ], surface->st[ j ][ dest ] );
+	for ( j = 0; j < surface->numColorArrays; j++ )
+		_pico_copy_color( surface->color[ j ][ src ], surface->color[ j ][ dest ] );
 }
 
-using LessFunc = int(*)(void *, pmm::index_t, pmm::index_t);
-
-class UniqueIndices
+/* a vertex split off by pp_fix_surface_normals_crease */
+class picoCreaseSplit_t
 {
 public:
-	BinaryTree tree;
-	IndexArray indices;
-	LessFunc lessFunc;
-	void* lessData;
+	int source;     /* vertex it was split from */
+	int corner;     /* first corner using it, holds its normal */
+	int next;       /* next split of the same source, -1 = none */
 };
 
-pmm::size_type UniqueIndices_size( UniqueIndices* self ){
-	return binarytree_size( &self->tree );
-}
-
-void UniqueIndices_reserve( UniqueIndices* self, pmm::size_type size ){
-	binarytree_reserve( &self->tree, size );
-	indexarray_reserve( &self->indices, size );
-}
+/*
+   pmm::pp_fix_surface_normals_crease()
+   regenerates all vertex normals, smoothing across triangles that share a
+   position and smoothing group only while their normals are less than
+   'creaseAngle' degrees apart. vertices used on both sides of a crease are
+   split, so hard edges survive without splitting the model by hand.
+   returns 1 on success or 0 on error
+ */
 
-void UniqueIndices_init( UniqueIndices* self, LessFunc lessFunc, void* lessData ){
-	self->lessFunc = lessFunc;
-	self->lessData = lessData;
-}
+int pmm::pp_fix_surface_normals_crease( pmm::surface_t *surface, float creaseAngle ){
+	int numVertexes, numTriangles, numCorners, c;
+	float cosCrease;
+	picoVertexTriangles_t adjacency;
+	std::vector<int> group;
 
-void UniqueIndices_destroy( UniqueIndices* self ){
-	binarytree_clear( &self->tree );
-	indexarray_clear( &self->indices );
-}
 
+	/* dummy check */
+	if ( surface == nullptr ) {
+		return 0;
+	}
+	numVertexes = surface->numVertexes;
+	numTriangles = surface->numIndexes / 3;
+	numCorners = numTriangles * 3;
+	if ( numVertexes <= 0 || numTriangles <= 0 ) {
+		return 1;
+	}
+	if ( !_pico_expand_compact( surface, "pp_fix_surface_normals_crease" ) ) {
+		return 0;
+	}
 
-pmm::index_t UniqueIndices_find_or_insert( UniqueIndices* self, pmm::index_t value ){
-	pmm::index_t index = 0;
+	/* triangles are compared by the cosine between their unit normals */
+	cosCrease = (float) cos( creaseAngle * PICO_PI / 180.0 );
 
-	for (;; )
-	{
-		if ( self->lessFunc( self->lessData, value, self->indices.data[index] ) ) {
-			BinaryTreeNode* node = self->tree.data + index;
-			if ( node->left != 0 ) {
-				index = node->left;
-				continue;
-			}
-			else
-			{
-				node->left = (pmm::index_t)binarytree_size( &self->tree );
-				binarytree_extend( &self->tree );
-				indexarray_push_back( &self->indices, value );
-				return node->left;
+	/* triangle normals: area weighted for the sums, unit for the angle test */
+	std::vector<pmm::vec_t> triNormals( numTriangles * 3 ), unitNormals( numTriangles * 3 );
+	pmm::vec_t *ux = unitNormals.data(), *uy = ux + numTriangles, *uz = uy + numTriangles;
+	_pico_parallel_for( numTriangles, NORMALS_GRAIN, [surface, &triNormals, ux, uy, uz]( int first, int last ){
+		for ( int i = first; i < last; i++ )
+		{
+			pmm::vec_t *normal = &triNormals[ i * 3 ];
+			if ( _pico_triangle_is_valid( surface, i ) ) {
+				pmm::index_t *index = surface->index + i * 3;
+				_pico_triangle_weighted_normal( surface->xyz[ index[ 0 ] ], surface->xyz[ index[ 1 ] ], surface->xyz[ index[ 2 ] ], normal );
 			}
+			ux[ i ] = normal[ 0 ];
+			uy[ i ] = normal[ 1 ];
+			uz[ i ] = normal[ 2 ];
 		}
-		if ( self->lessFunc( self->lessData, self->indices.data[index], value ) ) {
-			BinaryTreeNode* node = self->tree.data + index;
-			if ( node->right != 0 ) {
-				index = node->right;
-				continue;
-			}
-			else
+		_pico_normalize_vecs( ux + first, uy + first, uz + first, last - first );
+	} );
+
+	/* triangles around every position and smoothing group */
+	_pico_group_shared_vertices( surface, group );
+	_pico_build_vertex_triangles( surface, group.data(), &adjacency );
+
+	/* corner normals: each corner sums the triangles around its position
+	   that lie within the crease angle of its own triangle */
+	std::vector<pmm::vec_t> cornerNormals( numCorners * 3 );
+	pmm::vec_t *cx = cornerNormals.data(), *cy = cx + numCorners, *cz = cy + numCorners;
+	_pico_parallel_for( numTriangles, NORMALS_GRAIN, [&]( int first, int last ){
+		for ( int i = first; i < last; i++ )
+		{
+			int valid = _pico_triangle_is_valid( surface, i );
+			for ( int j = 0; j < 3; j++ )
 			{
-				node->right = (pmm::index_t)binarytree_size( &self->tree );
-				binarytree_extend( &self->tree );
-				indexarray_push_back( &self->indices, value );
-				return node->right;
+				pmm::vec3_t sum = { 0, 0, 0 };
+				if ( valid ) {
+					int v = group[ surface->index[ i * 3 + j ] ];
+					for ( int k = adjacency.first[ v ]; k < adjacency.first[ v + 1 ]; k++ )
+					{
+						int t = adjacency.tris[ k ];
+						if ( t == i || ux[ i ] * ux[ t ] + uy[ i ] * uy[ t ] + uz[ i ] * uz[ t ] >= cosCrease ) {
+							_pico_add_vec( &triNormals[ t * 3 ], sum, sum );
+						}
+					}
+				}
+				cx[ i * 3 + j ] = sum[ 0 ];
+				cy[ i * 3 + j ] = sum[ 1 ];
+				cz[ i * 3 + j ] = sum[ 2 ];
 			}
 		}
+		_pico_normalize_vecs( cx + first * 3, cy + first * 3, cz + first * 3, ( last - first ) * 3 );
+	} );
+
+	/* hand corners to vertices in index order. the first corner of a vertex
+	   sets its normal, corners that disagree get a split copy of it */
+	std::vector<int> owner( numVertexes, -1 ), firstSplit( numVertexes, -1 );
+	std::vector<picoCreaseSplit_t> splits;
+	std::vector<std::pair<int, int>> remap;
+	auto sameNormal = [cx, cy, cz]( int a, int b ){
+		return cx[ a ] == cx[ b ] && cy[ a ] == cy[ b ] && cz[ a ] == cz[ b ];
+	};
+	for ( c = 0; c < numCorners; c++ )
+	{
+		int v, split;
 
-		return index;
+		/* degenerate corners take whatever their vertex ends up with */
+		if ( !_pico_triangle_is_valid( surface, c / 3 ) ||
+			 ( cx[ c ] == 0 && cy[ c ] == 0 && cz[ c ] == 0 ) ) {
+			continue;
+		}
+		v = surface->index[ c ];
+		if ( owner[ v ] < 0 ) {
+			owner[ v ] = c;
+			continue;
+		}
+		if ( sameNormal( owner[ v ], c ) ) {
+			continue;
+		}
+		for ( split = firstSplit[ v ]; split >= 0 && !sameNormal( splits[ split ].corner, c ); split = splits[ split ].next )
+			;
+		if ( split < 0 ) {
+			split = (int) splits.size();
+			splits.push_back( { v, c, firstSplit[ v ] } );
+			firstSplit[ v ] = split;
+		}
+		remap.emplace_back( c, numVertexes + split );
 	}
-}
 
-pmm::index_t UniqueIndices_insert( UniqueIndices* self, pmm::index_t value ){
-	if ( self->tree.data == self->tree.last ) {
-		binarytree_extend( &self->tree );
-		indexarray_push_back( &self->indices, value );
+	/* append the split vertices */
+	if ( !splits.empty() && !pmm::pp_adjust_surface( surface, numVertexes + (int) splits.size(), 0, 0, 0, 0 ) ) {
 		return 0;
 	}
-	else
+	_pico_vertex_index_changed( surface, 0 );
+	for ( c = 0; c < (int) splits.size(); c++ )
 	{
-		return UniqueIndices_find_or_insert( self, value );
+		int corner = splits[ c ].corner;
+		_pico_copy_surface_vertex( surface, splits[ c ].source, numVertexes + c );
+		_pico_set_vec( surface->normal[ numVertexes + c ], cx[ corner ], cy[ corner ], cz[ corner ] );
 	}
+	for ( c = 0; c < numVertexes; c++ )
+		if ( owner[ c ] >= 0 ) {
+			_pico_set_vec( surface->normal[ c ], cx[ owner[ c ] ], cy[ owner[ c ] ], cz[ owner[ c ] ] );
+		}
+	for ( const std::pair<int, int> &corner : remap )
+		surface->index[ corner.first ] = corner.second;
+
+	return 1;
 }
 
-class picoSmoothVertices_t
+/* a run of triangles of one surface, handed to one pp_compute_face_normals task */
+class picoFaceRange_t
 {
 public:
-	pmm::vec3_t* xyz;
-	pmm::index_t* smoothingGroups;
+	pmm::surface_t *surface;
+	int first, count;
 };
 
-int lessSmoothVertex( void* data, pmm::index_t first, pmm::index_t second ){
-	picoSmoothVertices_t* smoothVertices = reinterpret_cast<decltype(smoothVertices)>(data);
+/*
+   pmm::pp_compute_face_normals()
+   fills faceNormal and faceDist of every triangle surface in a model,
+   one entry per triangle. all surfaces are cut into runs of triangles
+   that are processed in parallel.
+   returns 1 on success or 0 on error
+ */
 
-	if ( smoothVertices->xyz[first][0] != smoothVertices->xyz[second][0] ) {
-		return smoothVertices->xyz[first][0] < smoothVertices->xyz[second][0];
-	}
-	if ( smoothVertices->xyz[first][1] != smoothVertices->xyz[second][1] ) {
-		return smoothVertices->xyz[first][1] < smoothVertices->xyz[second][1];
-	}
-	if ( smoothVertices->xyz[first][2] != smoothVertices->xyz[second][2] ) {
-		return smoothVertices->xyz[first][2] < smoothVertices->xyz[second][2];
-	}
-	if ( smoothVertices->smoothingGroups[first] != smoothVertices->smoothingGroups[second] ) {
-		return smoothVertices->smoothingGroups[first] < smoothVertices->smoothingGroups[second];
-	}
-	return 0;
-}
+int pmm::pp_compute_face_normals( pmm::model_t *model ){
+	std::vector<picoFaceRange_t> ranges;
+	int i, first;
 
-void _pico_vertices_combine_shared_normals( pmm::vec3_t* xyz, pmm::index_t* smoothingGroups, pmm::vec3_t* normals, pmm::index_t numVertices ){
-	UniqueIndices vertices;
-	IndexArray indices;
-	picoSmoothVertices_t smoothVertices = { xyz, smoothingGroups };
-	UniqueIndices_init( &vertices, lessSmoothVertex, &smoothVertices );
-	UniqueIndices_reserve( &vertices, numVertices );
-	indexarray_reserve( &indices, numVertices );
 
+	/* dummy check */
+	if ( model == nullptr ) {
+		return 0;
+	}
 
+	/* size the face arrays up front, the tasks only write to them */
+	for ( i = 0; i < model->num_surfaces; i++ )
 	{
-		pmm::index_t i = 0;
-		for (; i < numVertices; ++i )
-		{
-			pmm::size_type size = UniqueIndices_size( &vertices );
-			pmm::index_t index = UniqueIndices_insert( &vertices, i );
-			if ( (pmm::size_type)index != size ) {
-				float* normal = normals[vertices.indices.data[index]];
-				_pico_add_vec( normal, normals[i], normal );
-			}
-			indexarray_push_back( &indices, index );
+		pmm::surface_t *surface = model->surface[ i ];
+		if ( surface == nullptr || surface->type != pmm::st_triangles || surface->numIndexes < 3 ) {
+			continue;
+		}
+		int numTriangles = surface->numIndexes / 3;
+		if ( !pmm::pp_adjust_surface( surface, 0, 0, 0, 0, numTriangles ) ) {
+			return 0;
 		}
+		for ( first = 0; first < numTriangles; first += NORMALS_GRAIN )
+			ranges.push_back( { surface, first, numTriangles - first < NORMALS_GRAIN ? numTriangles - first : NORMALS_GRAIN } );
 	}
 
-	{
-		pmm::index_t maxIndex = 0;
-		pmm::index_t* i = indices.data;
-		for (; i != indices.last; ++i )
+	_pico_parallel_for( (int) ranges.size(), 1, [&ranges]( int first, int last ){
+		for ( int i = first; i < last; i++ )
 		{
-			if ( *i <= maxIndex ) {
-				_pico_copy_vec( normals[vertices.indices.data[*i]], normals[i - indices.data] );
-			}
-			else
-			{
-				maxIndex = *i;
-			}
+			pmm::surface_t *surface = ranges[ i ].surface;
+			_pico_calc_face_planes( surface->xyz, surface->numVertexes, surface->index + ranges[ i ].first * 3, ranges[ i ].count,
+									surface->faceNormal + ranges[ i ].first, surface->faceDist + ranges[ i ].first );
 		}
+	} );
+
+	return 1;
+}
+
+/* _pico_perpendicular_vec:
+ *  some unit vector perpendicular to 'normal', (1, 0, 0) if it is zero
+ */
+static void _pico_perpendicular_vec( pmm::vec3_t normal, pmm::vec3_t dest ){
+	pmm::vec3_t axis = { 0, 0, 0 };
+
+	/* cross with the axis the normal is least aligned with */
+	if ( fabs( normal[ 0 ] ) <= fabs( normal[ 1 ] ) && fabs( normal[ 0 ] ) <= fabs( normal[ 2 ] ) ) {
+		axis[ 0 ] = 1;
+	}
+	else if ( fabs( normal[ 1 ] ) <= fabs( normal[ 2 ] ) ) {
+		axis[ 1 ] = 1;
+	}
+	else {
+		axis[ 2 ] = 1;
+	}
+	_pico_cross_vec( normal, axis, dest );
+	if ( _pico_normalize_vec( dest ) == 0 ) {
+		_pico_set_vec( dest, 1, 0, 0 );
 	}
+}
+
+/* _pico_project_unit_vec:
+ *  removes the part of 'vec' along unit vector 'normal' and normalizes
+ *  the rest, returns its length before normalizing
+ */
+static pmm::vec_t _pico_project_unit_vec( pmm::vec3_t vec, pmm::vec3_t normal, pmm::vec3_t dest ){
+	pmm::vec3_t along;
 
-	UniqueIndices_destroy( &vertices );
-	indexarray_clear( &indices );
+	_pico_scale_vec( normal, _pico_dot_vec( normal, vec ), along );
+	_pico_subtract_vec( vec, along, dest );
+	return _pico_normalize_vec( dest );
 }
 
-using picoNormalIter_t = pmm::vec3_t *;
-using picoIndexIter_t = pmm::index_t *;
+/*
+   pmm::pp_generate_tangents()
+   fills surface->tangent from the xyz, normal and st[ stArray ] arrays,
+   following the MikkTSpace conventions: vertices with equal xyz, normal
+   and st are treated as one, every triangle corner adds its st-derived
+   tangent projected onto the vertex normal and weighted by the corner
+   angle, and w holds the bitangent sign, bitangent = w * ( normal x tangent ).
+   frames of opposite st orientation are never averaged; vertices used
+   by both get split. returns 1 on success or 0 on error
+ */
+
+int pmm::pp_generate_tangents( pmm::surface_t *surface, int stArray ){
+	int numVertexes, numTriangles, numCorners, c;
+	std::vector<int> weld;
 
-#define THE_CROSSPRODUCTS_OF_ANY_PAIR_OF_EDGES_OF_A_GIVEN_TRIANGLE_ARE_EQUAL 1
 
-void _pico_triangles_generate_weighted_normals( picoIndexIter_t first, picoIndexIter_t end, pmm::vec3_t* xyz, pmm::vec3_t* normals ){
-	for (; first != end; first += 3 )
-	{
-#if ( THE_CROSSPRODUCTS_OF_ANY_PAIR_OF_EDGES_OF_A_GIVEN_TRIANGLE_ARE_EQUAL )
-		pmm::vec3_t weightedNormal;
-		{
-			float* a = xyz[*( first + 0 )];
-			float* b = xyz[*( first + 1 )];
-			float* c = xyz[*( first + 2 )];
-			pmm::vec3_t ba, ca;
-			_pico_subtract_vec( b, a, ba );
-			_pico_subtract_vec( c, a, ca );
-			_pico_cross_vec( ca, ba, weightedNormal );
-		}
-#endif
+	/* dummy check */
+	if ( surface == nullptr || stArray < 0 || stArray >= surface->numSTArrays ) {
+		return 0;
+	}
+	numVertexes = surface->numVertexes;
+	numTriangles = surface->numIndexes / 3;
+	numCorners = numTriangles * 3;
+	if ( numVertexes <= 0 ) {
+		return 1;
+	}
+	if ( !_pico_expand_compact( surface, "pp_generate_tangents" ) ) {
+		return 0;
+	}
+	pmm::vec2_t *st = surface->st[ stArray ];
+
+	/* vertices that only differ by index share a frame */
+	_pico_group_vertices( numVertexes, weld,
+		[surface, st]( int i ){
+			return _pico_hash_final( _pico_hash_vec2( _pico_hash_vec3( _pico_hash_vec3( 0, surface->xyz[ i ] ), surface->normal[ i ] ), st[ i ] ) );
+		},
+		[surface, st]( int a, int b ){
+			return surface->xyz[ a ][ 0 ] == surface->xyz[ b ][ 0 ] && surface->xyz[ a ][ 1 ] == surface->xyz[ b ][ 1 ] && surface->xyz[ a ][ 2 ] == surface->xyz[ b ][ 2 ] &&
+				   surface->normal[ a ][ 0 ] == surface->normal[ b ][ 0 ] && surface->normal[ a ][ 1 ] == surface->normal[ b ][ 1 ] && surface->normal[ a ][ 2 ] == surface->normal[ b ][ 2 ] &&
+				   st[ a ][ 0 ] == st[ b ][ 0 ] && st[ a ][ 1 ] == st[ b ][ 1 ];
+		} );
+
+	/* corner contributions. orient is 1 for triangles that keep the st
+	   orientation, -1 for mirrored ones and 0 for ones degenerate in st */
+	std::vector<pmm::vec_t> cornerTangents( numCorners * 3 );
+	std::vector<signed char> orient( numTriangles );
+	_pico_parallel_for( numTriangles, NORMALS_GRAIN, [&]( int first, int last ){
+		for ( int i = first; i < last; i++ )
 		{
-			int j = 0;
-			for (; j < 3; ++j )
+			pmm::index_t *index = surface->index + i * 3;
+			pmm::vec3_t d1, d2, os, s1, s2;
+			pmm::vec_t area;
+
+			orient[ i ] = 0;
+			if ( !_pico_triangle_is_valid( surface, i ) ) {
+				continue;
+			}
+			_pico_subtract_vec( surface->xyz[ index[ 1 ] ], surface->xyz[ index[ 0 ] ], d1 );
+			_pico_subtract_vec( surface->xyz[ index[ 2 ] ], surface->xyz[ index[ 0 ] ], d2 );
+			pmm::vec_t t21x = st[ index[ 1 ] ][ 0 ] - st[ index[ 0 ] ][ 0 ], t21y = st[ index[ 1 ] ][ 1 ] - st[ index[ 0 ] ][ 1 ];
+			pmm::vec_t t31x = st[ index[ 2 ] ][ 0 ] - st[ index[ 0 ] ][ 0 ], t31y = st[ index[ 2 ] ][ 1 ] - st[ index[ 0 ] ][ 1 ];
+			area = t21x * t31y - t21y * t31x;
+
+			/* tangent along increasing s, flipped with the st winding */
+			_pico_scale_vec( d1, t31y, s1 );
+			_pico_scale_vec( d2, t21y, s2 );
+			_pico_subtract_vec( s1, s2, os );
+			if ( fabs( area ) < FLT_MIN || _pico_normalize_vec( os ) == 0 ) {
+				continue;
+			}
+			if ( area < 0 ) {
+				_pico_scale_vec( os, -1, os );
+			}
+			orient[ i ] = area > 0 ? 1 : -1;
+
+			for ( int j = 0; j < 3; j++ )
 			{
-				float* normal = normals[*( first + j )];
-#if ( !THE_CROSSPRODUCTS_OF_ANY_PAIR_OF_EDGES_OF_A_GIVEN_TRIANGLE_ARE_EQUAL )
-				pmm::vec3_t weightedNormal;
-				{
-					float* a = xyz[*( first + ( ( j + 0 ) % 3 ) )];
-					float* b = xyz[*( first + ( ( j + 1 ) % 3 ) )];
-					float* c = xyz[*( first + ( ( j + 2 ) % 3 ) )];
-					pmm::vec3_t ba, ca;
-					_pico_subtract_vec( b, a, ba );
-					_pico_subtract_vec( c, a, ca );
-					_pico_cross_vec( ca, ba, weightedNormal );
+				pmm::vec_t *tangent = &cornerTangents[ ( i * 3 + j ) * 3 ];
+				pmm::vec3_t normal, e1, e2;
+				pmm::vec_t dot;
+
+				_pico_copy_vec( surface->normal[ index[ j ] ], normal );
+				_pico_normalize_vec( normal );
+				if ( _pico_project_unit_vec( os, normal, tangent ) == 0 ) {
+					continue;
 				}
-#endif
-				_pico_add_vec( weightedNormal, normal, normal );
+
+				/* weight by the corner angle in the tangent plane */
+				_pico_subtract_vec( surface->xyz[ index[ ( j + 1 ) % 3 ] ], surface->xyz[ index[ j ] ], e1 );
+				_pico_subtract_vec( surface->xyz[ index[ ( j + 2 ) % 3 ] ], surface->xyz[ index[ j ] ], e2 );
+				_pico_project_unit_vec( e1, normal, e1 );
+				_pico_project_unit_vec( e2, normal, e2 );
+				dot = _pico_dot_vec( e1, e2 );
+				_pico_scale_vec( tangent, (pmm::vec_t) acos( dot < -1 ? -1 : dot > 1 ? 1 : dot ), tangent );
 			}
 		}
+	} );
+
+	/* sum per welded vertex and orientation, in corner order */
+	std::vector<pmm::vec_t> sums( numVertexes * 2 * 3 );
+	pmm::vec_t *sx = sums.data(), *sy = sx + numVertexes * 2, *sz = sy + numVertexes * 2;
+	for ( c = 0; c < numCorners; c++ )
+		if ( orient[ c / 3 ] != 0 ) {
+			int key = weld[ surface->index[ c ] ] * 2 + ( orient[ c / 3 ] > 0 );
+			sx[ key ] += cornerTangents[ c * 3 + 0 ];
+			sy[ key ] += cornerTangents[ c * 3 + 1 ];
+			sz[ key ] += cornerTangents[ c * 3 + 2 ];
+		}
+	_pico_normalize_vecs( sx, sy, sz, numVertexes * 2 );
+
+	/* a vertex takes the orientation of its first corner, corners of the
+	   other orientation move to a split copy of it */
+	std::vector<signed char> vertexOrient( numVertexes, 0 );
+	std::vector<int> flipped( numVertexes, -1 ), splits;
+	std::vector<std::pair<int, int>> remap;
+	for ( c = 0; c < numCorners; c++ )
+	{
+		int o = orient[ c / 3 ], v = surface->index[ c ];
+		if ( o == 0 ) {
+			continue;
+		}
+		if ( vertexOrient[ v ] == 0 ) {
+			vertexOrient[ v ] = o;
+		}
+		else if ( vertexOrient[ v ] != o ) {
+			if ( flipped[ v ] < 0 ) {
+				flipped[ v ] = numVertexes + (int) splits.size();
+				splits.push_back( v );
+			}
+			remap.emplace_back( c, flipped[ v ] );
+		}
 	}
-}
 
-void _pico_normals_zero( picoNormalIter_t first, picoNormalIter_t last ){
-	for (; first != last; ++first )
-	{
-		_pico_zero_vec( *first );
+	/* allocate the tangents, pp_adjust_surface keeps them sized from here on */
+	if ( surface->tangent == nullptr ) {
+		surface->tangent = reinterpret_cast<decltype(surface->tangent)>(pmm::man.pp_k_new( surface->maxVertexes, sizeof( *surface->tangent ) ));
+		if ( surface->tangent == nullptr ) {
+			return 0;
+		}
+	}
+	if ( !splits.empty() && !pmm::pp_adjust_surface( surface, numVertexes + (int) splits.size(), 0, 0, 0, 0 ) ) {
+		return 0;
 	}
-}
 
-void _pico_normals_normalize( picoNormalIter_t first, picoNormalIter_t last ){
-	for (; first != last; ++first )
+	/* write the frames */
+	auto setTangent = [&]( int dest, int src, int o ){
+		int key = weld[ src ] * 2 + ( o > 0 );
+		pmm::vec_t *tangent = surface->tangent[ dest ];
+		_pico_set_vec( tangent, sx[ key ], sy[ key ], sz[ key ] );
+		if ( tangent[ 0 ] == 0 && tangent[ 1 ] == 0 && tangent[ 2 ] == 0 ) {
+			pmm::vec3_t normal;
+			_pico_copy_vec( surface->normal[ src ], normal );
+			_pico_perpendicular_vec( normal, tangent );
+		}
+		tangent[ 3 ] = o < 0 ? -1.0f : 1.0f;
+	};
+	for ( c = 0; c < (int) splits.size(); c++ )
 	{
-		_pico_normalize_vec( *first );
+		_pico_copy_surface_vertex( surface, splits[ c ], numVertexes + c );
+		setTangent( numVertexes + c, splits[ c ], -vertexOrient[ splits[ c ] ] );
 	}
-}
+	for ( c = 0; c < numVertexes; c++ )
+		setTangent( c, c, vertexOrient[ c ] );
+	for ( const std::pair<int, int> &corner : remap )
+		surface->index[ corner.first ] = corner.second;
 
-double _pico_length_vec( pmm::vec3_t vec ){
-	return sqrt( vec[ 0 ] * vec[ 0 ] + vec[ 1 ] * vec[ 1 ] + vec[ 2 ] * vec[ 2 ] );
+	return 1;
 }
 
-#define NORMAL_UNIT_LENGTH_EPSILON 0.01
-#define FLOAT_EQUAL_EPSILON( f, other, epsilon ) ( fabs( f - other ) < epsilon )
-
-int _pico_normal_is_unit_length( pmm::vec3_t normal ){
-	return FLOAT_EQUAL_EPSILON( _pico_length_vec( normal ), 1.0, NORMAL_UNIT_LENGTH_EPSILON );
-}
+/*
+   pmm::pp_generate_model_tangents()
+   runs pp_generate_tangents on every triangle surface of a model that
+   has st array 'stArray', surfaces in parallel.
+   returns 1 on success or 0 on error
+ */
 
-int _pico_normal_within_tolerance( pmm::vec3_t normal, pmm::vec3_t other ){
-	return _pico_dot_vec( normal, other ) > 0.0f;
-}
+int pmm::pp_generate_model_tangents( pmm::model_t *model, int stArray ){
+	int i;
 
 
-void _pico_normals_assign_generated_normals( picoNormalIter_t first, picoNormalIter_t last, picoNormalIter_t generated ){
-	for (; first != last; ++first, ++generated )
-	{
-		if ( !_pico_normal_is_unit_length( *first ) || !_pico_normal_within_tolerance( *first, *generated ) ) {
-			_pico_copy_vec( *generated, *first );
-		}
+	/* dummy check */
+	if ( model == nullptr ) {
+		return 0;
 	}
-}
-
-void pmm::pp_fix_surface_normals( pmm::surface_t* surface ){
-	pmm::vec3_t* normals = (pmm::vec3_t*)pmm::man.pp_k_new( surface->numVertexes, sizeof( pmm::vec3_t ) );
 
-	_pico_normals_zero( normals, normals + surface->numVertexes );
-
-	_pico_triangles_generate_weighted_normals( surface->index, surface->index + surface->numIndexes, surface->xyz, normals );
-	_pico_vertices_combine_shared_normals( surface->xyz, surface->smoothingGroup, normals, surface->numVertexes );
-
-	_pico_normals_normalize( normals, normals + surface->numVertexes );
-
-	_pico_normals_assign_generated_normals( surface->normal, surface->normal + surface->numVertexes, normals );
+	std::vector<int> results( model->num_surfaces, 1 );
+	_pico_parallel_for( model->num_surfaces, 1, [model, stArray, &results]( int first, int last ){
+		for ( int i = first; i < last; i++ )
+		{
+			pmm::surface_t *surface = model->surface[ i ];
+			if ( surface != nullptr && surface->type == pmm::st_triangles && stArray < surface->numSTArrays ) {
+				results[ i ] = pmm::pp_generate_tangents( surface, stArray );
+			}
+		}
+	} );
 
-	pmm::man.pp_m_delete( normals );
+	for ( i = 0; i < model->num_surfaces; i++ )
+		if ( !results[ i ] ) {
+			return 0;
+		}
+	return 1;
 }
 
 
@@ -2235,6 +3963,25 @@ int pmm::pp_remap_model( pmm::model_t *model, char *remapFile ){
 }
 
 
+/* _pico_new_triangle_surface:
+ *  creates the surface triangles using 'shader' (and 'name') are added to
+ */
+pmm::surface_t *_pico_new_triangle_surface( pmm::model_t *model, pmm::shader_t *shader, const char *name ){
+	/* create a new surface in the model for the unique shader */
+	pmm::surface_t *workSurface = pmm::pp_new_surface( model );
+	if ( !workSurface ) {
+		pmm::man.pp_print(pmm::pl_error, "Could not allocate a new surface!\n");
+		return nullptr;
+	}
+
+	/* do surface setup */
+	pmm::pp_set_surface_type( workSurface, pmm::st_triangles );
+	pmm::pp_set_surface_name( workSurface, name ? name : shader->name );
+	pmm::pp_set_surface_shader( workSurface, shader );
+
+	return workSurface;
+}
+
 /*
    pmm::pp_add_triangle_to_model() - jhefty
    A nice way to add individual triangles to the model.
@@ -2246,32 +3993,17 @@ void pmm::pp_add_triangle_to_model( pmm::model_t *model, pmm::vec3_t** xyz, pmm:
 							 pmm::shader_t* shader, const char *name, pmm::index_t* smoothingGroup ){
 	int i,j;
 	int vertDataIndex;
-	pmm::surface_t* workSurface = nullptr;
+	pmm::surface_t* workSurface;
 
 	/* see if a surface already has the shader */
-	for ( i = 0 ; i < model->num_surfaces ; i++ )
-	{
-		workSurface = model->surface[i];
-		if ( !name || !strcmp( workSurface->name, name ) ) {
-			if ( workSurface->shader == shader ) {
-				break;
-			}
-		}
-	}
+	workSurface = _pico_find_triangle_surface( model, shader, name );
 
 	/* no surface uses this shader yet, so create a new surface */
-	if ( !workSurface || i >= model->num_surfaces ) {
-		/* create a new surface in the model for the unique shader */
-		workSurface = pmm::pp_new_surface( model );
+	if ( !workSurface ) {
+		workSurface = _pico_new_triangle_surface( model, shader, name );
 		if ( !workSurface ) {
-			pmm::man.pp_print(pmm::pl_error, "Could not allocate a new surface!\n");
 			return;
 		}
-
-		/* do surface setup */
-		pmm::pp_set_surface_type( workSurface, pmm::st_triangles );
-		pmm::pp_set_surface_name( workSurface, name ? name : shader->name );
-		pmm::pp_set_surface_shader( workSurface, shader );
 	}
 
 	/* add the triangle data to the surface */
@@ -2309,3 +4041,145 @@ void pmm::pp_add_triangle_to_model( pmm::model_t *model, pmm::vec3_t** xyz, pmm:
 		pmm::pp_set_surface_index( workSurface, newVertIndex, vertDataIndex );
 	}
 }
+
+
+
+/*
+   pmm::pp_add_triangles_to_model()
+   adds a batch of triangles, with the same result as passing them to
+   pp_add_triangle_to_model() one by one. xyz, normals and smoothingGroups
+   hold 3 entries per triangle, st and colors hold numSTs resp. numColors
+   entries per triangle corner. triangle i uses shaders[ shaderNums[ i ] ]
+   (shaders[ 0 ] if shaderNums is nullptr). triangles are partitioned by
+   shader first, so each surface is looked up once and gets its vertices
+   welded and its indices appended in one go.
+ */
+
+void pmm::pp_add_triangles_to_model( pmm::model_t *model, int numTriangles, pmm::vec3_t *xyz, pmm::vec3_t *normals,
+							  int numSTs, pmm::vec2_t *st, int numColors, pmm::color_t *colors, pmm::index_t *smoothingGroups,
+							  int numShaders, pmm::shader_t **shaders, int *shaderNums, const char *name ){
+	pmm::vec3_t zeroNormal = { 0, 0, 0 };
+	int i, j, t, numSkipped;
+
+
+	/* dummy check */
+	if ( model == nullptr || numTriangles <= 0 || xyz == nullptr || numShaders <= 0 || shaders == nullptr ) {
+		return;
+	}
+	if ( st == nullptr || numSTs < 0 ) {
+		numSTs = 0;
+	}
+	if ( colors == nullptr || numColors < 0 ) {
+		numColors = 0;
+	}
+
+	/* partition triangles by shader with a stable counting sort */
+	std::vector<int> bucketStart( numShaders + 1, 0 ), firstUse( numShaders, numTriangles ), order( numTriangles );
+	numSkipped = 0;
+	for ( t = 0; t < numTriangles; t++ )
+	{
+		int shaderNum = shaderNums ? shaderNums[ t ] : 0;
+		if ( shaderNum < 0 || shaderNum >= numShaders || shaders[ shaderNum ] == nullptr ) {
+			numSkipped++;
+			continue;
+		}
+		bucketStart[ shaderNum + 1 ]++;
+		firstUse[ shaderNum ] = std::min( firstUse[ shaderNum ], t );
+	}
+	for ( i = 0; i < numShaders; i++ )
+		bucketStart[ i + 1 ] += bucketStart[ i ];
+	{
+		std::vector<int> next( bucketStart.begin(), bucketStart.end() - 1 );
+		for ( t = 0; t < numTriangles; t++ )
+		{
+			int shaderNum = shaderNums ? shaderNums[ t ] : 0;
+			if ( shaderNum >= 0 && shaderNum < numShaders && shaders[ shaderNum ] != nullptr ) {
+				order[ next[ shaderNum ]++ ] = t;
+			}
+		}
+	}
+	if ( numSkipped > 0 ) {
+		pmm::man.pp_print( pmm::pl_warning, ( std::ostringstream{} << "pp_add_triangles_to_model: skipped " << numSkipped << " triangles with an invalid shader\n" ).str() );
+	}
+
+	/* visit shaders in order of first use, so surfaces get created in the same order */
+	std::vector<int> shaderOrder;
+	for ( i = 0; i < numShaders; i++ )
+		if ( bucketStart[ i + 1 ] > bucketStart[ i ] ) {
+			shaderOrder.push_back( i );
+		}
+	std::sort( shaderOrder.begin(), shaderOrder.end(), [&firstUse]( int a, int b ){ return firstUse[ a ] < firstUse[ b ]; } );
+
+	std::vector<pmm::index_t> indices;
+	for ( int shaderNum : shaderOrder )
+	{
+		pmm::shader_t *shader = shaders[ shaderNum ];
+		pmm::surface_t *workSurface;
+		pmm::pp_vertex_index_t *vertexIndex;
+		int numIndexes;
+
+		/* find or create the surface for this shader */
+		workSurface = _pico_find_triangle_surface( model, shader, name );
+		if ( !workSurface ) {
+			workSurface = _pico_new_triangle_surface( model, shader, name );
+			if ( !workSurface ) {
+				return;
+			}
+		}
+		if ( !_pico_expand_compact( workSurface, "pp_add_triangles_to_model" ) ) {
+			return;
+		}
+		numIndexes = workSurface->numIndexes;
+		vertexIndex = _pico_update_vertex_index( workSurface, numSTs, numColors );
+		if ( vertexIndex == nullptr ) {
+			pmm::man.pp_print( pmm::pl_error, "pp_add_triangles_to_model: could not index surface\n" );
+			return;
+		}
+
+		/* weld corners against the vertex pool, appending new vertices as they come */
+		indices.clear();
+		for ( j = bucketStart[ shaderNum ]; j < bucketStart[ shaderNum + 1 ]; j++ )
+		{
+			for ( i = order[ j ] * 3; i < order[ j ] * 3 + 3; i++ )
+			{
+				pmm::vec_t *normal = normals ? normals[ i ] : zeroNormal;
+				pmm::vec2_t *cornerST = st + i * numSTs;
+				pmm::color_t *cornerColor = colors + i * numColors;
+				pmm::index_t smoothingGroup = smoothingGroups ? smoothingGroups[ i ] : 0;
+				unsigned int hash = _pico_query_vertex_hash( xyz[ i ], normal, numSTs, cornerST, numColors, cornerColor, smoothingGroup );
+				int vertDataIndex = _pico_vertex_index_find( vertexIndex, workSurface, hash, xyz[ i ], normal, numSTs, cornerST, numColors, cornerColor, smoothingGroup );
+
+				if ( vertDataIndex == -1 ) {
+					int k;
+
+					vertDataIndex = workSurface->numVertexes;
+					if ( !pmm::pp_adjust_surface( workSurface, vertDataIndex + 1, numSTs, numColors, 0, 0 ) ) {
+						pmm::man.pp_print( pmm::pl_error, "pp_add_triangles_to_model: could not grow surface\n" );
+						return;
+					}
+					_pico_copy_vec( xyz[ i ], workSurface->xyz[ vertDataIndex ] );
+					_pico_copy_vec( normal, workSurface->normal[ vertDataIndex ] );
+					for ( k = 0; k < numSTs; k++ )
+						_pico_copy_vec2( cornerST[ k ], workSurface->st[ k ][ vertDataIndex ] );
+					for ( k = 0; k < numColors; k++ )
+						_pico_copy_color( cornerColor[ k ], workSurface->color[ k ][ vertDataIndex ] );
+					if ( smoothingGroup != 0 || workSurface->smoothingGroup != nullptr ) {
+						if ( !_pico_alloc_smoothing_groups( workSurface ) ) {
+							pmm::man.pp_print( pmm::pl_error, "pp_add_triangles_to_model: could not grow surface\n" );
+							return;
+						}
+						workSurface->smoothingGroup[ vertDataIndex ] = smoothingGroup;
+					}
+
+					_pico_vertex_index_insert( vertexIndex, hash, vertDataIndex );
+					vertexIndex->numIndexed++;
+				}
+
+				indices.push_back( vertDataIndex );
+			}
+		}
+
+		/* append this surface's indices */
+		pmm::pp_set_surface_indices( workSurface, numIndexes, indices.data(), (int) indices.size() );
+	}
+}
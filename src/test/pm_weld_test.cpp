@@ -0,0 +1,260 @@
+/* -----------------------------------------------------------------------------
+
+   PicoModel Library
+
+   Copyright (c) 2002, Randy Reddig & seaw0lf
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification,
+   are permitted provided that the following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list
+   of conditions and the following disclaimer.
+
+   Redistributions in binary form must reproduce the above copyright notice, this
+   list of conditions and the following disclaimer in the documentation and/or
+   other materials provided with the distribution.
+
+   Neither the names of the copyright holders nor the names of its contributors may
+   be used to endorse or promote products derived from this software without
+   specific prior written permission.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+   ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+   ANY DIRECT, INDIRECT, INCidentAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+   (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+   LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+   ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   ----------------------------------------------------------------------------- */
+
+/* vertex combination hash table (weld) test */
+
+#include <pmpmesh/pmpmesh.hpp>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+/* default weld tolerances, see pp_set_vertex_combination_tolerances() */
+static const float XYZ_EPSILON    = 0.01f;
+static const float NORMAL_EPSILON = 0.02f;
+static const float ST_EPSILON     = 0.0001f;
+
+class weld_vertex_t
+{
+public:
+	pmm::vec3_t xyz, normal, st;
+	pmm::color_t color;
+};
+
+static int numFailed = 0;
+
+static void check( bool ok, const char *what ){
+	if ( !ok ) {
+		std::printf( "FAILED: %s\n", what );
+		numFailed++;
+	}
+}
+
+static weld_vertex_t make_vertex( float x, float y, float z ){
+	weld_vertex_t v{};
+
+	v.xyz[ 0 ] = x;
+	v.xyz[ 1 ] = y;
+	v.xyz[ 2 ] = z;
+	v.normal[ 2 ] = 1.0f;
+	memset( v.color, 255, sizeof( v.color ) );
+	return v;
+}
+
+static pmm::pp_vertex_comnination_hash_t *find( pmm::pp_vertex_combination_hash_table_t *hashTable, weld_vertex_t &v ){
+	return pmm::pp_find_vertex_combination_in_hash_table( hashTable, v.xyz, v.normal, v.st, v.color );
+}
+
+static pmm::pp_vertex_comnination_hash_t *add( pmm::pp_vertex_combination_hash_table_t *hashTable, weld_vertex_t &v, pmm::index_t index ){
+	return pmm::pp_add_vertex_combination_to_hash_table( hashTable, v.xyz, v.normal, v.st, v.color, index );
+}
+
+/* brute force weld, same rules as the table: per component tolerances, */
+/* equal colors, first added match wins */
+static int brute_force_find( const std::vector<weld_vertex_t> &added, const weld_vertex_t &v ){
+	for ( size_t i = 0; i < added.size(); i++ )
+	{
+		const weld_vertex_t &a = added[ i ];
+		bool ok = true;
+
+		for ( int j = 0; j < 3; j++ )
+			ok = ok && fabs( v.xyz[ j ] - a.xyz[ j ] ) <= XYZ_EPSILON && fabs( v.normal[ j ] - a.normal[ j ] ) <= NORMAL_EPSILON;
+		for ( int j = 0; j < 2; j++ )
+			ok = ok && fabs( v.st[ j ] - a.st[ j ] ) <= ST_EPSILON;
+		if ( ok && !memcmp( v.color, a.color, sizeof( v.color ) ) ) {
+			return (int) i;
+		}
+	}
+	return -1;
+}
+
+/* vertices within epsilon on either side of a cell boundary weld */
+static void test_cell_boundary(){
+	/* cells are 2 * epsilon wide, so these are all cell boundaries */
+	const float boundaries[] = { 0.0f, 2.0f * XYZ_EPSILON, -2.0f * XYZ_EPSILON, 1000.0f * XYZ_EPSILON };
+	pmm::pp_vertex_combination_hash_table_t *hashTable = pmm::pp_new_vertex_combination_hash_table();
+
+	check( hashTable != nullptr, "new hash table" );
+	if ( hashTable == nullptr ) {
+		return;
+	}
+
+	for ( float boundary : boundaries )
+	{
+		for ( int axis = 0; axis < 3; axis++ )
+		{
+			weld_vertex_t below = make_vertex( 0.5f, 0.5f, 0.5f ), above = below;
+
+			below.xyz[ axis ] = boundary - 0.45f * XYZ_EPSILON;
+			above.xyz[ axis ] = boundary + 0.45f * XYZ_EPSILON;
+			check( pmm::pp_vertex_coord_generate_hash( below.xyz ) != pmm::pp_vertex_coord_generate_hash( above.xyz ), "boundary vertices hash to different cells" );
+
+			/* both directions */
+			pmm::pp_clear_vertex_combination_hash_table( hashTable );
+			add( hashTable, below, 1 );
+			pmm::pp_vertex_comnination_hash_t *hit = find( hashTable, above );
+			check( hit != nullptr && hit->index == 1, "vertex above a cell boundary welds to one below" );
+
+			pmm::pp_clear_vertex_combination_hash_table( hashTable );
+			add( hashTable, above, 2 );
+			hit = find( hashTable, below );
+			check( hit != nullptr && hit->index == 2, "vertex below a cell boundary welds to one above" );
+		}
+	}
+
+	pmm::pp_free_vertex_combination_hash_table( hashTable );
+}
+
+/* vertices just outside any one tolerance don't weld */
+static void test_tolerances(){
+	pmm::pp_vertex_combination_hash_table_t *hashTable = pmm::pp_new_vertex_combination_hash_table();
+	weld_vertex_t base = make_vertex( 0.25f, -0.5f, 3.0f ), v;
+
+	check( hashTable != nullptr, "new hash table" );
+	if ( hashTable == nullptr ) {
+		return;
+	}
+	base.st[ 0 ] = 0.5f;
+	base.st[ 1 ] = 0.25f;
+	add( hashTable, base, 0 );
+
+	for ( int axis = 0; axis < 3; axis++ )
+	{
+		v = base;
+		v.xyz[ axis ] += 0.9f * XYZ_EPSILON;
+		check( find( hashTable, v ) != nullptr, "xyz just inside tolerance welds" );
+		v = base;
+		v.xyz[ axis ] += 1.1f * XYZ_EPSILON;
+		check( find( hashTable, v ) == nullptr, "xyz just outside tolerance doesn't weld" );
+		v = base;
+		v.xyz[ axis ] -= 1.1f * XYZ_EPSILON;
+		check( find( hashTable, v ) == nullptr, "xyz just outside tolerance doesn't weld" );
+
+		v = base;
+		v.normal[ axis ] += 0.9f * NORMAL_EPSILON;
+		check( find( hashTable, v ) != nullptr, "normal just inside tolerance welds" );
+		v = base;
+		v.normal[ axis ] -= 1.1f * NORMAL_EPSILON;
+		check( find( hashTable, v ) == nullptr, "normal just outside tolerance doesn't weld" );
+	}
+
+	for ( int axis = 0; axis < 2; axis++ )
+	{
+		v = base;
+		v.st[ axis ] += 0.9f * ST_EPSILON;
+		check( find( hashTable, v ) != nullptr, "st just inside tolerance welds" );
+		v = base;
+		v.st[ axis ] += 1.1f * ST_EPSILON;
+		check( find( hashTable, v ) == nullptr, "st just outside tolerance doesn't weld" );
+	}
+
+	v = base;
+	v.color[ 3 ] = 254;
+	check( find( hashTable, v ) == nullptr, "different colors don't weld" );
+
+	pmm::pp_free_vertex_combination_hash_table( hashTable );
+}
+
+/* hashed weld matches an O(n^2) weld on a randomized cloud */
+static void test_random_cloud(){
+	pmm::pp_vertex_combination_hash_table_t *hashTable = pmm::pp_new_vertex_combination_hash_table();
+	std::mt19937 rng( 1234 );
+	std::uniform_real_distribution<float> position( -1.0f, 1.0f ), jitter( -1.5f * XYZ_EPSILON, 1.5f * XYZ_EPSILON );
+	std::uniform_real_distribution<float> normalJitter( -1.5f * NORMAL_EPSILON, 1.5f * NORMAL_EPSILON ), stJitter( -1.5f * ST_EPSILON, 1.5f * ST_EPSILON );
+	std::vector<weld_vertex_t> added;
+	int numMismatches = 0;
+
+	check( hashTable != nullptr, "new hash table" );
+	if ( hashTable == nullptr ) {
+		return;
+	}
+
+	for ( int i = 0; i < 6000; i++ )
+	{
+		weld_vertex_t v;
+
+		/* near copies of earlier vertices, so welds straddle cells and tolerances */
+		if ( !added.empty() && rng() % 2 ) {
+			v = added[ rng() % added.size() ];
+			for ( int j = 0; j < 3; j++ )
+			{
+				v.xyz[ j ] += jitter( rng );
+				if ( rng() % 4 == 0 ) {
+					v.normal[ j ] += normalJitter( rng );
+				}
+			}
+			if ( rng() % 4 == 0 ) {
+				v.st[ rng() % 2 ] += stJitter( rng );
+			}
+			if ( rng() % 16 == 0 ) {
+				v.color[ 0 ] ^= 1;
+			}
+		}
+		else{
+			v = make_vertex( position( rng ), position( rng ), position( rng ) );
+		}
+
+		const int expected = brute_force_find( added, v );
+		pmm::pp_vertex_comnination_hash_t *hit = find( hashTable, v );
+		if ( ( hit ? (int) hit->index : -1 ) != expected ) {
+			numMismatches++;
+		}
+
+		if ( expected < 0 ) {
+			check( add( hashTable, v, (pmm::index_t) added.size() ) != nullptr, "add vertex" );
+			added.push_back( v );
+		}
+	}
+
+	if ( numMismatches ) {
+		std::printf( "%d of 6000 lookups differ from the brute force weld\n", numMismatches );
+	}
+	check( numMismatches == 0, "hashed weld matches brute force weld" );
+
+	pmm::pp_free_vertex_combination_hash_table( hashTable );
+}
+
+int main(){
+	test_cell_boundary();
+	test_tolerances();
+	test_random_cloud();
+
+	if ( numFailed ) {
+		std::printf( "%d checks failed\n", numFailed );
+		return 1;
+	}
+	std::printf( "weld test passed\n" );
+	return 0;
+}